@@ -0,0 +1,31 @@
+# Helpers of the benchmarks, sourced by bench/*_bench.sh.
+# ASSEMBLER and SIMULATOR select the builds to measure (for instance an
+# older build, to compare), and BENCH_RUNS how many times each command
+# runs (the best time is printed).
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+SIMULATOR=${SIMULATOR:-./simulator}
+BENCH_RUNS=${BENCH_RUNS:-3}
+WORK_DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+# Runs a command BENCH_RUNS times (without its output) and prints the best
+# time in milliseconds: measure LABEL COMMAND [ARGUMENT...]
+measure()
+{
+    label=$1
+    shift
+    best=
+    run=0
+    while [ $run -lt "$BENCH_RUNS" ]; do
+        start=$(date +%s%N)
+        "$@" > /dev/null 2>&1
+        end=$(date +%s%N)
+        elapsed=$(((end - start) / 1000000))
+        if [ -z "$best" ] || [ $elapsed -lt $best ]; then
+            best=$elapsed
+        fi
+        run=$((run + 1))
+    done
+    printf '  %-48s %8d ms\n' "$label" "$best"
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+# A program far over the 1000 words the segments once had: about 2.1M
+# code words and 2.05M data words, with a label each line, in some 34 MB
+# of source. The maximum resident set size is printed with GNU time.
+# Run from the repository root after 'make' (or through 'make bench').
+
+. bench/common.sh
+
+awk 'BEGIN {
+    print "MAIN: mov r1, r2"
+    for (i = 1; i < 1050000; ++i)
+    {
+        printf "LABEL%d: mov r%d, r%d\n", i, i % 8 + 1, (i + 3) % 8 + 1
+    }
+    for (i = 0; i < 205000; ++i)
+    {
+        printf "DATA%d: .data %d, -%d, %d, %d, %d, %d, %d, %d, %d, %d\n", i, i, i, 1, 2, 3, 4, 5, 6, 7, 8
+    }
+    print "stop"
+}' > "$WORK_DIR/large.as"
+
+echo "large_program_bench: $(($(wc -c < "$WORK_DIR/large.as") / 1048576)) MB of source"
+measure "assembly" "$ASSEMBLER" "$WORK_DIR/large"
+
+# The peak memory, where GNU time is installed
+if [ -x /usr/bin/time ] && /usr/bin/time -f '%M' true > /dev/null 2>&1; then
+    /usr/bin/time -f '  maximum resident set size: %M KB' "$ASSEMBLER" "$WORK_DIR/large" 2>&1 > /dev/null |
+        grep 'maximum resident'
+fi
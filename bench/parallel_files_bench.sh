@@ -0,0 +1,31 @@
+#!/bin/sh
+# Assembling many files with -j: 128 generated programs of 1200 lines,
+# assembled one after another and on 4 workers and one per processor.
+# Run from the repository root after 'make' (or through 'make bench').
+
+. bench/common.sh
+
+NUM_OF_FILES=128
+
+i=0
+files=
+while [ $i -lt $NUM_OF_FILES ]; do
+    awk -v seed=$i 'BEGIN {
+        print ".define sz=2"
+        print "MAIN: mov r3, LIST[sz]"
+        for (line = 0; line < 600; ++line)
+        {
+            printf "L%d: add LIST[%d], r%d\n", line, (line + seed) % 3, line % 8 + 1
+            printf "bne L%d\n", (line * 7) % 600
+        }
+        print "stop"
+        print "LIST: .data 6, -9, 4"
+    }' > "$WORK_DIR/program$i.as"
+    files="$files $WORK_DIR/program$i"
+    i=$((i + 1))
+done
+
+echo "parallel_files_bench: $NUM_OF_FILES files on $(nproc 2> /dev/null || echo ?) processors"
+measure "-j 1" "$ASSEMBLER" -j 1 $files
+measure "-j 4" "$ASSEMBLER" -j 4 $files
+measure "-j 0 (one worker per processor)" "$ASSEMBLER" -j 0 $files
@@ -0,0 +1,33 @@
+#!/bin/sh
+# A single large source scanned in parallel chunks (-j N): a generated
+# program of some 6.5 MB, assembled sequentially and with 2, 4 and 8
+# threads. The parallel scan needs several processors to gain.
+# Run from the repository root after 'make' (or through 'make bench').
+
+. bench/common.sh
+
+awk -v n=130000 'BEGIN {
+    print ".define sz=2"
+    print ".extern EXT"
+    print ".entry MAIN"
+    print "MAIN: mov r3, LIST[sz]"
+    for (i = 0; i < n; ++i)
+    {
+        printf "L%d: add LIST[%d], r%d\n", i, i % 3, i % 8 + 1
+        printf "cmp #%d, D%d\n", i % 1000, i % (n / 20)
+        printf "bne L%d\n", (i * 7) % n
+        if (0 == i % 20)
+        {
+            printf "D%d: .data %d, -%d, %d\n", i / 20, i, i, i % 7
+            printf "jsr EXT\n"
+        }
+    }
+    print "stop"
+    print "LIST: .data 6, -9, 4"
+}' > "$WORK_DIR/large.as"
+
+echo "parallel_scan_bench: $(($(wc -c < "$WORK_DIR/large.as") / 1024)) KB of source on $(nproc 2> /dev/null || echo ?) processors"
+measure "sequential" "$ASSEMBLER" "$WORK_DIR/large"
+for threads in 2 4 8; do
+    measure "-j $threads" "$ASSEMBLER" -j $threads "$WORK_DIR/large"
+done
@@ -0,0 +1,46 @@
+#!/bin/sh
+# The assembly server (-d) against a process per file: 2000 assemblies of
+# tests/test1.as, by a process each, by a client process each (-c), and by
+# one client for all of them.
+# Run from the repository root after 'make' (or through 'make bench').
+
+. bench/common.sh
+
+NUM_OF_FILES=2000
+SOCKET="$WORK_DIR/assembler.sock"
+
+i=0
+files=
+while [ $i -lt $NUM_OF_FILES ]; do
+    cp tests/test1.as "$WORK_DIR/test$i.as"
+    files="$files $WORK_DIR/test$i"
+    i=$((i + 1))
+done
+
+process_per_file()
+{
+    for file in $files; do
+        "$ASSEMBLER" "$file"
+    done
+}
+
+client_per_file()
+{
+    for file in $files; do
+        "$ASSEMBLER" -c "$SOCKET" "$file"
+    done
+}
+
+"$ASSEMBLER" -d "$SOCKET" 2> /dev/null &
+server=$!
+trap 'kill $server 2> /dev/null; rm -rf "$WORK_DIR"' EXIT
+tries=0
+while [ ! -S "$SOCKET" ] && [ $tries -lt 50 ]; do
+    sleep 0.1
+    tries=$((tries + 1))
+done
+
+echo "server_bench: $NUM_OF_FILES assemblies of tests/test1.as"
+measure "./assembler per file" process_per_file
+measure "./assembler -c per file" client_per_file
+measure "one ./assembler -c for all files" "$ASSEMBLER" -c "$SOCKET" $files
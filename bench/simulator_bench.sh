@@ -0,0 +1,59 @@
+#!/bin/sh
+# The simulator on loops of 36M steps: one on registers and one on
+# indexed memory operands, run from the micro-op cache, decoding every
+# step (-d) and with the JIT (-j).
+# Run from the repository root after 'make' (or through 'make bench').
+
+. bench/common.sh
+
+cat > "$WORK_DIR/registers.as" << 'END'
+MAIN:   mov     OUTER, r1
+NEXT:   mov     #1500, r2
+LOOP:   add     r3, r4
+        dec     r2
+        cmp     r2, #0
+        bne     LOOP
+        dec     r1
+        cmp     r1, #0
+        bne     NEXT
+        stop
+OUTER:  .data   6000
+END
+
+cat > "$WORK_DIR/memory.as" << 'END'
+MAIN:   mov     OUTER, r1
+NEXT:   mov     #1500, COUNT
+LOOP:   add     ARR[1], ARR[2]
+        dec     COUNT
+        cmp     COUNT, #0
+        bne     LOOP
+        dec     r1
+        cmp     r1, #0
+        bne     NEXT
+        stop
+OUTER:  .data   6000
+COUNT:  .data   0
+ARR:    .data   1, 2, 3
+END
+
+# Prints the best speed of BENCH_RUNS runs, as '-t' reports it:
+# steps_per_second LABEL SIMULATOR_ARGUMENT...
+steps_per_second()
+{
+    label=$1
+    shift
+    run=0
+    while [ $run -lt "$BENCH_RUNS" ]; do
+        "$SIMULATOR" -t "$@" 2>&1 > /dev/null
+        run=$((run + 1))
+    done | sed -n 's/.*(\([0-9.]*\) million steps per second).*/\1/p' |
+        sort -n | tail -n 1 | xargs printf '  %-48s %8s Msteps/s\n' "$label"
+}
+
+echo "simulator_bench: loops of 36M steps"
+for program in registers memory; do
+    "$ASSEMBLER" "$WORK_DIR/$program"
+    steps_per_second "$program, micro-op cache" "$WORK_DIR/$program"
+    steps_per_second "$program, decoding every step (-d)" -d "$WORK_DIR/$program"
+    steps_per_second "$program, JIT (-j)" -j "$WORK_DIR/$program"
+done
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Symbol table scaling: files of n .define lines and one use of the first
+# name, assembled for n from 1k to 1M.
+# Run from the repository root after 'make' (or through 'make bench').
+
+. bench/common.sh
+
+echo "symbol_table_bench: n .define lines"
+for n in 1000 10000 100000 1000000; do
+    awk -v n=$n 'BEGIN {
+        for (i = 1; i <= n; ++i) printf ".define S%d=%d\n", i, i % 1000
+        print "MAIN: mov #S1, r1"
+        print "stop"
+    }' > "$WORK_DIR/defines.as"
+    measure "n=$n" "$ASSEMBLER" "$WORK_DIR/defines"
+done
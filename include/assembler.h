@@ -0,0 +1,44 @@
+/****************************************
+* ASSEMBLER: assembler.h                *
+****************************************/
+
+#ifndef ASSEMBLER_ASSEMBLER_H
+#define ASSEMBLER_ASSEMBLER_H
+
+#include <stddef.h> /* size_t */
+
+/* Public interface of libassembler: assembles a source held in memory
+ * without touching the filesystem. The library has no global mutable state,
+ * so any number of assemblies may run at the same time on different
+ * threads. */
+
+#define ASSEMBLY_STARTING_ADDRESS (100)
+
+typedef struct
+{
+    const char *name;
+    int address;
+} AssemblySymbol;
+
+/* Everything an assembly produces. The arrays and strings live in a single
+ * allocation owned by the caller, released by DestroyAssemblyResult. */
+typedef struct
+{
+    unsigned short *words;    /* 14 bit words, the code words then the data */
+    size_t numOfCodeWords;    /* words[i] is at ASSEMBLY_STARTING_ADDRESS + i */
+    size_t numOfDataWords;
+    AssemblySymbol *entries;  /* The lines of the .ent file */
+    size_t numOfEntries;
+    AssemblySymbol *externs;  /* The lines of the .ext file, one per use */
+    size_t numOfExterns;
+    char *diagnostics;        /* Errors and warnings, as the assembler prints them */
+    int hasErrors;            /* No words, entries or externs are returned */
+    void *memory;
+} AssemblyResult;
+
+/* Returns 0 when the source assembled without errors. The result is filled
+ * in either way (it is empty if memory ran out) and must be destroyed. */
+int AssembleSource(const char *source, size_t length, AssemblyResult *result);
+void DestroyAssemblyResult(AssemblyResult *result);
+
+#endif /* ASSEMBLER_ASSEMBLER_H */
@@ -8,6 +8,8 @@
 #ifndef ASSEMBLER_UTILS_H
 #define ASSEMBLER_UTILS_H
 
+#include <stddef.h> /* size_t */
+
 #define MAX_SENTENCE_SIZE (100)
 #define MAX_FILENAME_SIZE (100)
 #define MAX_LABEL_SIZE (31)
@@ -18,7 +20,6 @@ static const char DATA_SENTENCE_PREFIX[] = ".data";
 static const char STRING_SENTENCE_PREFIX[] = ".string";
 static const char ENTRY_SENTENCE_PREFIX[] = ".entry";
 static const char EXTERN_SENTENCE_PREFIX[] = ".extern";
-static const char COMMA_SIGN_ARRAY[] = ",";
 
 static const char NEW_LINE = '\n';
 static const char END_LINE = '\0';
@@ -44,6 +45,13 @@ typedef enum
     TRUE = 1
 } bool;
 
+/* Part of a sentence, not NUL-terminated */
+typedef struct
+{
+    const char *start;
+    size_t length;
+} Span;
+
 typedef enum
 {
     ERROR = -1,
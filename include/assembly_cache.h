@@ -0,0 +1,78 @@
+/****************************************
+* ASSEMBLER: assembly_cache.h           *
+****************************************/
+
+#ifndef ASSEMBLER_ASSEMBLY_CACHE_H
+#define ASSEMBLER_ASSEMBLY_CACHE_H
+
+#include <stddef.h> /* size_t */
+
+#include "symbol_table.h"      /* API */
+#include "memory_word.h"       /* API */
+#include "instruction_table.h" /* API */
+#include "source_reader.h"     /* API */
+#include "diagnostics.h"       /* API */
+#include "assembler_utils.h"   /* Utils file */
+
+/* What the scan of one line produced, so an unchanged line is not parsed
+ * again. Only lines that reported nothing are kept (and never .define
+ * lines, which are always parsed). */
+typedef struct
+{
+    unsigned long hash;           /* Of the text of the line */
+    unsigned long macroSignature; /* Of the .define lines before the line */
+    unsigned long textOffset;     /* In the source saved with the cache */
+    unsigned long textLength;
+    int type;                     /* SentenceType */
+    int symbolId;                 /* Defined, extern or entry symbol, or NO_SYMBOL */
+    int firstDataWord;            /* .data and .string words */
+    int numOfDataWords;
+    Instruction instruction;      /* Of an instruction sentence */
+} CachedSentence;
+
+/* The lines of the previous assembly of a file (loaded from its cache
+ * file), and the lines of the current assembly (saved to it with the
+ * source they point into). A zero-initialized AssemblyCache is a valid
+ * empty cache. */
+typedef struct
+{
+    SourceReader file;
+    const CachedSentence *sentences;
+    size_t numOfSentences;
+    const unsigned short *dataWords;
+    size_t numOfDataWords;
+    const char *text;
+    const char *names; /* NUL-separated, in order of id */
+    size_t numOfNames;
+    size_t cursor;     /* The sentence after the last one found */
+    int *buckets;      /* Index in sentences + 1, or 0 for an empty bucket */
+    size_t numOfBuckets;
+    unsigned long macroSignature;
+
+    const char *source; /* Of the current assembly */
+    size_t sourceSize;
+    CachedSentence *newSentences;
+    size_t numOfNewSentences;
+    size_t newSentencesCapacity;
+} AssemblyCache;
+
+void LoadAssemblyCache(AssemblyCache *cache, const char *filename);
+void StartCachedScan(AssemblyCache *cache,
+                     const SourceReader *sourceReader,
+                     SymbolTable *symbolTable,
+                     Diagnostics *diagnostics);
+const CachedSentence *FindCachedSentence(AssemblyCache *cache,
+                                         Span text,
+                                         unsigned long hash);
+void AddMacroSentence(AssemblyCache *cache, unsigned long hash);
+ReturnStatus RecordSentence(AssemblyCache *cache,
+                            Span text,
+                            unsigned long hash,
+                            const CachedSentence *sentence);
+ReturnStatus SaveAssemblyCache(const AssemblyCache *cache,
+                               const char *filename,
+                               const SymbolTable *symbolTable,
+                               const MemorySegment *dataSegment);
+void DestroyAssemblyCache(AssemblyCache *cache);
+
+#endif /* ASSEMBLER_ASSEMBLY_CACHE_H */
@@ -0,0 +1,24 @@
+/****************************************
+* ASSEMBLER: assembly_service.h         *
+****************************************/
+
+#ifndef ASSEMBLER_ASSEMBLY_SERVICE_H
+#define ASSEMBLER_ASSEMBLY_SERVICE_H
+
+/* A long running assembler on a Unix domain socket. A connection carries
+ * any number of requests, each answered in order as soon as it is
+ * assembled:
+ *   request: kind, name, source (a text, NULL for PATH_REQUEST)
+ *   reply:   hasErrors, .ob text, .ent text, .ext text, diagnostics
+ * A PATH_REQUEST names a file the server reads itself (without the .as
+ * postfix, like the command line). Missing files are NULL texts. */
+typedef enum
+{
+    SOURCE_REQUEST = 0,
+    PATH_REQUEST = 1
+} RequestKind;
+
+int RunAssemblyServer(const char *socketPath, int numOfJobs);
+int RunAssemblyClient(const char *socketPath, char *filenames[], int numOfFiles);
+
+#endif /* ASSEMBLER_ASSEMBLY_SERVICE_H */
@@ -0,0 +1,28 @@
+/****************************************
+* ASSEMBLER: c_translator.h             *
+****************************************/
+
+#ifndef ASSEMBLER_C_TRANSLATOR_H
+#define ASSEMBLER_C_TRANSLATOR_H
+
+#include <stddef.h> /* size_t */
+
+#include "symbol_table.h"    /* API */
+#include "memory_word.h"     /* API */
+#include "assembler_utils.h" /* Utils file */
+
+/* Translates an assembled program to a C program that runs it as the
+ * simulator does ("cc -O2 program.c -o program", then "./program
+ * [-s MAX_STEPS] [-m]"). The code becomes one C function with a label at
+ * every jump target, named after its symbol when it has one (symbolTable
+ * may be NULL). What cannot be translated ahead of time, such as a jump
+ * into the data or a write to the code, runs in an interpreter that is
+ * part of the program. Returns the malloced, NUL-terminated text, or NULL. */
+char *TranslateToC(const MemoryWord *instructions,
+                   unsigned long instructionCounter,
+                   const MemoryWord *data,
+                   unsigned long dataCounter,
+                   const SymbolTable *symbolTable,
+                   size_t *length);
+
+#endif /* ASSEMBLER_C_TRANSLATOR_H */
@@ -0,0 +1,31 @@
+/****************************************
+* ASSEMBLER: diagnostics.h              *
+****************************************/
+
+#ifndef ASSEMBLER_DIAGNOSTICS_H
+#define ASSEMBLER_DIAGNOSTICS_H
+
+#include <stdio.h>  /* FILE */
+#include <stddef.h> /* size_t */
+
+#include "assembler_utils.h" /* Utils file */
+
+/* Errors and warnings of a single assembly. Messages are written to stream
+ * when it is set, and collected in buffer otherwise (so assemblies running
+ * in parallel do not interleave their messages). */
+typedef struct
+{
+    FILE *stream;
+    char *buffer;
+    size_t length;
+    size_t capacity;
+    size_t numOfReports; /* Errors and warnings reported so far */
+    bool errorHasOccurred;
+} Diagnostics;
+
+void ReportError(Diagnostics *diagnostics, const char *format, ...);
+void ReportWarning(Diagnostics *diagnostics, const char *format, ...);
+void AppendDiagnostics(Diagnostics *diagnostics, const Diagnostics *other);
+void DestroyDiagnostics(Diagnostics *diagnostics);
+
+#endif /* ASSEMBLER_DIAGNOSTICS_H */
@@ -10,6 +10,54 @@
 
 #include <stdio.h> /* FILE */
 
-void RunScans(FILE *assemblyFile, const char *filename);
+#include "symbol_table.h"      /* API */
+#include "memory_word.h"       /* API */
+#include "instruction_table.h" /* API */
+#include "source_reader.h"     /* API */
+#include "diagnostics.h"       /* API */
+#include "assembly_cache.h"    /* API */
+#include "output_cache.h"      /* API */
+#include "files_builder.h"     /* API */
+
+/* Largest address a direct operand can hold */
+#define MAX_ADDRESS ((1 << (MEMORY_WORD_SIZE_IN_BITS - 2)) - 1)
+
+/* Everything the scan of one source produces. A zero-initialized Assembly
+ * is a valid empty assembly. */
+typedef struct
+{
+    SymbolTable symbolTable;
+    MemorySegment instructionSegment;
+    MemorySegment dataSegment;
+    bool hasEntries;
+    bool hasExternals;
+} Assembly;
+
+/* How RunScans assembles a file */
+typedef struct
+{
+    bool isIncremental;             /* Reuse the lines of the last assembly */
+    const OutputCache *outputCache; /* Reuse whole assemblies, or NULL */
+    int numOfThreads;               /* Scan a large source in parallel */
+    ObjectFormat objectFormat;      /* Of the files written */
+} ScanOptions;
+
+void ScanSource(SourceReader *sourceReader,
+                Assembly *assembly,
+                AssemblyCache *cache,
+                Diagnostics *diagnostics);
+void ScanSentences(SourceReader *sourceReader,
+                   Assembly *assembly,
+                   InstructionTable *instructionTable,
+                   AssemblyCache *cache,
+                   int firstLineNumber,
+                   int *IC,
+                   Diagnostics *diagnostics);
+void DestroyAssembly(Assembly *assembly);
+
+void RunScans(FILE *assemblyFile,
+              const char *filename,
+              const ScanOptions *options,
+              Diagnostics *diagnostics);
 
 #endif /* ASSEMBLER_FILE_SCANNER_H */
@@ -8,16 +8,63 @@
 #ifndef ASSEMBLER_FILES_BUILDER_H
 #define ASSEMBLER_FILES_BUILDER_H
 
+#include <stddef.h> /* size_t */
+
 #include "symbol_table.h" /* API */
 #include "memory_word.h"  /* API */
+#include "object_file.h"  /* API */
+#include "diagnostics.h"  /* API */
+
+static const char OBJECT_FILE_POSTFIX[] = ".ob";
+static const char ENTRY_FILE_POSTFIX[] = ".ent";
+static const char EXTERN_FILE_POSTFIX[] = ".ext";
+static const char BINARY_OBJECT_FILE_POSTFIX[] = ".bin";
+static const char C_PROGRAM_FILE_POSTFIX[] = ".c";
+
+typedef enum
+{
+    TEXT_OBJECT,  /* The .ob, .ent and .ext files */
+    BINARY_OBJECT, /* A single .bin file (see object_file.h) */
+    C_PROGRAM      /* The text files and a .c file (see c_translator.h) */
+} ObjectFormat;
 
-void BuildFiles(MemoryWord *instructionsArray,
-                MemoryWord *dataArray,
-                SymbolTableNode *symbolTableHead,
+/* The texts of the files of one assembly. A text is NULL when its file is
+ * not created. */
+typedef struct
+{
+    char *object;
+    size_t objectLength;
+    char *entries;
+    size_t entriesLength;
+    char *externs;
+    size_t externsLength;
+    char *binaryObject;
+    size_t binaryObjectLength;
+    char *cProgram;
+    size_t cProgramLength;
+} FileTexts;
+
+void BuildFiles(const MemorySegment *instructionSegment,
+                const MemorySegment *dataSegment,
+                const SymbolTable *symbolTable,
                 const char *filename,
                 bool hasEntries,
                 bool hasExternals,
-                int dataCounter,
-                int instructionCounter);
+                ObjectFormat objectFormat,
+                Diagnostics *diagnostics);
+ReturnStatus FormatFiles(const MemorySegment *instructionSegment,
+                         const MemorySegment *dataSegment,
+                         const SymbolTable *symbolTable,
+                         bool hasEntries,
+                         bool hasExternals,
+                         ObjectFormat objectFormat,
+                         FileTexts *fileTexts);
+ReturnStatus FormatObjectContents(const ObjectContents *contents,
+                                  ObjectFormat objectFormat,
+                                  FileTexts *fileTexts);
+void WriteFiles(const FileTexts *fileTexts,
+                const char *filename,
+                Diagnostics *diagnostics);
+void DestroyFileTexts(FileTexts *fileTexts);
 
 #endif /* ASSEMBLER_FILES_BUILDER_H */
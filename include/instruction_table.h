@@ -0,0 +1,53 @@
+/****************************************
+* ASSEMBLER: instruction_table.h        *
+****************************************/
+
+#ifndef ASSEMBLER_INSTRUCTION_TABLE_H
+#define ASSEMBLER_INSTRUCTION_TABLE_H
+
+#include <stddef.h> /* size_t */
+
+#include "assembler_utils.h" /* Utils file */
+
+#define NO_SYMBOL (-1)
+
+typedef enum
+{
+    IMMEDIATE_ADDRESSING = 0,
+    DIRECT_ADDRESSING = 1,
+    FIXED_INDEX_ADDRESSING = 2,
+    DIRECT_REGISTER_ADDRESSING = 3
+} AddressingMethods;
+
+typedef struct
+{
+    unsigned char addressingMethod; /* AddressingMethods */
+    int value;                      /* Immediate, index or register number */
+    int symbolId;                   /* Label (DIRECT/FIXED_INDEX) or NO_SYMBOL */
+} Operand;
+
+/* A parsed instruction sentence. The first scan fills one per line, and
+ * the encoding stage builds the memory words from it. */
+typedef struct
+{
+    unsigned char operationCode;
+    unsigned char numOfOperands;
+    unsigned char numOfMemoryWords;
+    Operand srcOperand;
+    Operand destOperand;
+    int lineNumber;
+} Instruction;
+
+/* A zero-initialized InstructionTable is a valid empty table */
+typedef struct
+{
+    Instruction *instructions;
+    size_t numOfInstructions;
+    size_t capacity;
+} InstructionTable;
+
+ReturnStatus AddInstruction(InstructionTable *instructionTable,
+                            const Instruction *instruction);
+void DestroyInstructionTable(InstructionTable *instructionTable);
+
+#endif /* ASSEMBLER_INSTRUCTION_TABLE_H */
@@ -8,18 +8,16 @@
 #ifndef ASSEMBLER_MEMORY_WORD_H
 #define ASSEMBLER_MEMORY_WORD_H
 
-#include "symbol_table.h"    /* API */
-#include "assembler_utils.h" /* Utils file */
+#include "symbol_table.h"      /* API */
+#include "sentence_analyzer.h" /* API */
+#include "operations.h"        /* API */
+#include "instruction_table.h" /* API */
+#include "assembler_utils.h"   /* Utils file */
 
 #define MEMORY_WORD_SIZE_IN_BITS (14)
-
-typedef enum
-{
-    IMMEDIATE_ADDRESSING = 0,
-    DIRECT_ADDRESSING = 1,
-    FIXED_INDEX_ADDRESSING = 2,
-    DIRECT_REGISTER_ADDRESSING = 3
-} AddressingMethods;
+#define MEMORY_WORD_MASK ((1 << MEMORY_WORD_SIZE_IN_BITS) - 1)
+/* r0 to r7: a register field of a word is 3 bits wide */
+#define NUM_OF_REGISTERS (8)
 
 typedef enum
 {
@@ -34,47 +32,41 @@ typedef enum
     DEST_OPERAND
 } OperandType;
 
-typedef struct
-{
-    unsigned int data : MEMORY_WORD_SIZE_IN_BITS;
-} MemoryWord;
+/* A word in the low MEMORY_WORD_SIZE_IN_BITS bits; the bits above are 0 */
+typedef unsigned short MemoryWord;
 
+/* A growable block of words (the code or the data of a program), stored
+ * contiguously. A zero-initialized MemorySegment is a valid empty segment. */
 typedef struct
 {
-    char operandStr[MAX_SENTENCE_SIZE];
-    AddressingMethods addressingMethod;
-    Encoding encodingType;
-    unsigned int numOfMemoryWords;
-    int value;
-} Operand;
+    MemoryWord *words;
+    size_t numOfWords;
+    size_t capacity;
+} MemorySegment;
 
-typedef struct
-{
-    char operationName[MAX_SENTENCE_SIZE];
-    unsigned int operationCode;
-    unsigned int numOfOperands;
-    unsigned int numOfMemoryWords;
-    Operand srcOperand;
-    Operand destOperand;
-} InstructionDetails;
+ReturnStatus ReserveMemoryWords(MemorySegment *segment, size_t numOfWords);
+ReturnStatus AppendMemoryWord(MemorySegment *segment, unsigned int data);
+void DestroyMemorySegment(MemorySegment *segment);
 
-void InsertToDataArray(MemoryWord *dataArray,
-                       const char *sentence,
-                       int *dataCounter,
-                       SymbolTableNode *symbolTableHead,
-                       bool *errorHasOccurred,
-                       int lineNumber);
-void BuildFirstMemoryWord(MemoryWord *instructionsArray,
-                          const char *instructionSentence,
-                          int *instructionCounter,
-                          SymbolTableNode *symbolTableHead,
-                          bool *errorHasOccurred,
-                          int lineNumber);
-void BuildOtherMemoryWords(MemoryWord *instructionsArray,
-                           const char *instructionSentence,
-                           int *instructionCounter,
-                           SymbolTableNode *symbolTableHead,
-                           bool *errorHasOccurred,
-                           int lineNumber);
+void InsertToDataSegment(MemorySegment *dataSegment,
+                         const Sentence *sentence,
+                         SymbolTable *symbolTable,
+                         Diagnostics *diagnostics,
+                         int lineNumber);
+void ParseInstruction(const Sentence *instructionSentence,
+                      const Operation *operation,
+                      Instruction *instruction,
+                      SymbolTable *symbolTable,
+                      Diagnostics *diagnostics,
+                      int lineNumber);
+/* The words the encoding of an instruction takes, by its addressing methods */
+int GetNumOfMemoryWords(const Instruction *instruction);
+void EncodeInstructions(MemoryWord *instructionsArray,
+                        const Instruction *instructions,
+                        size_t numOfInstructions,
+                        int IC,
+                        const SymbolTable *symbolTable,
+                        ExternReferenceList *externReferences,
+                        Diagnostics *diagnostics);
 
 #endif /* ASSEMBLER_MEMORY_WORD_H */
@@ -0,0 +1,102 @@
+/****************************************
+* ASSEMBLER: object_file.h              *
+****************************************/
+
+#ifndef ASSEMBLER_OBJECT_FILE_H
+#define ASSEMBLER_OBJECT_FILE_H
+
+#include <stddef.h> /* size_t */
+
+#include "symbol_table.h"    /* API */
+#include "memory_word.h"     /* API */
+#include "diagnostics.h"     /* API */
+#include "assembler_utils.h" /* Utils file */
+
+/* The binary object file. Every number is little-endian and every table
+ * is aligned to its entries, so a loader can map the file and use it as
+ * is:
+ *
+ *   0  "ASOB"                       4  version (16 bits), flags (16 bits)
+ *   8  instruction counter (IC)    12  data counter (DC)
+ *  16  offset of the words         20  offset of the symbols
+ *  24  number of entries           28  number of externs
+ *  32  offset of the names         36  size of the names
+ *  40  size of the file            44  0
+ *
+ * The words are IC + DC 16-bit words (code, then data, from address 100).
+ * The symbols are 8 bytes each, the entries first and then the externs:
+ * the offset of the NUL-terminated name in the names, and the address of
+ * the symbol (an entry) or of its use (an extern). */
+#define BINARY_OBJECT_VERSION (1)
+#define BINARY_OBJECT_HEADER_SIZE (48)
+#define BINARY_OBJECT_SYMBOL_SIZE (8)
+
+static const char BINARY_OBJECT_MAGIC[] = "ASOB";
+
+typedef enum
+{
+    HAS_ENTRIES_FLAG = 1,  /* The program has a .ent file */
+    HAS_EXTERNALS_FLAG = 2 /* The program has a .ext file */
+} BinaryObjectFlags;
+
+/* A line of the .ent or the .ext file */
+typedef struct
+{
+    Span name;
+    unsigned long address;
+} ObjectSymbol;
+
+/* What the object files of a program hold. The names point into memory
+ * that outlives it (a symbol table or a file). A zero-initialized
+ * ObjectContents is a valid empty program. */
+typedef struct
+{
+    unsigned short *words; /* Code, then data */
+    unsigned long instructionCounter;
+    unsigned long dataCounter;
+    ObjectSymbol *symbols; /* Entries, then externs */
+    unsigned long numOfEntries;
+    unsigned long numOfExterns;
+    unsigned int flags; /* BinaryObjectFlags */
+} ObjectContents;
+
+/* A validated binary object file, read in place */
+typedef struct
+{
+    const unsigned char *data;
+    size_t size;
+    unsigned long instructionCounter;
+    unsigned long dataCounter;
+    unsigned long numOfEntries;
+    unsigned long numOfExterns;
+    unsigned int flags;
+    const unsigned char *words;
+    const unsigned char *symbols;
+    const char *names;
+    unsigned long namesSize;
+} BinaryObject;
+
+ReturnStatus GetAssemblyContents(const MemorySegment *instructionSegment,
+                                 const MemorySegment *dataSegment,
+                                 const SymbolTable *symbolTable,
+                                 bool hasEntries,
+                                 bool hasExternals,
+                                 ObjectContents *contents);
+char *FormatBinaryObject(const ObjectContents *contents, size_t *length);
+
+ReturnStatus OpenBinaryObject(BinaryObject *object, const void *data, size_t size);
+unsigned int GetBinaryObjectWord(const BinaryObject *object, unsigned long index);
+void GetBinaryObjectSymbol(const BinaryObject *object,
+                           unsigned long index,
+                           ObjectSymbol *symbol);
+ReturnStatus ReadBinaryObject(const BinaryObject *object, ObjectContents *contents);
+
+ReturnStatus ReadTextObject(Span object,
+                            const Span *entries,
+                            const Span *externs,
+                            ObjectContents *contents,
+                            Diagnostics *diagnostics);
+
+void DestroyObjectContents(ObjectContents *contents);
+
+#endif /* ASSEMBLER_OBJECT_FILE_H */
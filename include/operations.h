@@ -11,9 +11,24 @@
 #include "assembler_utils.h" /* Utils file */
 
 #define NUM_OF_OPERATIONS (16)
+#define MAX_OPERATION_NAME_SIZE (4)
 
-bool IsInOperationsTable(const char *operationName);
-int GetOperationCode(const char *operationName);
-int GetNumOfOperands(const char *operationName);
+/* Bit of an addressing method in the legal addressing methods of an operand */
+#define ADDRESSING_METHOD_FLAG(addressingMethod) (1 << (addressingMethod))
+
+typedef struct operation
+{
+    char name[MAX_OPERATION_NAME_SIZE + 1];
+    unsigned char code;
+    unsigned char numOfOperands;
+    unsigned char srcAddressingMethods;
+    unsigned char destAddressingMethods;
+} Operation;
+
+const Operation *FindOperation(Span operationName);
+const Operation *GetOperation(int operationCode);
+bool IsLegalInstruction(const Operation *operation,
+                        unsigned int srcAddressingMethod,
+                        unsigned int destAddressingMethod);
 
 #endif /* ASSEMBLER_OPERATIONS_H */
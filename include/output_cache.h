@@ -0,0 +1,40 @@
+/****************************************
+* ASSEMBLER: output_cache.h             *
+****************************************/
+
+#ifndef ASSEMBLER_OUTPUT_CACHE_H
+#define ASSEMBLER_OUTPUT_CACHE_H
+
+#include <stddef.h> /* size_t */
+
+#include "files_builder.h"   /* API */
+#include "diagnostics.h"     /* API */
+#include "assembler_utils.h" /* Utils file */
+
+/* Changed whenever the files of an assembly change, so older entries are
+ * not used */
+#define OUTPUT_CACHE_VERSION (2)
+#define OUTPUT_CACHE_KEY_SIZE (48)
+
+/* A directory of the files of earlier assemblies, by the content of their
+ * source. Any number of assemblies (and processes) can share it. */
+typedef struct
+{
+    const char *directory;
+    unsigned long maxSize; /* In bytes; least recently used entries go first */
+} OutputCache;
+
+void GetOutputCacheKey(const char *source,
+                       size_t size,
+                       ObjectFormat objectFormat,
+                       char *key);
+ReturnStatus RestoreOutputs(const OutputCache *outputCache,
+                            const char *key,
+                            const char *filename,
+                            Diagnostics *diagnostics);
+void PublishOutputs(const OutputCache *outputCache,
+                    const char *key,
+                    const FileTexts *fileTexts,
+                    const Diagnostics *warnings);
+
+#endif /* ASSEMBLER_OUTPUT_CACHE_H */
@@ -0,0 +1,21 @@
+/****************************************
+* ASSEMBLER: parallel_scanner.h         *
+****************************************/
+
+#ifndef ASSEMBLER_PARALLEL_SCANNER_H
+#define ASSEMBLER_PARALLEL_SCANNER_H
+
+#include "file_scanner.h"    /* API */
+#include "source_reader.h"   /* API */
+#include "diagnostics.h"     /* API */
+#include "assembler_utils.h" /* Utils file */
+
+/* Smallest part of a source scanned by a thread of its own */
+#define MIN_SCAN_CHUNK_SIZE (256 * 1024)
+
+void ScanSourceInParallel(SourceReader *sourceReader,
+                          Assembly *assembly,
+                          int numOfThreads,
+                          Diagnostics *diagnostics);
+
+#endif /* ASSEMBLER_PARALLEL_SCANNER_H */
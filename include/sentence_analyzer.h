@@ -10,23 +10,54 @@
 
 #include "assembler_utils.h" /* Utils file */
 
-bool IsCommentSentence(const char *sentence);
-bool IsMacroSentence(const char *sentence);
-bool IsEntrySentence(const char *sentence);
-bool IsExternSentence(const char *sentence);
-bool IsEmptySentence(const char *sentence);
-bool IsDataSentence(const char *sentence);
-bool IsStringSentence(const char *sentence);
-bool HasValidSymbol(const char *sentence);
-bool HasValidOperationName(const char *sentence);
-
-void GetString(const char *stringSentence, char *string);
-void GetData(const char *dataSentence, char *data);
-void GetOperationName(const char *sentence, char *operationName);
-void GetSymbol(const char *sentence, char *symbol);
-void GetInstructionParams(const char *instructionSentence, char *param);
-
-void RemoveWhiteSpaces(char *str);
-int FindChar(const char *str, char c);
+/* The largest magnitude of a number in a source: all 14 bits of a word */
+#define MAX_NUMBER_MAGNITUDE (0x3FFF)
+
+/* The ranges of the numbers of a source, in two's complement: a .data
+ * word (and a macro) has all 14 bits, an immediate or an index the 12
+ * bits above the encoding type */
+#define MIN_DATA_NUMBER (-0x2000)
+#define MAX_DATA_NUMBER (0x1FFF)
+#define MIN_OPERAND_NUMBER (-0x800)
+#define MAX_OPERAND_NUMBER (0x7FF)
+
+typedef enum
+{
+    EMPTY_SENTENCE,
+    COMMENT_SENTENCE,
+    MACRO_SENTENCE,
+    DATA_SENTENCE,
+    STRING_SENTENCE,
+    EXTERN_SENTENCE,
+    ENTRY_SENTENCE,
+    INSTRUCTION_SENTENCE
+} SentenceType;
+
+/* The fields of a sentence: "symbol: operation operands". symbol is empty
+ * when the sentence has no symbol definition, operation is the directive
+ * (e.g. ".data") or the operation name. isSymbolIndented is TRUE when the
+ * symbol definition does not start in column 0 (which is an error). */
+typedef struct
+{
+    SentenceType type;
+    Span symbol;
+    Span operation;
+    Span operands;
+    bool isSymbolIndented;
+} Sentence;
+
+ReturnStatus AnalyzeSentence(Span text, Sentence *sentence);
+
+bool GetString(Span operands, Span *string);
+
+bool GetNextToken(Span *str, char separator, Span *token);
+void TrimWhiteSpaces(Span *str);
+int FindChar(Span str, char c);
+bool IsSpanEqual(Span str, const char *other);
+Span GetSpan(const char *str);
+
+bool IsNumber(Span str);
+int GetNumber(Span number);
+bool IsNumberInRange(int number, int minNumber, int maxNumber);
 
 #endif /* ASSEMBLER_SENTENCE_ANALYZER_H */
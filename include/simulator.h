@@ -0,0 +1,133 @@
+/****************************************
+* ASSEMBLER: simulator.h                *
+****************************************/
+
+#ifndef ASSEMBLER_SIMULATOR_H
+#define ASSEMBLER_SIMULATOR_H
+
+#include <stdio.h> /* FILE */
+
+#include "diagnostics.h"     /* API */
+#include "memory_word.h"     /* MEMORY_WORD_SIZE_IN_BITS, NUM_OF_REGISTERS */
+#include "operations.h"      /* NUM_OF_OPERATIONS */
+#include "assembler_utils.h" /* Utils file */
+
+/* Addresses are 12 bits long (the 14 bits of a word without ARE) */
+#define MEMORY_SIZE (4096)
+#define RETURN_STACK_SIZE (1024)
+/* The operand words an instruction may read past the end of memory */
+#define MEMORY_PADDING (4)
+
+/* The fields of the words of an instruction (see memory_word.h) */
+#define WORD_SIGN_BIT (1 << (MEMORY_WORD_SIZE_IN_BITS - 1))
+#define VALUE_SIGN_BIT (1 << (MEMORY_WORD_SIZE_IN_BITS - 3))
+#define REGISTER_MASK (NUM_OF_REGISTERS - 1)
+#define SRC_REGISTER_SHIFT (5)
+#define DEST_REGISTER_SHIFT (2)
+/* The first word, two for a fixed index src and two for a fixed index dest */
+#define MAX_INSTRUCTION_LENGTH (5)
+
+/* The bits of the first word that select a handler: operation code and
+ * the addressing methods of both operands */
+#define NUM_OF_DISPATCH_INDEXES (256)
+#define DISPATCH_INDEX(word) (((word) >> 2) & (NUM_OF_DISPATCH_INDEXES - 1))
+
+/* A 12 bit two's complement value as a long */
+#define SIGN_EXTEND_VALUE(value) ((long)((value) ^ VALUE_SIGN_BIT) - VALUE_SIGN_BIT)
+
+#define OPERATION_CODE(word) (((word) >> 6) & (NUM_OF_OPERATIONS - 1))
+#define SRC_ADDRESSING_METHOD(word) (((word) >> 4) & 3)
+#define DEST_ADDRESSING_METHOD(word) (((word) >> 2) & 3)
+
+typedef enum
+{
+    SIMULATION_STOPPED,           /* A stop instruction was executed */
+    SIMULATION_OUT_OF_STEPS,
+    SIMULATION_ILLEGAL_INSTRUCTION,
+    SIMULATION_ADDRESS_ERROR,     /* Access or jump outside of memory */
+    SIMULATION_STACK_ERROR        /* jsr with a full stack or rts with an empty one */
+} SimulationStatus;
+
+/* Where a decoded operand is: MicroOp offsets are indexes of memory,
+ * registers or immediates of the Machine */
+typedef enum
+{
+    MEMORY_SPACE,
+    REGISTER_SPACE,
+    IMMEDIATE_SPACE,
+    NUM_OF_OPERAND_SPACES
+} OperandSpace;
+
+/* What a MicroOp does */
+typedef enum
+{
+    DECODE_HANDLER, /* The MicroOp of an instruction not decoded yet */
+    MOV_HANDLER,
+    CMP_HANDLER,
+    ADD_HANDLER,
+    SUB_HANDLER,
+    NOT_HANDLER,
+    CLR_HANDLER,
+    LEA_HANDLER,
+    INC_HANDLER,
+    DEC_HANDLER,
+    JMP_HANDLER,
+    BNE_HANDLER,
+    RED_HANDLER,
+    PRN_HANDLER,
+    JSR_HANDLER,
+    RTS_HANDLER,
+    STOP_HANDLER,
+    ILLEGAL_HANDLER,
+    ADDRESS_ERROR_HANDLER, /* A decoded index out of memory */
+    NUM_OF_HANDLERS
+} Handler;
+
+/* An instruction decoded once by RunMachine, kept at its address until a
+ * word of it is written */
+typedef struct
+{
+    unsigned char handler;   /* Handler */
+    unsigned char length;    /* In words, 0 if not decoded */
+    unsigned char srcSpace;  /* OperandSpace */
+    unsigned char destSpace; /* OperandSpace */
+    unsigned short src;
+    unsigned short dest;
+} MicroOp;
+
+/* A zero-initialized Machine has empty memory, an empty micro-op cache
+ * and a pc of 0 */
+typedef struct
+{
+    unsigned short memory[MEMORY_SIZE + MEMORY_PADDING];
+    MicroOp microOps[MEMORY_SIZE];
+    unsigned short immediates[2 * MEMORY_SIZE]; /* src and dest of each MicroOp */
+    unsigned char isCode[MEMORY_SIZE];          /* A decoded MicroOp read the word */
+    unsigned short registers[NUM_OF_REGISTERS];
+    unsigned short returnStack[RETURN_STACK_SIZE];
+    int stackPointer;
+    unsigned int pc;
+    bool zeroFlag;
+    unsigned long numOfSteps;
+    FILE *input;  /* red */
+    FILE *inputSource; /* When set, red reads on from here at the end of input,
+                        * and keeps what it read in input (so it can be replayed) */
+    FILE *output; /* prn */
+    unsigned int numOfCodeWords; /* As loaded: the data follows the code */
+    unsigned int numOfDataWords;
+} Machine;
+
+ReturnStatus LoadObjectFile(Machine *machine,
+                            FILE *objectFile,
+                            Diagnostics *diagnostics);
+ReturnStatus LoadBinaryObjectFile(Machine *machine,
+                                  FILE *objectFile,
+                                  Diagnostics *diagnostics);
+SimulationStatus RunMachine(Machine *machine, unsigned long maxSteps);
+SimulationStatus RunMachineUncached(Machine *machine, unsigned long maxSteps);
+const MicroOp *GetMicroOp(Machine *machine, unsigned int address);
+void ClearMicroOps(Machine *machine);
+const char *GetSimulationStatusName(SimulationStatus status);
+int ReadInputCharacter(FILE *input, FILE *inputSource);
+
+#endif /* ASSEMBLER_SIMULATOR_H */
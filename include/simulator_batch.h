@@ -0,0 +1,66 @@
+/****************************************
+* ASSEMBLER: simulator_batch.h          *
+****************************************/
+
+#ifndef ASSEMBLER_SIMULATOR_BATCH_H
+#define ASSEMBLER_SIMULATOR_BATCH_H
+
+#include <stdio.h>  /* FILE */
+#include <stddef.h> /* size_t */
+
+#include "simulator.h"       /* API */
+#include "assembler_utils.h" /* Utils file */
+
+/* The 32 bit FNV-1a hash of the output of a program with no output */
+#define OUTPUT_HASH_BASIS (2166136261UL)
+
+typedef SimulationStatus (*RunFunction)(Machine *machine, unsigned long maxSteps);
+
+/* How a run ended: a line of the results */
+typedef struct
+{
+    bool hasRun; /* FALSE when the program could not be loaded */
+    SimulationStatus status;
+    unsigned int pc;
+    unsigned long numOfSteps;
+    bool zeroFlag;
+    unsigned short registers[NUM_OF_REGISTERS];
+    unsigned long outputHash; /* Of the prn output */
+    unsigned long outputSize;
+} SimulationResult;
+
+typedef struct
+{
+    unsigned long maxSteps; /* Of every program */
+    int numOfThreads;       /* 0 for one per processor */
+    bool isBinaryObject;    /* A program without a postfix is name.bin, not name.ob */
+    RunFunction run;        /* RunMachine or RunMachineUncached */
+} BatchOptions;
+
+/* The output hash and size are left for the caller */
+void GetSimulationResult(const Machine *machine,
+                         SimulationStatus status,
+                         SimulationResult *result);
+bool IsSameSimulationResult(const SimulationResult *first, const SimulationResult *second);
+unsigned long HashOutput(unsigned long hash, const char *output, size_t length);
+/* Hashes the bytes written to a stream since it was rewound */
+void HashOutputStream(FILE *stream, SimulationResult *result);
+void WriteResultsHeader(FILE *results);
+/* "name status pc steps zero-flag r0 ... r7 output-hash output-size", or
+ * "name unloaded" */
+void WriteSimulationResult(FILE *results, const char *name, const SimulationResult *result);
+
+/* Runs the programs of a manifest, one "program [input]" line each (empty
+ * lines and lines starting with '#' are skipped), on a work-stealing thread
+ * pool. A program.as is assembled in memory, anything else is an object
+ * file. red reads the input file (or nothing), and prn is hashed.
+ *
+ * One results line per program is written in the order of the manifest,
+ * and the throughput and the latency percentiles are reported to
+ * statistics. Returns TRUE when every program stopped. */
+bool RunBatch(const char *manifestFilename,
+              FILE *results,
+              FILE *statistics,
+              const BatchOptions *options);
+
+#endif /* ASSEMBLER_SIMULATOR_BATCH_H */
@@ -0,0 +1,20 @@
+/****************************************
+* ASSEMBLER: simulator_jit.h            *
+****************************************/
+
+#ifndef ASSEMBLER_SIMULATOR_JIT_H
+#define ASSEMBLER_SIMULATOR_JIT_H
+
+#include "simulator.h"       /* API */
+#include "assembler_utils.h" /* Utils file */
+
+typedef struct jit Jit;
+
+/* Translates the basic blocks of a Machine to x86-64 code and runs them.
+ * CreateJit returns NULL on other processors (or when no executable
+ * memory can be mapped), and RunMachineJit of a NULL Jit is RunMachine. */
+Jit *CreateJit(void);
+SimulationStatus RunMachineJit(Jit *jit, Machine *machine, unsigned long maxSteps);
+void DestroyJit(Jit *jit);
+
+#endif /* ASSEMBLER_SIMULATOR_JIT_H */
@@ -0,0 +1,76 @@
+/****************************************
+* ASSEMBLER: simulator_lanes.h          *
+****************************************/
+
+#ifndef ASSEMBLER_SIMULATOR_LANES_H
+#define ASSEMBLER_SIMULATOR_LANES_H
+
+#include <stdio.h>  /* FILE */
+#include <stddef.h> /* size_t */
+
+#include "simulator.h"       /* API */
+#include "simulator_batch.h" /* SimulationResult */
+#include "diagnostics.h"     /* API */
+#include "assembler_utils.h" /* Utils file */
+
+/* The instances of a program stepped together: a row holds a word of
+ * every lane, so an instruction reads and writes a row at a time */
+#define NUM_OF_LANES (32)
+
+typedef enum
+{
+    ONE_BY_ONE_ENGINE,  /* RunMachine on a copy of the Machine per instance */
+    SCALAR_LANE_ENGINE, /* Lockstep, a lane at a time, any processor */
+    AVX2_LANE_ENGINE,   /* Lockstep, 16 lanes per 32-byte vector */
+    NUM_OF_INSTANCE_ENGINES
+} InstanceEngine;
+
+/* The data segments of the instances: instance i starts with the words
+ * words[offsets[i]] to words[offsets[i + 1] - 1] at the start of the data
+ * segment of the program (the rest of its memory is as loaded) */
+typedef struct
+{
+    unsigned short *words;
+    size_t *offsets;
+    size_t numOfInstances;
+} InstanceSet;
+
+typedef struct
+{
+    unsigned long numOfLockstepSteps; /* Instructions run for a group of lanes */
+    unsigned long numOfLaneSteps;     /* The steps of the lanes in those instructions */
+    unsigned long numOfScalarLanes;   /* Lanes that diverged and were finished by RunMachine */
+} InstanceStatistics;
+
+/* Reads a data segment per line, comma-separated numbers as in .data
+ * (empty lines and lines starting with '#' are skipped) */
+ReturnStatus ReadInstanceSet(FILE *file,
+                             unsigned int maxNumOfWords,
+                             InstanceSet *instances,
+                             Diagnostics *diagnostics);
+void DestroyInstanceSet(InstanceSet *instances);
+
+/* The fastest engine of this processor */
+InstanceEngine GetInstanceEngine(void);
+bool IsInstanceEngineSupported(InstanceEngine engine);
+const char *GetInstanceEngineName(InstanceEngine engine);
+
+/* Runs an instance of a loaded Machine per data segment, for up to
+ * maxSteps steps each (0 for no limit), and fills in results[i] as
+ * RunMachine would for instance i. red of every instance reads input from
+ * its start, so input must be a file that can be rewound; at its end, red
+ * reads on from the inputSource of the Machine (when set) into input.
+ *
+ * The lane engines run NUM_OF_LANES instances at a time. Lanes that
+ * branch apart wait while the lanes at the smallest pc run (masked), until
+ * they meet again; lanes that run alone for too long, or write to the code,
+ * are finished by RunMachine. statistics stay 0 for ONE_BY_ONE_ENGINE. */
+ReturnStatus RunInstances(InstanceEngine engine,
+                          const Machine *machine,
+                          const InstanceSet *instances,
+                          FILE *input,
+                          unsigned long maxSteps,
+                          SimulationResult *results,
+                          InstanceStatistics *statistics);
+
+#endif /* ASSEMBLER_SIMULATOR_LANES_H */
@@ -0,0 +1,45 @@
+/****************************************
+* ASSEMBLER: socket_stream.h            *
+****************************************/
+
+#ifndef ASSEMBLER_SOCKET_STREAM_H
+#define ASSEMBLER_SOCKET_STREAM_H
+
+#include <stddef.h> /* size_t */
+
+#include "assembler_utils.h" /* Utils file */
+
+/* Framing of the messages of the assembly service. A number is 4 bytes,
+ * most significant first. A text is its length followed by its characters,
+ * and a missing text (NULL) is sent as the length NO_TEXT. */
+#define NO_TEXT (0xFFFFFFFFUL)
+#define MAX_TEXT_LENGTH (1UL << 28)
+
+#define SOCKET_BUFFER_SIZE (16384)
+
+/* A connected socket with buffered input and output, so a message costs one
+ * send and a few receives. Output is sent on FlushSocketStream (or when the
+ * buffer fills). */
+typedef struct
+{
+    int socket;
+    size_t inputPosition;
+    size_t inputLength;
+    size_t outputLength;
+    char input[SOCKET_BUFFER_SIZE];
+    char output[SOCKET_BUFFER_SIZE];
+} SocketStream;
+
+int OpenListeningSocket(const char *socketPath);
+int ConnectToSocket(const char *socketPath);
+
+void OpenSocketStream(SocketStream *stream, int socket);
+void CloseSocketStream(SocketStream *stream);
+ReturnStatus FlushSocketStream(SocketStream *stream);
+
+ReturnStatus SendNumber(SocketStream *stream, unsigned long number);
+ReturnStatus ReceiveNumber(SocketStream *stream, unsigned long *number);
+ReturnStatus SendText(SocketStream *stream, const char *text, size_t length);
+ReturnStatus ReceiveText(SocketStream *stream, char **text, size_t *length);
+
+#endif /* ASSEMBLER_SOCKET_STREAM_H */
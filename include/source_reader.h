@@ -0,0 +1,33 @@
+/****************************************
+* ASSEMBLER: source_reader.h            *
+****************************************/
+
+#ifndef ASSEMBLER_SOURCE_READER_H
+#define ASSEMBLER_SOURCE_READER_H
+
+#include <stdio.h>  /* FILE */
+#include <stddef.h> /* size_t */
+
+#include "assembler_utils.h" /* Utils file */
+
+/* The whole source file in memory. Regular files are mapped, anything else
+ * (e.g. a pipe) is read into a buffer. Sentences are handed out as spans
+ * into the source, so lines have no length limit and are never copied. */
+typedef struct
+{
+    const char *data;
+    size_t size;
+    size_t position;
+    char *buffer;
+    bool isMapped;
+} SourceReader;
+
+ReturnStatus OpenSourceReader(SourceReader *sourceReader, FILE *sourceFile);
+void OpenSourceBuffer(SourceReader *sourceReader,
+                      const char *source,
+                      size_t length);
+bool ReadSentence(SourceReader *sourceReader, Span *sentence);
+void RewindSourceReader(SourceReader *sourceReader);
+void CloseSourceReader(SourceReader *sourceReader);
+
+#endif /* ASSEMBLER_SOURCE_READER_H */
@@ -0,0 +1,36 @@
+/****************************************
+* ASSEMBLER: string_pool.h              *
+****************************************/
+
+#ifndef ASSEMBLER_STRING_POOL_H
+#define ASSEMBLER_STRING_POOL_H
+
+#include <stddef.h> /* size_t */
+
+#include "assembler_utils.h" /* Utils file */
+
+typedef struct stringPoolBlock StringPoolBlock;
+
+/* Interns strings: every distinct string gets a small id, so they can be
+ * compared by id. The characters live in an arena of blocks, so the pooled
+ * strings never move. A zero-initialized StringPool is a valid empty pool. */
+typedef struct
+{
+    StringPoolBlock *blocks;
+    const char **strings;  /* id -> pooled string */
+    unsigned long *hashes; /* id -> hash of the string */
+    int numOfStrings;
+    int stringsCapacity;
+    int *buckets; /* id + 1, or 0 for an empty bucket */
+    size_t numOfBuckets;
+} StringPool;
+
+int InternString(StringPool *stringPool, const char *str, size_t length);
+int FindString(const StringPool *stringPool, const char *str, size_t length);
+const char *GetPooledString(const StringPool *stringPool, int id);
+unsigned long HashString(const char *str, size_t length);
+/* Continues a HashString over more bytes */
+unsigned long AddToHash(unsigned long hash, const char *str, size_t length);
+void DestroyStringPool(StringPool *stringPool);
+
+#endif /* ASSEMBLER_STRING_POOL_H */
@@ -8,9 +8,12 @@
 #ifndef ASSEMBLER_SYMBOL_TABLE_H
 #define ASSEMBLER_SYMBOL_TABLE_H
 
-#include <stdio.h> /* FILE */
+#include <stddef.h> /* size_t */
 
-#include "assembler_utils.h" /* Utils file */
+#include "string_pool.h"       /* API */
+#include "diagnostics.h"       /* API */
+#include "sentence_analyzer.h" /* API */
+#include "assembler_utils.h"   /* Utils file */
 
 typedef enum
 {
@@ -23,57 +26,114 @@ typedef enum
 
 typedef struct
 {
-    char name[MAX_SENTENCE_SIZE];
+    int nameId; /* Id of the name in the names pool of the table */
     SymbolCharacteristic type;
     int value;
 } Symbol;
 
 typedef struct node
 {
-    Symbol *symbol;
-    struct node *next;
+    Symbol symbol;
+    struct node *next;         /* Next node in insertion order */
+    struct node *nextSameName; /* Next node with the same name (externals) */
 } SymbolTableNode;
 
-void GetSymbolDetails(SymbolTableNode *symbolTableHead,
-                      const char *symbolName,
+/* A use of an external symbol, one line of the .ext file */
+typedef struct
+{
+    int symbolId;
+    int address;
+} ExternReference;
+
+/* The uses of external symbols of (a part of) a program, by address */
+typedef struct
+{
+    ExternReference *references;
+    int numOfReferences;
+    int capacity;
+} ExternReferenceList;
+
+typedef struct symbolTableBlock SymbolTableBlock;
+
+/* Nodes are kept in a list by insertion order (for the .ent/.ext files) and
+ * indexed by the id of their interned name. Every name, defined or only
+ * referenced, is interned once, so symbols are compared by id. The nodes are
+ * allocated from blocks, so destroying the table frees a handful of blocks.
+ * A zero-initialized SymbolTable is a valid empty table. */
+typedef struct
+{
+    SymbolTableNode *head;
+    SymbolTableNode *tail;
+    SymbolTableBlock *blocks;
+    SymbolTableNode **firstNodes; /* Name id -> first node with the name */
+    int numOfFirstNodes;
+    StringPool names;
+    int *entryIds; /* Names of the .entry directives */
+    int numOfEntries;
+    int entriesCapacity;
+    ExternReferenceList externReferences; /* Appended on encoding */
+} SymbolTable;
+
+void GetSymbolDetails(const SymbolTable *symbolTable,
+                      int symbolId,
                       Symbol *symbol,
-                      bool *errorHasOccurred,
+                      Diagnostics *diagnostics,
                       int lineNumber);
-bool IsValidMacro(const SymbolTableNode *symbolTableHead,
-                  const char *macroName,
+bool IsValidMacro(const SymbolTable *symbolTable,
+                  Span macroName,
                   int *value,
-                  bool *errorHasOccurred,
+                  Diagnostics *diagnostics,
                   int lineNumber);
-void SetSymbolParams(Symbol *symbol,
-                     const char *name,
-                     SymbolCharacteristic type,
-                     int value);
-void UpdateExternValue(SymbolTableNode *symbolTableHead,
-                       const char *symbolName,
-                       int newValue,
-                       bool *errorHasOccurred,
-                       int lineNumber);
-void UpdateDataSymbols(SymbolTableNode *symbolTableHead, int valueToAdd);
-void UpdateSymbolTypeToEntry(SymbolTableNode *symbolTableHead, const char *symbol);
-void WriteToFileByType(FILE *file,
-                       SymbolTableNode *symbolTableHead,
-                       SymbolCharacteristic type);
+void AddExternReference(ExternReferenceList *externReferences,
+                        int symbolId,
+                        int address,
+                        Diagnostics *diagnostics,
+                        int lineNumber);
+ReturnStatus AppendExternReferences(ExternReferenceList *externReferences,
+                                    const ExternReferenceList *other);
+void UpdateDataSymbols(SymbolTable *symbolTable, int valueToAdd);
+void UpdateSymbolTypeToEntry(SymbolTable *symbolTable, int symbolId);
+void UpdateEntrySymbols(SymbolTable *symbolTable);
+int InternSymbolName(SymbolTable *symbolTable,
+                     Span name,
+                     Diagnostics *diagnostics,
+                     int lineNumber);
+const char *GetSymbolName(const SymbolTable *symbolTable, int symbolId);
+char *FormatSymbolsByType(const SymbolTable *symbolTable,
+                          SymbolCharacteristic type,
+                          size_t *length);
+char *FormatExternReferences(const SymbolTable *symbolTable, size_t *length);
 
-void InsertMacroToSymbolTable(const char *macroSentence,
-                              SymbolTableNode **symbolTableHead,
-                              bool *errorHasOccurred,
+void InsertSymbolById(SymbolTable *symbolTable,
+                      int symbolId,
+                      SymbolCharacteristic type,
+                      int value,
+                      Diagnostics *diagnostics,
+                      int lineNumber);
+void AddEntrySymbol(SymbolTable *symbolTable,
+                    int symbolId,
+                    Diagnostics *diagnostics,
+                    int lineNumber);
+
+void InsertMacroToSymbolTable(const Sentence *macroSentence,
+                              SymbolTable *symbolTable,
+                              Diagnostics *diagnostics,
+                              int lineNumber);
+int InsertSymbolToSymbolTable(const Sentence *sentenceWithSymbol,
+                              SymbolTable *symbolTable,
+                              SymbolCharacteristic characteristic,
+                              int counter,
+                              Diagnostics *diagnostics,
+                              int lineNumber);
+int InsertExternToSymbolTable(const Sentence *externSentence,
+                              SymbolTable *symbolTable,
+                              Diagnostics *diagnostics,
                               int lineNumber);
-void InsertSymbolToSymbolTable(const char *sentenceWithSymbol,
-                               SymbolTableNode **symbolTableHead,
-                               SymbolCharacteristic characteristic,
-                               int counter,
-                               bool *errorHasOccurred,
-                               int lineNumber);
-void InsertExternToSymbolTable(const char *externSentence,
-                               SymbolTableNode **symbolTableHead,
-                               bool *errorHasOccurred,
-                               int lineNumber);
+int InsertEntryToSymbolTable(const Sentence *entrySentence,
+                             SymbolTable *symbolTable,
+                             Diagnostics *diagnostics,
+                             int lineNumber);
 
-void DestroySymbolTable(SymbolTableNode *head);
+void DestroySymbolTable(SymbolTable *symbolTable);
 
 #endif /* ASSEMBLER_SYMBOL_TABLE_H */
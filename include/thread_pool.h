@@ -0,0 +1,25 @@
+/****************************************
+* ASSEMBLER: thread_pool.h              *
+****************************************/
+
+#ifndef ASSEMBLER_THREAD_POOL_H
+#define ASSEMBLER_THREAD_POOL_H
+
+#include "assembler_utils.h" /* Utils file */
+
+typedef void (*TaskFunction)(void *argument);
+
+typedef struct threadPool ThreadPool;
+
+/* Fixed set of worker threads. Every worker has its own task queue and
+ * steals from the other queues when its own queue is empty. */
+ThreadPool *CreateThreadPool(int numOfThreads);
+ReturnStatus SubmitTask(ThreadPool *threadPool,
+                        TaskFunction function,
+                        void *argument);
+void WaitForTasks(ThreadPool *threadPool);
+void DestroyThreadPool(ThreadPool *threadPool);
+
+int GetNumOfProcessors(void);
+
+#endif /* ASSEMBLER_THREAD_POOL_H */
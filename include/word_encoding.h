@@ -0,0 +1,58 @@
+/****************************************
+* ASSEMBLER: word_encoding.h            *
+****************************************/
+
+#ifndef ASSEMBLER_WORD_ENCODING_H
+#define ASSEMBLER_WORD_ENCODING_H
+
+#include <stddef.h> /* size_t */
+
+#include "memory_word.h"     /* MEMORY_WORD_SIZE_IN_BITS, MEMORY_WORD_MASK */
+#include "assembler_utils.h" /* Utils file */
+
+/* A word of the object file is written as 7 base 4 digits, most
+ * significant first: '*', '#', '%' and '!' are 0-3 */
+#define ENCODED_WORD_SIZE (MEMORY_WORD_SIZE_IN_BITS / 2)
+
+/* Encodings are kept ENCODED_WORD_STRIDE bytes apart; the byte after
+ * every encoding is padding (written as '*', ignored when read) */
+#define ENCODED_WORD_STRIDE (8)
+
+/* Words encoded or decoded at a time by the object file readers and writer */
+#define WORD_BATCH_SIZE (256)
+
+typedef enum
+{
+    SCALAR_WORD_CODEC, /* A table of all the encodings, any processor */
+    SSSE3_WORD_CODEC,  /* 8 words at a time with 16-byte shuffles */
+    AVX2_WORD_CODEC,   /* 16 words at a time with 32-byte shuffles */
+    NUM_OF_WORD_CODECS
+} WordCodec;
+
+/* The words of the lines of an object file, read but not decoded yet */
+typedef struct
+{
+    char encodings[WORD_BATCH_SIZE * ENCODED_WORD_STRIDE];
+    unsigned long addresses[WORD_BATCH_SIZE];
+    int lineNumbers[WORD_BATCH_SIZE];
+    size_t numOfWords;
+} EncodedWordBatch;
+
+WordCodec GetWordCodec(void);
+bool IsWordCodecSupported(WordCodec codec);
+const char *GetWordCodecName(WordCodec codec);
+
+void EncodeWords(WordCodec codec,
+                 char *encodings,
+                 const unsigned short *words,
+                 size_t numOfWords);
+size_t DecodeWords(WordCodec codec,
+                   unsigned short *words,
+                   const char *encodings,
+                   size_t numOfWords);
+bool AddToWordBatch(EncodedWordBatch *batch,
+                    const char *encodedWord,
+                    unsigned long address,
+                    int lineNumber);
+
+#endif /* ASSEMBLER_WORD_ENCODING_H */
@@ -0,0 +1,179 @@
+/****************************************
+* ASSEMBLER: assembler.c                *
+****************************************/
+
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memset, memcpy, strlen */
+#include <assert.h> /* assert */
+
+#include "assembler.h"       /* API */
+#include "file_scanner.h"    /* API */
+#include "source_reader.h"   /* API */
+#include "symbol_table.h"    /* API */
+#include "diagnostics.h"     /* API */
+#include "assembler_utils.h" /* Utils file */
+
+static ReturnStatus FillAssemblyResult(const Assembly *assembly,
+                                       const Diagnostics *diagnostics,
+                                       AssemblyResult *result);
+static char *CopySymbol(AssemblySymbol *assemblySymbol,
+                        const char *name,
+                        int address,
+                        char *chars);
+
+/* Every piece of state lives in this call: the source is read in place and
+ * the diagnostics are collected in a buffer */
+int AssembleSource(const char *source, size_t length, AssemblyResult *result)
+{
+    Assembly assembly = {{0}};
+    SourceReader sourceReader;
+    Diagnostics diagnostics = {0};
+
+    assert(NULL != source || 0 == length);
+    assert(NULL != result);
+
+    memset(result, 0, sizeof(AssemblyResult));
+
+    OpenSourceBuffer(&sourceReader, source, length);
+    ScanSource(&sourceReader, &assembly, NULL, &diagnostics);
+
+    if (SUCCESS != FillAssemblyResult(&assembly, &diagnostics, result))
+    {
+        memset(result, 0, sizeof(AssemblyResult));
+        result->hasErrors = TRUE;
+    }
+
+    DestroyAssembly(&assembly);
+    CloseSourceReader(&sourceReader);
+    DestroyDiagnostics(&diagnostics);
+
+    return result->hasErrors ? ERROR : SUCCESS;
+}
+
+void DestroyAssemblyResult(AssemblyResult *result)
+{
+    assert(NULL != result);
+
+    free(result->memory);
+    memset(result, 0, sizeof(AssemblyResult));
+}
+
+/* Static functions */
+
+/* The symbols come first, then the words and then the characters, so every
+ * array in the single allocation is aligned */
+static ReturnStatus FillAssemblyResult(const Assembly *assembly,
+                                       const Diagnostics *diagnostics,
+                                       AssemblyResult *result)
+{
+    const SymbolTable *symbolTable = &assembly->symbolTable;
+    const SymbolTableNode *node = NULL;
+    const MemorySegment *instructionSegment = &assembly->instructionSegment;
+    const MemorySegment *dataSegment = &assembly->dataSegment;
+    AssemblySymbol *assemblySymbol = NULL;
+    size_t numOfWords = 0, numOfSymbols = 0, numOfChars = 0, i = 0;
+    char *chars = NULL;
+
+    result->hasErrors = diagnostics->errorHasOccurred;
+
+    if (!result->hasErrors)
+    {
+        for (node = symbolTable->head; NULL != node; node = node->next)
+        {
+            if (ENTRY == node->symbol.type)
+            {
+                ++result->numOfEntries;
+                numOfChars += strlen(GetSymbolName(symbolTable, node->symbol.nameId)) + 1;
+            }
+        }
+
+        for (i = 0; i < (size_t)symbolTable->externReferences.numOfReferences; ++i)
+        {
+            numOfChars += strlen(GetSymbolName(symbolTable,
+                                               symbolTable->externReferences.references[i].symbolId)) + 1;
+        }
+
+        result->numOfExterns = symbolTable->externReferences.numOfReferences;
+        result->numOfCodeWords = instructionSegment->numOfWords;
+        result->numOfDataWords = dataSegment->numOfWords;
+    }
+
+    numOfSymbols = result->numOfEntries + result->numOfExterns;
+    numOfWords = result->numOfCodeWords + result->numOfDataWords;
+    numOfChars += diagnostics->length + 1;
+
+    result->memory = malloc(numOfSymbols * sizeof(AssemblySymbol) +
+                            numOfWords * sizeof(unsigned short) +
+                            numOfChars);
+    if (NULL == result->memory)
+    {
+        return FAILURE;
+    }
+
+    result->entries = (AssemblySymbol *)result->memory;
+    result->externs = result->entries + result->numOfEntries;
+    result->words = (unsigned short *)(result->externs + result->numOfExterns);
+    chars = (char *)(result->words + numOfWords);
+
+    if (result->numOfCodeWords > 0)
+    {
+        memcpy(result->words,
+               instructionSegment->words,
+               result->numOfCodeWords * sizeof(MemoryWord));
+    }
+
+    if (result->numOfDataWords > 0)
+    {
+        memcpy(result->words + result->numOfCodeWords,
+               dataSegment->words,
+               result->numOfDataWords * sizeof(MemoryWord));
+    }
+
+    assemblySymbol = result->entries;
+    for (node = symbolTable->head;
+         NULL != node && 0 != result->numOfEntries;
+         node = node->next)
+    {
+        if (ENTRY == node->symbol.type)
+        {
+            chars = CopySymbol(assemblySymbol++,
+                               GetSymbolName(symbolTable, node->symbol.nameId),
+                               node->symbol.value,
+                               chars);
+        }
+    }
+
+    for (i = 0; i < result->numOfExterns; ++i)
+    {
+        const ExternReference *reference = symbolTable->externReferences.references + i;
+
+        chars = CopySymbol(result->externs + i,
+                           GetSymbolName(symbolTable, reference->symbolId),
+                           reference->address,
+                           chars);
+    }
+
+    result->diagnostics = chars;
+    if (0 != diagnostics->length)
+    {
+        memcpy(chars, diagnostics->buffer, diagnostics->length);
+    }
+    chars[diagnostics->length] = END_LINE;
+
+    return SUCCESS;
+}
+
+/* Returns the characters after the copied name */
+static char *CopySymbol(AssemblySymbol *assemblySymbol,
+                        const char *name,
+                        int address,
+                        char *chars)
+{
+    size_t nameLen = strlen(name);
+
+    memcpy(chars, name, nameLen + 1);
+    assemblySymbol->name = chars;
+    assemblySymbol->address = address;
+
+    return chars + nameLen + 1;
+}
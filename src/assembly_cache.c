@@ -0,0 +1,542 @@
+/****************************************
+* ASSEMBLER: assembly_cache.c           *
+****************************************/
+
+#include <assert.h> /* assert */
+#include <stdio.h>  /* FILE, fopen, fclose, fwrite, rename, remove */
+#include <stdlib.h> /* malloc, calloc, realloc, free */
+#include <string.h> /* memcmp, memcpy, memchr, memset, strlen, strcpy, strcat */
+
+#include "assembly_cache.h"    /* API */
+#include "sentence_analyzer.h" /* API */
+#include "string_pool.h"       /* HashString, AddToHash */
+#include "operations.h"        /* GetOperation, IsLegalInstruction */
+
+#define CACHE_VERSION (2)
+#define INITIAL_SENTENCES_CAPACITY (1024)
+#define MACRO_SIGNATURE_FACTOR (1000003UL)
+#define LOOKAHEAD (8)
+
+static const char CACHE_MAGIC[8] = {'A', 'S', 'M', 'C', 'A', 'C', 'H', 'E'};
+static const char *TEMPORARY_FILE_POSTFIX = ".tmp";
+static const char *READING_MODE = "rb";
+static const char *WRITING_MODE = "wb";
+
+/* The cache file is the header, the sentences, the data words (as unsigned
+ * shorts), the source and the names of the symbols. It is
+ * only read back by the build that wrote it, so it is in native layout.
+ * The checksum covers everything after the header, so a damaged file is
+ * not used even where its fields look valid. */
+typedef struct
+{
+    char magic[8];
+    unsigned long version;
+    unsigned long sentenceSize;
+    unsigned long numOfSentences;
+    unsigned long numOfDataWords;
+    unsigned long textSize;
+    unsigned long namesSize;
+    unsigned long numOfNames;
+    unsigned long checksum; /* HashString of the rest of the file */
+} CacheHeader;
+
+static ReturnStatus MapCacheFile(AssemblyCache *cache);
+static bool IsValidCachedSentence(const AssemblyCache *cache,
+                                  const CachedSentence *sentence,
+                                  unsigned long textSize);
+static bool IsValidCachedInstruction(const AssemblyCache *cache, const Instruction *instruction);
+static bool IsValidSymbolId(const AssemblyCache *cache, int symbolId);
+static bool IsSameSentence(const AssemblyCache *cache,
+                           const CachedSentence *sentence,
+                           Span text,
+                           unsigned long hash);
+static ReturnStatus BuildBuckets(AssemblyCache *cache);
+static ReturnStatus WriteCacheFile(const AssemblyCache *cache,
+                                   FILE *file,
+                                   const SymbolTable *symbolTable,
+                                   const MemorySegment *dataSegment);
+
+/* A missing, stale or damaged cache file leaves the cache empty (so every
+ * line is parsed) */
+void LoadAssemblyCache(AssemblyCache *cache, const char *filename)
+{
+    FILE *file = NULL;
+
+    assert(NULL != cache);
+    assert(NULL != filename);
+
+    memset(cache, 0, sizeof(AssemblyCache));
+
+    file = fopen(filename, READING_MODE);
+    if (NULL == file)
+    {
+        return;
+    }
+
+    if (SUCCESS != OpenSourceReader(&cache->file, file) ||
+        SUCCESS != MapCacheFile(cache))
+    {
+        DestroyAssemblyCache(cache);
+    }
+
+    fclose(file);
+}
+
+/* The symbol ids in the cached sentences are those of the previous
+ * assembly, so its names are interned first, in the same order. The
+ * source must stay open until the cache is saved. */
+void StartCachedScan(AssemblyCache *cache,
+                     const SourceReader *sourceReader,
+                     SymbolTable *symbolTable,
+                     Diagnostics *diagnostics)
+{
+    const char *name = NULL;
+    size_t i = 0;
+
+    assert(NULL != cache);
+    assert(NULL != sourceReader);
+    assert(NULL != symbolTable);
+
+    cache->source = sourceReader->data;
+    cache->sourceSize = sourceReader->size;
+
+    /* Most lines are usually recorded again */
+    if (cache->numOfSentences > 0)
+    {
+        cache->newSentences = (CachedSentence *)malloc(cache->numOfSentences *
+                                                       sizeof(CachedSentence));
+        if (NULL != cache->newSentences)
+        {
+            cache->newSentencesCapacity = cache->numOfSentences;
+        }
+    }
+
+    for (name = cache->names; i < cache->numOfNames; ++i)
+    {
+        Span span;
+
+        span.start = name;
+        span.length = strlen(name);
+        if ((int)i != InternSymbolName(symbolTable, span, diagnostics, 0))
+        {
+            cache->numOfSentences = 0; /* No sentence can be used */
+            return;
+        }
+
+        name += span.length + 1;
+    }
+}
+
+/* Returns the sentence of a line with the same text and the same .define
+ * lines before it, or NULL. Lines are usually found in order, so the
+ * sentences after the last one found are tried before the hash index
+ * (which is only built for the first line that is not among them). */
+const CachedSentence *FindCachedSentence(AssemblyCache *cache,
+                                         Span text,
+                                         unsigned long hash)
+{
+    size_t i = 0, end = 0, bucket = 0;
+
+    assert(NULL != cache);
+
+    end = cache->cursor + LOOKAHEAD;
+    if (end > cache->numOfSentences)
+    {
+        end = cache->numOfSentences;
+    }
+
+    for (i = cache->cursor; i < end; ++i)
+    {
+        if (IsSameSentence(cache, cache->sentences + i, text, hash))
+        {
+            cache->cursor = i + 1;
+            return cache->sentences + i;
+        }
+    }
+
+    if (NULL == cache->buckets && SUCCESS != BuildBuckets(cache))
+    {
+        return NULL;
+    }
+
+    for (bucket = hash & (cache->numOfBuckets - 1);
+         0 != cache->buckets[bucket];
+         bucket = (bucket + 1) & (cache->numOfBuckets - 1))
+    {
+        i = cache->buckets[bucket] - 1;
+        if (IsSameSentence(cache, cache->sentences + i, text, hash))
+        {
+            cache->cursor = i + 1;
+            return cache->sentences + i;
+        }
+    }
+
+    return NULL;
+}
+
+/* A line after a .define line can only reuse a sentence that had the same
+ * .define lines before it */
+void AddMacroSentence(AssemblyCache *cache, unsigned long hash)
+{
+    assert(NULL != cache);
+
+    cache->macroSignature = cache->macroSignature * MACRO_SIGNATURE_FACTOR + hash;
+}
+
+/* The text is a sentence of the source given to StartCachedScan */
+ReturnStatus RecordSentence(AssemblyCache *cache,
+                            Span text,
+                            unsigned long hash,
+                            const CachedSentence *sentence)
+{
+    CachedSentence *newSentence = NULL;
+
+    assert(NULL != cache);
+    assert(NULL != sentence);
+    assert(text.start >= cache->source &&
+           text.start + text.length <= cache->source + cache->sourceSize);
+
+    if (cache->numOfNewSentences == cache->newSentencesCapacity)
+    {
+        size_t newCapacity = (0 == cache->newSentencesCapacity)
+                                 ? INITIAL_SENTENCES_CAPACITY
+                                 : 2 * cache->newSentencesCapacity;
+        CachedSentence *newSentences = NULL;
+
+        newSentences = (CachedSentence *)realloc(cache->newSentences,
+                                                 newCapacity * sizeof(CachedSentence));
+        if (NULL == newSentences)
+        {
+            return FAILURE;
+        }
+
+        cache->newSentences = newSentences;
+        cache->newSentencesCapacity = newCapacity;
+    }
+
+    newSentence = cache->newSentences + cache->numOfNewSentences++;
+    *newSentence = *sentence;
+    newSentence->hash = hash;
+    newSentence->macroSignature = cache->macroSignature;
+    newSentence->textOffset = (unsigned long)(text.start - cache->source);
+    newSentence->textLength = text.length;
+
+    return SUCCESS;
+}
+
+/* The file is written under a temporary name and renamed, so a build that
+ * stops half way leaves the previous cache file */
+ReturnStatus SaveAssemblyCache(const AssemblyCache *cache,
+                               const char *filename,
+                               const SymbolTable *symbolTable,
+                               const MemorySegment *dataSegment)
+{
+    char temporaryFilename[MAX_FILENAME_SIZE] = {0};
+    FILE *file = NULL;
+    ReturnStatus status = SUCCESS;
+
+    assert(NULL != cache);
+    assert(NULL != filename);
+    assert(NULL != symbolTable);
+    assert(NULL != dataSegment);
+
+    if (strlen(filename) + strlen(TEMPORARY_FILE_POSTFIX) >= MAX_FILENAME_SIZE)
+    {
+        return FAILURE;
+    }
+
+    strcpy(temporaryFilename, filename);
+    strcat(temporaryFilename, TEMPORARY_FILE_POSTFIX);
+
+    file = fopen(temporaryFilename, WRITING_MODE);
+    if (NULL == file)
+    {
+        return FAILURE;
+    }
+
+    status = WriteCacheFile(cache, file, symbolTable, dataSegment);
+    if (0 != fclose(file))
+    {
+        status = FAILURE;
+    }
+
+    if (SUCCESS != status || 0 != rename(temporaryFilename, filename))
+    {
+        remove(temporaryFilename);
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+void DestroyAssemblyCache(AssemblyCache *cache)
+{
+    assert(NULL != cache);
+
+    CloseSourceReader(&cache->file);
+    free(cache->buckets);
+    free(cache->newSentences);
+    memset(cache, 0, sizeof(AssemblyCache));
+}
+
+/* Static functions */
+static ReturnStatus MapCacheFile(AssemblyCache *cache)
+{
+    CacheHeader header;
+    const char *data = cache->file.data;
+    unsigned long expectedSize = sizeof(CacheHeader);
+    size_t i = 0;
+
+    if (cache->file.size < sizeof(CacheHeader))
+    {
+        return FAILURE;
+    }
+
+    memcpy(&header, data, sizeof(CacheHeader));
+    if (0 != memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) ||
+        CACHE_VERSION != header.version ||
+        sizeof(CachedSentence) != header.sentenceSize)
+    {
+        return FAILURE;
+    }
+
+    expectedSize += header.numOfSentences * sizeof(CachedSentence) +
+                    header.numOfDataWords * sizeof(unsigned short) +
+                    header.textSize +
+                    header.namesSize;
+    if (expectedSize != cache->file.size ||
+        header.checksum != HashString(data + sizeof(CacheHeader), cache->file.size - sizeof(CacheHeader)))
+    {
+        return FAILURE;
+    }
+
+    data += sizeof(CacheHeader);
+    cache->sentences = (const CachedSentence *)data;
+    cache->numOfSentences = header.numOfSentences;
+
+    data += header.numOfSentences * sizeof(CachedSentence);
+    cache->dataWords = (const unsigned short *)data;
+    cache->numOfDataWords = header.numOfDataWords;
+
+    data += header.numOfDataWords * sizeof(unsigned short);
+    cache->text = data;
+
+    data += header.textSize;
+    cache->names = data;
+    cache->numOfNames = header.numOfNames;
+
+    /* Every name ends with a NUL */
+    for (i = 0; i < header.numOfNames; ++i)
+    {
+        const char *end = (const char *)memchr(data,
+                                               END_LINE,
+                                               (size_t)(cache->names + header.namesSize - data));
+        if (NULL == end)
+        {
+            return FAILURE;
+        }
+
+        data = end + 1;
+    }
+
+    for (i = 0; i < cache->numOfSentences; ++i)
+    {
+        if (!IsValidCachedSentence(cache, cache->sentences + i, header.textSize))
+        {
+            return FAILURE;
+        }
+    }
+
+    return SUCCESS;
+}
+
+static bool IsValidCachedSentence(const AssemblyCache *cache,
+                                  const CachedSentence *sentence,
+                                  unsigned long textSize)
+{
+    if (sentence->textOffset > textSize ||
+        sentence->textLength > textSize - sentence->textOffset ||
+        sentence->firstDataWord < 0 ||
+        sentence->numOfDataWords < 0 ||
+        (size_t)sentence->firstDataWord + sentence->numOfDataWords > cache->numOfDataWords ||
+        (NO_SYMBOL != sentence->symbolId && !IsValidSymbolId(cache, sentence->symbolId)))
+    {
+        return FALSE;
+    }
+
+    switch (sentence->type)
+    {
+    case DATA_SENTENCE:
+    case STRING_SENTENCE:
+    {
+        return TRUE;
+    }
+
+    case EXTERN_SENTENCE:
+    case ENTRY_SENTENCE:
+    {
+        return IsValidSymbolId(cache, sentence->symbolId);
+    }
+
+    case INSTRUCTION_SENTENCE:
+    {
+        return IsValidCachedInstruction(cache, &sentence->instruction);
+    }
+
+    default:
+    {
+        return FALSE;
+    }
+    }
+}
+
+/* The replay adds numOfMemoryWords to IC, and the encoding writes the
+ * words of the addressing methods, so the two must agree */
+static bool IsValidCachedInstruction(const AssemblyCache *cache, const Instruction *instruction)
+{
+    const Operand *src = &instruction->srcOperand, *dest = &instruction->destOperand;
+
+    if (instruction->operationCode >= NUM_OF_OPERATIONS ||
+        instruction->numOfOperands != GetOperation(instruction->operationCode)->numOfOperands ||
+        src->addressingMethod > DIRECT_REGISTER_ADDRESSING ||
+        dest->addressingMethod > DIRECT_REGISTER_ADDRESSING ||
+        !IsLegalInstruction(GetOperation(instruction->operationCode),
+                            src->addressingMethod,
+                            dest->addressingMethod) ||
+        instruction->numOfMemoryWords != GetNumOfMemoryWords(instruction))
+    {
+        return FALSE;
+    }
+
+    return ((IMMEDIATE_ADDRESSING == src->addressingMethod ||
+             DIRECT_REGISTER_ADDRESSING == src->addressingMethod ||
+             IsValidSymbolId(cache, src->symbolId)) &&
+            (IMMEDIATE_ADDRESSING == dest->addressingMethod ||
+             DIRECT_REGISTER_ADDRESSING == dest->addressingMethod ||
+             IsValidSymbolId(cache, dest->symbolId)));
+}
+
+static bool IsValidSymbolId(const AssemblyCache *cache, int symbolId)
+{
+    return (symbolId >= 0 && (size_t)symbolId < cache->numOfNames);
+}
+
+static bool IsSameSentence(const AssemblyCache *cache,
+                           const CachedSentence *sentence,
+                           Span text,
+                           unsigned long hash)
+{
+    return (sentence->hash == hash &&
+            sentence->macroSignature == cache->macroSignature &&
+            sentence->textLength == text.length &&
+            0 == memcmp(cache->text + sentence->textOffset, text.start, text.length));
+}
+
+/* Open addressing with at least twice as many buckets as sentences. When
+ * there is no memory for it, no sentence is used any more. */
+static ReturnStatus BuildBuckets(AssemblyCache *cache)
+{
+    size_t i = 0;
+
+    if (0 == cache->numOfSentences)
+    {
+        return FAILURE;
+    }
+
+    for (cache->numOfBuckets = 1;
+         cache->numOfBuckets < 2 * cache->numOfSentences;
+         cache->numOfBuckets *= 2)
+    {
+    }
+
+    cache->buckets = (int *)calloc(cache->numOfBuckets, sizeof(int));
+    if (NULL == cache->buckets)
+    {
+        cache->numOfBuckets = 0;
+        cache->numOfSentences = 0;
+        return FAILURE;
+    }
+
+    for (i = 0; i < cache->numOfSentences; ++i)
+    {
+        size_t bucket = cache->sentences[i].hash & (cache->numOfBuckets - 1);
+
+        while (0 != cache->buckets[bucket])
+        {
+            bucket = (bucket + 1) & (cache->numOfBuckets - 1);
+        }
+
+        cache->buckets[bucket] = (int)i + 1;
+    }
+
+    return SUCCESS;
+}
+
+static ReturnStatus WriteCacheFile(const AssemblyCache *cache,
+                                   FILE *file,
+                                   const SymbolTable *symbolTable,
+                                   const MemorySegment *dataSegment)
+{
+    CacheHeader header;
+    char *names = NULL, *end = NULL;
+    int id = 0;
+
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.sentenceSize = sizeof(CachedSentence);
+    header.numOfSentences = cache->numOfNewSentences;
+    header.numOfDataWords = dataSegment->numOfWords;
+    header.textSize = cache->sourceSize;
+    header.numOfNames = symbolTable->names.numOfStrings;
+    for (id = 0; id < symbolTable->names.numOfStrings; ++id)
+    {
+        header.namesSize += strlen(GetSymbolName(symbolTable, id)) + 1;
+    }
+
+    /* The names are copied together, as one write per name is slow */
+    names = (char *)malloc(header.namesSize + 1);
+    if (NULL == names)
+    {
+        return FAILURE;
+    }
+
+    for (id = 0, end = names; id < symbolTable->names.numOfStrings; ++id)
+    {
+        const char *name = GetSymbolName(symbolTable, id);
+        size_t length = strlen(name) + 1;
+
+        memcpy(end, name, length);
+        end += length;
+    }
+
+    header.checksum = HashString((const char *)cache->newSentences,
+                                 cache->numOfNewSentences * sizeof(CachedSentence));
+    header.checksum = AddToHash(header.checksum,
+                                (const char *)dataSegment->words,
+                                dataSegment->numOfWords * sizeof(MemoryWord));
+    header.checksum = AddToHash(header.checksum, cache->source, cache->sourceSize);
+    header.checksum = AddToHash(header.checksum, names, header.namesSize);
+
+    if (1 != fwrite(&header, sizeof(CacheHeader), 1, file) ||
+        (0 != cache->numOfNewSentences &&
+         cache->numOfNewSentences != fwrite(cache->newSentences,
+                                            sizeof(CachedSentence),
+                                            cache->numOfNewSentences,
+                                            file)) ||
+        (0 != dataSegment->numOfWords &&
+         dataSegment->numOfWords != fwrite(dataSegment->words,
+                                           sizeof(MemoryWord),
+                                           dataSegment->numOfWords,
+                                           file)) ||
+        cache->sourceSize != fwrite(cache->source, 1, cache->sourceSize, file) ||
+        header.namesSize != fwrite(names, 1, header.namesSize, file))
+    {
+        free(names);
+        return FAILURE;
+    }
+
+    free(names);
+
+    return SUCCESS;
+}
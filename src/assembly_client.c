@@ -0,0 +1,145 @@
+/****************************************
+* ASSEMBLER: assembly_client.c          *
+****************************************/
+
+#include <signal.h> /* signal, SIGPIPE, SIG_IGN */
+#include <stdio.h>  /* FILE, fopen, fclose, fputs, stderr */
+#include <stdlib.h> /* free */
+#include <string.h> /* strerror, strcpy, strcat, strlen */
+#include <errno.h>  /* errno */
+#include <assert.h> /* assert */
+
+#include "assembly_service.h" /* API */
+#include "socket_stream.h"    /* API */
+#include "files_builder.h"    /* API */
+#include "source_reader.h"    /* API */
+#include "diagnostics.h"      /* API */
+#include "assembler_utils.h"  /* Utils file */
+
+static const char *ASSEMBLY_FILE_POSTFIX = ".as";
+static const char *READING_MODE = "r";
+
+static ReturnStatus AssembleRemotely(SocketStream *connection,
+                                     const char *filename,
+                                     Diagnostics *diagnostics);
+static ReturnStatus ReceiveReply(SocketStream *connection,
+                                 const char *filename,
+                                 Diagnostics *diagnostics);
+
+/* Sends the files one by one and writes the returned files next to them,
+ * exactly like a local assembly. Returns the number of files handled: the
+ * caller assembles the rest locally (all of them when no server listens). */
+int RunAssemblyClient(const char *socketPath, char *filenames[], int numOfFiles)
+{
+    SocketStream connection;
+    int connectedSocket = 0, i = 0;
+
+    assert(NULL != socketPath);
+    assert(NULL != filenames);
+
+    connectedSocket = ConnectToSocket(socketPath);
+    if (ERROR == connectedSocket)
+    {
+        return 0;
+    }
+
+    OpenSocketStream(&connection, connectedSocket);
+
+    signal(SIGPIPE, SIG_IGN); /* A server that went away is a failed send */
+
+    for (i = 0; i < numOfFiles; ++i)
+    {
+        Diagnostics diagnostics = {0};
+
+        diagnostics.stream = stderr;
+        if (SUCCESS != AssembleRemotely(&connection, filenames[i], &diagnostics))
+        {
+            break;
+        }
+    }
+
+    CloseSocketStream(&connection);
+
+    return i;
+}
+
+/* Static functions */
+
+/* Returns FAILURE only when the connection failed */
+static ReturnStatus AssembleRemotely(SocketStream *connection,
+                                     const char *filename,
+                                     Diagnostics *diagnostics)
+{
+    FILE *assemblyFile = NULL;
+    SourceReader sourceReader;
+    char filenameWithPostfix[MAX_FILENAME_SIZE] = {0};
+    ReturnStatus status = SUCCESS;
+
+    strcpy(filenameWithPostfix, filename);
+    strcat(filenameWithPostfix, ASSEMBLY_FILE_POSTFIX);
+
+    assemblyFile = fopen(filenameWithPostfix, READING_MODE);
+    if (NULL == assemblyFile)
+    {
+        ReportWarning(diagnostics,
+                      "Error opening file \"%s\": %s\n",
+                      filenameWithPostfix,
+                      strerror(errno));
+        return SUCCESS;
+    }
+
+    if (SUCCESS != OpenSourceReader(&sourceReader, assemblyFile))
+    {
+        ReportError(diagnostics, "Error reading the source of \"%s\"\n", filename);
+    }
+    else if (SUCCESS != SendNumber(connection, SOURCE_REQUEST) ||
+             SUCCESS != SendText(connection, filename, strlen(filename)) ||
+             SUCCESS != SendText(connection,
+                                 (NULL != sourceReader.data) ? sourceReader.data : "",
+                                 sourceReader.size) ||
+             SUCCESS != FlushSocketStream(connection) ||
+             SUCCESS != ReceiveReply(connection, filename, diagnostics))
+    {
+        status = FAILURE;
+    }
+
+    CloseSourceReader(&sourceReader);
+    fclose(assemblyFile);
+
+    return status;
+}
+
+static ReturnStatus ReceiveReply(SocketStream *connection,
+                                 const char *filename,
+                                 Diagnostics *diagnostics)
+{
+    FileTexts fileTexts = {0};
+    char *messages = NULL;
+    size_t messagesLength = 0;
+    unsigned long hasErrors = 0;
+    ReturnStatus status = FAILURE;
+
+    if (SUCCESS == ReceiveNumber(connection, &hasErrors) &&
+        SUCCESS == ReceiveText(connection, &fileTexts.object, &fileTexts.objectLength) &&
+        SUCCESS == ReceiveText(connection, &fileTexts.entries, &fileTexts.entriesLength) &&
+        SUCCESS == ReceiveText(connection, &fileTexts.externs, &fileTexts.externsLength) &&
+        SUCCESS == ReceiveText(connection, &messages, &messagesLength))
+    {
+        if (NULL != messages)
+        {
+            fputs(messages, diagnostics->stream);
+        }
+
+        if (!hasErrors)
+        {
+            WriteFiles(&fileTexts, filename, diagnostics);
+        }
+
+        status = SUCCESS;
+    }
+
+    free(messages);
+    DestroyFileTexts(&fileTexts);
+
+    return status;
+}
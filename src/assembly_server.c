@@ -0,0 +1,252 @@
+/****************************************
+* ASSEMBLER: assembly_server.c          *
+****************************************/
+
+#include <sys/socket.h> /* accept */
+#include <unistd.h>     /* close, unlink */
+#include <signal.h>     /* signal, SIGPIPE, SIG_IGN */
+#include <stdio.h>      /* FILE, fopen, fclose, fprintf, perror */
+#include <stdlib.h>     /* malloc, free, EXIT_FAILURE */
+#include <string.h>     /* strerror, strcpy, strcat, strlen */
+#include <errno.h>      /* errno, EINTR, EADDRINUSE */
+#include <assert.h>     /* assert */
+
+#include "assembly_service.h" /* API */
+#include "socket_stream.h"    /* API */
+#include "thread_pool.h"      /* API */
+#include "file_scanner.h"     /* API */
+#include "files_builder.h"    /* API */
+#include "source_reader.h"    /* API */
+#include "diagnostics.h"      /* API */
+#include "assembler_utils.h"  /* Utils file */
+
+static const char *ASSEMBLY_FILE_POSTFIX = ".as";
+static const char *READING_MODE = "r";
+
+typedef struct
+{
+    unsigned long kind;
+    char *name;
+    size_t nameLength;
+    char *source;
+    size_t sourceLength;
+} AssemblyRequest;
+
+static void ServeConnection(void *argument);
+static ReturnStatus ReceiveRequest(SocketStream *connection, AssemblyRequest *request);
+static void DestroyRequest(AssemblyRequest *request);
+static ReturnStatus AnswerRequest(SocketStream *connection,
+                                  const AssemblyRequest *request);
+static void AssembleRequest(const AssemblyRequest *request,
+                            FileTexts *fileTexts,
+                            Diagnostics *diagnostics);
+
+/* Every connection is served by one worker of the pool, so a slow client
+ * holds one worker and not the whole server. Runs until it is killed. */
+int RunAssemblyServer(const char *socketPath, int numOfJobs)
+{
+    ThreadPool *threadPool = NULL;
+    int listeningSocket = 0;
+
+    assert(NULL != socketPath);
+    assert(numOfJobs > 0);
+
+    signal(SIGPIPE, SIG_IGN); /* A client that went away is a failed send */
+
+    listeningSocket = OpenListeningSocket(socketPath);
+    if (ERROR == listeningSocket && EADDRINUSE == errno)
+    {
+        fprintf(stderr, "Error: a server is already running on \"%s\"\n", socketPath);
+        return EXIT_FAILURE;
+    }
+
+    if (ERROR == listeningSocket)
+    {
+        fprintf(stderr, "Error listening on \"%s\": %s\n", socketPath, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    threadPool = CreateThreadPool(numOfJobs);
+    if (NULL == threadPool)
+    {
+        fprintf(stderr, "Memory allocation error\n");
+        close(listeningSocket);
+        return EXIT_FAILURE;
+    }
+
+    for (;;)
+    {
+        SocketStream *connection = NULL;
+        int newConnection = accept(listeningSocket, NULL, NULL);
+
+        if (newConnection < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+
+            perror("accept");
+            break;
+        }
+
+        connection = (SocketStream *)malloc(sizeof(SocketStream));
+        if (NULL == connection)
+        {
+            close(newConnection);
+            continue;
+        }
+
+        OpenSocketStream(connection, newConnection);
+        if (SUCCESS != SubmitTask(threadPool, ServeConnection, connection))
+        {
+            ServeConnection(connection);
+        }
+    }
+
+    DestroyThreadPool(threadPool);
+    close(listeningSocket);
+    unlink(socketPath);
+
+    return EXIT_FAILURE;
+}
+
+/* Static functions */
+static void ServeConnection(void *argument)
+{
+    SocketStream *connection = (SocketStream *)argument;
+    AssemblyRequest request;
+
+    while (SUCCESS == ReceiveRequest(connection, &request))
+    {
+        ReturnStatus status = AnswerRequest(connection, &request);
+
+        DestroyRequest(&request);
+        if (SUCCESS != status)
+        {
+            break;
+        }
+    }
+
+    CloseSocketStream(connection);
+    free(connection);
+}
+
+static ReturnStatus ReceiveRequest(SocketStream *connection, AssemblyRequest *request)
+{
+    memset(request, 0, sizeof(AssemblyRequest));
+
+    if (SUCCESS != ReceiveNumber(connection, &request->kind) ||
+        (SOURCE_REQUEST != request->kind && PATH_REQUEST != request->kind) ||
+        SUCCESS != ReceiveText(connection, &request->name, &request->nameLength) ||
+        SUCCESS != ReceiveText(connection, &request->source, &request->sourceLength) ||
+        NULL == request->name ||
+        (SOURCE_REQUEST == request->kind && NULL == request->source))
+    {
+        DestroyRequest(request);
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+static void DestroyRequest(AssemblyRequest *request)
+{
+    free(request->name);
+    free(request->source);
+    memset(request, 0, sizeof(AssemblyRequest));
+}
+
+static ReturnStatus AnswerRequest(SocketStream *connection,
+                                  const AssemblyRequest *request)
+{
+    FileTexts fileTexts = {0};
+    Diagnostics diagnostics = {0};
+    ReturnStatus status = SUCCESS;
+
+    AssembleRequest(request, &fileTexts, &diagnostics);
+
+    if (SUCCESS != SendNumber(connection, diagnostics.errorHasOccurred) ||
+        SUCCESS != SendText(connection, fileTexts.object, fileTexts.objectLength) ||
+        SUCCESS != SendText(connection, fileTexts.entries, fileTexts.entriesLength) ||
+        SUCCESS != SendText(connection, fileTexts.externs, fileTexts.externsLength) ||
+        SUCCESS != SendText(connection,
+                            (NULL != diagnostics.buffer) ? diagnostics.buffer : "",
+                            diagnostics.length) ||
+        SUCCESS != FlushSocketStream(connection))
+    {
+        status = FAILURE;
+    }
+
+    DestroyFileTexts(&fileTexts);
+    DestroyDiagnostics(&diagnostics);
+
+    return status;
+}
+
+static void AssembleRequest(const AssemblyRequest *request,
+                            FileTexts *fileTexts,
+                            Diagnostics *diagnostics)
+{
+    Assembly assembly = {{0}};
+    SourceReader sourceReader;
+    FILE *assemblyFile = NULL;
+
+    if (PATH_REQUEST == request->kind)
+    {
+        char filenameWithPostfix[MAX_FILENAME_SIZE] = {0};
+
+        if (request->nameLength + strlen(ASSEMBLY_FILE_POSTFIX) >= MAX_FILENAME_SIZE)
+        {
+            ReportError(diagnostics, "Error: the file name \"%s\" is too long\n", request->name);
+            return;
+        }
+
+        strcpy(filenameWithPostfix, request->name);
+        strcat(filenameWithPostfix, ASSEMBLY_FILE_POSTFIX);
+
+        assemblyFile = fopen(filenameWithPostfix, READING_MODE);
+        if (NULL == assemblyFile)
+        {
+            ReportError(diagnostics,
+                        "Error opening file \"%s\": %s\n",
+                        filenameWithPostfix,
+                        strerror(errno));
+            return;
+        }
+
+        if (SUCCESS != OpenSourceReader(&sourceReader, assemblyFile))
+        {
+            ReportError(diagnostics, "Error reading the source of \"%s\"\n", request->name);
+            CloseSourceReader(&sourceReader);
+            fclose(assemblyFile);
+            return;
+        }
+    }
+    else
+    {
+        OpenSourceBuffer(&sourceReader, request->source, request->sourceLength);
+    }
+
+    ScanSource(&sourceReader, &assembly, NULL, diagnostics);
+
+    if (!diagnostics->errorHasOccurred &&
+        SUCCESS != FormatFiles(&assembly.instructionSegment,
+                               &assembly.dataSegment,
+                               &assembly.symbolTable,
+                               assembly.hasEntries,
+                               assembly.hasExternals,
+                               TEXT_OBJECT,
+                               fileTexts))
+    {
+        ReportError(diagnostics, "Memory allocation error\n");
+        DestroyFileTexts(fileTexts);
+    }
+
+    DestroyAssembly(&assembly);
+    CloseSourceReader(&sourceReader);
+    if (NULL != assemblyFile)
+    {
+        fclose(assemblyFile);
+    }
+}
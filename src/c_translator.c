@@ -0,0 +1,933 @@
+/****************************************
+* ASSEMBLER: c_translator.c             *
+****************************************/
+
+#include <stdio.h>  /* vsnprintf, sprintf */
+#include <stdarg.h> /* va_list, va_start, va_end */
+#include <stdlib.h> /* calloc, realloc, free */
+#include <string.h> /* strlen, memcpy, memset */
+#include <assert.h> /* assert */
+
+#include "c_translator.h"      /* API */
+#include "simulator.h"         /* MEMORY_SIZE, the fields of the words */
+#include "operations.h"        /* API */
+#include "instruction_table.h" /* AddressingMethods */
+#include "memory_word.h"       /* MEMORY_WORD_MASK */
+#include "assembler_utils.h"   /* Utils file */
+
+#define INITIAL_TEXT_CAPACITY (64 * 1024)
+#define MAX_LINE_SIZE (256)
+#define MAX_OPERAND_SIZE (32)
+/* "L_", a label and a NUL */
+#define MAX_TARGET_SIZE (MAX_LABEL_SIZE + 3)
+#define WORDS_PER_LINE (12)
+
+/* The generated code before the tables: the machine the simulator runs */
+static const char *const MACHINE_LINES[] = {
+    "#include <stdio.h>",
+    "#include <stdlib.h>",
+    "#include <string.h>",
+    "#include <limits.h>",
+    "",
+    "#define SIGN_EXTEND_VALUE(value) ((long)((value) ^ VALUE_SIGN_BIT) - VALUE_SIGN_BIT)",
+    "#define TO_SIGNED(word) ((int)(((word) ^ WORD_SIGN_BIT) & WORD_MASK) - WORD_SIGN_BIT)",
+    "#define SRC_ADDRESSING_METHOD(word) (((word) >> 4) & 3)",
+    "#define DEST_ADDRESSING_METHOD(word) (((word) >> 2) & 3)",
+    "#define JUMP_TARGET(word, dest) \\",
+    "    ((REGISTER_ADDRESSING == DEST_ADDRESSING_METHOD(word)) ? *(dest) : (unsigned int)((dest) - memory))",
+    "",
+    "enum",
+    "{",
+    "    IMMEDIATE_ADDRESSING,",
+    "    DIRECT_ADDRESSING,",
+    "    FIXED_INDEX_ADDRESSING,",
+    "    REGISTER_ADDRESSING",
+    "};",
+    "",
+    "/* As the simulator reports them */",
+    "enum",
+    "{",
+    "    STOPPED,",
+    "    OUT_OF_STEPS,",
+    "    ILLEGAL_INSTRUCTION,",
+    "    ADDRESS_ERROR,",
+    "    STACK_ERROR",
+    "};",
+    "",
+    "static const char *const STATUS_NAMES[] = {\"stopped\", \"out of steps\", \"illegal instruction\",",
+    "                                           \"address out of memory\", \"return stack error\"};",
+    NULL};
+
+/* The generated code between the tables and the translated code */
+static const char *const INTERPRETER_LINES[] = {
+    "static unsigned short memory[MEMORY_SIZE + MEMORY_PADDING];",
+    "static unsigned short registers[NUM_OF_REGISTERS];",
+    "static unsigned short returnStack[RETURN_STACK_SIZE];",
+    "static int stackPointer = 0;",
+    "static int zeroFlag = 0;",
+    "static unsigned int pc = STARTING_ADDRESS;",
+    "static unsigned long stepsLeft = ULONG_MAX;",
+    "",
+    "/* Points to the operand whose words are at the pc and moves the pc past",
+    " * them; NULL for an index out of memory */",
+    "static unsigned short *GetOperand(unsigned int addressingMethod,",
+    "                                  unsigned int registerShift,",
+    "                                  unsigned short *immediate)",
+    "{",
+    "    unsigned int word = memory[pc++];",
+    "    long address = 0;",
+    "",
+    "    switch (addressingMethod)",
+    "    {",
+    "    case IMMEDIATE_ADDRESSING:",
+    "        *immediate = (unsigned short)(SIGN_EXTEND_VALUE(word >> 2) & WORD_MASK);",
+    "        return immediate;",
+    "    case DIRECT_ADDRESSING:",
+    "        return memory + (word >> 2);",
+    "    case FIXED_INDEX_ADDRESSING:",
+    "        address = (long)(word >> 2) + SIGN_EXTEND_VALUE(memory[pc++] >> 2);",
+    "        return (address < 0 || address >= MEMORY_SIZE) ? NULL : memory + address;",
+    "    default:",
+    "        return registers + ((word >> registerShift) & REGISTER_MASK);",
+    "    }",
+    "}",
+    "",
+    "/* Runs from the pc as the simulator does, for the code that was not",
+    " * translated; instructionAddress is reported if the pc is out of memory */",
+    "static int Interpret(unsigned int instructionAddress)",
+    "{",
+    "    unsigned short srcImmediate = 0, destImmediate = 0;",
+    "    unsigned short *src = NULL, *dest = NULL;",
+    "    unsigned int word = 0;",
+    "    int operation = 0;",
+    "",
+    "    for (;;)",
+    "    {",
+    "        if (pc >= MEMORY_SIZE)",
+    "        {",
+    "            pc = instructionAddress;",
+    "            return ADDRESS_ERROR;",
+    "        }",
+    "",
+    "        if (0 == stepsLeft)",
+    "        {",
+    "            return OUT_OF_STEPS;",
+    "        }",
+    "",
+    "        --stepsLeft;",
+    "        instructionAddress = pc;",
+    "        word = memory[pc++];",
+    "        operation = OPERATIONS[(word >> 2) & 255];",
+    "        if (operation < 0)",
+    "        {",
+    "            pc = instructionAddress;",
+    "            return ILLEGAL_INSTRUCTION;",
+    "        }",
+    "",
+    "        src = &srcImmediate;",
+    "        dest = &destImmediate;",
+    "        if (2 == NUM_OF_OPERANDS[operation] &&",
+    "            REGISTER_ADDRESSING == SRC_ADDRESSING_METHOD(word) &&",
+    "            REGISTER_ADDRESSING == DEST_ADDRESSING_METHOD(word))",
+    "        {",
+    "            unsigned int registersWord = memory[pc++];",
+    "",
+    "            src = registers + ((registersWord >> SRC_REGISTER_SHIFT) & REGISTER_MASK);",
+    "            dest = registers + ((registersWord >> DEST_REGISTER_SHIFT) & REGISTER_MASK);",
+    "        }",
+    "        else",
+    "        {",
+    "            if (2 == NUM_OF_OPERANDS[operation])",
+    "            {",
+    "                src = GetOperand(SRC_ADDRESSING_METHOD(word), SRC_REGISTER_SHIFT, &srcImmediate);",
+    "            }",
+    "",
+    "            if (NULL != src && 0 != NUM_OF_OPERANDS[operation])",
+    "            {",
+    "                dest = GetOperand(DEST_ADDRESSING_METHOD(word), DEST_REGISTER_SHIFT, &destImmediate);",
+    "            }",
+    "        }",
+    "",
+    "        if (NULL == src || NULL == dest)",
+    "        {",
+    "            pc = instructionAddress;",
+    "            return ADDRESS_ERROR;",
+    "        }",
+    "",
+    "        switch (operation)",
+    "        {",
+    "        case MOV:",
+    "            *dest = *src;",
+    "            break;",
+    "        case CMP:",
+    "            zeroFlag = (*src == *dest);",
+    "            break;",
+    "        case ADD:",
+    "            *dest = (unsigned short)((*dest + *src) & WORD_MASK);",
+    "            break;",
+    "        case SUB:",
+    "            *dest = (unsigned short)((*dest - *src) & WORD_MASK);",
+    "            break;",
+    "        case NOT:",
+    "            *dest = (unsigned short)(~*dest & WORD_MASK);",
+    "            break;",
+    "        case CLR:",
+    "            *dest = 0;",
+    "            break;",
+    "        case LEA:",
+    "            *dest = (unsigned short)(src - memory);",
+    "            break;",
+    "        case INC:",
+    "            *dest = (unsigned short)((*dest + 1) & WORD_MASK);",
+    "            break;",
+    "        case DEC:",
+    "            *dest = (unsigned short)((*dest - 1) & WORD_MASK);",
+    "            break;",
+    "        case JMP:",
+    "            pc = JUMP_TARGET(word, dest);",
+    "            break;",
+    "        case BNE:",
+    "            if (!zeroFlag)",
+    "            {",
+    "                pc = JUMP_TARGET(word, dest);",
+    "            }",
+    "            break;",
+    "        case RED:",
+    "            *dest = (unsigned short)(getchar() & WORD_MASK);",
+    "            break;",
+    "        case PRN:",
+    "            printf(\"%d\\n\", TO_SIGNED(*dest));",
+    "            break;",
+    "        case JSR:",
+    "            if (RETURN_STACK_SIZE == stackPointer)",
+    "            {",
+    "                pc = instructionAddress;",
+    "                return STACK_ERROR;",
+    "            }",
+    "            returnStack[stackPointer++] = (unsigned short)pc;",
+    "            pc = JUMP_TARGET(word, dest);",
+    "            break;",
+    "        case RTS:",
+    "            if (0 == stackPointer)",
+    "            {",
+    "                pc = instructionAddress;",
+    "                return STACK_ERROR;",
+    "            }",
+    "            pc = returnStack[--stackPointer];",
+    "            break;",
+    "        default:",
+    "            pc = instructionAddress;",
+    "            return STOPPED;",
+    "        }",
+    "    }",
+    "}",
+    "",
+    "/* The translated code keeps the registers, the zero flag and the steps",
+    " * in locals, and leaves them in the machine whenever it returns */",
+    "#define SAVE()                                                            \\",
+    "    (registers[0] = r0, registers[1] = r1, registers[2] = r2, registers[3] = r3, \\",
+    "     registers[4] = r4, registers[5] = r5, registers[6] = r6, registers[7] = r7, \\",
+    "     zeroFlag = z, stepsLeft = steps)",
+    "#define STEP(address) if (0 == steps) { pc = (address); SAVE(); return OUT_OF_STEPS; } --steps",
+    "#define END(address, status) { pc = (address); SAVE(); return (status); }",
+    "#define INTERPRET(address, next) { pc = (next); SAVE(); return Interpret(address); }",
+    "#define STORE(lvalue, value) ((lvalue) = (unsigned short)((value) & WORD_MASK))",
+    NULL};
+
+/* The generated code after the translated code */
+static const char *const MAIN_LINES[] = {
+    "/* The same lines as simulator -m */",
+    "static void PrintMachine(unsigned long numOfSteps)",
+    "{",
+    "    unsigned int i = 0;",
+    "",
+    "    fprintf(stderr, \"steps: %lu\\nzero flag: %d\\nregisters:\", numOfSteps, zeroFlag);",
+    "    for (i = 0; i < NUM_OF_REGISTERS; ++i)",
+    "    {",
+    "        fprintf(stderr, \" %u\", registers[i]);",
+    "    }",
+    "",
+    "    fprintf(stderr, \"\\nreturn stack:\");",
+    "    for (i = 0; i < (unsigned int)stackPointer; ++i)",
+    "    {",
+    "        fprintf(stderr, \" %u\", returnStack[i]);",
+    "    }",
+    "",
+    "    fprintf(stderr, \"\\nmemory:\\n\");",
+    "    for (i = 0; i < MEMORY_SIZE; ++i)",
+    "    {",
+    "        if (0 != memory[i])",
+    "        {",
+    "            fprintf(stderr, \"%04u %u\\n\", i, memory[i]);",
+    "        }",
+    "    }",
+    "}",
+    "",
+    "int main(int argc, char *argv[])",
+    "{",
+    "    unsigned long maxSteps = 0;",
+    "    int i = 1, status = STOPPED, printMachine = 0;",
+    "",
+    "    for (; i < argc; ++i)",
+    "    {",
+    "        if (0 == strcmp(argv[i], \"-s\") && i + 1 < argc)",
+    "        {",
+    "            maxSteps = strtoul(argv[++i], NULL, 10);",
+    "        }",
+    "        else if (0 == strcmp(argv[i], \"-m\"))",
+    "        {",
+    "            printMachine = 1;",
+    "        }",
+    "        else",
+    "        {",
+    "            fprintf(stderr, \"Usage: %s [-s MAX_STEPS] [-m]\\n\", argv[0]);",
+    "            return EXIT_FAILURE;",
+    "        }",
+    "    }",
+    "",
+    "    memcpy(memory + STARTING_ADDRESS, WORDS, NUM_OF_WORDS * sizeof(WORDS[0]));",
+    "    stepsLeft = (0 == maxSteps) ? ULONG_MAX : maxSteps;",
+    "",
+    "    status = RunProgram();",
+    "    fflush(stdout);",
+    "",
+    "    if (STOPPED != status)",
+    "    {",
+    "        fprintf(stderr, \"%s: %s at address %04u\\n\", argv[0], STATUS_NAMES[status], pc);",
+    "    }",
+    "",
+    "    if (printMachine)",
+    "    {",
+    "        PrintMachine(((0 == maxSteps) ? ULONG_MAX : maxSteps) - stepsLeft);",
+    "    }",
+    "",
+    "    return (STOPPED == status) ? EXIT_SUCCESS : EXIT_FAILURE;",
+    "}",
+    NULL};
+
+/* A text that grows as it is written */
+typedef struct
+{
+    char *text;
+    size_t length;
+    size_t capacity;
+    bool hasFailed;
+} TextBuilder;
+
+/* An operand of a translated instruction */
+typedef struct
+{
+    unsigned int addressingMethod; /* AddressingMethods */
+    char expression[MAX_OPERAND_SIZE]; /* Its value in C (an lvalue unless immediate) */
+    long address;                  /* In memory (DIRECT/FIXED_INDEX) */
+} TranslatedOperand;
+
+/* An instruction of the code, decoded from its words */
+typedef struct
+{
+    const Operation *operation; /* NULL when illegal */
+    unsigned int length;
+    bool isInMemory; /* FALSE for an index out of memory */
+    TranslatedOperand src;
+    TranslatedOperand dest;
+} TranslatedInstruction;
+
+typedef struct
+{
+    MemoryWord memory[MEMORY_SIZE + MEMORY_PADDING];
+    unsigned char lengths[MEMORY_SIZE]; /* Of the translated instruction at an address, or 0 */
+    bool isTarget[MEMORY_SIZE];         /* A label is written before the instruction */
+    const char *labels[MEMORY_SIZE];    /* Names of the code symbols, or NULL */
+    unsigned long numOfWords;
+    unsigned int codeEnd; /* Past the last translated instruction */
+    bool hasIndirectJumps;
+    TextBuilder text;
+} Translation;
+
+static void FindInstructions(Translation *translation);
+static void FindLabels(Translation *translation, const SymbolTable *symbolTable);
+static void DecodeInstruction(const Translation *translation,
+                              unsigned int address,
+                              TranslatedInstruction *instruction);
+static void DecodeOperand(const Translation *translation,
+                          unsigned int *address,
+                          unsigned int addressingMethod,
+                          unsigned int registerShift,
+                          TranslatedOperand *operand);
+static void WriteTables(Translation *translation);
+static void WriteProgramFunction(Translation *translation);
+static void WriteInstruction(Translation *translation, unsigned int address);
+static void WriteJump(Translation *translation,
+                      unsigned int address,
+                      const TranslatedOperand *target,
+                      const char *indent);
+static void GetTarget(const Translation *translation, unsigned int address, char *target);
+static bool IsStoreToCode(const Translation *translation, const TranslatedOperand *dest);
+static void AppendLines(TextBuilder *text, const char *const *lines);
+static void AppendText(TextBuilder *text, const char *format, ...);
+static void AppendString(TextBuilder *text, const char *string);
+
+char *TranslateToC(const MemoryWord *instructions,
+                   unsigned long instructionCounter,
+                   const MemoryWord *data,
+                   unsigned long dataCounter,
+                   const SymbolTable *symbolTable,
+                   size_t *length)
+{
+    Translation *translation = NULL;
+    char *text = NULL;
+
+    assert(NULL != instructions || 0 == instructionCounter);
+    assert(NULL != data || 0 == dataCounter);
+    assert(NULL != length);
+
+    translation = (Translation *)calloc(1, sizeof(Translation));
+    if (NULL == translation)
+    {
+        return NULL;
+    }
+
+    /* The simulator does not load a program larger than its memory */
+    if (instructionCounter > MEMORY_SIZE - STARTING_ADDRESS)
+    {
+        instructionCounter = MEMORY_SIZE - STARTING_ADDRESS;
+    }
+    if (dataCounter > MEMORY_SIZE - STARTING_ADDRESS - instructionCounter)
+    {
+        dataCounter = MEMORY_SIZE - STARTING_ADDRESS - instructionCounter;
+    }
+
+    if (0 != instructionCounter) /* A program of data only has no code words */
+    {
+        memcpy(translation->memory + STARTING_ADDRESS,
+               instructions,
+               instructionCounter * sizeof(MemoryWord));
+    }
+    if (0 != dataCounter)
+    {
+        memcpy(translation->memory + STARTING_ADDRESS + instructionCounter,
+               data,
+               dataCounter * sizeof(MemoryWord));
+    }
+    translation->numOfWords = instructionCounter + dataCounter;
+    translation->codeEnd = STARTING_ADDRESS + instructionCounter;
+
+    FindInstructions(translation);
+    if (NULL != symbolTable)
+    {
+        FindLabels(translation, symbolTable);
+    }
+
+    AppendString(&translation->text,
+                 "/* An assembled program translated to C by the assembler (--emit-c).\n"
+                 " * It runs as the simulator runs the program: prn to stdout, red from\n"
+                 " * stdin, -s MAX_STEPS stops it after MAX_STEPS instructions and -m\n"
+                 " * prints the registers and the memory at the end. */\n\n");
+    AppendLines(&translation->text, MACHINE_LINES);
+    WriteTables(translation);
+    AppendLines(&translation->text, INTERPRETER_LINES);
+    WriteProgramFunction(translation);
+    AppendLines(&translation->text, MAIN_LINES);
+
+    if (translation->text.hasFailed)
+    {
+        free(translation->text.text);
+    }
+    else
+    {
+        text = translation->text.text;
+        *length = translation->text.length;
+    }
+
+    free(translation);
+
+    return text;
+}
+
+/* Static functions */
+
+/* Walks the code from STARTING_ADDRESS one instruction at a time. The
+ * code ends with the instruction counter, or earlier at an instruction
+ * that would run past the end of memory. */
+static void FindInstructions(Translation *translation)
+{
+    TranslatedInstruction instruction;
+    unsigned int address = STARTING_ADDRESS, end = translation->codeEnd;
+
+    while (address < end)
+    {
+        DecodeInstruction(translation, address, &instruction);
+        if (address + instruction.length > MEMORY_SIZE)
+        {
+            break;
+        }
+
+        translation->lengths[address] = (unsigned char)instruction.length;
+
+        if (NULL != instruction.operation && instruction.isInMemory)
+        {
+            switch (MOV_HANDLER + instruction.operation->code)
+            {
+            case JMP_HANDLER:
+            case BNE_HANDLER:
+            case JSR_HANDLER:
+                if (DIRECT_REGISTER_ADDRESSING == instruction.dest.addressingMethod)
+                {
+                    translation->hasIndirectJumps = TRUE;
+                }
+                else if (instruction.dest.address >= STARTING_ADDRESS &&
+                         instruction.dest.address < MEMORY_SIZE)
+                {
+                    translation->isTarget[instruction.dest.address] = TRUE;
+                }
+                break;
+            case RTS_HANDLER:
+                translation->hasIndirectJumps = TRUE;
+                break;
+            default:
+                break;
+            }
+        }
+
+        address += instruction.length;
+    }
+
+    translation->codeEnd = address;
+
+    /* A jump to any instruction goes through a switch on the pc */
+    if (translation->hasIndirectJumps)
+    {
+        for (address = STARTING_ADDRESS; address < translation->codeEnd; ++address)
+        {
+            translation->isTarget[address] = (0 != translation->lengths[address]);
+        }
+    }
+}
+
+/* Code labels (and entries) name the instructions they are on */
+static void FindLabels(Translation *translation, const SymbolTable *symbolTable)
+{
+    const SymbolTableNode *currentNode = NULL;
+
+    for (currentNode = symbolTable->head; NULL != currentNode; currentNode = currentNode->next)
+    {
+        const Symbol *symbol = &currentNode->symbol;
+
+        if ((CODE == symbol->type || ENTRY == symbol->type) &&
+            symbol->value >= STARTING_ADDRESS &&
+            symbol->value < MEMORY_SIZE &&
+            0 != translation->lengths[symbol->value])
+        {
+            translation->labels[symbol->value] = GetSymbolName(symbolTable, symbol->nameId);
+        }
+    }
+}
+
+/* Decodes the instruction at the address the way the simulator does */
+static void DecodeInstruction(const Translation *translation,
+                              unsigned int address,
+                              TranslatedInstruction *instruction)
+{
+    unsigned int word = translation->memory[address], next = address + 1;
+    const Operation *operation = GetOperation(OPERATION_CODE(word));
+
+    memset(instruction, 0, sizeof(TranslatedInstruction));
+    instruction->isInMemory = TRUE;
+
+    if (!IsLegalInstruction(operation, SRC_ADDRESSING_METHOD(word), DEST_ADDRESSING_METHOD(word)))
+    {
+        instruction->length = 1;
+        return;
+    }
+
+    instruction->operation = operation;
+
+    /* Two register operands share one word */
+    if (2 == operation->numOfOperands &&
+        DIRECT_REGISTER_ADDRESSING == SRC_ADDRESSING_METHOD(word) &&
+        DIRECT_REGISTER_ADDRESSING == DEST_ADDRESSING_METHOD(word))
+    {
+        unsigned int registersWord = translation->memory[next++];
+
+        instruction->src.addressingMethod = DIRECT_REGISTER_ADDRESSING;
+        instruction->dest.addressingMethod = DIRECT_REGISTER_ADDRESSING;
+        sprintf(instruction->src.expression, "r%u", (registersWord >> SRC_REGISTER_SHIFT) & REGISTER_MASK);
+        sprintf(instruction->dest.expression, "r%u", (registersWord >> DEST_REGISTER_SHIFT) & REGISTER_MASK);
+    }
+    else
+    {
+        if (2 == operation->numOfOperands)
+        {
+            DecodeOperand(translation, &next, SRC_ADDRESSING_METHOD(word), SRC_REGISTER_SHIFT, &instruction->src);
+            instruction->isInMemory = (instruction->src.address >= 0);
+        }
+
+        if (instruction->isInMemory && 0 != operation->numOfOperands)
+        {
+            DecodeOperand(translation, &next, DEST_ADDRESSING_METHOD(word), DEST_REGISTER_SHIFT, &instruction->dest);
+            instruction->isInMemory = (instruction->dest.address >= 0);
+        }
+    }
+
+    instruction->length = next - address;
+}
+
+/* An index out of memory leaves a negative address */
+static void DecodeOperand(const Translation *translation,
+                          unsigned int *address,
+                          unsigned int addressingMethod,
+                          unsigned int registerShift,
+                          TranslatedOperand *operand)
+{
+    unsigned int operandWord = translation->memory[(*address)++];
+
+    operand->addressingMethod = addressingMethod;
+
+    switch (addressingMethod)
+    {
+    case IMMEDIATE_ADDRESSING:
+        sprintf(operand->expression, "%ld", SIGN_EXTEND_VALUE(operandWord >> 2) & MEMORY_WORD_MASK);
+        break;
+
+    case DIRECT_ADDRESSING:
+        operand->address = (long)(operandWord >> 2);
+        sprintf(operand->expression, "memory[%ld]", operand->address);
+        break;
+
+    case FIXED_INDEX_ADDRESSING:
+        operand->address = (long)(operandWord >> 2) +
+                           SIGN_EXTEND_VALUE(translation->memory[(*address)++] >> 2);
+        if (operand->address >= MEMORY_SIZE)
+        {
+            operand->address = -1;
+        }
+        sprintf(operand->expression, "memory[%ld]", operand->address);
+        break;
+
+    default:
+        sprintf(operand->expression, "r%u", (operandWord >> registerShift) & REGISTER_MASK);
+        break;
+    }
+}
+
+/* The constants, the decoding tables and the words of the program */
+static void WriteTables(Translation *translation)
+{
+    TextBuilder *text = &translation->text;
+    unsigned long i = 0;
+    int code = 0;
+
+    AppendText(text, "\n#define MEMORY_SIZE (%d)\n", MEMORY_SIZE);
+    AppendText(text, "#define MEMORY_PADDING (%d)\n", MEMORY_PADDING);
+    AppendText(text, "#define NUM_OF_REGISTERS (%d)\n", NUM_OF_REGISTERS);
+    AppendText(text, "#define REGISTER_MASK (%d)\n", REGISTER_MASK);
+    AppendText(text, "#define SRC_REGISTER_SHIFT (%d)\n", SRC_REGISTER_SHIFT);
+    AppendText(text, "#define DEST_REGISTER_SHIFT (%d)\n", DEST_REGISTER_SHIFT);
+    AppendText(text, "#define RETURN_STACK_SIZE (%d)\n", RETURN_STACK_SIZE);
+    AppendText(text, "#define STARTING_ADDRESS (%d)\n", STARTING_ADDRESS);
+    AppendText(text, "#define WORD_MASK (%d)\n", MEMORY_WORD_MASK);
+    AppendText(text, "#define WORD_SIGN_BIT (%d)\n", WORD_SIGN_BIT);
+    AppendText(text, "#define VALUE_SIGN_BIT (%d)\n", VALUE_SIGN_BIT);
+    AppendText(text, "#define NUM_OF_WORDS (%lu)\n\nenum\n{\n", translation->numOfWords);
+
+    for (code = 0; code < NUM_OF_OPERATIONS; ++code)
+    {
+        const char *name = GetOperation(code)->name;
+
+        AppendString(text, "    ");
+        for (; END_LINE != *name; ++name)
+        {
+            AppendText(text, "%c", *name - 'a' + 'A');
+        }
+        AppendString(text, (NUM_OF_OPERATIONS - 1 == code) ? "\n};\n\n" : ",\n");
+    }
+
+    AppendString(text, "/* The operation of a first word by its bits 2-9, -1 when its addressing\n"
+                       " * methods are illegal */\n"
+                       "static const signed char OPERATIONS[256] = {");
+    for (i = 0; i < NUM_OF_DISPATCH_INDEXES; ++i)
+    {
+        unsigned int word = (unsigned int)i << 2;
+        const Operation *operation = GetOperation(OPERATION_CODE(word));
+
+        AppendText(text,
+                   "%s%s%d",
+                   (0 == i) ? "" : ",",
+                   (0 == i % 16) ? "\n    " : " ",
+                   IsLegalInstruction(operation, SRC_ADDRESSING_METHOD(word), DEST_ADDRESSING_METHOD(word))
+                       ? (int)operation->code
+                       : -1);
+    }
+
+    AppendString(text, "};\n\nstatic const unsigned char NUM_OF_OPERANDS[] = {");
+    for (code = 0; code < NUM_OF_OPERATIONS; ++code)
+    {
+        AppendText(text, "%s%d", (0 == code) ? "" : ", ", GetOperation(code)->numOfOperands);
+    }
+
+    /* One word more, so that an empty program is valid C */
+    AppendString(text, "};\n\n/* Loaded from STARTING_ADDRESS */\n"
+                       "static const unsigned short WORDS[NUM_OF_WORDS + 1] = {");
+    for (i = 0; i < translation->numOfWords; ++i)
+    {
+        AppendText(text,
+                   "%s%u,",
+                   (0 == i % WORDS_PER_LINE) ? "\n    " : " ",
+                   translation->memory[STARTING_ADDRESS + i]);
+    }
+    AppendString(text, "\n    0};\n\n");
+}
+
+/* RunProgram: the translated instructions, in the order of the code */
+static void WriteProgramFunction(Translation *translation)
+{
+    TextBuilder *text = &translation->text;
+    unsigned int address = STARTING_ADDRESS, lastAddress = STARTING_ADDRESS;
+    char target[MAX_TARGET_SIZE] = {0};
+
+    AppendString(text,
+                 "\n/* The code of the program, translated */\n"
+                 "static int RunProgram(void)\n"
+                 "{\n"
+                 "    unsigned short r0 = registers[0], r1 = registers[1], r2 = registers[2], r3 = registers[3];\n"
+                 "    unsigned short r4 = registers[4], r5 = registers[5], r6 = registers[6], r7 = registers[7];\n"
+                 "    int z = zeroFlag;\n"
+                 "    unsigned long steps = stepsLeft;\n");
+    if (translation->hasIndirectJumps)
+    {
+        AppendString(text, "    unsigned int from = 0; /* The address of an indirect jump */\n");
+    }
+    AppendString(text, "\n");
+
+    for (; address < translation->codeEnd; address += translation->lengths[address])
+    {
+        WriteInstruction(translation, address);
+        lastAddress = address;
+    }
+
+    /* Past the code, the data runs in the interpreter */
+    AppendText(text, "    INTERPRET(%u, %u);\n", lastAddress, translation->codeEnd);
+
+    if (translation->hasIndirectJumps)
+    {
+        AppendString(text, "\ndispatch:\n    switch (pc)\n    {\n");
+        for (address = STARTING_ADDRESS; address < translation->codeEnd; address += translation->lengths[address])
+        {
+            GetTarget(translation, address, target);
+            AppendText(text, "    case %u:\n        goto %s;\n", address, target);
+        }
+        AppendString(text, "    default:\n        INTERPRET(from, pc);\n    }\n");
+    }
+
+    AppendString(text, "}\n\n");
+}
+
+static void WriteInstruction(Translation *translation, unsigned int address)
+{
+    TextBuilder *text = &translation->text;
+    TranslatedInstruction instruction;
+    const TranslatedOperand *src = &instruction.src, *dest = &instruction.dest;
+    unsigned int next = 0;
+    char target[MAX_TARGET_SIZE] = {0};
+
+    DecodeInstruction(translation, address, &instruction);
+    next = address + instruction.length;
+
+    if (translation->isTarget[address])
+    {
+        GetTarget(translation, address, target);
+        AppendText(text, "%s:\n", target);
+    }
+
+    AppendText(text,
+               "    /* %04u %s */\n    STEP(%u);\n",
+               address,
+               (NULL != instruction.operation) ? instruction.operation->name : "(illegal)",
+               address);
+
+    if (NULL == instruction.operation)
+    {
+        AppendText(text, "    END(%u, ILLEGAL_INSTRUCTION);\n", address);
+        return;
+    }
+
+    if (!instruction.isInMemory)
+    {
+        AppendText(text, "    END(%u, ADDRESS_ERROR);\n", address);
+        return;
+    }
+
+    switch (MOV_HANDLER + instruction.operation->code)
+    {
+    case MOV_HANDLER:
+        AppendText(text, "    %s = %s;\n", dest->expression, src->expression);
+        break;
+    case CMP_HANDLER:
+        AppendText(text, "    z = (%s == %s);\n", src->expression, dest->expression);
+        break;
+    case ADD_HANDLER:
+    case SUB_HANDLER:
+        AppendText(text,
+                   "    STORE(%s, %s %c %s);\n",
+                   dest->expression,
+                   dest->expression,
+                   (ADD_HANDLER - MOV_HANDLER == instruction.operation->code) ? PLUS_SIGN : MINUS_SIGN,
+                   src->expression);
+        break;
+    case NOT_HANDLER:
+        AppendText(text, "    STORE(%s, ~%s);\n", dest->expression, dest->expression);
+        break;
+    case CLR_HANDLER:
+        AppendText(text, "    %s = 0;\n", dest->expression);
+        break;
+    case LEA_HANDLER:
+        AppendText(text, "    %s = %ld;\n", dest->expression, src->address);
+        break;
+    case INC_HANDLER:
+    case DEC_HANDLER:
+        AppendText(text,
+                   "    STORE(%s, %s %c 1);\n",
+                   dest->expression,
+                   dest->expression,
+                   (INC_HANDLER - MOV_HANDLER == instruction.operation->code) ? PLUS_SIGN : MINUS_SIGN);
+        break;
+    case JMP_HANDLER:
+        WriteJump(translation, address, dest, "    ");
+        return;
+    case BNE_HANDLER:
+        AppendString(text, "    if (!z)\n    {\n");
+        WriteJump(translation, address, dest, "        ");
+        AppendString(text, "    }\n");
+        return;
+    case RED_HANDLER:
+        AppendText(text, "    STORE(%s, getchar());\n", dest->expression);
+        break;
+    case PRN_HANDLER:
+        AppendText(text, "    printf(\"%%d\\n\", TO_SIGNED(%s));\n", dest->expression);
+        return;
+    case JSR_HANDLER:
+        AppendText(text, "    if (RETURN_STACK_SIZE == stackPointer) END(%u, STACK_ERROR);\n", address);
+        AppendText(text, "    returnStack[stackPointer++] = %u;\n", next);
+        WriteJump(translation, address, dest, "    ");
+        return;
+    case RTS_HANDLER:
+        AppendText(text, "    if (0 == stackPointer) END(%u, STACK_ERROR);\n", address);
+        AppendText(text, "    from = %u;\n    pc = returnStack[--stackPointer];\n    goto dispatch;\n", address);
+        return;
+    default:
+        AppendText(text, "    END(%u, STOPPED);\n", address);
+        return;
+    }
+
+    /* The code after a write to it runs in the interpreter */
+    if (IsStoreToCode(translation, dest))
+    {
+        AppendText(text, "    INTERPRET(%u, %u);\n", address, next);
+    }
+}
+
+/* A jump to a register goes through the switch on the pc, a jump to an
+ * address that is not a translated instruction to the interpreter */
+static void WriteJump(Translation *translation,
+                      unsigned int address,
+                      const TranslatedOperand *target,
+                      const char *indent)
+{
+    char label[MAX_TARGET_SIZE] = {0};
+
+    if (DIRECT_REGISTER_ADDRESSING == target->addressingMethod)
+    {
+        AppendText(&translation->text,
+                   "%sfrom = %u;\n%spc = %s;\n%sgoto dispatch;\n",
+                   indent,
+                   address,
+                   indent,
+                   target->expression,
+                   indent);
+    }
+    else if (translation->isTarget[target->address] && 0 != translation->lengths[target->address])
+    {
+        GetTarget(translation, (unsigned int)target->address, label);
+        AppendText(&translation->text, "%sgoto %s;\n", indent, label);
+    }
+    else
+    {
+        AppendText(&translation->text, "%sINTERPRET(%u, %ld);\n", indent, address, target->address);
+    }
+}
+
+/* The label of a translated instruction */
+static void GetTarget(const Translation *translation, unsigned int address, char *target)
+{
+    if (NULL != translation->labels[address])
+    {
+        sprintf(target, "L_%s", translation->labels[address]);
+    }
+    else
+    {
+        sprintf(target, "A%04u", address);
+    }
+}
+
+static bool IsStoreToCode(const Translation *translation, const TranslatedOperand *dest)
+{
+    return (DIRECT_REGISTER_ADDRESSING != dest->addressingMethod &&
+            IMMEDIATE_ADDRESSING != dest->addressingMethod &&
+            dest->address >= STARTING_ADDRESS &&
+            dest->address < (long)translation->codeEnd);
+}
+
+static void AppendLines(TextBuilder *text, const char *const *lines)
+{
+    for (; NULL != *lines; ++lines)
+    {
+        AppendString(text, *lines);
+        AppendString(text, "\n");
+    }
+}
+
+static void AppendText(TextBuilder *text, const char *format, ...)
+{
+    char line[MAX_LINE_SIZE] = {0};
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    AppendString(text, line);
+}
+
+static void AppendString(TextBuilder *text, const char *string)
+{
+    size_t stringLength = strlen(string);
+
+    if (text->hasFailed)
+    {
+        return;
+    }
+
+    if (text->length + stringLength + 1 > text->capacity)
+    {
+        size_t newCapacity = (0 == text->capacity) ? INITIAL_TEXT_CAPACITY : text->capacity;
+        char *newText = NULL;
+
+        while (text->length + stringLength + 1 > newCapacity)
+        {
+            newCapacity *= 2;
+        }
+
+        newText = (char *)realloc(text->text, newCapacity);
+        if (NULL == newText)
+        {
+            text->hasFailed = TRUE;
+            return;
+        }
+
+        text->text = newText;
+        text->capacity = newCapacity;
+    }
+
+    memcpy(text->text + text->length, string, stringLength + 1);
+    text->length += stringLength;
+}
@@ -0,0 +1,328 @@
+/****************************************
+* ASSEMBLER: converter_main.c           *
+****************************************/
+
+#include <stdio.h>  /* FILE, printf, fprintf, fopen, fclose */
+#include <errno.h>  /* errno, ENOENT */
+#include <string.h> /* strerror, strcat, strcpy, strcmp, strlen, memcmp */
+#include <stdlib.h> /* EXIT_SUCCESS, EXIT_FAILURE, malloc, free */
+#include <time.h>   /* clock, CLOCKS_PER_SEC */
+
+#include "object_file.h"     /* API */
+#include "files_builder.h"   /* API */
+#include "source_reader.h"   /* API */
+#include "diagnostics.h"     /* API */
+#include "word_encoding.h"   /* API */
+#include "assembler_utils.h" /* Utils file */
+
+static const char *READING_MODE = "r";
+static const char *TO_BINARY_OPTION = "-b";
+static const char *TO_TEXT_OPTION = "-t";
+static const char *TO_C_PROGRAM_OPTION = "-c";
+static const char *BENCHMARK_OPTION = "-m";
+
+/* Words of the microbenchmark, and the least time spent on each pass */
+#define NUM_OF_BENCHMARK_WORDS (64 * 1024)
+#define MIN_BENCHMARK_SECONDS (0.25)
+
+static bool ConvertFromText(const char *filename,
+                            ObjectFormat objectFormat,
+                            Diagnostics *diagnostics);
+static bool ConvertToText(const char *filename, Diagnostics *diagnostics);
+static ReturnStatus OpenObjectFile(SourceReader *sourceReader,
+                                   const char *filename,
+                                   const char *postfix,
+                                   bool isOptional,
+                                   Diagnostics *diagnostics);
+static int BenchmarkWordCodecs(void);
+
+/* Converts the object files of every program between the text files of
+ * the assembler (.ob, .ent and .ext) and the binary object file (.bin),
+ * or translates them to a C program (.c) */
+int main(int argc, char *argv[])
+{
+    ObjectFormat objectFormat = TEXT_OBJECT;
+    int i = 2, exitStatus = EXIT_SUCCESS;
+
+    if (2 == argc && 0 == strcmp(argv[1], BENCHMARK_OPTION))
+    {
+        return BenchmarkWordCodecs();
+    }
+
+    if (argc < 3 ||
+        (0 != strcmp(argv[1], TO_BINARY_OPTION) &&
+         0 != strcmp(argv[1], TO_TEXT_OPTION) &&
+         0 != strcmp(argv[1], TO_C_PROGRAM_OPTION)))
+    {
+        fprintf(stderr, "Usage: %s -b file...   (.ob, .ent and .ext to .bin)\n", argv[0]);
+        fprintf(stderr, "       %s -t file...   (.bin to .ob, .ent and .ext)\n", argv[0]);
+        fprintf(stderr, "       %s -c file...   (.ob to .c, see assembler --emit-c)\n", argv[0]);
+        fprintf(stderr, "       %s -m           (words per second of the word encodings)\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (0 == strcmp(argv[1], TO_BINARY_OPTION))
+    {
+        objectFormat = BINARY_OBJECT;
+    }
+    else if (0 == strcmp(argv[1], TO_C_PROGRAM_OPTION))
+    {
+        objectFormat = C_PROGRAM;
+    }
+
+    for (; i < argc; ++i)
+    {
+        Diagnostics diagnostics = {0};
+        bool isConverted = FALSE;
+
+        diagnostics.stream = stderr;
+
+        if (strlen(argv[i]) + strlen(BINARY_OBJECT_FILE_POSTFIX) >= MAX_FILENAME_SIZE)
+        {
+            fprintf(stderr, "File name too long: \"%s\"\n", argv[i]);
+            exitStatus = EXIT_FAILURE;
+            continue;
+        }
+
+        isConverted = (TEXT_OBJECT != objectFormat)
+                          ? ConvertFromText(argv[i], objectFormat, &diagnostics)
+                          : ConvertToText(argv[i], &diagnostics);
+        if (!isConverted)
+        {
+            exitStatus = EXIT_FAILURE;
+        }
+    }
+
+    return exitStatus;
+}
+
+/* Static functions */
+
+/* The .ent and .ext files are read when they exist */
+static bool ConvertFromText(const char *filename,
+                            ObjectFormat objectFormat,
+                            Diagnostics *diagnostics)
+{
+    SourceReader objectReader, entriesReader, externsReader;
+    Span object = {0}, entries = {0}, externs = {0};
+    ObjectContents contents;
+    FileTexts fileTexts = {0};
+    bool isConverted = FALSE;
+
+    memset(&entriesReader, 0, sizeof(SourceReader));
+    memset(&externsReader, 0, sizeof(SourceReader));
+
+    if (SUCCESS != OpenObjectFile(&objectReader, filename, OBJECT_FILE_POSTFIX, FALSE, diagnostics))
+    {
+        return FALSE;
+    }
+
+    object.start = objectReader.data;
+    object.length = objectReader.size;
+
+    if (SUCCESS == OpenObjectFile(&entriesReader, filename, ENTRY_FILE_POSTFIX, TRUE, diagnostics) &&
+        SUCCESS == OpenObjectFile(&externsReader, filename, EXTERN_FILE_POSTFIX, TRUE, diagnostics))
+    {
+        entries.start = entriesReader.data;
+        entries.length = entriesReader.size;
+        externs.start = externsReader.data;
+        externs.length = externsReader.size;
+
+        if (SUCCESS == ReadTextObject(object,
+                                      (NULL != entries.start) ? &entries : NULL,
+                                      (NULL != externs.start) ? &externs : NULL,
+                                      &contents,
+                                      diagnostics))
+        {
+            if (SUCCESS == FormatObjectContents(&contents, objectFormat, &fileTexts))
+            {
+                WriteFiles(&fileTexts, filename, diagnostics);
+                isConverted = !diagnostics->errorHasOccurred;
+            }
+            else
+            {
+                ReportError(diagnostics, "Memory allocation error\n");
+            }
+
+            DestroyFileTexts(&fileTexts);
+            DestroyObjectContents(&contents);
+        }
+    }
+
+    CloseSourceReader(&objectReader);
+    CloseSourceReader(&entriesReader);
+    CloseSourceReader(&externsReader);
+
+    return isConverted;
+}
+
+static bool ConvertToText(const char *filename, Diagnostics *diagnostics)
+{
+    SourceReader binaryReader;
+    BinaryObject object;
+    ObjectContents contents;
+    FileTexts fileTexts = {0};
+    bool isConverted = FALSE;
+
+    if (SUCCESS != OpenObjectFile(&binaryReader, filename, BINARY_OBJECT_FILE_POSTFIX, FALSE, diagnostics))
+    {
+        return FALSE;
+    }
+
+    if (SUCCESS != OpenBinaryObject(&object, binaryReader.data, binaryReader.size))
+    {
+        ReportError(diagnostics, "Error: \"%s%s\" is not a binary object file\n",
+                    filename,
+                    BINARY_OBJECT_FILE_POSTFIX);
+    }
+    else if (SUCCESS != ReadBinaryObject(&object, &contents))
+    {
+        ReportError(diagnostics, "Memory allocation error\n");
+    }
+    else
+    {
+        if (SUCCESS == FormatObjectContents(&contents, TEXT_OBJECT, &fileTexts))
+        {
+            WriteFiles(&fileTexts, filename, diagnostics);
+            isConverted = !diagnostics->errorHasOccurred;
+        }
+        else
+        {
+            ReportError(diagnostics, "Memory allocation error\n");
+        }
+
+        DestroyFileTexts(&fileTexts);
+        DestroyObjectContents(&contents);
+    }
+
+    CloseSourceReader(&binaryReader);
+
+    return isConverted;
+}
+
+/* A missing optional file leaves the reader with no data */
+static ReturnStatus OpenObjectFile(SourceReader *sourceReader,
+                                   const char *filename,
+                                   const char *postfix,
+                                   bool isOptional,
+                                   Diagnostics *diagnostics)
+{
+    FILE *file = NULL;
+    char filenameWithPostfix[MAX_FILENAME_SIZE] = {0};
+    ReturnStatus status = SUCCESS;
+
+    memset(sourceReader, 0, sizeof(SourceReader));
+
+    strcpy(filenameWithPostfix, filename);
+    strcat(filenameWithPostfix, postfix);
+
+    file = fopen(filenameWithPostfix, READING_MODE);
+    if (NULL == file)
+    {
+        if (isOptional && ENOENT == errno)
+        {
+            return SUCCESS;
+        }
+
+        ReportError(diagnostics,
+                    "Error opening file \"%s\": %s\n",
+                    filenameWithPostfix,
+                    strerror(errno));
+        return FAILURE;
+    }
+
+    status = OpenSourceReader(sourceReader, file);
+    if (SUCCESS != status)
+    {
+        ReportError(diagnostics, "Error reading \"%s\"\n", filenameWithPostfix);
+        CloseSourceReader(sourceReader);
+    }
+
+    fclose(file);
+
+    return status;
+}
+
+/* Encodes and decodes the same words with every codec of the processor
+ * and prints the millions of words per second of each */
+static int BenchmarkWordCodecs(void)
+{
+    unsigned short *words = NULL, *decodedWords = NULL;
+    char *encodings = NULL;
+    unsigned long seed = 1, numOfPasses = 0;
+    double encodeSeconds = 0, decodeSeconds = 0;
+    clock_t startTime = 0;
+    int codec = 0;
+    size_t i = 0;
+
+    words = (unsigned short *)malloc(NUM_OF_BENCHMARK_WORDS * sizeof(unsigned short));
+    decodedWords = (unsigned short *)malloc(NUM_OF_BENCHMARK_WORDS * sizeof(unsigned short));
+    encodings = (char *)malloc(NUM_OF_BENCHMARK_WORDS * ENCODED_WORD_STRIDE);
+    if (NULL == words || NULL == decodedWords || NULL == encodings)
+    {
+        fprintf(stderr, "Memory allocation error\n");
+        free(words);
+        free(decodedWords);
+        free(encodings);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < NUM_OF_BENCHMARK_WORDS; ++i)
+    {
+        seed = (seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+        words[i] = (unsigned short)((seed >> 16) & MEMORY_WORD_MASK);
+    }
+
+    for (codec = 0; codec < NUM_OF_WORD_CODECS; ++codec)
+    {
+        if (!IsWordCodecSupported((WordCodec)codec))
+        {
+            printf("%-8s not supported by this processor\n", GetWordCodecName((WordCodec)codec));
+            continue;
+        }
+
+        startTime = clock();
+        for (numOfPasses = 0;
+             0 == numOfPasses ||
+             (double)(clock() - startTime) / CLOCKS_PER_SEC < MIN_BENCHMARK_SECONDS;
+             ++numOfPasses)
+        {
+            EncodeWords((WordCodec)codec, encodings, words, NUM_OF_BENCHMARK_WORDS);
+        }
+        encodeSeconds = (double)(clock() - startTime) / CLOCKS_PER_SEC / numOfPasses;
+
+        startTime = clock();
+        for (numOfPasses = 0;
+             0 == numOfPasses ||
+             (double)(clock() - startTime) / CLOCKS_PER_SEC < MIN_BENCHMARK_SECONDS;
+             ++numOfPasses)
+        {
+            if (NUM_OF_BENCHMARK_WORDS != DecodeWords((WordCodec)codec,
+                                                      decodedWords,
+                                                      encodings,
+                                                      NUM_OF_BENCHMARK_WORDS))
+            {
+                break;
+            }
+        }
+        decodeSeconds = (double)(clock() - startTime) / CLOCKS_PER_SEC / numOfPasses;
+
+        if (0 != memcmp(words, decodedWords, NUM_OF_BENCHMARK_WORDS * sizeof(unsigned short)))
+        {
+            printf("%-8s decoded words differ from the encoded words\n",
+                   GetWordCodecName((WordCodec)codec));
+            continue;
+        }
+
+        printf("%-8s encode %8.1f Mwords/s   decode %8.1f Mwords/s\n",
+               GetWordCodecName((WordCodec)codec),
+               NUM_OF_BENCHMARK_WORDS / encodeSeconds / 1e6,
+               NUM_OF_BENCHMARK_WORDS / decodeSeconds / 1e6);
+    }
+
+    free(words);
+    free(decodedWords);
+    free(encodings);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/****************************************
+* ASSEMBLER: diagnostics.c              *
+****************************************/
+
+#include <stdio.h>  /* vfprintf, vsnprintf, fputs */
+#include <stdarg.h> /* va_list, va_start, va_end */
+#include <stdlib.h> /* realloc, free */
+#include <string.h> /* memcpy, memset */
+#include <assert.h> /* assert */
+
+#include "diagnostics.h" /* API */
+
+#define INITIAL_BUFFER_CAPACITY (256)
+
+static size_t GetMessageLength(const char *format, va_list args);
+static void Report(Diagnostics *diagnostics,
+                   size_t messageLen,
+                   const char *format,
+                   va_list args);
+static void AppendMessage(Diagnostics *diagnostics,
+                          const char *message,
+                          size_t messageLen);
+static ReturnStatus ReserveMessage(Diagnostics *diagnostics, size_t messageLen);
+
+void ReportError(Diagnostics *diagnostics, const char *format, ...)
+{
+    va_list args;
+    size_t messageLen = 0;
+
+    assert(NULL != diagnostics);
+    assert(NULL != format);
+
+    /* Without va_copy in C89, the arguments are read twice: once for
+     * the length of the message and once for the message */
+    va_start(args, format);
+    messageLen = GetMessageLength(format, args);
+    va_end(args);
+
+    va_start(args, format);
+    Report(diagnostics, messageLen, format, args);
+    va_end(args);
+
+    diagnostics->errorHasOccurred = TRUE;
+}
+
+void ReportWarning(Diagnostics *diagnostics, const char *format, ...)
+{
+    va_list args;
+    size_t messageLen = 0;
+
+    assert(NULL != diagnostics);
+    assert(NULL != format);
+
+    va_start(args, format);
+    messageLen = GetMessageLength(format, args);
+    va_end(args);
+
+    va_start(args, format);
+    Report(diagnostics, messageLen, format, args);
+    va_end(args);
+}
+
+/* Reports the messages collected in other (in their order) */
+void AppendDiagnostics(Diagnostics *diagnostics, const Diagnostics *other)
+{
+    assert(NULL != diagnostics);
+    assert(NULL != other);
+
+    if (NULL != other->buffer)
+    {
+        if (NULL != diagnostics->stream)
+        {
+            fputs(other->buffer, diagnostics->stream);
+        }
+        else
+        {
+            AppendMessage(diagnostics, other->buffer, other->length);
+        }
+    }
+
+    diagnostics->numOfReports += other->numOfReports;
+    if (other->errorHasOccurred)
+    {
+        diagnostics->errorHasOccurred = TRUE;
+    }
+}
+
+void DestroyDiagnostics(Diagnostics *diagnostics)
+{
+    assert(NULL != diagnostics);
+
+    free(diagnostics->buffer);
+    memset(diagnostics, 0, sizeof(Diagnostics));
+}
+
+/* Static functions */
+static size_t GetMessageLength(const char *format, va_list args)
+{
+    int messageLen = vsnprintf(NULL, 0, format, args);
+
+    return (messageLen < 0) ? 0 : (size_t)messageLen;
+}
+
+/* The message is formatted right into the buffer, whatever its length */
+static void Report(Diagnostics *diagnostics,
+                   size_t messageLen,
+                   const char *format,
+                   va_list args)
+{
+    ++diagnostics->numOfReports;
+
+    if (NULL != diagnostics->stream)
+    {
+        vfprintf(diagnostics->stream, format, args);
+        return;
+    }
+
+    if (SUCCESS == ReserveMessage(diagnostics, messageLen))
+    {
+        vsnprintf(diagnostics->buffer + diagnostics->length, messageLen + 1, format, args);
+        diagnostics->length += messageLen;
+    }
+}
+
+static void AppendMessage(Diagnostics *diagnostics,
+                          const char *message,
+                          size_t messageLen)
+{
+    if (SUCCESS != ReserveMessage(diagnostics, messageLen))
+    {
+        return;
+    }
+
+    memcpy(diagnostics->buffer + diagnostics->length, message, messageLen);
+    diagnostics->length += messageLen;
+    diagnostics->buffer[diagnostics->length] = END_LINE;
+}
+
+/* Makes room for a message and its terminating NUL */
+static ReturnStatus ReserveMessage(Diagnostics *diagnostics, size_t messageLen)
+{
+    if (diagnostics->length + messageLen + 1 > diagnostics->capacity)
+    {
+        size_t newCapacity = (0 == diagnostics->capacity)
+                                 ? INITIAL_BUFFER_CAPACITY
+                                 : diagnostics->capacity;
+        char *newBuffer = NULL;
+
+        while (diagnostics->length + messageLen + 1 > newCapacity)
+        {
+            newCapacity *= 2;
+        }
+
+        newBuffer = (char *)realloc(diagnostics->buffer, newCapacity);
+        if (NULL == newBuffer)
+        {
+            return FAILURE; /* The message is lost, but errorHasOccurred is kept */
+        }
+
+        diagnostics->buffer = newBuffer;
+        diagnostics->capacity = newCapacity;
+    }
+
+    return SUCCESS;
+}
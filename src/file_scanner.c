@@ -6,230 +6,555 @@
 ****************************************/
 
 #include <assert.h> /* assert */
-#include <stdio.h>  /* rewind */
+#include <stdio.h>  /* FILE */
+#include <string.h> /* memset, strlen, strcpy, strcat */
 
 #include "file_scanner.h"      /* API */
 #include "symbol_table.h"      /* API */
 #include "sentence_analyzer.h" /* API */
 #include "memory_word.h"       /* API */
+#include "operations.h"        /* API */
+#include "instruction_table.h" /* API */
 #include "files_builder.h"     /* API */
+#include "source_reader.h"     /* API */
+#include "assembly_cache.h"    /* API */
+#include "output_cache.h"      /* API */
+#include "parallel_scanner.h"  /* API */
+#include "string_pool.h"       /* API */
 #include "assembler_utils.h"   /* Utils file */
 
-#define MEMORY_ARRAY_MAX_SIZE (1000)
-
-static void RunFirstScan(FILE *assemblyFile,
-                         SymbolTableNode **symbolTableHead,
-                         const char *filename);
-static void RunSecondScan(FILE *assemblyFile,
-                          MemoryWord *instructionsArray,
-                          MemoryWord *dataArray,
-                          SymbolTableNode **symbolTableHead,
-                          const char *filename,
-                          bool hasEntries,
-                          bool hasExternals,
-                          int dataCounter);
-
-void RunScans(FILE *assemblyFile, const char *filename)
+static const char *CACHE_FILE_POSTFIX = ".cache";
+
+static void ScanIncrementally(SourceReader *sourceReader,
+                              Assembly *assembly,
+                              const char *filename,
+                              Diagnostics *diagnostics);
+static void ReplaySentence(const CachedSentence *cachedSentence,
+                           const AssemblyCache *cache,
+                           Assembly *assembly,
+                           InstructionTable *instructionTable,
+                           int *IC,
+                           Diagnostics *diagnostics,
+                           int lineNumber);
+
+/* All the state of an assembly is local to this call, so different files
+ * can be assembled concurrently (each with its own Diagnostics) */
+void RunScans(FILE *assemblyFile,
+              const char *filename,
+              const ScanOptions *options,
+              Diagnostics *diagnostics)
 {
-    SymbolTableNode *symbolTableHead = NULL;
+    Assembly assembly = {{0}};
+    SourceReader sourceReader;
+    Diagnostics scanDiagnostics = {0};
+    char key[OUTPUT_CACHE_KEY_SIZE] = {0};
 
     assert(NULL != assemblyFile);
     assert(NULL != filename);
+    assert(NULL != options);
+    assert(NULL != diagnostics);
 
-    RunFirstScan(assemblyFile, &symbolTableHead, filename);
+    if (SUCCESS != OpenSourceReader(&sourceReader, assemblyFile))
+    {
+        ReportError(diagnostics, "Error reading the source of \"%s\"\n", filename);
+        CloseSourceReader(&sourceReader);
+        return;
+    }
 
-    DestroySymbolTable(symbolTableHead);
+    if (NULL != options->outputCache)
+    {
+        GetOutputCacheKey(sourceReader.data,
+                          sourceReader.size,
+                          options->objectFormat,
+                          key);
+        if (SUCCESS == RestoreOutputs(options->outputCache, key, filename, diagnostics))
+        {
+            CloseSourceReader(&sourceReader);
+            return;
+        }
+    }
+
+    /* The messages of the scan are kept apart, to be saved with the files */
+    if (options->isIncremental)
+    {
+        ScanIncrementally(&sourceReader, &assembly, filename, &scanDiagnostics);
+    }
+    else if (options->numOfThreads > 1)
+    {
+        ScanSourceInParallel(&sourceReader,
+                             &assembly,
+                             options->numOfThreads,
+                             &scanDiagnostics);
+    }
+    else
+    {
+        ScanSource(&sourceReader, &assembly, NULL, &scanDiagnostics);
+    }
+
+    AppendDiagnostics(diagnostics, &scanDiagnostics);
+
+    if (!scanDiagnostics.errorHasOccurred && NULL == options->outputCache)
+    {
+        BuildFiles(&assembly.instructionSegment,
+                   &assembly.dataSegment,
+                   &assembly.symbolTable,
+                   filename,
+                   assembly.hasEntries,
+                   assembly.hasExternals,
+                   options->objectFormat,
+                   diagnostics);
+    }
+    else if (!scanDiagnostics.errorHasOccurred)
+    {
+        FileTexts fileTexts = {0};
+
+        if (SUCCESS != FormatFiles(&assembly.instructionSegment,
+                                   &assembly.dataSegment,
+                                   &assembly.symbolTable,
+                                   assembly.hasEntries,
+                                   assembly.hasExternals,
+                                   options->objectFormat,
+                                   &fileTexts))
+        {
+            ReportError(diagnostics, "Memory allocation error\n");
+        }
+        else
+        {
+            WriteFiles(&fileTexts, filename, diagnostics);
+            PublishOutputs(options->outputCache, key, &fileTexts, &scanDiagnostics);
+        }
+
+        DestroyFileTexts(&fileTexts);
+    }
+
+    DestroyDiagnostics(&scanDiagnostics);
+    DestroyAssembly(&assembly);
+    CloseSourceReader(&sourceReader);
 }
 
-/* Static functions */
-static void RunFirstScan(FILE *assemblyFile,
-                         SymbolTableNode **symbolTableHead,
-                         const char *filename)
+/* Single pass over the file: every line is parsed exactly once, data words
+ * are built right away and instructions are kept as parsed Instructions.
+ * Once every symbol is defined, the instruction words are encoded from the
+ * parsed Instructions. Sentences are spans into the source, so they are
+ * neither copied nor limited in length, and each one is lexed once.
+ * With a cache, a line that is in it is replayed instead of parsed, and
+ * every line that reports nothing is recorded in it. */
+void ScanSource(SourceReader *sourceReader,
+                Assembly *assembly,
+                AssemblyCache *cache,
+                Diagnostics *diagnostics)
 {
-    MemoryWord instructionsArray[MEMORY_ARRAY_MAX_SIZE] = {0};
-    MemoryWord dataArray[MEMORY_ARRAY_MAX_SIZE] = {0};
-    char sentence[MAX_SENTENCE_SIZE] = {0};
-    int IC = 0, DC = 0, lineNumber = 0;
-    bool hasEntries = FALSE, hasExternals = FALSE, errorHasOccurred = FALSE;
+    SymbolTable *symbolTable = NULL;
+    MemorySegment *instructionSegment = NULL, *dataSegment = NULL;
+    InstructionTable instructionTable = {0};
+    int IC = 0;
 
-    assert(NULL != assemblyFile);
-    assert(NULL != symbolTableHead);
+    assert(NULL != sourceReader);
+    assert(NULL != assembly);
+    assert(NULL != diagnostics);
 
-    while (fgets(sentence, MAX_SENTENCE_SIZE, (FILE *)assemblyFile))
+    symbolTable = &assembly->symbolTable;
+    instructionSegment = &assembly->instructionSegment;
+    dataSegment = &assembly->dataSegment;
+
+    if (NULL != cache)
     {
+        StartCachedScan(cache, sourceReader, symbolTable, diagnostics);
+    }
+
+    ScanSentences(sourceReader,
+                  assembly,
+                  &instructionTable,
+                  cache,
+                  1,
+                  &IC,
+                  diagnostics);
+
+    if (!diagnostics->errorHasOccurred &&
+        SUCCESS != ReserveMemoryWords(instructionSegment, IC))
+    {
+        ReportError(diagnostics, "Memory allocation error\n");
+    }
+
+    if (!diagnostics->errorHasOccurred)
+    {
+        if (STARTING_ADDRESS + IC + dataSegment->numOfWords > MAX_ADDRESS + 1)
+        {
+            ReportWarning(diagnostics, "Warning: the program does not fit in the %d word address space\n", MAX_ADDRESS + 1);
+        }
+
+        UpdateDataSymbols(symbolTable, IC + STARTING_ADDRESS);
+        EncodeInstructions(instructionSegment->words,
+                           instructionTable.instructions,
+                           instructionTable.numOfInstructions,
+                           0,
+                           symbolTable,
+                           &symbolTable->externReferences,
+                           diagnostics);
+        instructionSegment->numOfWords = IC;
+        UpdateEntrySymbols(symbolTable);
+    }
+
+    DestroyInstructionTable(&instructionTable);
+}
+
+/* The loop of ScanSource over the sentences left in the reader, the first
+ * of them at line firstLineNumber. Instructions are added to the table and
+ * counted in *IC, data symbols get their offset in the data segment. */
+void ScanSentences(SourceReader *sourceReader,
+                   Assembly *assembly,
+                   InstructionTable *instructionTable,
+                   AssemblyCache *cache,
+                   int firstLineNumber,
+                   int *IC,
+                   Diagnostics *diagnostics)
+{
+    SymbolTable *symbolTable = NULL;
+    MemorySegment *dataSegment = NULL;
+    Span text = {0};
+    int lineNumber = firstLineNumber - 1;
+
+    assert(NULL != sourceReader);
+    assert(NULL != assembly);
+    assert(NULL != instructionTable);
+    assert(firstLineNumber > 0);
+    assert(NULL != IC);
+    assert(NULL != diagnostics);
+
+    symbolTable = &assembly->symbolTable;
+    dataSegment = &assembly->dataSegment;
+
+    while (ReadSentence(sourceReader, &text))
+    {
+        Sentence sentence;
+        const Operation *operation = NULL;
         bool hasSymbolDefinition = FALSE;
+        CachedSentence record;
+        unsigned long hash = 0;
+        size_t numOfReports = diagnostics->numOfReports;
 
         ++lineNumber;
 
-        if (IsEmptySentence(sentence) || IsCommentSentence(sentence))
+        if (NULL != cache)
         {
-            continue;
+            const CachedSentence *cachedSentence = NULL;
+
+            hash = HashString(text.start, text.length);
+            cachedSentence = FindCachedSentence(cache, text, hash);
+            if (NULL != cachedSentence)
+            {
+                record = *cachedSentence;
+                record.firstDataWord = (int)dataSegment->numOfWords;
+                ReplaySentence(cachedSentence,
+                               cache,
+                               assembly,
+                               instructionTable,
+                               IC,
+                               diagnostics,
+                               lineNumber);
+                RecordSentence(cache, text, hash, &record);
+
+                continue;
+            }
         }
 
-        if (IsMacroSentence(sentence))
+        if (SUCCESS != AnalyzeSentence(text, &sentence))
         {
-            InsertMacroToSymbolTable(sentence,
-                                     symbolTableHead,
-                                     &errorHasOccurred,
-                                     lineNumber);
+            ReportError(diagnostics,
+                        sentence.isSymbolIndented
+                            ? "Line %d:\tError: a symbol definition must start in column 1\n"
+                            : "Line %d:\tError: invalid symbol definition\n",
+                        lineNumber);
 
             continue;
         }
 
-        if (HasValidSymbol(sentence))
+        hasSymbolDefinition = (0 != sentence.symbol.length);
+        memset(&record, 0, sizeof(CachedSentence));
+        record.type = sentence.type;
+        record.symbolId = NO_SYMBOL;
+        record.firstDataWord = (int)dataSegment->numOfWords;
+
+        switch (sentence.type)
+        {
+        case EMPTY_SENTENCE:
+        case COMMENT_SENTENCE:
         {
-            hasSymbolDefinition = TRUE;
+            break;
         }
 
-        if (IsDataSentence(sentence) || IsStringSentence(sentence))
+        case MACRO_SENTENCE:
         {
             if (hasSymbolDefinition)
             {
-                InsertSymbolToSymbolTable(sentence,
-                                          symbolTableHead,
-                                          DATA,
-                                          DC,
-                                          &errorHasOccurred,
-                                          lineNumber);
+                ReportWarning(diagnostics, "Warning: symbol definition at the start of macro definition\n");
             }
 
-            InsertToDataArray(dataArray,
-                              sentence,
-                              &DC,
-                              *symbolTableHead,
-                              &errorHasOccurred,
-                              lineNumber);
+            InsertMacroToSymbolTable(&sentence,
+                                     symbolTable,
+                                     diagnostics,
+                                     lineNumber);
 
-            continue;
+            if (NULL != cache)
+            {
+                AddMacroSentence(cache, hash);
+            }
+
+            break;
         }
 
-        if (IsExternSentence(sentence))
+        case DATA_SENTENCE:
+        case STRING_SENTENCE:
         {
-            hasExternals = TRUE;
-
             if (hasSymbolDefinition)
             {
-                fprintf(stderr, "Warning: symbol definition at the start of extern instruction\n");
+                record.symbolId = InsertSymbolToSymbolTable(&sentence,
+                                                            symbolTable,
+                                                            DATA,
+                                                            (int)dataSegment->numOfWords,
+                                                            diagnostics,
+                                                            lineNumber);
             }
 
-            InsertExternToSymbolTable(sentence,
-                                      symbolTableHead,
-                                      &errorHasOccurred,
-                                      lineNumber);
+            InsertToDataSegment(dataSegment,
+                                &sentence,
+                                symbolTable,
+                                diagnostics,
+                                lineNumber);
 
-            continue;
+            break;
         }
 
-        if (IsEntrySentence(sentence))
+        case EXTERN_SENTENCE:
         {
-            hasEntries = TRUE;
+            assembly->hasExternals = TRUE;
 
             if (hasSymbolDefinition)
             {
-                fprintf(stderr, "Warning: symbol definition at the start of entry instruction\n");
+                ReportWarning(diagnostics, "Warning: symbol definition at the start of extern instruction\n");
             }
 
-            continue;
-        }
+            record.symbolId = InsertExternToSymbolTable(&sentence,
+                                                        symbolTable,
+                                                        diagnostics,
+                                                        lineNumber);
 
-        if (hasSymbolDefinition)
-        {
-            InsertSymbolToSymbolTable(sentence,
-                                      symbolTableHead,
-                                      CODE,
-                                      IC + STARTING_ADDRESS,
-                                      &errorHasOccurred,
-                                      lineNumber);
+            break;
         }
 
-        if (!HasValidOperationName(sentence))
+        case ENTRY_SENTENCE:
         {
-            fprintf(stderr, "Line %d:\tError: unknown operation name\n", lineNumber);
-            errorHasOccurred = TRUE;
+            assembly->hasEntries = TRUE;
+
+            if (hasSymbolDefinition)
+            {
+                ReportWarning(diagnostics, "Warning: symbol definition at the start of entry instruction\n");
+            }
+
+            record.symbolId = InsertEntryToSymbolTable(&sentence,
+                                                       symbolTable,
+                                                       diagnostics,
+                                                       lineNumber);
+
+            break;
         }
-        else
+
+        case INSTRUCTION_SENTENCE:
         {
-            BuildFirstMemoryWord(instructionsArray,
-                                 sentence,
-                                 &IC,
-                                 *symbolTableHead,
-                                 &errorHasOccurred,
+            if (hasSymbolDefinition)
+            {
+                record.symbolId = InsertSymbolToSymbolTable(&sentence,
+                                                            symbolTable,
+                                                            CODE,
+                                                            *IC + STARTING_ADDRESS,
+                                                            diagnostics,
+                                                            lineNumber);
+            }
+
+            operation = FindOperation(sentence.operation);
+
+            if (NULL == operation)
+            {
+                ReportError(diagnostics, "Line %d:\tError: unknown operation name\n", lineNumber);
+            }
+            else
+            {
+                Instruction instruction;
+
+                ParseInstruction(&sentence,
+                                 operation,
+                                 &instruction,
+                                 symbolTable,
+                                 diagnostics,
                                  lineNumber);
+                *IC += instruction.numOfMemoryWords;
+                record.instruction = instruction;
+
+                if (SUCCESS != AddInstruction(instructionTable, &instruction))
+                {
+                    ReportError(diagnostics, "Line %d:\tMemory allocation error\n", lineNumber);
+                }
+            }
+
+            break;
+        }
         }
 
+        if (NULL != cache &&
+            numOfReports == diagnostics->numOfReports &&
+            EMPTY_SENTENCE != sentence.type &&
+            COMMENT_SENTENCE != sentence.type &&
+            MACRO_SENTENCE != sentence.type)
+        {
+            record.numOfDataWords = (int)dataSegment->numOfWords - record.firstDataWord;
+            RecordSentence(cache, text, hash, &record);
+        }
     } /* End of while */
+}
 
-    if (!errorHasOccurred)
-    {
-        UpdateDataSymbols(*symbolTableHead, IC + STARTING_ADDRESS);
-        RunSecondScan(assemblyFile,
-                      instructionsArray,
-                      dataArray,
-                      symbolTableHead,
-                      filename,
-                      hasEntries,
-                      hasExternals,
-                      DC);
-    }
+void DestroyAssembly(Assembly *assembly)
+{
+    assert(NULL != assembly);
+
+    DestroySymbolTable(&assembly->symbolTable);
+    DestroyMemorySegment(&assembly->instructionSegment);
+    DestroyMemorySegment(&assembly->dataSegment);
+    assembly->hasEntries = FALSE;
+    assembly->hasExternals = FALSE;
 }
 
-static void RunSecondScan(FILE *assemblyFile,
-                          MemoryWord *instructionsArray,
-                          MemoryWord *dataArray,
-                          SymbolTableNode **symbolTableHead,
-                          const char *filename,
-                          bool hasEntries,
-                          bool hasExternals,
-                          int dataCounter)
+/* Static functions */
+
+/* The cache file is saved only after an assembly without errors. A cached
+ * line can hide an error (e.g. a macro that became a label), so an assembly
+ * that fails is scanned again without the cache to report the errors of a
+ * full assembly. */
+static void ScanIncrementally(SourceReader *sourceReader,
+                              Assembly *assembly,
+                              const char *filename,
+                              Diagnostics *diagnostics)
 {
-    char sentence[MAX_SENTENCE_SIZE] = {0};
-    int IC = 0, lineNumber = 0;
-    bool errorHasOccurred = FALSE;
+    char cacheFilename[MAX_FILENAME_SIZE] = {0};
+    AssemblyCache cache;
+    Diagnostics cachedDiagnostics = {0};
+
+    if (strlen(filename) + strlen(CACHE_FILE_POSTFIX) >= MAX_FILENAME_SIZE)
+    {
+        ScanSource(sourceReader, assembly, NULL, diagnostics);
+        return;
+    }
 
-    /* Sets the file position indicator to the beginning of the file */
-    rewind(assemblyFile);
+    strcpy(cacheFilename, filename);
+    strcat(cacheFilename, CACHE_FILE_POSTFIX);
 
-    while (fgets(sentence, MAX_SENTENCE_SIZE, (FILE *)assemblyFile))
+    LoadAssemblyCache(&cache, cacheFilename);
+    ScanSource(sourceReader, assembly, &cache, &cachedDiagnostics);
+
+    if (cachedDiagnostics.errorHasOccurred)
     {
-        ++lineNumber;
+        DestroyAssembly(assembly);
+        RewindSourceReader(sourceReader);
+        ScanSource(sourceReader, assembly, NULL, diagnostics);
+    }
+    else
+    {
+        AppendDiagnostics(diagnostics, &cachedDiagnostics);
+        SaveAssemblyCache(&cache,
+                          cacheFilename,
+                          &assembly->symbolTable,
+                          &assembly->dataSegment);
+    }
+
+    DestroyDiagnostics(&cachedDiagnostics);
+    DestroyAssemblyCache(&cache);
+}
+
+/* Does what the scan of the line did, without parsing it */
+static void ReplaySentence(const CachedSentence *cachedSentence,
+                           const AssemblyCache *cache,
+                           Assembly *assembly,
+                           InstructionTable *instructionTable,
+                           int *IC,
+                           Diagnostics *diagnostics,
+                           int lineNumber)
+{
+    int i = 0;
 
-        if (IsCommentSentence(sentence) ||
-            IsEmptySentence(sentence) ||
-            IsDataSentence(sentence) ||
-            IsStringSentence(sentence) ||
-            IsExternSentence(sentence) ||
-            IsMacroSentence(sentence))
+    switch (cachedSentence->type)
+    {
+    case DATA_SENTENCE:
+    case STRING_SENTENCE:
+    {
+        if (NO_SYMBOL != cachedSentence->symbolId)
         {
-            continue;
+            InsertSymbolById(&assembly->symbolTable,
+                             cachedSentence->symbolId,
+                             DATA,
+                             (int)assembly->dataSegment.numOfWords,
+                             diagnostics,
+                             lineNumber);
         }
 
-        if (IsEntrySentence(sentence))
+        for (i = 0; i < cachedSentence->numOfDataWords; ++i)
         {
-            char param[MAX_SENTENCE_SIZE] = {0};
+            if (SUCCESS != AppendMemoryWord(&assembly->dataSegment,
+                                            cache->dataWords[cachedSentence->firstDataWord + i]))
+            {
+                ReportError(diagnostics, "Line %d:\tMemory allocation error\n", lineNumber);
+                return;
+            }
+        }
 
-            GetInstructionParams(sentence, param);
-            UpdateSymbolTypeToEntry(*symbolTableHead, param);
+        break;
+    }
 
-            continue;
-        }
+    case EXTERN_SENTENCE:
+    {
+        assembly->hasExternals = TRUE;
+        InsertSymbolById(&assembly->symbolTable,
+                         cachedSentence->symbolId,
+                         EXTERNAL,
+                         0,
+                         diagnostics,
+                         lineNumber);
+
+        break;
+    }
 
-        BuildOtherMemoryWords(instructionsArray,
-                              sentence,
-                              &IC,
-                              *symbolTableHead,
-                              &errorHasOccurred,
-                              lineNumber);
-    } /* End of while */
+    case ENTRY_SENTENCE:
+    {
+        assembly->hasEntries = TRUE;
+        AddEntrySymbol(&assembly->symbolTable,
+                       cachedSentence->symbolId,
+                       diagnostics,
+                       lineNumber);
 
-    if (!errorHasOccurred)
+        break;
+    }
+
+    case INSTRUCTION_SENTENCE:
     {
-        BuildFiles(instructionsArray,
-                   dataArray,
-                   *symbolTableHead,
-                   filename,
-                   hasEntries,
-                   hasExternals,
-                   dataCounter,
-                   IC);
+        Instruction instruction = cachedSentence->instruction;
+
+        if (NO_SYMBOL != cachedSentence->symbolId)
+        {
+            InsertSymbolById(&assembly->symbolTable,
+                             cachedSentence->symbolId,
+                             CODE,
+                             *IC + STARTING_ADDRESS,
+                             diagnostics,
+                             lineNumber);
+        }
+
+        instruction.lineNumber = lineNumber;
+        *IC += instruction.numOfMemoryWords;
+
+        if (SUCCESS != AddInstruction(instructionTable, &instruction))
+        {
+            ReportError(diagnostics, "Line %d:\tMemory allocation error\n", lineNumber);
+        }
+
+        break;
+    }
     }
 }
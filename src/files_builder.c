@@ -5,169 +5,477 @@
 * Date: 19/08/2019                      *
 ****************************************/
 
-#include <stdio.h>  /* FILE, fprintf, fopen, fclose */
+#include <stdio.h>  /* FILE, fwrite, fopen, fclose, remove */
+#include <stdlib.h> /* malloc, free */
 #include <errno.h>  /* errno */
-#include <string.h> /* strerror, strcat, strcpy */
-#include <assert.h> /* assert */
+#include <string.h> /* strerror, strcat, strcpy, memcpy, memset */
+#include <assert.h>  /* assert */
 
 #include "files_builder.h"   /* API */
+#include "object_file.h"     /* API */
+#include "word_encoding.h"   /* API */
+#include "c_translator.h"    /* API */
 #include "assembler_utils.h" /* Utils file */
 
-#define PART_SIZE_IN_BITS (2)
+#define MIN_ADDRESS_DIGITS (4)
+#define MAX_ADDRESS_DIGITS (10)
+#define MAX_HEADER_SIZE (2 * MAX_ADDRESS_DIGITS + 4)
+/* address, '\t', encoded word, '\n' */
+#define MAX_OBJECT_LINE_SIZE (MAX_ADDRESS_DIGITS + 1 + ENCODED_WORD_SIZE + 1)
+/* name, '\t', address, '\n' */
+#define MAX_SYMBOL_LINE_EXTRA (1 + MAX_ADDRESS_DIGITS + 1)
 
-typedef struct
-{
-    unsigned int part1 : PART_SIZE_IN_BITS;
-    unsigned int part2 : PART_SIZE_IN_BITS;
-    unsigned int part3 : PART_SIZE_IN_BITS;
-    unsigned int part4 : PART_SIZE_IN_BITS;
-    unsigned int part5 : PART_SIZE_IN_BITS;
-    unsigned int part6 : PART_SIZE_IN_BITS;
-    unsigned int part7 : PART_SIZE_IN_BITS;
-} SpecialWord;
-
-static const char *OBJECT_FILE_POSTFIX = ".ob";
-static const char *ENTRY_FILE_POSTFIX = ".ent";
-static const char *EXTERN_FILE_POSTFIX = ".ext";
 static const char *WRITING_MODE = "w";
 
-static unsigned int CONVERTER_LUT[4] = {'*', '#', '%', '!'};
-
-static void BuildObjectFile(MemoryWord *instructionsArray,
-                            MemoryWord *dataArray,
-                            int dataCounter,
-                            int instructionCounter,
-                            const char *filename);
-static void BuildEntriesFile(SymbolTableNode *symbolTableHead,
-                             const char *filename);
-static void BuildExternalsFile(SymbolTableNode *symbolTableHead,
-                               const char *filename);
-static void WriteToObjectFile(FILE *objectFile,
-                              MemoryWord *instructionsArray,
-                              MemoryWord *dataArray,
-                              int dataCounter,
-                              int instructionCounter);
-static void WriteSpecialWordToObjectFile(FILE *objectFile,
-                                         SpecialWord *specialWord);
-static FILE *OpenFile(const char *filename, const char *postfix);
+static char *FormatObjectFile(const MemorySegment *instructionSegment,
+                              const MemorySegment *dataSegment,
+                              size_t *length);
+static char *FormatObjectSymbols(const ObjectSymbol *symbols,
+                                 unsigned long numOfSymbols,
+                                 size_t *length);
+static void WriteFile(const char *text,
+                      size_t length,
+                      const char *filename,
+                      const char *postfix,
+                      Diagnostics *diagnostics);
+static char *WriteWords(char *buffer,
+                        const MemoryWord *words,
+                        size_t numOfWords,
+                        unsigned long address);
+static char *WriteNumber(char *buffer, unsigned long number, int minDigits);
+static FILE *OpenFile(const char *filename,
+                      const char *postfix,
+                      Diagnostics *diagnostics);
 static void CloseFile(FILE *file);
 
-void BuildFiles(MemoryWord *instructionsArray,
-                MemoryWord *dataArray,
-                SymbolTableNode *symbolTableHead,
+void BuildFiles(const MemorySegment *instructionSegment,
+                const MemorySegment *dataSegment,
+                const SymbolTable *symbolTable,
                 const char *filename,
                 bool hasEntries,
                 bool hasExternals,
-                int dataCounter,
-                int instructionCounter)
+                ObjectFormat objectFormat,
+                Diagnostics *diagnostics)
 {
-    assert(NULL != instructionsArray);
-    assert(NULL != dataArray);
-    assert(NULL != symbolTableHead);
+    FileTexts fileTexts = {0};
+
+    assert(NULL != instructionSegment);
+    assert(NULL != dataSegment);
+    assert(NULL != symbolTable);
     assert(NULL != filename);
-    assert(dataCounter >= 0);
-    assert(instructionCounter >= 0);
+    assert(NULL != diagnostics);
+
+    if (SUCCESS != FormatFiles(instructionSegment,
+                               dataSegment,
+                               symbolTable,
+                               hasEntries,
+                               hasExternals,
+                               objectFormat,
+                               &fileTexts))
+    {
+        ReportError(diagnostics, "Memory allocation error\n");
+    }
+    else
+    {
+        WriteFiles(&fileTexts, filename, diagnostics);
+    }
+
+    DestroyFileTexts(&fileTexts);
+}
+
+/* Every file is formatted into one buffer, so it is written at once */
+ReturnStatus FormatFiles(const MemorySegment *instructionSegment,
+                         const MemorySegment *dataSegment,
+                         const SymbolTable *symbolTable,
+                         bool hasEntries,
+                         bool hasExternals,
+                         ObjectFormat objectFormat,
+                         FileTexts *fileTexts)
+{
+    assert(NULL != instructionSegment);
+    assert(NULL != dataSegment);
+    assert(NULL != symbolTable);
+    assert(NULL != fileTexts);
+
+    memset(fileTexts, 0, sizeof(FileTexts));
+
+    if (BINARY_OBJECT == objectFormat)
+    {
+        ObjectContents contents;
+
+        if (SUCCESS != GetAssemblyContents(instructionSegment,
+                                           dataSegment,
+                                           symbolTable,
+                                           hasEntries,
+                                           hasExternals,
+                                           &contents))
+        {
+            return FAILURE;
+        }
 
-    BuildObjectFile(instructionsArray,
-                    dataArray,
-                    dataCounter,
-                    instructionCounter,
-                    filename);
+        fileTexts->binaryObject = FormatBinaryObject(&contents,
+                                                     &fileTexts->binaryObjectLength);
+        DestroyObjectContents(&contents);
+
+        return (NULL == fileTexts->binaryObject) ? FAILURE : SUCCESS;
+    }
+
+    fileTexts->object = FormatObjectFile(instructionSegment,
+                                         dataSegment,
+                                         &fileTexts->objectLength);
+    if (NULL == fileTexts->object)
+    {
+        return FAILURE;
+    }
 
     if (hasEntries)
     {
-        BuildEntriesFile(symbolTableHead, filename);
+        fileTexts->entries = FormatSymbolsByType(symbolTable,
+                                                 ENTRY,
+                                                 &fileTexts->entriesLength);
+        if (NULL == fileTexts->entries)
+        {
+            return FAILURE;
+        }
     }
 
     if (hasExternals)
     {
-        BuildExternalsFile(symbolTableHead, filename);
+        fileTexts->externs = FormatExternReferences(symbolTable,
+                                                    &fileTexts->externsLength);
+        if (NULL == fileTexts->externs)
+        {
+            return FAILURE;
+        }
     }
+
+    if (C_PROGRAM == objectFormat)
+    {
+        fileTexts->cProgram = TranslateToC(instructionSegment->words,
+                                           instructionSegment->numOfWords,
+                                           dataSegment->words,
+                                           dataSegment->numOfWords,
+                                           symbolTable,
+                                           &fileTexts->cProgramLength);
+        if (NULL == fileTexts->cProgram)
+        {
+            return FAILURE;
+        }
+    }
+
+    return SUCCESS;
 }
 
-/* Static functions */
-static void BuildObjectFile(MemoryWord *instructionsArray,
-                            MemoryWord *dataArray,
-                            int dataCounter,
-                            int instructionCounter,
-                            const char *filename)
+/* The files of a program read from its object files (see object_file.h),
+ * the same as those of its assembly */
+ReturnStatus FormatObjectContents(const ObjectContents *contents,
+                                  ObjectFormat objectFormat,
+                                  FileTexts *fileTexts)
 {
-    FILE *objectFile = OpenFile(filename, OBJECT_FILE_POSTFIX);
+    MemorySegment instructionSegment = {0}, dataSegment = {0};
+    unsigned long i = 0;
+
+    assert(NULL != contents);
+    assert(NULL != fileTexts);
 
-    if (NULL != objectFile)
+    memset(fileTexts, 0, sizeof(FileTexts));
+
+    if (BINARY_OBJECT == objectFormat)
+    {
+        fileTexts->binaryObject = FormatBinaryObject(contents,
+                                                     &fileTexts->binaryObjectLength);
+
+        return (NULL == fileTexts->binaryObject) ? FAILURE : SUCCESS;
+    }
+
+    for (i = 0; i < contents->instructionCounter + contents->dataCounter; ++i)
+    {
+        if (SUCCESS != AppendMemoryWord((i < contents->instructionCounter)
+                                            ? &instructionSegment
+                                            : &dataSegment,
+                                        contents->words[i]))
+        {
+            break;
+        }
+    }
+
+    if (i == contents->instructionCounter + contents->dataCounter)
+    {
+        fileTexts->object = FormatObjectFile(&instructionSegment,
+                                             &dataSegment,
+                                             &fileTexts->objectLength);
+    }
+
+    DestroyMemorySegment(&instructionSegment);
+    DestroyMemorySegment(&dataSegment);
+
+    if (NULL == fileTexts->object)
+    {
+        return FAILURE;
+    }
+
+    if (contents->flags & HAS_ENTRIES_FLAG)
     {
-        WriteToObjectFile(objectFile,
-                          instructionsArray,
-                          dataArray,
-                          dataCounter,
-                          instructionCounter);
-        CloseFile(objectFile);
+        fileTexts->entries = FormatObjectSymbols(contents->symbols,
+                                                 contents->numOfEntries,
+                                                 &fileTexts->entriesLength);
+        if (NULL == fileTexts->entries)
+        {
+            return FAILURE;
+        }
     }
+
+    if (contents->flags & HAS_EXTERNALS_FLAG)
+    {
+        fileTexts->externs = FormatObjectSymbols(contents->symbols + contents->numOfEntries,
+                                                 contents->numOfExterns,
+                                                 &fileTexts->externsLength);
+        if (NULL == fileTexts->externs)
+        {
+            return FAILURE;
+        }
+    }
+
+    /* The object files have no code labels */
+    if (C_PROGRAM == objectFormat)
+    {
+        fileTexts->cProgram = TranslateToC(contents->words,
+                                           contents->instructionCounter,
+                                           contents->words + contents->instructionCounter,
+                                           contents->dataCounter,
+                                           NULL,
+                                           &fileTexts->cProgramLength);
+        if (NULL == fileTexts->cProgram)
+        {
+            return FAILURE;
+        }
+    }
+
+    return SUCCESS;
 }
 
-static void BuildEntriesFile(SymbolTableNode *symbolTableHead,
-                             const char *filename)
+void WriteFiles(const FileTexts *fileTexts,
+                const char *filename,
+                Diagnostics *diagnostics)
 {
-    FILE *entriesFile = OpenFile(filename, ENTRY_FILE_POSTFIX);
+    assert(NULL != fileTexts);
+    assert(NULL != filename);
+    assert(NULL != diagnostics);
 
-    if (NULL != entriesFile)
+    if (NULL != fileTexts->object)
     {
-        WriteToFileByType(entriesFile, symbolTableHead, ENTRY);
-        CloseFile(entriesFile);
+        WriteFile(fileTexts->object,
+                  fileTexts->objectLength,
+                  filename,
+                  OBJECT_FILE_POSTFIX,
+                  diagnostics);
     }
+
+    if (NULL != fileTexts->entries)
+    {
+        WriteFile(fileTexts->entries,
+                  fileTexts->entriesLength,
+                  filename,
+                  ENTRY_FILE_POSTFIX,
+                  diagnostics);
+    }
+
+    if (NULL != fileTexts->externs)
+    {
+        WriteFile(fileTexts->externs,
+                  fileTexts->externsLength,
+                  filename,
+                  EXTERN_FILE_POSTFIX,
+                  diagnostics);
+    }
+
+    if (NULL != fileTexts->binaryObject)
+    {
+        WriteFile(fileTexts->binaryObject,
+                  fileTexts->binaryObjectLength,
+                  filename,
+                  BINARY_OBJECT_FILE_POSTFIX,
+                  diagnostics);
+    }
+
+    if (NULL != fileTexts->cProgram)
+    {
+        WriteFile(fileTexts->cProgram,
+                  fileTexts->cProgramLength,
+                  filename,
+                  C_PROGRAM_FILE_POSTFIX,
+                  diagnostics);
+    }
+}
+
+void DestroyFileTexts(FileTexts *fileTexts)
+{
+    assert(NULL != fileTexts);
+
+    free(fileTexts->object);
+    free(fileTexts->entries);
+    free(fileTexts->externs);
+    free(fileTexts->binaryObject);
+    free(fileTexts->cProgram);
+    memset(fileTexts, 0, sizeof(FileTexts));
 }
 
-static void BuildExternalsFile(SymbolTableNode *symbolTableHead,
-                               const char *filename)
+/* Static functions */
+
+/* Returns the "name\taddress\n" lines of the symbols (malloced,
+ * NUL-terminated), or NULL */
+static char *FormatObjectSymbols(const ObjectSymbol *symbols,
+                                 unsigned long numOfSymbols,
+                                 size_t *length)
 {
-    FILE *externalsFile = OpenFile(filename, EXTERN_FILE_POSTFIX);
+    size_t textSize = 1;
+    char *text = NULL, *end = NULL;
+    unsigned long i = 0;
 
-    if (NULL != externalsFile)
+    for (i = 0; i < numOfSymbols; ++i)
     {
-        WriteToFileByType(externalsFile, symbolTableHead, EXTERNAL);
-        CloseFile(externalsFile);
+        textSize += symbols[i].name.length + MAX_SYMBOL_LINE_EXTRA;
+    }
+
+    text = (char *)malloc(textSize);
+    if (NULL == text)
+    {
+        return NULL;
     }
+
+    end = text;
+
+    for (i = 0; i < numOfSymbols; ++i)
+    {
+        memcpy(end, symbols[i].name.start, symbols[i].name.length);
+        end += symbols[i].name.length;
+        *end++ = '\t';
+        end = WriteNumber(end, symbols[i].address, MIN_ADDRESS_DIGITS);
+        *end++ = NEW_LINE;
+    }
+
+    *end = END_LINE;
+    *length = end - text;
+
+    return text;
 }
 
-static void WriteToObjectFile(FILE *objectFile,
-                              MemoryWord *instructionsArray,
-                              MemoryWord *dataArray,
-                              int dataCounter,
-                              int instructionCounter)
+static void WriteFile(const char *text,
+                      size_t length,
+                      const char *filename,
+                      const char *postfix,
+                      Diagnostics *diagnostics)
 {
-    int i = 0;
-    fprintf(objectFile, "\t%d %d\n", instructionCounter, dataCounter);
+    FILE *file = OpenFile(filename, postfix, diagnostics);
 
-    for (i = 0; i < instructionCounter; ++i)
+    if (NULL != file)
     {
-        SpecialWord *specialWord = (SpecialWord *)(instructionsArray + i);
+        if (fwrite(text, 1, length, file) != length)
+        {
+            ReportError(diagnostics, "Error writing the %s file of \"%s\"\n", postfix, filename);
+        }
 
-        fprintf(objectFile, "%04d\t", STARTING_ADDRESS + i);
-        WriteSpecialWordToObjectFile(objectFile, specialWord);
+        CloseFile(file);
     }
+}
+
+/* Returns the text of the object file (malloced), or NULL */
+static char *FormatObjectFile(const MemorySegment *instructionSegment,
+                              const MemorySegment *dataSegment,
+                              size_t *length)
+{
+    char *buffer = NULL, *end = NULL;
+    size_t instructionCounter = instructionSegment->numOfWords;
+    size_t dataCounter = dataSegment->numOfWords;
+    size_t bufferSize = MAX_HEADER_SIZE +
+                        (instructionCounter + dataCounter) * MAX_OBJECT_LINE_SIZE;
 
-    for (i = 0; i < dataCounter; ++i)
+    buffer = (char *)malloc(bufferSize);
+    if (NULL == buffer)
     {
-        SpecialWord *specialWord = (SpecialWord *)(dataArray + i);
+        return NULL;
+    }
+
+    end = buffer;
+    *end++ = '\t';
+    end = WriteNumber(end, instructionCounter, 1);
+    *end++ = ' ';
+    end = WriteNumber(end, dataCounter, 1);
+    *end++ = NEW_LINE;
+
+    end = WriteWords(end,
+                     instructionSegment->words,
+                     instructionCounter,
+                     STARTING_ADDRESS);
+    end = WriteWords(end,
+                     dataSegment->words,
+                     dataCounter,
+                     STARTING_ADDRESS + instructionCounter);
 
-        fprintf(objectFile, "%04d\t", STARTING_ADDRESS + instructionCounter + i);
-        WriteSpecialWordToObjectFile(objectFile, specialWord);
+    *length = end - buffer;
+
+    return buffer;
+}
+
+/* Writes "address\tencoding\n" for every word, returns the end of the text.
+ * The words are encoded a batch at a time; the padding byte after every
+ * encoding is copied with it, where the '\n' goes. */
+static char *WriteWords(char *buffer,
+                        const MemoryWord *words,
+                        size_t numOfWords,
+                        unsigned long address)
+{
+    char encodings[WORD_BATCH_SIZE * ENCODED_WORD_STRIDE];
+    WordCodec codec = GetWordCodec();
+    size_t i = 0, j = 0, batchSize = 0;
+
+    for (i = 0; i < numOfWords; i += batchSize)
+    {
+        batchSize = (numOfWords - i < WORD_BATCH_SIZE) ? numOfWords - i : WORD_BATCH_SIZE;
+
+        EncodeWords(codec, encodings, words + i, batchSize);
+
+        for (j = 0; j < batchSize; ++j)
+        {
+            buffer = WriteNumber(buffer, address + i + j, MIN_ADDRESS_DIGITS);
+            *buffer++ = '\t';
+            memcpy(buffer, encodings + j * ENCODED_WORD_STRIDE, ENCODED_WORD_STRIDE);
+            buffer += ENCODED_WORD_SIZE;
+            *buffer++ = NEW_LINE;
+        }
     }
+
+    return buffer;
 }
 
-static void WriteSpecialWordToObjectFile(FILE *objectFile,
-                                         SpecialWord *specialWord)
+/* Like "%0*lu", returns the end of the number */
+static char *WriteNumber(char *buffer, unsigned long number, int minDigits)
 {
-    fprintf(objectFile, "%c", CONVERTER_LUT[specialWord->part7]);
-    fprintf(objectFile, "%c", CONVERTER_LUT[specialWord->part6]);
-    fprintf(objectFile, "%c", CONVERTER_LUT[specialWord->part5]);
-    fprintf(objectFile, "%c", CONVERTER_LUT[specialWord->part4]);
-    fprintf(objectFile, "%c", CONVERTER_LUT[specialWord->part3]);
-    fprintf(objectFile, "%c", CONVERTER_LUT[specialWord->part2]);
-    fprintf(objectFile, "%c\n", CONVERTER_LUT[specialWord->part1]);
+    char digits[MAX_ADDRESS_DIGITS] = {0};
+    int numOfDigits = 0;
+
+    do
+    {
+        digits[numOfDigits++] = ZERO_DIGIT + (char)(number % 10);
+        number /= 10;
+    } while (0 != number);
+
+    for (; minDigits > numOfDigits; --minDigits)
+    {
+        *buffer++ = ZERO_DIGIT;
+    }
+
+    while (numOfDigits > 0)
+    {
+        *buffer++ = digits[--numOfDigits];
+    }
+
+    return buffer;
 }
 
-static FILE *OpenFile(const char *filename, const char *postfix)
+static FILE *OpenFile(const char *filename,
+                      const char *postfix,
+                      Diagnostics *diagnostics)
 {
     FILE *file = NULL;
     char filenameWithPostfix[MAX_FILENAME_SIZE] = {0};
@@ -175,10 +483,13 @@ static FILE *OpenFile(const char *filename, const char *postfix)
     strcpy(filenameWithPostfix, filename);
     strcat(filenameWithPostfix, postfix);
 
+    /* A new file is created rather than the old one truncated, as the old
+     * one may be a link to an entry of an output cache */
+    remove(filenameWithPostfix);
     file = fopen(filenameWithPostfix, WRITING_MODE);
     if (NULL == file)
     {
-        fprintf(stderr, "Error opening file \"%s\": %s\n", filename, strerror(errno));
+        ReportWarning(diagnostics, "Error opening file \"%s\": %s\n", filename, strerror(errno));
         return NULL;
     }
 
@@ -0,0 +1,48 @@
+/****************************************
+* ASSEMBLER: instruction_table.c        *
+****************************************/
+
+#include <stdlib.h> /* realloc, free */
+#include <string.h> /* memset */
+#include <assert.h> /* assert */
+
+#include "instruction_table.h" /* API */
+
+#define INITIAL_INSTRUCTIONS_CAPACITY (64)
+
+ReturnStatus AddInstruction(InstructionTable *instructionTable,
+                            const Instruction *instruction)
+{
+    assert(NULL != instructionTable);
+    assert(NULL != instruction);
+
+    if (instructionTable->numOfInstructions == instructionTable->capacity)
+    {
+        size_t newCapacity = (0 == instructionTable->capacity)
+                                 ? INITIAL_INSTRUCTIONS_CAPACITY
+                                 : 2 * instructionTable->capacity;
+        Instruction *newInstructions =
+            (Instruction *)realloc(instructionTable->instructions,
+                                   newCapacity * sizeof(Instruction));
+        if (NULL == newInstructions)
+        {
+            return FAILURE;
+        }
+
+        instructionTable->instructions = newInstructions;
+        instructionTable->capacity = newCapacity;
+    }
+
+    instructionTable->instructions[instructionTable->numOfInstructions++] =
+        *instruction;
+
+    return SUCCESS;
+}
+
+void DestroyInstructionTable(InstructionTable *instructionTable)
+{
+    assert(NULL != instructionTable);
+
+    free(instructionTable->instructions);
+    memset(instructionTable, 0, sizeof(InstructionTable));
+}
@@ -5,40 +5,297 @@
 * Date: 19/08/2019                      *
 ****************************************/
 
-#include <stdio.h>  /* FILE, fprintf, fopen, fclose */
+#include <stdio.h>  /* FILE, fprintf, fopen, fclose, fputs */
 #include <errno.h>  /* errno */
-#include <string.h> /* strerror, strcat, strcpy */
-#include <stdlib.h> /* EXIT_SUCCESS */
+#include <string.h> /* strerror, strcat, strcpy, strcmp, strncmp */
+#include <stdlib.h> /* EXIT_SUCCESS, EXIT_FAILURE, strtol, calloc, free */
+#include <limits.h> /* INT_MAX, ULONG_MAX */
 
-#include "file_scanner.h"    /* API */
-#include "assembler_utils.h" /* Utils file */
+#include "file_scanner.h"     /* API */
+#include "diagnostics.h"      /* API */
+#include "thread_pool.h"      /* API */
+#include "assembly_service.h" /* API */
+#include "assembler_utils.h"  /* Utils file */
 
 static const char *ASSEMBLY_FILE_POSTFIX = ".as";
 static const char *READING_MODE = "r";
+static const char *JOBS_OPTION = "-j";
+static const char *SERVER_OPTION = "-d";
+static const char *CLIENT_OPTION = "-c";
+static const char *INCREMENTAL_OPTION = "-i";
+static const char *OUTPUT_CACHE_OPTION = "-r";
+static const char *OUTPUT_CACHE_SIZE_OPTION = "-m";
+static const char *BINARY_OBJECT_OPTION = "-b";
+static const char *C_PROGRAM_OPTION = "--emit-c";
+
+/* In megabytes */
+#define DEFAULT_OUTPUT_CACHE_SIZE (256)
+#define BYTES_PER_MEGABYTE (1024UL * 1024UL)
+
+typedef struct
+{
+    const char *filename;
+    const ScanOptions *options;
+    Diagnostics diagnostics;
+} AssemblyJob;
+
+static const char *GetOptionValue(int argc, char *argv[], int *i, const char *option);
+static bool GetNumericValue(const char *value, long maxNumber, long *number);
+static int PrintUsage(const char *programName);
+static void AssembleFile(const char *filename,
+                         const ScanOptions *options,
+                         Diagnostics *diagnostics);
+static void RunAssemblyJob(void *argument);
+static int AssembleInParallel(char *filenames[],
+                              int numOfFiles,
+                              int numOfJobs,
+                              const ScanOptions *options);
 
 int main(int argc, char *argv[])
 {
+    int i = 1, numOfJobs = 0; /* 0 when -j is not given */
+    const char *serverSocket = NULL, *clientSocket = NULL;
+    ScanOptions options = {FALSE, NULL, 0, TEXT_OBJECT};
+    OutputCache outputCache = {NULL, DEFAULT_OUTPUT_CACHE_SIZE * BYTES_PER_MEGABYTE};
+
+    while (i < argc && '-' == argv[i][0])
+    {
+        const char *value = NULL;
+
+        /* -i: reuse the lines that did not change since the last assembly */
+        if (0 == strcmp(argv[i], INCREMENTAL_OPTION))
+        {
+            options.isIncremental = TRUE;
+            ++i;
+        }
+        /* -b: write a binary object file instead of the .ob, .ent and .ext files */
+        else if (0 == strcmp(argv[i], BINARY_OBJECT_OPTION))
+        {
+            options.objectFormat = BINARY_OBJECT;
+            ++i;
+        }
+        /* --emit-c: also translate the program to a C program */
+        else if (0 == strcmp(argv[i], C_PROGRAM_OPTION))
+        {
+            options.objectFormat = C_PROGRAM;
+            ++i;
+        }
+        /* -r DIR: reuse the files of assemblies of the same source in DIR */
+        else if (NULL != (value = GetOptionValue(argc, argv, &i, OUTPUT_CACHE_OPTION)))
+        {
+            outputCache.directory = value;
+            options.outputCache = &outputCache;
+        }
+        /* -m N: keep up to N megabytes in the directory of -r */
+        else if (NULL != (value = GetOptionValue(argc, argv, &i, OUTPUT_CACHE_SIZE_OPTION)))
+        {
+            long numOfMegabytes = 0;
+
+            if (!GetNumericValue(value, (long)(ULONG_MAX / BYTES_PER_MEGABYTE), &numOfMegabytes))
+            {
+                return PrintUsage(argv[0]);
+            }
+
+            outputCache.maxSize = (unsigned long)numOfMegabytes * BYTES_PER_MEGABYTE;
+        }
+        /* -j N: assemble up to N files concurrently (0 for one per processor) */
+        else if (NULL != (value = GetOptionValue(argc, argv, &i, JOBS_OPTION)))
+        {
+            long number = 0;
+
+            if (!GetNumericValue(value, INT_MAX, &number))
+            {
+                return PrintUsage(argv[0]);
+            }
+
+            numOfJobs = (int)number;
+            if (0 == numOfJobs)
+            {
+                numOfJobs = GetNumOfProcessors();
+            }
+        }
+        /* -d SOCKET: serve assembly requests on the socket */
+        else if (NULL != (value = GetOptionValue(argc, argv, &i, SERVER_OPTION)))
+        {
+            serverSocket = value;
+        }
+        /* -c SOCKET: have the server on the socket assemble the files */
+        else if (NULL != (value = GetOptionValue(argc, argv, &i, CLIENT_OPTION)))
+        {
+            clientSocket = value;
+        }
+        else
+        {
+            return PrintUsage(argv[0]);
+        }
+    }
+
+    /* The server sends back the text files */
+    if ((NULL != serverSocket && i < argc) ||
+        (NULL != clientSocket && TEXT_OBJECT != options.objectFormat))
+    {
+        return PrintUsage(argv[0]);
+    }
+
+    if (NULL != serverSocket)
+    {
+        return RunAssemblyServer(serverSocket,
+                                 (0 == numOfJobs) ? GetNumOfProcessors() : numOfJobs);
+    }
+
+    if (NULL != clientSocket)
+    {
+        i += RunAssemblyClient(clientSocket, argv + i, argc - i);
+    }
+
+    if (numOfJobs > 1 && argc - i > 1)
+    {
+        return AssembleInParallel(argv + i, argc - i, numOfJobs, &options);
+    }
+
+    /* The workers of a single file scan the parts of a large source */
+    options.numOfThreads = numOfJobs;
+
+    for (; i < argc; ++i)
+    {
+        Diagnostics diagnostics = {0};
+
+        diagnostics.stream = stderr;
+        AssembleFile(argv[i], &options, &diagnostics);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Static functions */
+
+/* Returns the value of the option at argv[*i] ("-jN" or "-j N") and moves
+ * past it, or NULL if argv[*i] is another option */
+static const char *GetOptionValue(int argc, char *argv[], int *i, const char *option)
+{
+    size_t optionLen = strlen(option);
+    const char *value = argv[*i] + optionLen;
+
+    if (0 != strncmp(argv[*i], option, optionLen))
+    {
+        return NULL;
+    }
+
+    if (END_LINE == value[0] && *i + 1 < argc)
+    {
+        value = argv[++*i];
+    }
+
+    ++*i;
+
+    return value;
+}
+
+/* Reads a whole value of an option as a number from 0 to maxNumber.
+ * Returns FALSE when it is not one. */
+static bool GetNumericValue(const char *value, long maxNumber, long *number)
+{
+    char *end = NULL;
+
+    errno = 0;
+    *number = strtol(value, &end, 10);
+
+    return (END_LINE != value[0] &&
+            END_LINE == *end &&
+            0 == errno &&
+            *number >= 0 &&
+            *number <= maxNumber);
+}
+
+static int PrintUsage(const char *programName)
+{
+    fprintf(stderr, "Usage: %s [-i] [-b | --emit-c] [-r DIR [-m MB]] [-j N] [-c SOCKET] file...\n", programName);
+    fprintf(stderr, "       %s -d SOCKET [-j N]\n", programName);
+
+    return EXIT_FAILURE;
+}
+
+static void AssembleFile(const char *filename,
+                         const ScanOptions *options,
+                         Diagnostics *diagnostics)
+{
+    FILE *assemblyFile = NULL;
+    char filenameWithPostfix[MAX_FILENAME_SIZE] = {0};
+
+    strcpy(filenameWithPostfix, filename);
+    strcat(filenameWithPostfix, ASSEMBLY_FILE_POSTFIX);
+
+    assemblyFile = fopen(filenameWithPostfix, READING_MODE);
+    if (NULL == assemblyFile)
+    {
+        ReportWarning(diagnostics,
+                      "Error opening file \"%s\": %s\n",
+                      filenameWithPostfix,
+                      strerror(errno));
+        return;
+    }
+
+    RunScans(assemblyFile, filename, options, diagnostics);
+
+    fclose(assemblyFile);
+}
+
+static void RunAssemblyJob(void *argument)
+{
+    AssemblyJob *job = (AssemblyJob *)argument;
+
+    AssembleFile(job->filename, job->options, &job->diagnostics);
+}
+
+/* The diagnostics of every file are collected separately and printed in
+ * the order of the files on the command line */
+static int AssembleInParallel(char *filenames[],
+                              int numOfFiles,
+                              int numOfJobs,
+                              const ScanOptions *options)
+{
+    AssemblyJob *jobs = NULL;
+    ThreadPool *threadPool = NULL;
     int i = 0;
 
-    for (i = 1; i < argc; ++i)
+    jobs = (AssemblyJob *)calloc(numOfFiles, sizeof(AssemblyJob));
+    threadPool = CreateThreadPool(numOfJobs < numOfFiles ? numOfJobs : numOfFiles);
+    if (NULL == jobs || NULL == threadPool)
     {
-        FILE *assemblyFile = NULL;
-        char filename[MAX_FILENAME_SIZE] = {0};
+        fprintf(stderr, "Memory allocation error\n");
+        if (NULL != threadPool)
+        {
+            DestroyThreadPool(threadPool);
+        }
+        free(jobs);
+        return EXIT_FAILURE;
+    }
 
-        strcpy(filename, argv[i]);
-        strcat(filename, ASSEMBLY_FILE_POSTFIX);
+    for (i = 0; i < numOfFiles; ++i)
+    {
+        jobs[i].filename = filenames[i];
+        jobs[i].options = options;
 
-        assemblyFile = fopen(filename, READING_MODE);
-        if (NULL == assemblyFile)
+        if (SUCCESS != SubmitTask(threadPool, RunAssemblyJob, jobs + i))
         {
-            fprintf(stderr, "Error opening file \"%s\": %s\n", filename, strerror(errno));
-            continue;
+            RunAssemblyJob(jobs + i);
         }
+    }
+
+    WaitForTasks(threadPool);
+    DestroyThreadPool(threadPool);
 
-        RunScans(assemblyFile, argv[i]);
+    for (i = 0; i < numOfFiles; ++i)
+    {
+        if (NULL != jobs[i].diagnostics.buffer)
+        {
+            fputs(jobs[i].diagnostics.buffer, stderr);
+        }
 
-        fclose(assemblyFile);
+        DestroyDiagnostics(&jobs[i].diagnostics);
     }
 
+    free(jobs);
+
     return EXIT_SUCCESS;
 }
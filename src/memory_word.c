@@ -5,262 +5,398 @@
 * Date: 19/08/2019                      *
 ****************************************/
 
-#include <string.h> /* strlen, strtok */
+#include <stdlib.h> /* realloc, free */
+#include <string.h> /* memset */
 #include <assert.h> /* assert */
-#include <ctype.h>  /* isdigit, isalpha */
-#include <stdlib.h> /* atoi */
 
 #include "memory_word.h"        /* API */
 #include "sentence_analyzer.h" /* API */
-#include "operations.h"        /* API */
-
-static void InsertStringToDataArray(MemoryWord *dataArray,
-                                    const char *sentence,
-                                    int *dataCounter);
-static void InsertDataToDataArray(MemoryWord *dataArray,
-                                  const char *sentence,
-                                  int *dataCounter,
-                                  SymbolTableNode *symbolTableHead,
-                                  bool *errorHasOccurred,
-                                  int lineNumber);
+
+#define INITIAL_SEGMENT_CAPACITY (1024)
+
+/* A value placed at a bit of a word. The value is converted to unsigned
+ * first, so a negative value is shifted as its two's complement (shifting
+ * a negative int is undefined); SetMemoryWord then cuts it to the word. */
+#define WORD_FIELD(value, shift) ((unsigned int)(value) << (shift))
+
+static void InsertStringToDataSegment(MemorySegment *dataSegment,
+                                      const Sentence *sentence,
+                                      Diagnostics *diagnostics,
+                                      int lineNumber);
+static void InsertDataToDataSegment(MemorySegment *dataSegment,
+                                    const Sentence *sentence,
+                                    SymbolTable *symbolTable,
+                                    Diagnostics *diagnostics,
+                                    int lineNumber);
 static void SetMemoryWord(MemoryWord *memoryWord, unsigned int data);
-static bool IsNumber(const char *str);
-static bool IsImmediateNumber(const char *operand);
-static bool IsRegister(const char *operand);
-static int GetRegisterNum(const char *registerOperand);
-static bool IsFixedIndex(const char *operand);
-static void GetInstructionDetails(const char *instructionSentence,
-                                  InstructionDetails *instructionDetails,
-                                  SymbolTableNode *symbolTableHead,
-                                  bool *errorHasOccurred,
+static ReturnStatus GrowMemorySegment(MemorySegment *segment,
+                                      size_t numOfWords);
+static bool IsImmediateNumber(Span operand);
+static bool IsRegister(Span operand);
+static int GetRegisterNum(Span registerOperand);
+static bool IsFixedIndex(Span operand);
+static void FillOperandDetails(Span operandStr,
+                               Operand *operand,
+                               SymbolTable *symbolTable,
+                               Diagnostics *diagnostics,
+                               int lineNumber);
+static int GetNumberOrMacroValue(Span operand,
+                                 int minNumber,
+                                 SymbolTable *symbolTable,
+                                 Diagnostics *diagnostics,
+                                 int lineNumber);
+static void ReportNumberOutOfRange(Span number,
+                                   const char *rangeName,
+                                   Diagnostics *diagnostics,
+                                   int lineNumber);
+static void ReportTooManyOperands(const Operation *operation,
+                                  Diagnostics *diagnostics,
                                   int lineNumber);
-static void BuildMemoryWordsForOperand(Operand *operand,
+static void GetValueBetweenBrackets(Span operand,
+                                    Span *valueBetweenSquareBrackets);
+static void EncodeInstruction(const Instruction *instruction,
+                              MemoryWord *instructionsArray,
+                              int *instructionCounter,
+                              const SymbolTable *symbolTable,
+                              ExternReferenceList *externReferences,
+                              Diagnostics *diagnostics);
+static void BuildMemoryWordsForOperand(const Operand *operand,
                                        MemoryWord *instructionsArray,
                                        int *instructionCounter,
-                                       SymbolTableNode *symbolTableHead,
-                                       bool *errorHasOccurred,
+                                       const SymbolTable *symbolTable,
+                                       ExternReferenceList *externReferences,
+                                       Diagnostics *diagnostics,
                                        int lineNumber,
                                        OperandType operandType);
-static void FillOperandDetails(Operand *operand,
-                               SymbolTableNode *symbolTableHead,
-                               bool *errorHasOccurred,
-                               int lineNumber);
-static int GetNumberOrMacroValue(const char *operand,
-                                 SymbolTableNode *symbolTableHead,
-                                 bool *errorHasOccurred,
-                                 int lineNumber);
-static void GetValueBetweenBrackets(const char *operand,
-                                    char *valueBetweenSquareBrackets);
-static void SetMemoryWordWithSymbol(const char *symbolName,
+static void SetMemoryWordWithSymbol(int symbolId,
                                     MemoryWord *instructionsArray,
                                     int *instructionCounter,
-                                    SymbolTableNode *symbolTableHead,
-                                    bool *errorHasOccurred,
+                                    const SymbolTable *symbolTable,
+                                    ExternReferenceList *externReferences,
+                                    Diagnostics *diagnostics,
                                     int lineNumber);
 static void SetMemoryWordWithValueAndEncoding(MemoryWord *instructionsArray,
                                               int *instructionCounter,
                                               int value,
                                               Encoding encodingType);
 
-void InsertToDataArray(MemoryWord *dataArray,
-                       const char *sentence,
-                       int *dataCounter,
-                       SymbolTableNode *symbolTableHead,
-                       bool *errorHasOccurred,
-                       int lineNumber)
+void InsertToDataSegment(MemorySegment *dataSegment,
+                         const Sentence *sentence,
+                         SymbolTable *symbolTable,
+                         Diagnostics *diagnostics,
+                         int lineNumber)
 {
-    assert(NULL != dataArray);
+    assert(NULL != dataSegment);
     assert(NULL != sentence);
-    assert(IsDataSentence(sentence) || IsStringSentence(sentence));
-    assert(NULL != dataCounter);
-    assert(NULL != symbolTableHead);
-    assert(NULL != errorHasOccurred);
+    assert(DATA_SENTENCE == sentence->type || STRING_SENTENCE == sentence->type);
+    assert(NULL != symbolTable);
+    assert(NULL != diagnostics);
     assert(lineNumber >= 0);
 
-    IsStringSentence(sentence)
-        ? InsertStringToDataArray(dataArray, sentence, dataCounter)
-        : InsertDataToDataArray(dataArray,
-                                sentence,
-                                dataCounter,
-                                symbolTableHead,
-                                errorHasOccurred,
-                                lineNumber);
+    (STRING_SENTENCE == sentence->type)
+        ? InsertStringToDataSegment(dataSegment,
+                                    sentence,
+                                    diagnostics,
+                                    lineNumber)
+        : InsertDataToDataSegment(dataSegment,
+                                  sentence,
+                                  symbolTable,
+                                  diagnostics,
+                                  lineNumber);
 }
 
-void BuildFirstMemoryWord(MemoryWord *instructionsArray,
-                          const char *instructionSentence,
-                          int *instructionCounter,
-                          SymbolTableNode *symbolTableHead,
-                          bool *errorHasOccurred,
-                          int lineNumber)
+void ParseInstruction(const Sentence *instructionSentence,
+                      const Operation *operation,
+                      Instruction *instruction,
+                      SymbolTable *symbolTable,
+                      Diagnostics *diagnostics,
+                      int lineNumber)
 {
-    InstructionDetails instructionDetails = {0};
-    MemoryWord *memoryWord = NULL;
-    unsigned int data = 0;
+    Span operands = {0}, operand = {0};
 
-    assert(NULL != instructionsArray);
     assert(NULL != instructionSentence);
-    assert(NULL != instructionCounter);
-    assert(NULL != symbolTableHead);
-    assert(NULL != errorHasOccurred);
+    assert(INSTRUCTION_SENTENCE == instructionSentence->type);
+    assert(NULL != operation);
+    assert(NULL != instruction);
+    assert(NULL != symbolTable);
+    assert(NULL != diagnostics);
     assert(lineNumber >= 0);
 
-    memoryWord = (MemoryWord *)(instructionsArray + *instructionCounter);
+    memset(instruction, 0, sizeof(Instruction));
+    instruction->srcOperand.symbolId = NO_SYMBOL;
+    instruction->destOperand.symbolId = NO_SYMBOL;
+    instruction->lineNumber = lineNumber;
 
-    GetInstructionDetails(instructionSentence,
-                          &instructionDetails,
-                          symbolTableHead,
-                          errorHasOccurred,
-                          lineNumber);
+    instruction->operationCode = operation->code;
+    instruction->numOfOperands = operation->numOfOperands;
 
-    /* build first memory word */
-    data = (instructionDetails.operationCode << 6) |
-           (instructionDetails.srcOperand.addressingMethod << 4) |
-           (instructionDetails.destOperand.addressingMethod << 2);
-    SetMemoryWord(memoryWord, data);
+    operands = instructionSentence->operands;
 
-    /* Update IC */
-    *instructionCounter += instructionDetails.numOfMemoryWords;
+    if (0 == instruction->numOfOperands)
+    {
+        TrimWhiteSpaces(&operands);
+        if (NULL != operands.start && operands.length > 0)
+        {
+            ReportTooManyOperands(operation, diagnostics, lineNumber);
+        }
+
+        instruction->numOfMemoryWords = 1;
+        return;
+    }
+
+    if (2 == instruction->numOfOperands)
+    {
+        GetNextToken(&operands, COMMA_SIGN, &operand);
+        FillOperandDetails(operand,
+                           &instruction->srcOperand,
+                           symbolTable,
+                           diagnostics,
+                           lineNumber);
+
+        if (!GetNextToken(&operands, COMMA_SIGN, &operand))
+        {
+            ReportError(diagnostics, "Line %d:\tError: missing destination operand of \"%s\"\n",
+                        lineNumber,
+                        operation->name);
+            instruction->numOfMemoryWords = (unsigned char)GetNumOfMemoryWords(instruction);
+            return;
+        }
+        FillOperandDetails(operand,
+                           &instruction->destOperand,
+                           symbolTable,
+                           diagnostics,
+                           lineNumber);
+
+        if (!(operation->srcAddressingMethods &
+              ADDRESSING_METHOD_FLAG(instruction->srcOperand.addressingMethod)))
+        {
+            ReportError(diagnostics, "Line %d:\tError: illegal addressing method for the source operand of \"%s\"\n",
+                        lineNumber,
+                        operation->name);
+        }
+    }
+    else
+    {
+        assert(1 == instruction->numOfOperands);
+
+        GetNextToken(&operands, COMMA_SIGN, &operand);
+        FillOperandDetails(operand,
+                           &instruction->destOperand,
+                           symbolTable,
+                           diagnostics,
+                           lineNumber);
+    }
+
+    /* Whatever follows a comma after the last operand */
+    if (NULL != operands.start)
+    {
+        ReportTooManyOperands(operation, diagnostics, lineNumber);
+    }
+
+    if (!(operation->destAddressingMethods &
+          ADDRESSING_METHOD_FLAG(instruction->destOperand.addressingMethod)))
+    {
+        ReportError(diagnostics, "Line %d:\tError: illegal addressing method for the destination operand of \"%s\"\n",
+                    lineNumber,
+                    operation->name);
+    }
+
+    instruction->numOfMemoryWords = (unsigned char)GetNumOfMemoryWords(instruction);
 }
 
-void BuildOtherMemoryWords(MemoryWord *instructionsArray,
-                           const char *instructionSentence,
-                           int *instructionCounter,
-                           SymbolTableNode *symbolTableHead,
-                           bool *errorHasOccurred,
-                           int lineNumber)
+int GetNumOfMemoryWords(const Instruction *instruction)
 {
-    InstructionDetails instructionDetails = {0};
-
-    assert(NULL != instructionsArray);
-    assert(NULL != instructionSentence);
-    assert(NULL != instructionCounter);
-    assert(NULL != symbolTableHead);
-    assert(NULL != errorHasOccurred);
-    assert(lineNumber >= 0);
+    int numOfMemoryWords = 1;
 
-    GetInstructionDetails(instructionSentence,
-                          &instructionDetails,
-                          symbolTableHead,
-                          errorHasOccurred,
-                          lineNumber);
+    assert(NULL != instruction);
 
-    ++(*instructionCounter); /* For the first word */
+    if (0 == instruction->numOfOperands)
+    {
+        return numOfMemoryWords;
+    }
 
-    if (DIRECT_REGISTER_ADDRESSING == instructionDetails.srcOperand.addressingMethod &&
-        DIRECT_REGISTER_ADDRESSING == instructionDetails.destOperand.addressingMethod)
+    if (DIRECT_REGISTER_ADDRESSING == instruction->srcOperand.addressingMethod &&
+        DIRECT_REGISTER_ADDRESSING == instruction->destOperand.addressingMethod)
     {
-        MemoryWord *memoryWord = (MemoryWord *)(instructionsArray + *instructionCounter);
-        unsigned int data = (instructionDetails.srcOperand.value << 5) |
-                            (instructionDetails.destOperand.value << 2);
+        return numOfMemoryWords + 1;
+    }
 
-        SetMemoryWord(memoryWord, data);
-        ++(*instructionCounter);
+    if (2 == instruction->numOfOperands)
+    {
+        numOfMemoryWords += (FIXED_INDEX_ADDRESSING == instruction->srcOperand.addressingMethod) ? 2 : 1;
     }
-    else
+
+    numOfMemoryWords += (FIXED_INDEX_ADDRESSING == instruction->destOperand.addressingMethod) ? 2 : 1;
+
+    return numOfMemoryWords;
+}
+
+/* Encodes the instructions into the words from instructionsArray[IC] on.
+ * Symbols are resolved in source order, so externals get their addresses
+ * in order of use. */
+void EncodeInstructions(MemoryWord *instructionsArray,
+                        const Instruction *instructions,
+                        size_t numOfInstructions,
+                        int IC,
+                        const SymbolTable *symbolTable,
+                        ExternReferenceList *externReferences,
+                        Diagnostics *diagnostics)
+{
+    const Instruction *instruction = NULL, *end = NULL;
+
+    assert(NULL != instructionsArray || 0 == numOfInstructions);
+    assert(NULL != instructions || 0 == numOfInstructions);
+    assert(IC >= 0);
+    assert(NULL != symbolTable);
+    assert(NULL != externReferences);
+    assert(NULL != diagnostics);
+
+    end = instructions + numOfInstructions;
+
+    for (instruction = instructions; instruction != end; ++instruction)
     {
-        BuildMemoryWordsForOperand(&instructionDetails.srcOperand,
-                                   instructionsArray,
-                                   instructionCounter,
-                                   symbolTableHead,
-                                   errorHasOccurred,
-                                   lineNumber,
-                                   SRC_OPERAND);
+        EncodeInstruction(instruction,
+                          instructionsArray,
+                          &IC,
+                          symbolTable,
+                          externReferences,
+                          diagnostics);
+    }
+}
 
-        BuildMemoryWordsForOperand(&instructionDetails.destOperand,
-                                   instructionsArray,
-                                   instructionCounter,
-                                   symbolTableHead,
-                                   errorHasOccurred,
-                                   lineNumber,
-                                   DEST_OPERAND);
+/* Makes room for numOfWords words, without changing the words in use */
+ReturnStatus ReserveMemoryWords(MemorySegment *segment, size_t numOfWords)
+{
+    assert(NULL != segment);
+
+    return (numOfWords <= segment->capacity)
+               ? SUCCESS
+               : GrowMemorySegment(segment, numOfWords);
+}
+
+ReturnStatus AppendMemoryWord(MemorySegment *segment, unsigned int data)
+{
+    assert(NULL != segment);
+
+    if (segment->numOfWords == segment->capacity &&
+        SUCCESS != GrowMemorySegment(segment, segment->numOfWords + 1))
+    {
+        return FAILURE;
     }
+
+    SetMemoryWord(segment->words + segment->numOfWords++, data);
+
+    return SUCCESS;
+}
+
+void DestroyMemorySegment(MemorySegment *segment)
+{
+    assert(NULL != segment);
+
+    free(segment->words);
+    memset(segment, 0, sizeof(MemorySegment));
 }
 
 /* Static functions */
-static void InsertStringToDataArray(MemoryWord *dataArray,
-                                    const char *sentence,
-                                    int *dataCounter)
+static void InsertStringToDataSegment(MemorySegment *dataSegment,
+                                      const Sentence *sentence,
+                                      Diagnostics *diagnostics,
+                                      int lineNumber)
 {
-    char string[MAX_SENTENCE_SIZE] = {0};
-    int i = 0, stringLen = 0;
+    Span string = {0};
+    size_t i = 0;
 
-    GetString(sentence, string);
-    stringLen = strlen(string) + 1; /* +1 for '\0' */
+    if (!GetString(sentence->operands, &string))
+    {
+        ReportError(diagnostics,
+                    "Line %d:\tError: string must be surrounded by quotes\n",
+                    lineNumber);
+        return;
+    }
 
-    for (i = 0; i < stringLen; ++i, ++(*dataCounter))
+    /* +1 for '\0' */
+    if (SUCCESS != ReserveMemoryWords(dataSegment,
+                                      dataSegment->numOfWords + string.length + 1))
     {
-        SetMemoryWord(dataArray + (*dataCounter), string[i]);
+        ReportError(diagnostics, "Line %d:\tMemory allocation error\n", lineNumber);
+        return;
     }
+
+    for (i = 0; i < string.length; ++i)
+    {
+        SetMemoryWord(dataSegment->words + dataSegment->numOfWords++,
+                      string.start[i]);
+    }
+
+    SetMemoryWord(dataSegment->words + dataSegment->numOfWords++, END_LINE);
 }
 
-static void InsertDataToDataArray(MemoryWord *dataArray,
-                                  const char *sentence,
-                                  int *dataCounter,
-                                  SymbolTableNode *symbolTableHead,
-                                  bool *errorHasOccurred,
-                                  int lineNumber)
+static void InsertDataToDataSegment(MemorySegment *dataSegment,
+                                    const Sentence *sentence,
+                                    SymbolTable *symbolTable,
+                                    Diagnostics *diagnostics,
+                                    int lineNumber)
 {
-    char data[MAX_SENTENCE_SIZE] = {0};
-    char *token = NULL;
-
-    assert(IsDataSentence(sentence));
+    Span data = sentence->operands, token = {0};
 
-    GetData(sentence, data);
-    token = strtok(data, COMMA_SIGN_ARRAY);
+    assert(DATA_SENTENCE == sentence->type);
 
-    while (NULL != token)
+    while (GetNextToken(&data, COMMA_SIGN, &token))
     {
-        int macroValue = 0;
+        int value = 0;
 
-        if (IsNumber(token))
+        if (0 == token.length) /* Empty values are skipped (as strtok did) */
         {
-            SetMemoryWord(dataArray + (*dataCounter)++, atoi(token));
+            continue;
         }
-        else if (IsValidMacro(symbolTableHead,
-                              token,
-                              &macroValue,
-                              errorHasOccurred,
-                              lineNumber))
+
+        if (IsNumber(token))
         {
-            SetMemoryWord(dataArray + (*dataCounter)++, macroValue);
+            value = GetNumber(token);
+            if (!IsNumberInRange(value, MIN_DATA_NUMBER, MAX_DATA_NUMBER))
+            {
+                ReportNumberOutOfRange(token, "a memory word", diagnostics, lineNumber);
+                return;
+            }
         }
-        else
+        else if (!IsValidMacro(symbolTable,
+                               token,
+                               &value,
+                               diagnostics,
+                               lineNumber))
         {
             return;
         }
 
-        token = strtok(NULL, COMMA_SIGN_ARRAY);
+        if (SUCCESS != AppendMemoryWord(dataSegment, value))
+        {
+            ReportError(diagnostics, "Line %d:\tMemory allocation error\n", lineNumber);
+            return;
+        }
     }
 }
 
-static bool IsNumber(const char *str)
-{
-    return (str[0] == PLUS_SIGN || str[0] == MINUS_SIGN || isdigit(str[0]));
-}
-
-static bool IsImmediateNumber(const char *operand)
+static bool IsImmediateNumber(Span operand)
 {
-    return (operand[0] == HASH_MARK);
+    return (operand.length > 0 && operand.start[0] == HASH_MARK);
 }
 
-static bool IsRegister(const char *operand)
+static bool IsRegister(Span operand)
 {
-    return (2 == strlen(operand) &&
-            operand[0] == REGISTER_PREFIX &&
-            isdigit(operand[1]) &&
-            operand[1] != ZERO_DIGIT &&
-            operand[1] != NINE_DIGIT);
+    return (2 == operand.length &&
+            operand.start[0] == REGISTER_PREFIX &&
+            operand.start[1] >= ZERO_DIGIT &&
+            operand.start[1] < ZERO_DIGIT + NUM_OF_REGISTERS);
 }
 
-static int GetRegisterNum(const char *registerOperand)
+static int GetRegisterNum(Span registerOperand)
 {
     assert(IsRegister(registerOperand));
 
-    return registerOperand[1] - '0';
+    return registerOperand.start[1] - ZERO_DIGIT;
 }
 
-static bool IsFixedIndex(const char *operand)
+static bool IsFixedIndex(Span operand)
 {
     int openingSquareBracketsIndex = FindChar(operand, OPENING_SQUARE_BRACKETS);
     int closingSquareBracketsIndex = FindChar(operand, CLOSING_SQUARE_BRACKETS);
@@ -270,65 +406,102 @@ static bool IsFixedIndex(const char *operand)
             closingSquareBracketsIndex > (openingSquareBracketsIndex + 1));
 }
 
-static int GetNumberOrMacroValue(const char *operand,
-                                 SymbolTableNode *symbolTableHead,
-                                 bool *errorHasOccurred,
+/* The value of an immediate (minNumber is MIN_OPERAND_NUMBER) or of an
+ * index (0): a number or a macro that fits in the 12 bits of the word */
+static int GetNumberOrMacroValue(Span operand,
+                                 int minNumber,
+                                 SymbolTable *symbolTable,
+                                 Diagnostics *diagnostics,
                                  int lineNumber)
 {
     int value = 0;
 
     if (IsNumber(operand))
     {
-        value = atoi(operand);
+        value = GetNumber(operand);
     }
-    else if (!IsValidMacro(symbolTableHead,
+    else if (!IsValidMacro(symbolTable,
                            operand,
                            &value,
-                           errorHasOccurred,
+                           diagnostics,
                            lineNumber))
     {
-        value = ERROR;
+        return ERROR;
+    }
+
+    if (!IsNumberInRange(value, minNumber, MAX_OPERAND_NUMBER))
+    {
+        ReportNumberOutOfRange(operand,
+                               (0 == minNumber) ? "an index" : "an immediate operand",
+                               diagnostics,
+                               lineNumber);
+        return ERROR;
     }
 
     return value;
 }
 
-static void GetValueBetweenBrackets(const char *operand,
-                                    char *valueBetweenSquareBrackets)
+static void ReportTooManyOperands(const Operation *operation,
+                                  Diagnostics *diagnostics,
+                                  int lineNumber)
+{
+    ReportError(diagnostics,
+                "Line %d:\tError: too many operands of \"%s\"\n",
+                lineNumber,
+                operation->name);
+}
+
+static void ReportNumberOutOfRange(Span number,
+                                   const char *rangeName,
+                                   Diagnostics *diagnostics,
+                                   int lineNumber)
+{
+    ReportError(diagnostics,
+                "Line %d:\tError: \"%.*s\" is out of the range of %s\n",
+                lineNumber,
+                (int)number.length,
+                number.start,
+                rangeName);
+}
+
+static void GetValueBetweenBrackets(Span operand,
+                                    Span *valueBetweenSquareBrackets)
 {
     int openingSquareBracketsIndex = FindChar(operand, OPENING_SQUARE_BRACKETS);
     int closingSquareBracketsIndex = FindChar(operand, CLOSING_SQUARE_BRACKETS);
-    int valueLen = closingSquareBracketsIndex - openingSquareBracketsIndex - 1;
 
-    strncpy(valueBetweenSquareBrackets,
-            operand + openingSquareBracketsIndex + 1,
-            valueLen);
+    valueBetweenSquareBrackets->start =
+        operand.start + openingSquareBracketsIndex + 1;
+    valueBetweenSquareBrackets->length =
+        closingSquareBracketsIndex - openingSquareBracketsIndex - 1;
+    TrimWhiteSpaces(valueBetweenSquareBrackets);
 }
 
-static void SetMemoryWordWithSymbol(const char *symbolName,
+static void SetMemoryWordWithSymbol(int symbolId,
                                     MemoryWord *instructionsArray,
                                     int *instructionCounter,
-                                    SymbolTableNode *symbolTableHead,
-                                    bool *errorHasOccurred,
+                                    const SymbolTable *symbolTable,
+                                    ExternReferenceList *externReferences,
+                                    Diagnostics *diagnostics,
                                     int lineNumber)
 {
     Symbol symbol = {0};
     SymbolCharacteristic encodingType = 0;
 
-    GetSymbolDetails(symbolTableHead,
-                     symbolName,
+    GetSymbolDetails(symbolTable,
+                     symbolId,
                      &symbol,
-                     errorHasOccurred,
+                     diagnostics,
                      lineNumber);
 
     if (EXTERNAL == symbol.type)
     {
         encodingType = EXTERNAL_ENCODING;
-        UpdateExternValue(symbolTableHead,
-                          symbol.name,
-                          *instructionCounter + STARTING_ADDRESS,
-                          errorHasOccurred,
-                          lineNumber);
+        AddExternReference(externReferences,
+                           symbolId,
+                           *instructionCounter + STARTING_ADDRESS,
+                           diagnostics,
+                           lineNumber);
     }
     else
     {
@@ -346,27 +519,80 @@ static void SetMemoryWordWithValueAndEncoding(MemoryWord *instructionsArray,
                                               int value,
                                               Encoding encodingType)
 {
-    MemoryWord *memoryWord =
-        (MemoryWord *)(instructionsArray + *instructionCounter);
-    unsigned int data = (value << 2) | encodingType;
+    MemoryWord *memoryWord = instructionsArray + *instructionCounter;
+    unsigned int data = WORD_FIELD(value, 2) | encodingType;
 
     SetMemoryWord(memoryWord, data);
     ++(*instructionCounter);
 }
 
-static void BuildMemoryWordsForOperand(Operand *operand,
-                                       MemoryWord *instructionsArray,
-                                       int *instructionCounter,
-                                       SymbolTableNode *symbolTableHead,
-                                       bool *errorHasOccurred,
-                                       int lineNumber,
-                                       OperandType operandType)
+static void EncodeInstruction(const Instruction *instruction,
+                              MemoryWord *instructionsArray,
+                              int *instructionCounter,
+                              const SymbolTable *symbolTable,
+                              ExternReferenceList *externReferences,
+                              Diagnostics *diagnostics)
 {
-    if (0 == operand->numOfMemoryWords)
+    MemoryWord *memoryWord = NULL;
+    unsigned int data = 0;
+
+    /* build first memory word */
+    memoryWord = instructionsArray + *instructionCounter;
+    data = WORD_FIELD(instruction->operationCode, 6) |
+           WORD_FIELD(instruction->srcOperand.addressingMethod, 4) |
+           WORD_FIELD(instruction->destOperand.addressingMethod, 2);
+    SetMemoryWord(memoryWord, data);
+    ++(*instructionCounter);
+
+    if (0 == instruction->numOfOperands)
     {
         return;
     }
 
+    if (DIRECT_REGISTER_ADDRESSING == instruction->srcOperand.addressingMethod &&
+        DIRECT_REGISTER_ADDRESSING == instruction->destOperand.addressingMethod)
+    {
+        memoryWord = instructionsArray + *instructionCounter;
+        data = WORD_FIELD(instruction->srcOperand.value, 5) |
+               WORD_FIELD(instruction->destOperand.value, 2);
+
+        SetMemoryWord(memoryWord, data);
+        ++(*instructionCounter);
+
+        return;
+    }
+
+    if (2 == instruction->numOfOperands)
+    {
+        BuildMemoryWordsForOperand(&instruction->srcOperand,
+                                   instructionsArray,
+                                   instructionCounter,
+                                   symbolTable,
+                                   externReferences,
+                                   diagnostics,
+                                   instruction->lineNumber,
+                                   SRC_OPERAND);
+    }
+
+    BuildMemoryWordsForOperand(&instruction->destOperand,
+                               instructionsArray,
+                               instructionCounter,
+                               symbolTable,
+                               externReferences,
+                               diagnostics,
+                               instruction->lineNumber,
+                               DEST_OPERAND);
+}
+
+static void BuildMemoryWordsForOperand(const Operand *operand,
+                                       MemoryWord *instructionsArray,
+                                       int *instructionCounter,
+                                       const SymbolTable *symbolTable,
+                                       ExternReferenceList *externReferences,
+                                       Diagnostics *diagnostics,
+                                       int lineNumber,
+                                       OperandType operandType)
+{
     switch (operand->addressingMethod)
     {
     case IMMEDIATE_ADDRESSING:
@@ -374,22 +600,20 @@ static void BuildMemoryWordsForOperand(Operand *operand,
         SetMemoryWordWithValueAndEncoding(instructionsArray,
                                           instructionCounter,
                                           operand->value,
-                                          operand->encodingType);
+                                          ABSOLUTE_ENCODING);
 
         break;
     }
 
     case DIRECT_ADDRESSING:
     {
-        char symbolName[MAX_SENTENCE_SIZE] = {0};
-
         /* Set address */
-        strcpy(symbolName, operand->operandStr);
-        SetMemoryWordWithSymbol(symbolName,
+        SetMemoryWordWithSymbol(operand->symbolId,
                                 instructionsArray,
                                 instructionCounter,
-                                symbolTableHead,
-                                errorHasOccurred,
+                                symbolTable,
+                                externReferences,
+                                diagnostics,
                                 lineNumber);
 
         break;
@@ -397,21 +621,13 @@ static void BuildMemoryWordsForOperand(Operand *operand,
 
     case FIXED_INDEX_ADDRESSING:
     {
-        char symbolName[MAX_SENTENCE_SIZE] = {0};
-        int openingSquareBracketsIndex = 0;
-
         /* Set address */
-        openingSquareBracketsIndex = FindChar(operand->operandStr,
-                                              OPENING_SQUARE_BRACKETS);
-
-        strncpy(symbolName, operand->operandStr, openingSquareBracketsIndex);
-        symbolName[openingSquareBracketsIndex] = END_LINE;
-
-        SetMemoryWordWithSymbol(symbolName,
+        SetMemoryWordWithSymbol(operand->symbolId,
                                 instructionsArray,
                                 instructionCounter,
-                                symbolTableHead,
-                                errorHasOccurred,
+                                symbolTable,
+                                externReferences,
+                                diagnostics,
                                 lineNumber);
 
         /* Set value */
@@ -425,18 +641,17 @@ static void BuildMemoryWordsForOperand(Operand *operand,
 
     case DIRECT_REGISTER_ADDRESSING:
     {
-        MemoryWord *memoryWord =
-            (MemoryWord *)(instructionsArray + (*instructionCounter));
+        MemoryWord *memoryWord = instructionsArray + *instructionCounter;
 
         if (SRC_OPERAND == operandType)
         {
-            SetMemoryWord(memoryWord, (operand->value << 5) | 0);
+            SetMemoryWord(memoryWord, WORD_FIELD(operand->value, 5));
         }
         else
         {
             assert(DEST_OPERAND == operandType);
 
-            SetMemoryWord(memoryWord, (operand->value << 2) | 0);
+            SetMemoryWord(memoryWord, WORD_FIELD(operand->value, 2));
         }
 
         ++(*instructionCounter);
@@ -446,123 +661,98 @@ static void BuildMemoryWordsForOperand(Operand *operand,
 
     default:
     {
-        fprintf(stderr, "Line %d:\tError: wrong addressing method - %d\n",
-                lineNumber,
-                operand->addressingMethod);
-        *errorHasOccurred = TRUE;
+        ReportError(diagnostics, "Line %d:\tError: wrong addressing method - %d\n",
+                    lineNumber,
+                    operand->addressingMethod);
         break;
     }
     }
 }
 
-static void FillOperandDetails(Operand *operand,
-                               SymbolTableNode *symbolTableHead,
-                               bool *errorHasOccurred,
+static void FillOperandDetails(Span operandStr,
+                               Operand *operand,
+                               SymbolTable *symbolTable,
+                               Diagnostics *diagnostics,
                                int lineNumber)
 {
-    if (IsImmediateNumber(operand->operandStr))
+    if (IsImmediateNumber(operandStr))
     {
-        char numberOrMacro[MAX_SENTENCE_SIZE] = {0};
+        Span number = operandStr;
 
+        ++number.start; /* Skip the '#' */
+        --number.length;
         operand->addressingMethod = IMMEDIATE_ADDRESSING;
-        operand->encodingType = ABSOLUTE_ENCODING;
-
-        strcpy(numberOrMacro, operand->operandStr + 1); /* +1 because of '#' */
-        operand->value = GetNumberOrMacroValue(numberOrMacro,
-                                               symbolTableHead,
-                                               errorHasOccurred,
+        operand->value = GetNumberOrMacroValue(number,
+                                               MIN_OPERAND_NUMBER,
+                                               symbolTable,
+                                               diagnostics,
                                                lineNumber);
-        operand->numOfMemoryWords = 1;
     }
-    else if (IsRegister(operand->operandStr))
+    else if (IsRegister(operandStr))
     {
         operand->addressingMethod = DIRECT_REGISTER_ADDRESSING;
-        operand->encodingType = ABSOLUTE_ENCODING;
-        operand->value = GetRegisterNum(operand->operandStr);
-        operand->numOfMemoryWords = 1;
+        operand->value = GetRegisterNum(operandStr);
     }
-    else if (IsFixedIndex(operand->operandStr))
+    else if (IsFixedIndex(operandStr))
     {
-        char valueBetweenSquareBrackets[MAX_SENTENCE_SIZE] = {0};
+        Span label = operandStr, valueBetweenSquareBrackets = {0};
+
+        label.length = FindChar(operandStr, OPENING_SQUARE_BRACKETS);
+        TrimWhiteSpaces(&label);
 
         operand->addressingMethod = FIXED_INDEX_ADDRESSING;
-        GetValueBetweenBrackets(operand->operandStr, valueBetweenSquareBrackets);
+        operand->symbolId = InternSymbolName(symbolTable,
+                                             label,
+                                             diagnostics,
+                                             lineNumber);
+
+        GetValueBetweenBrackets(operandStr, &valueBetweenSquareBrackets);
         operand->value = GetNumberOrMacroValue(valueBetweenSquareBrackets,
-                                               symbolTableHead,
-                                               errorHasOccurred,
+                                               0,
+                                               symbolTable,
+                                               diagnostics,
                                                lineNumber);
-        operand->numOfMemoryWords = 2;
     }
     else
     {
         operand->addressingMethod = DIRECT_ADDRESSING;
-        operand->numOfMemoryWords = 1;
+        operand->symbolId = InternSymbolName(symbolTable,
+                                             operandStr,
+                                             diagnostics,
+                                             lineNumber);
     }
 }
 
-static void GetInstructionDetails(const char *instructionSentence,
-                                  InstructionDetails *instructionDetails,
-                                  SymbolTableNode *symbolTableHead,
-                                  bool *errorHasOccurred,
-                                  int lineNumber)
+/* Every word is made here: data is taken modulo 2^MEMORY_WORD_SIZE_IN_BITS
+ * (a negative number, converted to unsigned, becomes its two's complement) */
+static void SetMemoryWord(MemoryWord *memoryWord, unsigned int data)
 {
-    char operands[MAX_SENTENCE_SIZE] = {0};
-
-    GetOperationName(instructionSentence, instructionDetails->operationName);
-    instructionDetails->operationCode =
-        GetOperationCode(instructionDetails->operationName);
+    *memoryWord = (MemoryWord)(data & MEMORY_WORD_MASK);
+}
 
-    GetInstructionParams(instructionSentence, operands);
-    instructionDetails->numOfOperands =
-        GetNumOfOperands(instructionDetails->operationName);
+/* The capacity is at least doubled, so appending is amortized O(1) */
+static ReturnStatus GrowMemorySegment(MemorySegment *segment,
+                                      size_t numOfWords)
+{
+    size_t newCapacity = (0 == segment->capacity)
+                             ? INITIAL_SEGMENT_CAPACITY
+                             : 2 * segment->capacity;
+    MemoryWord *newWords = NULL;
 
-    if (0 == instructionDetails->numOfOperands)
+    if (newCapacity < numOfWords)
     {
-        instructionDetails->numOfMemoryWords = 1;
-        return;
+        newCapacity = numOfWords;
     }
 
-    if (2 == instructionDetails->numOfOperands)
-    {
-        int commaIndex = FindChar(operands, COMMA_SIGN);
-
-        strncpy(instructionDetails->srcOperand.operandStr, operands, commaIndex);
-        strcpy(instructionDetails->destOperand.operandStr, operands + commaIndex + 1);
-
-        FillOperandDetails(&instructionDetails->srcOperand,
-                           symbolTableHead,
-                           errorHasOccurred,
-                           lineNumber);
-        FillOperandDetails(&instructionDetails->destOperand,
-                           symbolTableHead,
-                           errorHasOccurred,
-                           lineNumber);
-    }
-    else
+    newWords = (MemoryWord *)realloc(segment->words,
+                                     newCapacity * sizeof(MemoryWord));
+    if (NULL == newWords)
     {
-        assert(1 == instructionDetails->numOfOperands);
-
-        strcpy(instructionDetails->destOperand.operandStr, operands);
-        FillOperandDetails(&instructionDetails->destOperand,
-                           symbolTableHead,
-                           errorHasOccurred,
-                           lineNumber);
+        return FAILURE;
     }
 
-    if (DIRECT_REGISTER_ADDRESSING == instructionDetails->srcOperand.addressingMethod &&
-        DIRECT_REGISTER_ADDRESSING == instructionDetails->destOperand.addressingMethod)
-    {
-        instructionDetails->numOfMemoryWords = 2;
-    }
-    else
-    {
-        instructionDetails->numOfMemoryWords =
-            instructionDetails->srcOperand.numOfMemoryWords +
-            instructionDetails->destOperand.numOfMemoryWords + 1;
-    }
-}
+    segment->words = newWords;
+    segment->capacity = newCapacity;
 
-static void SetMemoryWord(MemoryWord *memoryWord, unsigned int data)
-{
-    memoryWord->data = data;
+    return SUCCESS;
 }
@@ -0,0 +1,674 @@
+/****************************************
+* ASSEMBLER: object_file.c              *
+****************************************/
+
+#include <stdlib.h> /* malloc, calloc, free */
+#include <string.h> /* memcpy, memcmp, memchr, memset, strlen */
+#include <assert.h> /* assert */
+
+#include "object_file.h"       /* API */
+#include "symbol_table.h"      /* API */
+#include "memory_word.h"       /* API */
+#include "files_builder.h"     /* API */
+#include "string_pool.h"       /* API */
+#include "source_reader.h"     /* API */
+#include "sentence_analyzer.h" /* API */
+#include "word_encoding.h"     /* API */
+#include "assembler_utils.h"   /* Utils file */
+
+#define MAX_NUMBER_DIGITS (9)
+/* The shortest line of a word: a digit, '\t', the word and '\n' */
+#define MIN_OBJECT_LINE_SIZE (ENCODED_WORD_SIZE + 3)
+#define MAX_FILE_SIZE (0xFFFFFFFFUL)
+
+/* Offsets of the fields of the header */
+#define VERSION_OFFSET (4)
+#define FLAGS_OFFSET (6)
+#define INSTRUCTION_COUNTER_OFFSET (8)
+#define DATA_COUNTER_OFFSET (12)
+#define WORDS_OFFSET (16)
+#define SYMBOLS_OFFSET (20)
+#define NUM_OF_ENTRIES_OFFSET (24)
+#define NUM_OF_EXTERNS_OFFSET (28)
+#define NAMES_OFFSET (32)
+#define NAMES_SIZE_OFFSET (36)
+#define FILE_SIZE_OFFSET (40)
+
+static void PutLittleEndian16(unsigned char *bytes, unsigned int value);
+static void PutLittleEndian32(unsigned char *bytes, unsigned long value);
+static unsigned int GetLittleEndian16(const unsigned char *bytes);
+static unsigned long GetLittleEndian32(const unsigned char *bytes);
+static unsigned long AlignToSymbols(unsigned long offset);
+static ReturnStatus ReadSymbolLines(Span text,
+                                    const char *postfix,
+                                    ObjectSymbol *symbols,
+                                    unsigned long *numOfSymbols,
+                                    Diagnostics *diagnostics);
+static unsigned long CountLines(Span text);
+static bool ParseNumber(Span str, unsigned long *number);
+static unsigned long StoreWordBatch(unsigned short *words,
+                                    unsigned long numOfWords,
+                                    unsigned long expectedNumOfWords,
+                                    EncodedWordBatch *batch,
+                                    Diagnostics *diagnostics);
+
+/* The entries are in the order of the .ent file and the externs in the
+ * order of the .ext file */
+ReturnStatus GetAssemblyContents(const MemorySegment *instructionSegment,
+                                 const MemorySegment *dataSegment,
+                                 const SymbolTable *symbolTable,
+                                 bool hasEntries,
+                                 bool hasExternals,
+                                 ObjectContents *contents)
+{
+    const SymbolTableNode *node = NULL;
+    ObjectSymbol *symbol = NULL;
+    unsigned long numOfWords = 0;
+    int j = 0;
+
+    assert(NULL != instructionSegment);
+    assert(NULL != dataSegment);
+    assert(NULL != symbolTable);
+    assert(NULL != contents);
+
+    memset(contents, 0, sizeof(ObjectContents));
+    contents->instructionCounter = instructionSegment->numOfWords;
+    contents->dataCounter = dataSegment->numOfWords;
+    contents->flags = (hasEntries ? HAS_ENTRIES_FLAG : 0) |
+                      (hasExternals ? HAS_EXTERNALS_FLAG : 0);
+
+    for (node = symbolTable->head; hasEntries && NULL != node; node = node->next)
+    {
+        contents->numOfEntries += (ENTRY == node->symbol.type);
+    }
+
+    if (hasExternals)
+    {
+        contents->numOfExterns = symbolTable->externReferences.numOfReferences;
+    }
+
+    numOfWords = contents->instructionCounter + contents->dataCounter;
+    contents->words = (unsigned short *)malloc((numOfWords + 1) * sizeof(unsigned short));
+    contents->symbols = (ObjectSymbol *)malloc(
+        (contents->numOfEntries + contents->numOfExterns + 1) * sizeof(ObjectSymbol));
+    if (NULL == contents->words || NULL == contents->symbols)
+    {
+        DestroyObjectContents(contents);
+        return FAILURE;
+    }
+
+    if (contents->instructionCounter > 0)
+    {
+        memcpy(contents->words,
+               instructionSegment->words,
+               contents->instructionCounter * sizeof(MemoryWord));
+    }
+
+    if (contents->dataCounter > 0)
+    {
+        memcpy(contents->words + contents->instructionCounter,
+               dataSegment->words,
+               contents->dataCounter * sizeof(MemoryWord));
+    }
+
+    symbol = contents->symbols;
+    for (node = symbolTable->head; hasEntries && NULL != node; node = node->next)
+    {
+        if (ENTRY == node->symbol.type)
+        {
+            symbol->name.start = GetSymbolName(symbolTable, node->symbol.nameId);
+            symbol->name.length = strlen(symbol->name.start);
+            symbol->address = (unsigned long)node->symbol.value;
+            ++symbol;
+        }
+    }
+
+    for (j = 0; hasExternals && j < symbolTable->externReferences.numOfReferences; ++j)
+    {
+        const ExternReference *reference = symbolTable->externReferences.references + j;
+
+        symbol->name.start = GetSymbolName(symbolTable, reference->symbolId);
+        symbol->name.length = strlen(symbol->name.start);
+        symbol->address = (unsigned long)reference->address;
+        ++symbol;
+    }
+
+    return SUCCESS;
+}
+
+/* Returns the binary object file of the program (malloced), or NULL. A
+ * name is kept once however many symbols have it. */
+char *FormatBinaryObject(const ObjectContents *contents, size_t *length)
+{
+    StringPool names = {0};
+    unsigned long *nameOffsets = NULL;
+    unsigned long numOfWords = 0, numOfSymbols = 0, namesSize = 0;
+    unsigned long symbolsOffset = 0, namesOffset = 0, fileSize = 0, i = 0;
+    unsigned char *file = NULL;
+    int *nameIds = NULL, id = 0;
+
+    assert(NULL != contents);
+    assert(NULL != length);
+
+    numOfWords = contents->instructionCounter + contents->dataCounter;
+    numOfSymbols = contents->numOfEntries + contents->numOfExterns;
+
+    nameIds = (int *)malloc((numOfSymbols + 1) * sizeof(int));
+    if (NULL == nameIds)
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < numOfSymbols; ++i)
+    {
+        const ObjectSymbol *symbol = contents->symbols + i;
+
+        nameIds[i] = InternString(&names, symbol->name.start, symbol->name.length);
+        if (ERROR == nameIds[i])
+        {
+            break;
+        }
+    }
+
+    nameOffsets = (unsigned long *)malloc((names.numOfStrings + 1) * sizeof(unsigned long));
+    if (i < numOfSymbols || NULL == nameOffsets)
+    {
+        free(nameOffsets);
+        free(nameIds);
+        DestroyStringPool(&names);
+        return NULL;
+    }
+
+    for (id = 0; id < names.numOfStrings; ++id)
+    {
+        nameOffsets[id] = namesSize;
+        namesSize += strlen(GetPooledString(&names, id)) + 1;
+    }
+
+    symbolsOffset = AlignToSymbols(BINARY_OBJECT_HEADER_SIZE + 2 * numOfWords);
+    namesOffset = symbolsOffset + numOfSymbols * BINARY_OBJECT_SYMBOL_SIZE;
+    fileSize = namesOffset + namesSize;
+
+    if (fileSize <= MAX_FILE_SIZE)
+    {
+        file = (unsigned char *)calloc(fileSize, 1);
+    }
+
+    if (NULL != file)
+    {
+        memcpy(file, BINARY_OBJECT_MAGIC, strlen(BINARY_OBJECT_MAGIC));
+        PutLittleEndian16(file + VERSION_OFFSET, BINARY_OBJECT_VERSION);
+        PutLittleEndian16(file + FLAGS_OFFSET, contents->flags);
+        PutLittleEndian32(file + INSTRUCTION_COUNTER_OFFSET, contents->instructionCounter);
+        PutLittleEndian32(file + DATA_COUNTER_OFFSET, contents->dataCounter);
+        PutLittleEndian32(file + WORDS_OFFSET, BINARY_OBJECT_HEADER_SIZE);
+        PutLittleEndian32(file + SYMBOLS_OFFSET, symbolsOffset);
+        PutLittleEndian32(file + NUM_OF_ENTRIES_OFFSET, contents->numOfEntries);
+        PutLittleEndian32(file + NUM_OF_EXTERNS_OFFSET, contents->numOfExterns);
+        PutLittleEndian32(file + NAMES_OFFSET, namesOffset);
+        PutLittleEndian32(file + NAMES_SIZE_OFFSET, namesSize);
+        PutLittleEndian32(file + FILE_SIZE_OFFSET, fileSize);
+
+        for (i = 0; i < numOfWords; ++i)
+        {
+            PutLittleEndian16(file + BINARY_OBJECT_HEADER_SIZE + 2 * i, contents->words[i]);
+        }
+
+        for (i = 0; i < numOfSymbols; ++i)
+        {
+            unsigned char *symbol = file + symbolsOffset + i * BINARY_OBJECT_SYMBOL_SIZE;
+
+            PutLittleEndian32(symbol, nameOffsets[nameIds[i]]);
+            PutLittleEndian32(symbol + 4, contents->symbols[i].address);
+        }
+
+        for (id = 0; id < names.numOfStrings; ++id)
+        {
+            const char *name = GetPooledString(&names, id);
+
+            memcpy(file + namesOffset + nameOffsets[id], name, strlen(name));
+        }
+
+        *length = fileSize;
+    }
+
+    free(nameOffsets);
+    free(nameIds);
+    DestroyStringPool(&names);
+
+    return (char *)file;
+}
+
+/* Checks that every table of the file is inside it, so the accessors need
+ * no checks of their own */
+ReturnStatus OpenBinaryObject(BinaryObject *object, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    unsigned long wordsOffset = 0, symbolsOffset = 0, namesOffset = 0;
+    unsigned long numOfSymbols = 0, i = 0;
+
+    assert(NULL != object);
+    assert(NULL != data || 0 == size);
+
+    memset(object, 0, sizeof(BinaryObject));
+
+    if (size < BINARY_OBJECT_HEADER_SIZE ||
+        0 != memcmp(bytes, BINARY_OBJECT_MAGIC, strlen(BINARY_OBJECT_MAGIC)) ||
+        BINARY_OBJECT_VERSION != GetLittleEndian16(bytes + VERSION_OFFSET) ||
+        size != GetLittleEndian32(bytes + FILE_SIZE_OFFSET))
+    {
+        return FAILURE;
+    }
+
+    object->data = bytes;
+    object->size = size;
+    object->flags = GetLittleEndian16(bytes + FLAGS_OFFSET);
+    object->instructionCounter = GetLittleEndian32(bytes + INSTRUCTION_COUNTER_OFFSET);
+    object->dataCounter = GetLittleEndian32(bytes + DATA_COUNTER_OFFSET);
+    object->numOfEntries = GetLittleEndian32(bytes + NUM_OF_ENTRIES_OFFSET);
+    object->numOfExterns = GetLittleEndian32(bytes + NUM_OF_EXTERNS_OFFSET);
+    object->namesSize = GetLittleEndian32(bytes + NAMES_SIZE_OFFSET);
+    wordsOffset = GetLittleEndian32(bytes + WORDS_OFFSET);
+    symbolsOffset = GetLittleEndian32(bytes + SYMBOLS_OFFSET);
+    namesOffset = GetLittleEndian32(bytes + NAMES_OFFSET);
+    numOfSymbols = object->numOfEntries + object->numOfExterns;
+
+    /* Every count is at most the size of the file, so nothing overflows */
+    if (object->instructionCounter > size || object->dataCounter > size ||
+        object->numOfEntries > size || object->numOfExterns > size ||
+        wordsOffset < BINARY_OBJECT_HEADER_SIZE || 0 != wordsOffset % 2 ||
+        wordsOffset + 2 * (object->instructionCounter + object->dataCounter) > size ||
+        0 != symbolsOffset % 4 || symbolsOffset > size ||
+        numOfSymbols * BINARY_OBJECT_SYMBOL_SIZE > size - symbolsOffset ||
+        namesOffset > size || object->namesSize > size - namesOffset ||
+        (numOfSymbols > 0 &&
+         (0 == object->namesSize || END_LINE != bytes[namesOffset + object->namesSize - 1])))
+    {
+        return FAILURE;
+    }
+
+    object->words = bytes + wordsOffset;
+    object->symbols = bytes + symbolsOffset;
+    object->names = (const char *)bytes + namesOffset;
+
+    for (i = 0; i < numOfSymbols; ++i)
+    {
+        if (GetLittleEndian32(object->symbols + i * BINARY_OBJECT_SYMBOL_SIZE) >= object->namesSize)
+        {
+            return FAILURE;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/* The word at address STARTING_ADDRESS + index */
+unsigned int GetBinaryObjectWord(const BinaryObject *object, unsigned long index)
+{
+    assert(NULL != object);
+    assert(index < object->instructionCounter + object->dataCounter);
+
+    return GetLittleEndian16(object->words + 2 * index);
+}
+
+/* The entries come first, then the externs */
+void GetBinaryObjectSymbol(const BinaryObject *object,
+                           unsigned long index,
+                           ObjectSymbol *symbol)
+{
+    const unsigned char *entry = NULL;
+
+    assert(NULL != object);
+    assert(index < object->numOfEntries + object->numOfExterns);
+    assert(NULL != symbol);
+
+    entry = object->symbols + index * BINARY_OBJECT_SYMBOL_SIZE;
+    symbol->name.start = object->names + GetLittleEndian32(entry);
+    symbol->name.length = strlen(symbol->name.start);
+    symbol->address = GetLittleEndian32(entry + 4);
+}
+
+/* The names point into the file */
+ReturnStatus ReadBinaryObject(const BinaryObject *object, ObjectContents *contents)
+{
+    unsigned long numOfWords = 0, numOfSymbols = 0, i = 0;
+
+    assert(NULL != object);
+    assert(NULL != contents);
+
+    memset(contents, 0, sizeof(ObjectContents));
+    numOfWords = object->instructionCounter + object->dataCounter;
+    numOfSymbols = object->numOfEntries + object->numOfExterns;
+
+    contents->words = (unsigned short *)malloc((numOfWords + 1) * sizeof(unsigned short));
+    contents->symbols = (ObjectSymbol *)malloc((numOfSymbols + 1) * sizeof(ObjectSymbol));
+    if (NULL == contents->words || NULL == contents->symbols)
+    {
+        DestroyObjectContents(contents);
+        return FAILURE;
+    }
+
+    contents->instructionCounter = object->instructionCounter;
+    contents->dataCounter = object->dataCounter;
+    contents->numOfEntries = object->numOfEntries;
+    contents->numOfExterns = object->numOfExterns;
+    contents->flags = object->flags;
+
+    for (i = 0; i < numOfWords; ++i)
+    {
+        contents->words[i] = (unsigned short)GetBinaryObjectWord(object, i);
+    }
+
+    for (i = 0; i < numOfSymbols; ++i)
+    {
+        GetBinaryObjectSymbol(object, i, contents->symbols + i);
+    }
+
+    return SUCCESS;
+}
+
+/* Reads the texts of the .ob file and of the .ent and .ext files (NULL
+ * when the program has none). The words must be in order of address, as
+ * the assembler writes them. The names point into the texts. */
+ReturnStatus ReadTextObject(Span object,
+                            const Span *entries,
+                            const Span *externs,
+                            ObjectContents *contents,
+                            Diagnostics *diagnostics)
+{
+    SourceReader sourceReader;
+    EncodedWordBatch batch;
+    Span line = {0}, field = {0};
+    unsigned long numOfWords = 0, expectedNumOfWords = 0, numOfSymbols = 0;
+    int lineNumber = 1;
+
+    assert(NULL != object.start || 0 == object.length);
+    assert(NULL != contents);
+    assert(NULL != diagnostics);
+
+    batch.numOfWords = 0;
+
+    memset(contents, 0, sizeof(ObjectContents));
+    contents->flags = ((NULL != entries) ? HAS_ENTRIES_FLAG : 0) |
+                      ((NULL != externs) ? HAS_EXTERNALS_FLAG : 0);
+
+    OpenSourceBuffer(&sourceReader, object.start, object.length);
+
+    if (ReadSentence(&sourceReader, &line))
+    {
+        TrimWhiteSpaces(&line);
+
+        if (GetNextToken(&line, ' ', &field) &&
+            ParseNumber(field, &contents->instructionCounter) &&
+            GetNextToken(&line, ' ', &field))
+        {
+            ParseNumber(field, &contents->dataCounter);
+        }
+    }
+
+    expectedNumOfWords = contents->instructionCounter + contents->dataCounter;
+    if (0 == contents->instructionCounter ||
+        expectedNumOfWords > object.length / MIN_OBJECT_LINE_SIZE)
+    {
+        ReportError(diagnostics, "Line %d:\tError: bad object file header\n", lineNumber);
+        return FAILURE;
+    }
+
+    numOfSymbols = ((NULL != entries) ? CountLines(*entries) : 0) +
+                   ((NULL != externs) ? CountLines(*externs) : 0);
+    contents->words = (unsigned short *)malloc(expectedNumOfWords * sizeof(unsigned short));
+    contents->symbols = (ObjectSymbol *)malloc((numOfSymbols + 1) * sizeof(ObjectSymbol));
+    if (NULL == contents->words || NULL == contents->symbols)
+    {
+        ReportError(diagnostics, "Memory allocation error\n");
+        DestroyObjectContents(contents);
+        return FAILURE;
+    }
+
+    /* The words are decoded a batch at a time, and every line in the batch
+     * is expected to follow the one before it. The batch is stored before
+     * any other error is reported, so the errors stay in line order. */
+    while (ReadSentence(&sourceReader, &line))
+    {
+        unsigned long address = 0;
+        bool isWordField = FALSE;
+
+        ++lineNumber;
+
+        TrimWhiteSpaces(&line);
+        if (0 == line.length)
+        {
+            continue;
+        }
+
+        if (!GetNextToken(&line, '\t', &field) || !ParseNumber(field, &address))
+        {
+            numOfWords = StoreWordBatch(contents->words, numOfWords, expectedNumOfWords, &batch, diagnostics);
+            ReportError(diagnostics, "Line %d:\tError: bad address\n", lineNumber);
+            continue;
+        }
+
+        isWordField = GetNextToken(&line, '\t', &field) && ENCODED_WORD_SIZE == field.length;
+
+        if (!isWordField ||
+            address != STARTING_ADDRESS + numOfWords + batch.numOfWords ||
+            numOfWords + batch.numOfWords == expectedNumOfWords)
+        {
+            /* A bad word in the batch moves the next address back */
+            numOfWords = StoreWordBatch(contents->words, numOfWords, expectedNumOfWords, &batch, diagnostics);
+
+            if (address != STARTING_ADDRESS + numOfWords || numOfWords == expectedNumOfWords)
+            {
+                ReportError(diagnostics, "Line %d:\tError: bad address\n", lineNumber);
+                continue;
+            }
+
+            if (!isWordField)
+            {
+                ReportError(diagnostics, "Line %d:\tError: bad memory word\n", lineNumber);
+                continue;
+            }
+        }
+
+        if (AddToWordBatch(&batch, field.start, address, lineNumber))
+        {
+            numOfWords = StoreWordBatch(contents->words, numOfWords, expectedNumOfWords, &batch, diagnostics);
+        }
+    }
+
+    numOfWords = StoreWordBatch(contents->words, numOfWords, expectedNumOfWords, &batch, diagnostics);
+
+    if (!diagnostics->errorHasOccurred && numOfWords != expectedNumOfWords)
+    {
+        ReportError(diagnostics,
+                    "Error: the header has %lu words but the file has %lu\n",
+                    expectedNumOfWords,
+                    numOfWords);
+    }
+
+    if (NULL != entries)
+    {
+        ReadSymbolLines(*entries,
+                        ENTRY_FILE_POSTFIX,
+                        contents->symbols,
+                        &contents->numOfEntries,
+                        diagnostics);
+    }
+
+    if (NULL != externs)
+    {
+        ReadSymbolLines(*externs,
+                        EXTERN_FILE_POSTFIX,
+                        contents->symbols + contents->numOfEntries,
+                        &contents->numOfExterns,
+                        diagnostics);
+    }
+
+    if (diagnostics->errorHasOccurred)
+    {
+        DestroyObjectContents(contents);
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+void DestroyObjectContents(ObjectContents *contents)
+{
+    assert(NULL != contents);
+
+    free(contents->words);
+    free(contents->symbols);
+    memset(contents, 0, sizeof(ObjectContents));
+}
+
+/* Static functions */
+static void PutLittleEndian16(unsigned char *bytes, unsigned int value)
+{
+    bytes[0] = (unsigned char)(value & 0xFF);
+    bytes[1] = (unsigned char)((value >> 8) & 0xFF);
+}
+
+static void PutLittleEndian32(unsigned char *bytes, unsigned long value)
+{
+    PutLittleEndian16(bytes, (unsigned int)(value & 0xFFFF));
+    PutLittleEndian16(bytes + 2, (unsigned int)((value >> 16) & 0xFFFF));
+}
+
+static unsigned int GetLittleEndian16(const unsigned char *bytes)
+{
+    return (unsigned int)bytes[0] | ((unsigned int)bytes[1] << 8);
+}
+
+static unsigned long GetLittleEndian32(const unsigned char *bytes)
+{
+    return (unsigned long)GetLittleEndian16(bytes) |
+           ((unsigned long)GetLittleEndian16(bytes + 2) << 16);
+}
+
+static unsigned long AlignToSymbols(unsigned long offset)
+{
+    return (offset + 3) & ~3UL;
+}
+
+/* Reads the "name\taddress" lines of a .ent or a .ext file */
+static ReturnStatus ReadSymbolLines(Span text,
+                                    const char *postfix,
+                                    ObjectSymbol *symbols,
+                                    unsigned long *numOfSymbols,
+                                    Diagnostics *diagnostics)
+{
+    SourceReader sourceReader;
+    Span line = {0};
+    int lineNumber = 0;
+
+    OpenSourceBuffer(&sourceReader, text.start, text.length);
+
+    while (ReadSentence(&sourceReader, &line))
+    {
+        ObjectSymbol *symbol = symbols + *numOfSymbols;
+        Span address = {0};
+
+        ++lineNumber;
+
+        TrimWhiteSpaces(&line);
+        if (0 == line.length)
+        {
+            continue;
+        }
+
+        if (!GetNextToken(&line, '\t', &symbol->name) ||
+            0 == symbol->name.length ||
+            !GetNextToken(&line, '\t', &address) ||
+            !ParseNumber(address, &symbol->address))
+        {
+            ReportError(diagnostics, "Line %d of the %s file:\tError: bad symbol\n", lineNumber, postfix);
+            continue;
+        }
+
+        ++*numOfSymbols;
+    }
+
+    return diagnostics->errorHasOccurred ? FAILURE : SUCCESS;
+}
+
+/* The most lines ReadSentence can read from the text */
+static unsigned long CountLines(Span text)
+{
+    const char *position = text.start, *end = text.start + text.length;
+    unsigned long numOfLines = 1;
+
+    while (position < end &&
+           NULL != (position = (const char *)memchr(position, NEW_LINE, end - position)))
+    {
+        ++numOfLines;
+        ++position;
+    }
+
+    return numOfLines;
+}
+
+static bool ParseNumber(Span str, unsigned long *number)
+{
+    size_t i = 0;
+
+    if (0 == str.length || str.length > MAX_NUMBER_DIGITS)
+    {
+        return FALSE;
+    }
+
+    *number = 0;
+    for (i = 0; i < str.length; ++i)
+    {
+        if (str.start[i] < ZERO_DIGIT || str.start[i] > NINE_DIGIT)
+        {
+            return FALSE;
+        }
+
+        *number = *number * 10 + (unsigned long)(str.start[i] - ZERO_DIGIT);
+    }
+
+    return TRUE;
+}
+
+/* Decodes the words of the batch after the first numOfWords words and
+ * empties it. The lines after a bad word are checked again, like the
+ * lines read one at a time. Returns the number of words now. */
+static unsigned long StoreWordBatch(unsigned short *words,
+                                    unsigned long numOfWords,
+                                    unsigned long expectedNumOfWords,
+                                    EncodedWordBatch *batch,
+                                    Diagnostics *diagnostics)
+{
+    WordCodec codec = GetWordCodec();
+    size_t i = 0, numOfDecoded = 0;
+
+    numOfDecoded = DecodeWords(codec, words + numOfWords, batch->encodings, batch->numOfWords);
+    numOfWords += numOfDecoded;
+
+    for (i = numOfDecoded; i < batch->numOfWords; ++i)
+    {
+        if (i > numOfDecoded &&
+            (batch->addresses[i] != STARTING_ADDRESS + numOfWords ||
+             numOfWords == expectedNumOfWords))
+        {
+            ReportError(diagnostics, "Line %d:\tError: bad address\n", batch->lineNumbers[i]);
+        }
+        else if (i == numOfDecoded ||
+                 1 != DecodeWords(codec,
+                                  words + numOfWords,
+                                  batch->encodings + i * ENCODED_WORD_STRIDE,
+                                  1))
+        {
+            ReportError(diagnostics, "Line %d:\tError: bad memory word\n", batch->lineNumbers[i]);
+        }
+        else
+        {
+            ++numOfWords;
+        }
+    }
+
+    batch->numOfWords = 0;
+
+    return numOfWords;
+}
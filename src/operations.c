@@ -5,113 +5,114 @@
 * Date: 19/08/2019                      *
 ****************************************/
 
-#include <string.h> /* strcmp */
+#include <string.h> /* strncmp */
 #include <assert.h> /* assert */
 
-#include "operations.h" /* API */
-
-typedef struct operation
-{
-    char name[MAX_SENTENCE_SIZE];
-    unsigned int code;
-} Operation;
-
-const Operation OperationsTable[NUM_OF_OPERATIONS] = {
-    {"mov", 0},
-    {"cmp", 1},
-    {"add", 2},
-    {"sub", 3},
-    {"not", 4},
-    {"clr", 5},
-    {"lea", 6},
-    {"inc", 7},
-    {"dec", 8},
-    {"jmp", 9},
-    {"bne", 10},
-    {"red", 11},
-    {"prn", 12},
-    {"jsr", 13},
-    {"rts", 14},
-    {"stop", 15}};
-
-bool IsInOperationsTable(const char *operationName)
+#include "operations.h"        /* API */
+#include "instruction_table.h" /* AddressingMethods */
+
+#define OPERATIONS_HASH_SIZE (32)
+
+#define NO_OPERANDS (0)
+#define ALL_METHODS (ADDRESSING_METHOD_FLAG(IMMEDIATE_ADDRESSING) |     \
+                     ADDRESSING_METHOD_FLAG(DIRECT_ADDRESSING) |        \
+                     ADDRESSING_METHOD_FLAG(FIXED_INDEX_ADDRESSING) |   \
+                     ADDRESSING_METHOD_FLAG(DIRECT_REGISTER_ADDRESSING))
+#define WRITABLE_METHODS (ALL_METHODS & ~ADDRESSING_METHOD_FLAG(IMMEDIATE_ADDRESSING))
+#define MEMORY_METHODS (ADDRESSING_METHOD_FLAG(DIRECT_ADDRESSING) |     \
+                        ADDRESSING_METHOD_FLAG(FIXED_INDEX_ADDRESSING))
+#define JUMP_METHODS (ADDRESSING_METHOD_FLAG(DIRECT_ADDRESSING) |       \
+                      ADDRESSING_METHOD_FLAG(DIRECT_REGISTER_ADDRESSING))
+
+/* Indexed by the operation code */
+static const Operation OPERATIONS_TABLE[NUM_OF_OPERATIONS] = {
+    {"mov", 0, 2, ALL_METHODS, WRITABLE_METHODS},
+    {"cmp", 1, 2, ALL_METHODS, ALL_METHODS},
+    {"add", 2, 2, ALL_METHODS, WRITABLE_METHODS},
+    {"sub", 3, 2, ALL_METHODS, WRITABLE_METHODS},
+    {"not", 4, 1, NO_OPERANDS, WRITABLE_METHODS},
+    {"clr", 5, 1, NO_OPERANDS, WRITABLE_METHODS},
+    {"lea", 6, 2, MEMORY_METHODS, WRITABLE_METHODS},
+    {"inc", 7, 1, NO_OPERANDS, WRITABLE_METHODS},
+    {"dec", 8, 1, NO_OPERANDS, WRITABLE_METHODS},
+    {"jmp", 9, 1, NO_OPERANDS, JUMP_METHODS},
+    {"bne", 10, 1, NO_OPERANDS, JUMP_METHODS},
+    {"red", 11, 1, NO_OPERANDS, WRITABLE_METHODS},
+    {"prn", 12, 1, NO_OPERANDS, ALL_METHODS},
+    {"jsr", 13, 1, NO_OPERANDS, JUMP_METHODS},
+    {"rts", 14, 0, NO_OPERANDS, NO_OPERANDS},
+    {"stop", 15, 0, NO_OPERANDS, NO_OPERANDS}};
+
+/* Perfect hash of the operation names: the slot of OperationsHash() holds
+ * the code of the only operation that can have that name (-1 for none).
+ * The multipliers were found by a search over the 16 names. */
+static const signed char OPERATIONS_HASH_TABLE[OPERATIONS_HASH_SIZE] = {
+    -1, -1, 12, 1, -1, -1, 13, 10, -1, 8, -1, 0, 4, -1, -1, 2,
+    15, 14, -1, 5, 11, 3, -1, -1, 9, -1, 7, -1, -1, -1, -1, 6};
+
+static unsigned int OperationsHash(const char *name);
+
+/* Returns NULL if operationName is not an operation */
+const Operation *FindOperation(Span operationName)
 {
-    int i = 0;
+    const Operation *operation = NULL;
+    int code = 0;
 
-    assert(NULL != operationName);
+    assert(NULL != operationName.start);
 
-    for (i = 0; i < NUM_OF_OPERATIONS; ++i)
+    /* Every operation name is 3 or 4 letters long */
+    if (operationName.length < MAX_OPERATION_NAME_SIZE - 1 ||
+        operationName.length > MAX_OPERATION_NAME_SIZE)
     {
-        if (0 == strcmp(OperationsTable[i].name, operationName))
-        {
-            return TRUE;
-        }
+        return NULL;
     }
 
-    return FALSE;
-}
+    code = OPERATIONS_HASH_TABLE[OperationsHash(operationName.start)];
+    if (code < 0)
+    {
+        return NULL;
+    }
 
-int GetOperationCode(const char *operationName)
-{
-    int i = 0, returnCode = 0;
+    operation = OPERATIONS_TABLE + code;
 
-    assert(NULL != operationName);
-    assert(IsInOperationsTable(operationName));
+    return (0 == strncmp(operation->name, operationName.start, operationName.length) &&
+            END_LINE == operation->name[operationName.length])
+               ? operation
+               : NULL;
+}
 
-    for (i = 0; i < NUM_OF_OPERATIONS; ++i)
-    {
-        if (0 == strcmp(OperationsTable[i].name, operationName))
-        {
-            returnCode = OperationsTable[i].code;
-            break;
-        }
-    }
+const Operation *GetOperation(int operationCode)
+{
+    assert(operationCode >= 0 && operationCode < NUM_OF_OPERATIONS);
 
-    return returnCode;
+    return OPERATIONS_TABLE + operationCode;
 }
 
-int GetNumOfOperands(const char *operationName)
+/* Missing operands are encoded as immediate (0) */
+bool IsLegalInstruction(const Operation *operation,
+                        unsigned int srcAddressingMethod,
+                        unsigned int destAddressingMethod)
 {
-    int operationCode = 0, result = 0;
+    bool isSrcLegal = FALSE, isDestLegal = FALSE;
 
-    assert(NULL != operationName);
-    assert(IsInOperationsTable(operationName));
+    assert(NULL != operation);
 
-    operationCode = GetOperationCode(operationName);
+    isSrcLegal = (2 == operation->numOfOperands)
+                     ? (operation->srcAddressingMethods &
+                        ADDRESSING_METHOD_FLAG(srcAddressingMethod)) != 0
+                     : IMMEDIATE_ADDRESSING == srcAddressingMethod;
+    isDestLegal = (0 != operation->numOfOperands)
+                      ? (operation->destAddressingMethods &
+                         ADDRESSING_METHOD_FLAG(destAddressingMethod)) != 0
+                      : IMMEDIATE_ADDRESSING == destAddressingMethod;
 
-    switch (operationCode)
-    {
-    /* No break's on purpose */
-    case (0):
-    case (1):
-    case (2):
-    case (3):
-    case (6):
-        result = 2;
-        break;
-
-    /* No break's on purpose */
-    case (4):
-    case (5):
-    case (7):
-    case (8):
-    case (9):
-    case (10):
-    case (11):
-    case (12):
-    case (13):
-        result = 1;
-        break;
-
-    /* No break's on purpose */
-    case (14):
-    case (15):
-        result = 0;
-        break;
-
-    default:
-        break;
-    }
+    return (isSrcLegal && isDestLegal);
+}
 
-    return result;
-}
\ No newline at end of file
+/* Static functions */
+static unsigned int OperationsHash(const char *name)
+{
+    return (3 * (unsigned char)name[0] +
+            18 * (unsigned char)name[1] +
+            (unsigned char)name[2]) % OPERATIONS_HASH_SIZE;
+}
@@ -0,0 +1,599 @@
+/****************************************
+* ASSEMBLER: output_cache.c             *
+****************************************/
+
+#include <assert.h>    /* assert */
+#include <stdio.h>     /* FILE, fopen, fclose, fread, fwrite, ferror, fileno, sprintf, rename, remove */
+#include <stdlib.h>    /* malloc, realloc, free, qsort */
+#include <string.h>    /* memcpy, strlen, strcpy, strcat, strcmp, strncmp, strchr */
+#include <errno.h>     /* errno, ENOENT */
+#include <sys/types.h> /* time_t */
+#include <sys/stat.h>  /* stat, fstat, mkdir, S_ISDIR */
+#include <unistd.h>    /* link, rmdir, getpid */
+#include <dirent.h>    /* opendir, readdir, closedir */
+#include <utime.h>     /* utime */
+
+#include "output_cache.h" /* API */
+#include "string_pool.h"  /* API */
+
+#define MAX_PATH_SIZE (1024)
+#define MAX_ENTRY_NAME_SIZE (128)
+#define MAX_MANIFEST_SIZE (128)
+#define COPY_BLOCK_SIZE (65536)
+#define INITIAL_ENTRIES_CAPACITY (64)
+#define NUM_OF_LANES (4)
+#define DIRECTORY_MODE (0777)
+/* 0x9E3779B97F4A7C15 where unsigned long has 64 bits, 0x7F4A7C15 otherwise */
+#define MIX_FACTOR ((0x9E3779B9UL << 16 << 16) | 0x7F4A7C15UL)
+
+static const char *ENTRY_FILE_NAME = "output";
+static const char *LOG_FILE_POSTFIX = ".log";
+static const char *MANIFEST_FILE_POSTFIX = ".files";
+static const char *TEMPORARY_ENTRY_PREFIX = "tmp.";
+static const char *EVICTED_ENTRY_PREFIX = "old.";
+static const char *READING_MODE = "rb";
+static const char *WRITING_MODE = "wb";
+
+/* An entry has the files its assembly created, and a manifest of their
+ * postfixes (and of the log, when there were warnings), one per line */
+static const char *const OUTPUT_POSTFIXES[] = {OBJECT_FILE_POSTFIX,
+                                               ENTRY_FILE_POSTFIX,
+                                               EXTERN_FILE_POSTFIX,
+                                               BINARY_OBJECT_FILE_POSTFIX,
+                                               C_PROGRAM_FILE_POSTFIX};
+
+#define NUM_OF_OUTPUTS (sizeof(OUTPUT_POSTFIXES) / sizeof(OUTPUT_POSTFIXES[0]))
+
+typedef struct
+{
+    char name[MAX_ENTRY_NAME_SIZE];
+    time_t lastUse;
+    unsigned long size;
+} CacheEntry;
+
+static unsigned long HashSource(const char *source, size_t size);
+static unsigned long Mix(unsigned long value);
+static ReturnStatus BuildPath(char *path,
+                              const char *directory,
+                              const char *name,
+                              const char *postfix);
+static ReturnStatus CopyFile(const char *source, const char *destination);
+static ReturnStatus WriteEntryFile(const char *entryPath,
+                                   const char *postfix,
+                                   const char *text,
+                                   size_t length);
+static char *ReadEntryFile(const char *path, size_t *length);
+static ReturnStatus WriteManifest(const char *entryPath,
+                                  const FileTexts *fileTexts,
+                                  const Diagnostics *warnings);
+static bool IsListed(const char *manifest, const char *postfix);
+static void RemoveEntry(const char *entryPath);
+static void EvictOutputs(const OutputCache *outputCache);
+static unsigned long GetEntrySize(const char *entryPath);
+static int CompareLastUse(const void *first, const void *second);
+
+/* The key depends on the whole source, on the files made of it and on
+ * the version of the cache */
+void GetOutputCacheKey(const char *source,
+                       size_t size,
+                       ObjectFormat objectFormat,
+                       char *key)
+{
+    assert(NULL != source || 0 == size);
+    assert(NULL != key);
+
+    sprintf(key,
+            "%lx-%lx-%d-%d",
+            HashSource(source, size),
+            (unsigned long)size,
+            (int)objectFormat,
+            OUTPUT_CACHE_VERSION);
+}
+
+/* Links (or copies) the files of the entry of the key to the files of the
+ * assembly, and reports the warnings of the assembly that created it.
+ * Returns FAILURE when there is no such entry or any file of its manifest
+ * is missing, and then some of the files may already have been replaced. */
+ReturnStatus RestoreOutputs(const OutputCache *outputCache,
+                            const char *key,
+                            const char *filename,
+                            Diagnostics *diagnostics)
+{
+    char entryPath[MAX_PATH_SIZE], cachedPath[MAX_PATH_SIZE], outputPath[MAX_PATH_SIZE];
+    Diagnostics warnings = {0};
+    char *manifest = NULL;
+    size_t i = 0, manifestLength = 0;
+    ReturnStatus status = SUCCESS;
+
+    assert(NULL != outputCache);
+    assert(NULL != key);
+    assert(NULL != filename);
+    assert(NULL != diagnostics);
+
+    if (SUCCESS != BuildPath(entryPath, outputCache->directory, key, "") ||
+        SUCCESS != BuildPath(cachedPath, entryPath, ENTRY_FILE_NAME, MANIFEST_FILE_POSTFIX) ||
+        NULL == (manifest = ReadEntryFile(cachedPath, &manifestLength)))
+    {
+        return FAILURE;
+    }
+
+    if (IsListed(manifest, LOG_FILE_POSTFIX) &&
+        (SUCCESS != BuildPath(cachedPath, entryPath, ENTRY_FILE_NAME, LOG_FILE_POSTFIX) ||
+         NULL == (warnings.buffer = ReadEntryFile(cachedPath, &warnings.length))))
+    {
+        status = FAILURE; /* The entry was evicted meanwhile */
+    }
+
+    for (i = 0; i < NUM_OF_OUTPUTS && SUCCESS == status; ++i)
+    {
+        if (!IsListed(manifest, OUTPUT_POSTFIXES[i]))
+        {
+            continue;
+        }
+
+        if (SUCCESS != BuildPath(cachedPath, entryPath, ENTRY_FILE_NAME, OUTPUT_POSTFIXES[i]) ||
+            SUCCESS != BuildPath(outputPath, NULL, filename, OUTPUT_POSTFIXES[i]))
+        {
+            status = FAILURE;
+            break;
+        }
+
+        remove(outputPath);
+        if (0 != link(cachedPath, outputPath) &&
+            (ENOENT == errno || SUCCESS != CopyFile(cachedPath, outputPath)))
+        {
+            status = FAILURE; /* The entry was evicted meanwhile */
+        }
+    }
+
+    if (SUCCESS == status)
+    {
+        AppendDiagnostics(diagnostics, &warnings);
+        utime(entryPath, NULL); /* The modification time is the last use */
+    }
+
+    free(warnings.buffer);
+    free(manifest);
+
+    return status;
+}
+
+/* The entry is filled under a temporary name and renamed to its key, so
+ * an entry is never seen half written. When another assembly published
+ * the key first, its entry is kept. */
+void PublishOutputs(const OutputCache *outputCache,
+                    const char *key,
+                    const FileTexts *fileTexts,
+                    const Diagnostics *warnings)
+{
+    char temporaryName[MAX_ENTRY_NAME_SIZE];
+    char temporaryPath[MAX_PATH_SIZE], entryPath[MAX_PATH_SIZE];
+
+    assert(NULL != outputCache);
+    assert(NULL != key);
+    assert(NULL != fileTexts);
+    assert(NULL != warnings);
+
+    sprintf(temporaryName, "%s%ld.%s", TEMPORARY_ENTRY_PREFIX, (long)getpid(), key);
+    if (SUCCESS != BuildPath(temporaryPath, outputCache->directory, temporaryName, "") ||
+        SUCCESS != BuildPath(entryPath, outputCache->directory, key, ""))
+    {
+        return;
+    }
+
+    mkdir(outputCache->directory, DIRECTORY_MODE);
+    if (0 != mkdir(temporaryPath, DIRECTORY_MODE))
+    {
+        return;
+    }
+
+    if (SUCCESS != WriteEntryFile(temporaryPath,
+                                  OBJECT_FILE_POSTFIX,
+                                  fileTexts->object,
+                                  fileTexts->objectLength) ||
+        SUCCESS != WriteEntryFile(temporaryPath,
+                                  ENTRY_FILE_POSTFIX,
+                                  fileTexts->entries,
+                                  fileTexts->entriesLength) ||
+        SUCCESS != WriteEntryFile(temporaryPath,
+                                  EXTERN_FILE_POSTFIX,
+                                  fileTexts->externs,
+                                  fileTexts->externsLength) ||
+        SUCCESS != WriteEntryFile(temporaryPath,
+                                  BINARY_OBJECT_FILE_POSTFIX,
+                                  fileTexts->binaryObject,
+                                  fileTexts->binaryObjectLength) ||
+        SUCCESS != WriteEntryFile(temporaryPath,
+                                  C_PROGRAM_FILE_POSTFIX,
+                                  fileTexts->cProgram,
+                                  fileTexts->cProgramLength) ||
+        SUCCESS != WriteEntryFile(temporaryPath,
+                                  LOG_FILE_POSTFIX,
+                                  (0 == warnings->length) ? NULL : warnings->buffer,
+                                  warnings->length) ||
+        SUCCESS != WriteManifest(temporaryPath, fileTexts, warnings) ||
+        0 != rename(temporaryPath, entryPath))
+    {
+        RemoveEntry(temporaryPath);
+        return;
+    }
+
+    EvictOutputs(outputCache);
+}
+
+/* Static functions */
+
+/* Several independent lanes of words, so the hash is not bound by the
+ * latency of one multiplication per byte */
+static unsigned long HashSource(const char *source, size_t size)
+{
+    unsigned long lanes[NUM_OF_LANES] = {1, 2, 3, 4};
+    unsigned long hash = 0;
+    size_t i = 0;
+    int lane = 0;
+
+    for (; i + sizeof(lanes) <= size; i += sizeof(lanes))
+    {
+        for (lane = 0; lane < NUM_OF_LANES; ++lane)
+        {
+            unsigned long word = 0;
+
+            memcpy(&word, source + i + lane * sizeof(unsigned long), sizeof(unsigned long));
+            lanes[lane] = Mix(lanes[lane] ^ word);
+        }
+    }
+
+    hash = HashString(source + i, size - i);
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        hash = Mix(hash ^ lanes[lane]);
+    }
+
+    return hash;
+}
+
+static unsigned long Mix(unsigned long value)
+{
+    value *= MIX_FACTOR;
+
+    return value ^ (value >> 15 >> 14);
+}
+
+/* directory/namepostfix, or namepostfix when directory is NULL */
+static ReturnStatus BuildPath(char *path,
+                              const char *directory,
+                              const char *name,
+                              const char *postfix)
+{
+    size_t directoryLength = (NULL == directory) ? 0 : strlen(directory) + 1;
+
+    if (directoryLength + strlen(name) + strlen(postfix) >= MAX_PATH_SIZE)
+    {
+        return FAILURE;
+    }
+
+    path[0] = END_LINE;
+    if (NULL != directory)
+    {
+        strcpy(path, directory);
+        strcat(path, "/");
+    }
+
+    strcat(path, name);
+    strcat(path, postfix);
+
+    return SUCCESS;
+}
+
+/* For a cache on another file system than the files */
+static ReturnStatus CopyFile(const char *source, const char *destination)
+{
+    char block[COPY_BLOCK_SIZE];
+    FILE *sourceFile = NULL, *destinationFile = NULL;
+    size_t numOfBytesRead = 0;
+    ReturnStatus status = SUCCESS;
+
+    sourceFile = fopen(source, READING_MODE);
+    if (NULL == sourceFile)
+    {
+        return FAILURE;
+    }
+
+    destinationFile = fopen(destination, WRITING_MODE);
+    if (NULL == destinationFile)
+    {
+        fclose(sourceFile);
+        return FAILURE;
+    }
+
+    while (0 != (numOfBytesRead = fread(block, 1, sizeof(block), sourceFile)))
+    {
+        if (numOfBytesRead != fwrite(block, 1, numOfBytesRead, destinationFile))
+        {
+            status = FAILURE;
+            break;
+        }
+    }
+
+    if (ferror(sourceFile))
+    {
+        status = FAILURE;
+    }
+
+    fclose(sourceFile);
+    if (0 != fclose(destinationFile))
+    {
+        status = FAILURE;
+    }
+
+    return status;
+}
+
+/* A NULL text creates no file */
+static ReturnStatus WriteEntryFile(const char *entryPath,
+                                   const char *postfix,
+                                   const char *text,
+                                   size_t length)
+{
+    char path[MAX_PATH_SIZE];
+    FILE *file = NULL;
+    ReturnStatus status = SUCCESS;
+
+    if (NULL == text)
+    {
+        return SUCCESS;
+    }
+
+    if (SUCCESS != BuildPath(path, entryPath, ENTRY_FILE_NAME, postfix))
+    {
+        return FAILURE;
+    }
+
+    file = fopen(path, WRITING_MODE);
+    if (NULL == file)
+    {
+        return FAILURE;
+    }
+
+    if (length != fwrite(text, 1, length, file))
+    {
+        status = FAILURE;
+    }
+
+    if (0 != fclose(file))
+    {
+        status = FAILURE;
+    }
+
+    return status;
+}
+
+/* Returns the NUL-terminated content of the file (malloced), or NULL */
+static char *ReadEntryFile(const char *path, size_t *length)
+{
+    FILE *file = NULL;
+    char *text = NULL;
+    struct stat fileStatus;
+
+    *length = 0;
+
+    file = fopen(path, READING_MODE);
+    if (NULL == file)
+    {
+        return NULL;
+    }
+
+    if (0 == fstat(fileno(file), &fileStatus) &&
+        NULL != (text = (char *)malloc((size_t)fileStatus.st_size + 1)))
+    {
+        *length = fread(text, 1, (size_t)fileStatus.st_size, file);
+        text[*length] = END_LINE;
+    }
+
+    fclose(file);
+
+    return text;
+}
+
+static ReturnStatus WriteManifest(const char *entryPath,
+                                  const FileTexts *fileTexts,
+                                  const Diagnostics *warnings)
+{
+    char manifest[MAX_MANIFEST_SIZE];
+    const char *texts[NUM_OF_OUTPUTS];
+    size_t i = 0;
+
+    /* In the order of OUTPUT_POSTFIXES */
+    texts[0] = fileTexts->object;
+    texts[1] = fileTexts->entries;
+    texts[2] = fileTexts->externs;
+    texts[3] = fileTexts->binaryObject;
+    texts[4] = fileTexts->cProgram;
+
+    manifest[0] = END_LINE;
+    for (i = 0; i < NUM_OF_OUTPUTS; ++i)
+    {
+        if (NULL != texts[i])
+        {
+            strcat(manifest, OUTPUT_POSTFIXES[i]);
+            strcat(manifest, "\n");
+        }
+    }
+
+    if (0 != warnings->length)
+    {
+        strcat(manifest, LOG_FILE_POSTFIX);
+        strcat(manifest, "\n");
+    }
+
+    return WriteEntryFile(entryPath, MANIFEST_FILE_POSTFIX, manifest, strlen(manifest));
+}
+
+static bool IsListed(const char *manifest, const char *postfix)
+{
+    size_t length = strlen(postfix);
+
+    while (NULL != manifest && END_LINE != *manifest)
+    {
+        if (0 == strncmp(manifest, postfix, length) && '\n' == manifest[length])
+        {
+            return TRUE;
+        }
+
+        manifest = strchr(manifest, '\n');
+        if (NULL != manifest)
+        {
+            ++manifest;
+        }
+    }
+
+    return FALSE;
+}
+
+static void RemoveEntry(const char *entryPath)
+{
+    char path[MAX_PATH_SIZE];
+    size_t i = 0;
+
+    for (i = 0; i < NUM_OF_OUTPUTS; ++i)
+    {
+        if (SUCCESS == BuildPath(path, entryPath, ENTRY_FILE_NAME, OUTPUT_POSTFIXES[i]))
+        {
+            remove(path);
+        }
+    }
+
+    if (SUCCESS == BuildPath(path, entryPath, ENTRY_FILE_NAME, LOG_FILE_POSTFIX))
+    {
+        remove(path);
+    }
+
+    if (SUCCESS == BuildPath(path, entryPath, ENTRY_FILE_NAME, MANIFEST_FILE_POSTFIX))
+    {
+        remove(path);
+    }
+
+    rmdir(entryPath);
+}
+
+/* Removes the least recently used entries until the cache fits in its
+ * size. An entry is renamed before its files are removed, so it is never
+ * restored half removed. */
+static void EvictOutputs(const OutputCache *outputCache)
+{
+    DIR *directory = NULL;
+    struct dirent *directoryEntry = NULL;
+    CacheEntry *entries = NULL;
+    size_t numOfEntries = 0, capacity = 0, i = 0;
+    unsigned long totalSize = 0;
+
+    directory = opendir(outputCache->directory);
+    if (NULL == directory)
+    {
+        return;
+    }
+
+    while (NULL != (directoryEntry = readdir(directory)))
+    {
+        char entryPath[MAX_PATH_SIZE];
+        struct stat entryStatus;
+
+        if ('.' == directoryEntry->d_name[0] ||
+            strlen(directoryEntry->d_name) >= MAX_ENTRY_NAME_SIZE ||
+            SUCCESS != BuildPath(entryPath, outputCache->directory, directoryEntry->d_name, "") ||
+            0 != stat(entryPath, &entryStatus) ||
+            !S_ISDIR(entryStatus.st_mode))
+        {
+            continue;
+        }
+
+        if (numOfEntries == capacity)
+        {
+            size_t newCapacity = (0 == capacity) ? INITIAL_ENTRIES_CAPACITY : 2 * capacity;
+            CacheEntry *newEntries = (CacheEntry *)realloc(entries,
+                                                           newCapacity * sizeof(CacheEntry));
+
+            if (NULL == newEntries)
+            {
+                break;
+            }
+
+            entries = newEntries;
+            capacity = newCapacity;
+        }
+
+        strcpy(entries[numOfEntries].name, directoryEntry->d_name);
+        entries[numOfEntries].lastUse = entryStatus.st_mtime;
+        entries[numOfEntries].size = GetEntrySize(entryPath);
+        totalSize += entries[numOfEntries++].size;
+    }
+
+    closedir(directory);
+
+    if (totalSize > outputCache->maxSize)
+    {
+        qsort(entries, numOfEntries, sizeof(CacheEntry), CompareLastUse);
+    }
+
+    for (i = 0; i < numOfEntries && totalSize > outputCache->maxSize; ++i)
+    {
+        char evictedName[MAX_ENTRY_NAME_SIZE * 2];
+        char entryPath[MAX_PATH_SIZE], evictedPath[MAX_PATH_SIZE];
+
+        sprintf(evictedName, "%s%ld.%s", EVICTED_ENTRY_PREFIX, (long)getpid(), entries[i].name);
+        if (SUCCESS == BuildPath(entryPath, outputCache->directory, entries[i].name, "") &&
+            SUCCESS == BuildPath(evictedPath, outputCache->directory, evictedName, "") &&
+            0 == rename(entryPath, evictedPath))
+        {
+            RemoveEntry(evictedPath);
+        }
+
+        totalSize -= entries[i].size;
+    }
+
+    free(entries);
+}
+
+static unsigned long GetEntrySize(const char *entryPath)
+{
+    char path[MAX_PATH_SIZE];
+    struct stat fileStatus;
+    unsigned long size = 0;
+    size_t i = 0;
+
+    for (i = 0; i < NUM_OF_OUTPUTS; ++i)
+    {
+        if (SUCCESS == BuildPath(path, entryPath, ENTRY_FILE_NAME, OUTPUT_POSTFIXES[i]) &&
+            0 == stat(path, &fileStatus))
+        {
+            size += (unsigned long)fileStatus.st_size;
+        }
+    }
+
+    if (SUCCESS == BuildPath(path, entryPath, ENTRY_FILE_NAME, LOG_FILE_POSTFIX) &&
+        0 == stat(path, &fileStatus))
+    {
+        size += (unsigned long)fileStatus.st_size;
+    }
+
+    if (SUCCESS == BuildPath(path, entryPath, ENTRY_FILE_NAME, MANIFEST_FILE_POSTFIX) &&
+        0 == stat(path, &fileStatus))
+    {
+        size += (unsigned long)fileStatus.st_size;
+    }
+
+    return size;
+}
+
+static int CompareLastUse(const void *first, const void *second)
+{
+    const CacheEntry *firstEntry = (const CacheEntry *)first;
+    const CacheEntry *secondEntry = (const CacheEntry *)second;
+
+    if (firstEntry->lastUse != secondEntry->lastUse)
+    {
+        return (firstEntry->lastUse < secondEntry->lastUse) ? -1 : 1;
+    }
+
+    return strcmp(firstEntry->name, secondEntry->name);
+}
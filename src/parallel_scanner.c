@@ -0,0 +1,533 @@
+/****************************************
+* ASSEMBLER: parallel_scanner.c         *
+****************************************/
+
+#include <assert.h> /* assert */
+#include <stdlib.h> /* calloc, malloc, realloc, free */
+#include <string.h> /* memchr, memcpy, strlen, strncmp */
+
+#include "parallel_scanner.h"  /* API */
+#include "file_scanner.h"      /* API */
+#include "symbol_table.h"      /* API */
+#include "sentence_analyzer.h" /* API */
+#include "memory_word.h"       /* API */
+#include "instruction_table.h" /* API */
+#include "source_reader.h"     /* API */
+#include "thread_pool.h"       /* API */
+#include "assembler_utils.h"   /* Utils file */
+
+#define INITIAL_MACRO_SENTENCES_CAPACITY (16)
+
+/* A run of whole lines of the source, scanned as a program of its own */
+typedef struct scanChunk
+{
+    Span text;
+    int firstLineNumber;
+    int numOfLines;
+    Sentence *macroSentences; /* The .define lines of the chunk */
+    int numOfMacroSentences;
+    int macroSentencesCapacity;
+    const struct scanChunk *chunks; /* All the chunks, in source order */
+
+    Assembly assembly; /* Code addresses and data offsets from 0 */
+    InstructionTable instructionTable;
+    int IC;
+    int numOfSeededMacros; /* The .define lines of the chunks before */
+    Diagnostics diagnostics;
+
+    int firstIC; /* Of the chunk in the whole program */
+    int firstDC;
+    int *symbolIds; /* Id in the chunk -> id in the whole program */
+    const Assembly *program;
+    ExternReferenceList externReferences;
+} ScanChunk;
+
+static int SplitSource(const SourceReader *sourceReader,
+                       ScanChunk *chunks,
+                       int numOfChunks);
+static void RunChunkTasks(ThreadPool *threadPool,
+                          TaskFunction function,
+                          ScanChunk *chunks,
+                          int numOfChunks);
+static void FindChunkLines(void *argument);
+static void ScanChunkSentences(void *argument);
+static void EncodeChunk(void *argument);
+static ReturnStatus MergeChunks(ScanChunk *chunks,
+                                int numOfChunks,
+                                Assembly *assembly,
+                                int *IC);
+static ReturnStatus MergeChunk(ScanChunk *chunk,
+                               Assembly *assembly,
+                               Diagnostics *diagnostics);
+static bool HasErrors(const ScanChunk *chunks, int numOfChunks);
+static void DestroyChunks(ScanChunk *chunks, int numOfChunks);
+
+/* Gives the same assembly and messages as ScanSource, with the lines
+ * scanned by numOfThreads threads. The source is split into chunks of
+ * whole lines and every chunk is scanned as a program of its own, knowing
+ * only the .define lines of the chunks before it. The chunks are then
+ * merged in order: their code and data are placed after those of the
+ * chunks before, and their names are given the ids of the whole program.
+ * Finally every chunk encodes its instructions into its own part of the
+ * code. A source that fails anywhere on the way (or that is too small to
+ * split) is scanned by ScanSource, so errors are reported exactly as a
+ * sequential scan reports them. */
+void ScanSourceInParallel(SourceReader *sourceReader,
+                          Assembly *assembly,
+                          int numOfThreads,
+                          Diagnostics *diagnostics)
+{
+    ScanChunk *chunks = NULL;
+    ThreadPool *threadPool = NULL;
+    int numOfChunks = 0, IC = 0, i = 0;
+    bool isScanned = FALSE;
+
+    assert(NULL != sourceReader);
+    assert(NULL != assembly);
+    assert(NULL != diagnostics);
+
+    numOfChunks = (int)(sourceReader->size / MIN_SCAN_CHUNK_SIZE);
+    if (numOfChunks > numOfThreads)
+    {
+        numOfChunks = numOfThreads;
+    }
+
+    if (numOfChunks > 1)
+    {
+        chunks = (ScanChunk *)calloc(numOfChunks, sizeof(ScanChunk));
+        threadPool = CreateThreadPool(numOfChunks);
+    }
+
+    if (NULL != chunks && NULL != threadPool)
+    {
+        numOfChunks = SplitSource(sourceReader, chunks, numOfChunks);
+
+        RunChunkTasks(threadPool, FindChunkLines, chunks, numOfChunks);
+
+        chunks[0].firstLineNumber = 1;
+        for (i = 1; i < numOfChunks; ++i)
+        {
+            chunks[i].firstLineNumber = chunks[i - 1].firstLineNumber +
+                                        chunks[i - 1].numOfLines;
+        }
+
+        RunChunkTasks(threadPool, ScanChunkSentences, chunks, numOfChunks);
+
+        if (!HasErrors(chunks, numOfChunks) &&
+            SUCCESS == MergeChunks(chunks, numOfChunks, assembly, &IC))
+        {
+            RunChunkTasks(threadPool, EncodeChunk, chunks, numOfChunks);
+            isScanned = !HasErrors(chunks, numOfChunks);
+        }
+
+        for (i = 0; isScanned && i < numOfChunks; ++i)
+        {
+            isScanned = (SUCCESS == AppendExternReferences(
+                                        &assembly->symbolTable.externReferences,
+                                        &chunks[i].externReferences));
+        }
+    }
+
+    if (isScanned)
+    {
+        for (i = 0; i < numOfChunks; ++i)
+        {
+            AppendDiagnostics(diagnostics, &chunks[i].diagnostics);
+        }
+
+        if (STARTING_ADDRESS + IC + assembly->dataSegment.numOfWords > MAX_ADDRESS + 1)
+        {
+            ReportWarning(diagnostics, "Warning: the program does not fit in the %d word address space\n", MAX_ADDRESS + 1);
+        }
+
+        assembly->instructionSegment.numOfWords = IC;
+        UpdateEntrySymbols(&assembly->symbolTable);
+    }
+    else
+    {
+        DestroyAssembly(assembly);
+        RewindSourceReader(sourceReader);
+        ScanSource(sourceReader, assembly, NULL, diagnostics);
+    }
+
+    if (NULL != threadPool)
+    {
+        DestroyThreadPool(threadPool);
+    }
+
+    if (NULL != chunks)
+    {
+        DestroyChunks(chunks, numOfChunks);
+    }
+}
+
+/* Static functions */
+
+/* Every chunk but the last ends with a '\n'. Returns the number of chunks,
+ * which is smaller than numOfChunks when the source has few long lines. */
+static int SplitSource(const SourceReader *sourceReader,
+                       ScanChunk *chunks,
+                       int numOfChunks)
+{
+    const char *start = sourceReader->data;
+    const char *end = sourceReader->data + sourceReader->size;
+    int i = 0;
+
+    for (i = 0; i < numOfChunks && start < end; ++i)
+    {
+        const char *chunkEnd = end;
+
+        if (i < numOfChunks - 1 &&
+            (size_t)(end - start) > sourceReader->size / numOfChunks)
+        {
+            chunkEnd = (const char *)memchr(start + sourceReader->size / numOfChunks,
+                                            '\n',
+                                            end - start - sourceReader->size / numOfChunks);
+            chunkEnd = (NULL == chunkEnd) ? end : chunkEnd + 1;
+        }
+
+        chunks[i].text.start = start;
+        chunks[i].text.length = chunkEnd - start;
+        chunks[i].chunks = chunks;
+        start = chunkEnd;
+    }
+
+    return i;
+}
+
+/* Runs function on every chunk and waits for all of them */
+static void RunChunkTasks(ThreadPool *threadPool,
+                          TaskFunction function,
+                          ScanChunk *chunks,
+                          int numOfChunks)
+{
+    int i = 0;
+
+    for (i = 0; i < numOfChunks; ++i)
+    {
+        if (SUCCESS != SubmitTask(threadPool, function, chunks + i))
+        {
+            function(chunks + i);
+        }
+    }
+
+    WaitForTasks(threadPool);
+}
+
+/* Counts the lines of the chunk and keeps its .define lines, so the chunks
+ * after it know its macros */
+static void FindChunkLines(void *argument)
+{
+    ScanChunk *chunk = (ScanChunk *)argument;
+    const char *position = chunk->text.start;
+    const char *end = chunk->text.start + chunk->text.length;
+    size_t prefixLength = strlen(MACRO_SENTENCE_PREFIX);
+
+    while (position < end &&
+           NULL != (position = (const char *)memchr(position, '\n', end - position)))
+    {
+        ++chunk->numOfLines;
+        ++position;
+    }
+
+    /* Only a line with ".define" in it can be a macro sentence */
+    position = chunk->text.start;
+    while (position < end &&
+           NULL != (position = (const char *)memchr(position, MACRO_SENTENCE_PREFIX[0], end - position)))
+    {
+        const char *lineStart = position, *lineEnd = NULL;
+        Sentence sentence;
+        Span text = {0};
+
+        if ((size_t)(end - position) < prefixLength ||
+            0 != strncmp(position, MACRO_SENTENCE_PREFIX, prefixLength))
+        {
+            ++position;
+            continue;
+        }
+
+        while (lineStart > chunk->text.start && '\n' != lineStart[-1])
+        {
+            --lineStart;
+        }
+
+        lineEnd = (const char *)memchr(position, '\n', end - position);
+        lineEnd = (NULL == lineEnd) ? end : lineEnd;
+        position = lineEnd;
+
+        text.start = lineStart;
+        text.length = lineEnd - lineStart;
+        if (SUCCESS != AnalyzeSentence(text, &sentence) ||
+            MACRO_SENTENCE != sentence.type)
+        {
+            continue;
+        }
+
+        if (chunk->numOfMacroSentences == chunk->macroSentencesCapacity)
+        {
+            int newCapacity = (0 == chunk->macroSentencesCapacity)
+                                  ? INITIAL_MACRO_SENTENCES_CAPACITY
+                                  : 2 * chunk->macroSentencesCapacity;
+            Sentence *newSentences = (Sentence *)realloc(chunk->macroSentences,
+                                                         newCapacity * sizeof(Sentence));
+            if (NULL == newSentences)
+            {
+                ReportError(&chunk->diagnostics, "Memory allocation error\n");
+                return;
+            }
+
+            chunk->macroSentences = newSentences;
+            chunk->macroSentencesCapacity = newCapacity;
+        }
+
+        chunk->macroSentences[chunk->numOfMacroSentences++] = sentence;
+    }
+}
+
+/* The macros of the chunks before are inserted first, so operands and
+ * .data values that use them are parsed as they are in a sequential scan */
+static void ScanChunkSentences(void *argument)
+{
+    ScanChunk *chunk = (ScanChunk *)argument;
+    const ScanChunk *previousChunk = NULL;
+    SourceReader sourceReader;
+    int i = 0;
+
+    for (previousChunk = chunk->chunks; previousChunk != chunk; ++previousChunk)
+    {
+        for (i = 0; i < previousChunk->numOfMacroSentences; ++i)
+        {
+            InsertMacroToSymbolTable(previousChunk->macroSentences + i,
+                                     &chunk->assembly.symbolTable,
+                                     &chunk->diagnostics,
+                                     chunk->firstLineNumber);
+            ++chunk->numOfSeededMacros;
+        }
+    }
+
+    OpenSourceBuffer(&sourceReader, chunk->text.start, chunk->text.length);
+    ScanSentences(&sourceReader,
+                  &chunk->assembly,
+                  &chunk->instructionTable,
+                  NULL,
+                  chunk->firstLineNumber,
+                  &chunk->IC,
+                  &chunk->diagnostics);
+    CloseSourceReader(&sourceReader);
+}
+
+/* Symbols of operands are given their ids in the whole program, and the
+ * words go to the part of the code of the chunk */
+static void EncodeChunk(void *argument)
+{
+    ScanChunk *chunk = (ScanChunk *)argument;
+    Instruction *instruction = NULL, *end = NULL;
+
+    end = chunk->instructionTable.instructions + chunk->instructionTable.numOfInstructions;
+
+    for (instruction = chunk->instructionTable.instructions;
+         instruction != end;
+         ++instruction)
+    {
+        if (NO_SYMBOL != instruction->srcOperand.symbolId)
+        {
+            instruction->srcOperand.symbolId = chunk->symbolIds[instruction->srcOperand.symbolId];
+        }
+
+        if (NO_SYMBOL != instruction->destOperand.symbolId)
+        {
+            instruction->destOperand.symbolId = chunk->symbolIds[instruction->destOperand.symbolId];
+        }
+    }
+
+    EncodeInstructions(chunk->program->instructionSegment.words,
+                       chunk->instructionTable.instructions,
+                       chunk->instructionTable.numOfInstructions,
+                       chunk->firstIC,
+                       &chunk->program->symbolTable,
+                       &chunk->externReferences,
+                       &chunk->diagnostics);
+}
+
+/* Builds the symbol table and the data of the whole program from those of
+ * the chunks, and makes room for its code. Returns FAILURE where the result
+ * could differ from a sequential scan. */
+static ReturnStatus MergeChunks(ScanChunk *chunks,
+                                int numOfChunks,
+                                Assembly *assembly,
+                                int *IC)
+{
+    Diagnostics mergeDiagnostics = {0};
+    const SymbolTableNode *node = NULL;
+    ReturnStatus status = SUCCESS;
+    int i = 0, DC = 0;
+
+    for (i = 0; i < numOfChunks && SUCCESS == status; ++i)
+    {
+        chunks[i].firstIC = *IC;
+        chunks[i].firstDC = DC;
+        chunks[i].program = assembly;
+        *IC += chunks[i].IC;
+        DC += (int)chunks[i].assembly.dataSegment.numOfWords;
+
+        status = MergeChunk(chunks + i, assembly, &mergeDiagnostics);
+    }
+
+    /* A name used as a macro in a chunk must be a macro before anything else
+     * (e.g. not an external of a chunk before) */
+    for (node = assembly->symbolTable.head;
+         NULL != node && SUCCESS == status;
+         node = node->next)
+    {
+        Symbol firstSymbol = {0};
+
+        if (MACRO == node->symbol.type)
+        {
+            GetSymbolDetails(&assembly->symbolTable,
+                             node->symbol.nameId,
+                             &firstSymbol,
+                             &mergeDiagnostics,
+                             0);
+            status = (MACRO == firstSymbol.type) ? SUCCESS : FAILURE;
+        }
+    }
+
+    if (SUCCESS == status &&
+        SUCCESS != ReserveMemoryWords(&assembly->instructionSegment, *IC))
+    {
+        status = FAILURE;
+    }
+
+    if (SUCCESS == status)
+    {
+        UpdateDataSymbols(&assembly->symbolTable, *IC + STARTING_ADDRESS);
+    }
+
+    if (mergeDiagnostics.errorHasOccurred)
+    {
+        status = FAILURE;
+    }
+
+    DestroyDiagnostics(&mergeDiagnostics);
+
+    return status;
+}
+
+/* Appends the symbols, entries and data of the chunk to the program */
+static ReturnStatus MergeChunk(ScanChunk *chunk,
+                               Assembly *assembly,
+                               Diagnostics *diagnostics)
+{
+    const SymbolTable *chunkTable = &chunk->assembly.symbolTable;
+    const MemorySegment *chunkData = &chunk->assembly.dataSegment;
+    const SymbolTableNode *node = NULL;
+    int i = 0;
+
+    chunk->symbolIds = (int *)malloc((chunkTable->names.numOfStrings + 1) * sizeof(int));
+    if (NULL == chunk->symbolIds)
+    {
+        return FAILURE;
+    }
+
+    for (i = 0; i < chunkTable->names.numOfStrings; ++i)
+    {
+        Span name = {0};
+
+        name.start = GetSymbolName(chunkTable, i);
+        name.length = strlen(name.start);
+        chunk->symbolIds[i] = InternSymbolName(&assembly->symbolTable,
+                                               name,
+                                               diagnostics,
+                                               chunk->firstLineNumber);
+        if (ERROR == chunk->symbolIds[i])
+        {
+            return FAILURE;
+        }
+    }
+
+    /* The macros of the chunks before come first, and are already merged */
+    for (node = chunkTable->head, i = 0; NULL != node; node = node->next, ++i)
+    {
+        int value = node->symbol.value;
+
+        if (i < chunk->numOfSeededMacros)
+        {
+            continue;
+        }
+
+        if (CODE == node->symbol.type)
+        {
+            value += chunk->firstIC;
+        }
+        else if (DATA == node->symbol.type)
+        {
+            value += chunk->firstDC;
+        }
+
+        InsertSymbolById(&assembly->symbolTable,
+                         chunk->symbolIds[node->symbol.nameId],
+                         node->symbol.type,
+                         value,
+                         diagnostics,
+                         chunk->firstLineNumber);
+    }
+
+    for (i = 0; i < chunkTable->numOfEntries; ++i)
+    {
+        AddEntrySymbol(&assembly->symbolTable,
+                       chunk->symbolIds[chunkTable->entryIds[i]],
+                       diagnostics,
+                       chunk->firstLineNumber);
+    }
+
+    assembly->hasEntries |= chunk->assembly.hasEntries;
+    assembly->hasExternals |= chunk->assembly.hasExternals;
+
+    if (SUCCESS != ReserveMemoryWords(&assembly->dataSegment,
+                                      assembly->dataSegment.numOfWords + chunkData->numOfWords))
+    {
+        return FAILURE;
+    }
+
+    if (chunkData->numOfWords > 0)
+    {
+        memcpy(assembly->dataSegment.words + assembly->dataSegment.numOfWords,
+               chunkData->words,
+               chunkData->numOfWords * sizeof(MemoryWord));
+        assembly->dataSegment.numOfWords += chunkData->numOfWords;
+    }
+
+    return diagnostics->errorHasOccurred ? FAILURE : SUCCESS;
+}
+
+static bool HasErrors(const ScanChunk *chunks, int numOfChunks)
+{
+    int i = 0;
+
+    for (i = 0; i < numOfChunks; ++i)
+    {
+        if (chunks[i].diagnostics.errorHasOccurred)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void DestroyChunks(ScanChunk *chunks, int numOfChunks)
+{
+    int i = 0;
+
+    for (i = 0; i < numOfChunks; ++i)
+    {
+        free(chunks[i].macroSentences);
+        DestroyAssembly(&chunks[i].assembly);
+        DestroyInstructionTable(&chunks[i].instructionTable);
+        DestroyDiagnostics(&chunks[i].diagnostics);
+        free(chunks[i].symbolIds);
+        free(chunks[i].externReferences.references);
+    }
+
+    free(chunks);
+}
@@ -5,272 +5,396 @@
 * Date: 19/08/2019                      *
 ****************************************/
 
-#include <stdio.h>  /* stderr */
-#include <errno.h>  /* errno */
-#include <string.h> /* strncmp, strncpy, strstr */
-#include <ctype.h>  /* isspace, isalpha, isdigit */
-#include <stdlib.h> /* atoi */
+#include <string.h> /* strlen, strncmp */
+#include <ctype.h>  /* isspace, isalpha, isdigit, isalnum */
 #include <assert.h> /* assert */
 
 #include "sentence_analyzer.h" /* API */
-#include "operations.h"        /* API */
 
-static bool IsSpecificSentenceByPrefix(const char *sentence,
-                                       const char *prefix);
-static bool HasSubstring(const char *sentence, const char *substring);
-
-bool IsCommentSentence(const char *sentence)
+/* States of the sentence lexer */
+typedef enum
+{
+    START_STATE,           /* Column 0 */
+    FIRST_WORD_STATE,      /* Letters and digits from column 0 (maybe a symbol) */
+    WORD_STATE,            /* Any other word from column 0 */
+    SYMBOL_END_STATE,      /* Right after the colon of a symbol definition */
+    BAD_SYMBOL_STATE,      /* A word from column 0 ending with a colon */
+    BLANK_STATE,           /* Spaces before the operation */
+    LEADING_BLANK_STATE,   /* Spaces from column 0 */
+    INDENTED_WORD_STATE,   /* Letters and digits after them (maybe a symbol) */
+    INDENTED_SYMBOL_STATE, /* Right after the colon of an indented symbol */
+    OPERATION_STATE,
+    COMMENT_STATE,         /* Final */
+    OPERANDS_STATE,        /* Final, the rest of the sentence are the operands */
+    NUM_OF_STATES
+} LexerState;
+
+typedef enum
+{
+    SPACE_CHAR,
+    LETTER_CHAR,
+    DIGIT_CHAR,
+    COLON_CHAR,
+    SEMICOLON_CHAR,
+    OTHER_CHAR,
+    NUM_OF_CHAR_CLASSES
+} CharClass;
+
+static const unsigned char LEXER_TRANSITIONS[NUM_OF_STATES][NUM_OF_CHAR_CLASSES] =
+{
+    /*                      SPACE                  LETTER                 DIGIT                  COLON                  SEMICOLON              OTHER */
+    /* START */           { LEADING_BLANK_STATE,   FIRST_WORD_STATE,      WORD_STATE,            WORD_STATE,            COMMENT_STATE,         WORD_STATE },
+    /* FIRST_WORD */      { OPERANDS_STATE,        FIRST_WORD_STATE,      FIRST_WORD_STATE,      SYMBOL_END_STATE,      WORD_STATE,            WORD_STATE },
+    /* WORD */            { OPERANDS_STATE,        WORD_STATE,            WORD_STATE,            BAD_SYMBOL_STATE,      WORD_STATE,            WORD_STATE },
+    /* SYMBOL_END */      { BLANK_STATE,           OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE },
+    /* BAD_SYMBOL */      { BLANK_STATE,           OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE },
+    /* BLANK */           { BLANK_STATE,           OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE },
+    /* LEADING_BLANK */   { LEADING_BLANK_STATE,   INDENTED_WORD_STATE,   OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE },
+    /* INDENTED_WORD */   { OPERANDS_STATE,        INDENTED_WORD_STATE,   INDENTED_WORD_STATE,   INDENTED_SYMBOL_STATE, OPERATION_STATE,       OPERATION_STATE },
+    /* INDENTED_SYMBOL */ { BLANK_STATE,           OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE },
+    /* OPERATION */       { OPERANDS_STATE,        OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE,       OPERATION_STATE },
+    /* COMMENT */         { COMMENT_STATE,         COMMENT_STATE,         COMMENT_STATE,         COMMENT_STATE,         COMMENT_STATE,         COMMENT_STATE },
+    /* OPERANDS */        { OPERANDS_STATE,        OPERANDS_STATE,        OPERANDS_STATE,        OPERANDS_STATE,        OPERANDS_STATE,        OPERANDS_STATE }
+};
+
+static CharClass GetCharClass(char c);
+static SentenceType GetSentenceType(Span operation);
+static bool IsValidSymbol(Span symbol);
+
+/* Splits a sentence into its fields in a single pass. Returns FAILURE if
+ * the symbol definition is not a valid symbol or is indented (the other
+ * fields are still filled). */
+ReturnStatus AnalyzeSentence(Span text, Sentence *sentence)
 {
+    LexerState state = START_STATE;
+    size_t i = 0, wordStart = 0;
+    ReturnStatus status = SUCCESS;
+
+    assert(NULL != text.start || 0 == text.length);
     assert(NULL != sentence);
 
-    return (IsSpecificSentenceByPrefix(sentence, COMMENT_SENTENCE_PREFIX));
-}
+    sentence->type = EMPTY_SENTENCE;
+    sentence->symbol.start = text.start;
+    sentence->symbol.length = 0;
+    sentence->operation.start = text.start;
+    sentence->operation.length = 0;
+    sentence->operands.start = text.start + text.length;
+    sentence->operands.length = 0;
+    sentence->isSymbolIndented = FALSE;
 
-bool IsMacroSentence(const char *sentence)
-{
-    assert(NULL != sentence);
+    for (i = 0; i < text.length; ++i)
+    {
+        LexerState nextState =
+            (LexerState)LEXER_TRANSITIONS[state][GetCharClass(text.start[i])];
 
-    return (IsSpecificSentenceByPrefix(sentence, MACRO_SENTENCE_PREFIX));
-}
+        switch (nextState)
+        {
+        case SYMBOL_END_STATE:
+        case BAD_SYMBOL_STATE:
+        {
+            sentence->symbol.length = i;
+            wordStart = i + 1;
+            break;
+        }
 
-bool IsEntrySentence(const char *sentence)
-{
-    assert(NULL != sentence);
+        case INDENTED_SYMBOL_STATE:
+        {
+            sentence->symbol.start = text.start + wordStart;
+            sentence->symbol.length = i - wordStart;
+            sentence->isSymbolIndented = TRUE;
+            wordStart = i + 1;
+            break;
+        }
 
-    return (IsSpecificSentenceByPrefix(sentence, ENTRY_SENTENCE_PREFIX));
-}
+        case INDENTED_WORD_STATE:
+        case OPERATION_STATE:
+        {
+            if (nextState != state && INDENTED_WORD_STATE != state)
+            {
+                wordStart = i;
+            }
+            break;
+        }
 
-bool IsExternSentence(const char *sentence)
-{
-    assert(NULL != sentence);
+        case COMMENT_STATE:
+        {
+            sentence->type = COMMENT_SENTENCE;
+            return SUCCESS;
+        }
 
-    return HasSubstring(sentence, EXTERN_SENTENCE_PREFIX);
-}
+        case OPERANDS_STATE:
+        {
+            sentence->operation.start = text.start + wordStart;
+            sentence->operation.length = i - wordStart;
+            sentence->operands.start = text.start + i;
+            sentence->operands.length = text.length - i;
+            TrimWhiteSpaces(&sentence->operands);
+            break;
+        }
 
-bool IsEmptySentence(const char *sentence)
-{
-    int i = 0;
+        default:
+            break;
+        }
 
-    assert(NULL != sentence);
+        state = nextState;
 
-    for (i = 0; sentence[i] != NEW_LINE; ++i)
-    {
-        if (!isspace(sentence[i]))
+        if (OPERANDS_STATE == state)
         {
-            return FALSE;
+            break;
         }
     }
 
-    return TRUE;
-}
+    if (OPERANDS_STATE != state && BLANK_STATE != state &&
+        LEADING_BLANK_STATE != state && START_STATE != state)
+    {
+        /* The operation ends the sentence */
+        sentence->operation.start = text.start + wordStart;
+        sentence->operation.length = text.length - wordStart;
+    }
 
-bool IsDataSentence(const char *sentence)
-{
-    assert(NULL != sentence);
+    if (BAD_SYMBOL_STATE == state || sentence->isSymbolIndented ||
+        (0 != sentence->symbol.length && !IsValidSymbol(sentence->symbol)))
+    {
+        status = FAILURE;
+    }
 
-    return HasSubstring(sentence, DATA_SENTENCE_PREFIX);
+    if (0 != sentence->operation.length || 0 != sentence->symbol.length)
+    {
+        sentence->type = GetSentenceType(sentence->operation);
+    }
+
+    return status;
 }
 
-bool IsStringSentence(const char *sentence)
+/* Returns FALSE if the string is not enclosed in quotation marks */
+bool GetString(Span operands, Span *string)
 {
-    assert(NULL != sentence);
+    assert(NULL != operands.start);
+    assert(NULL != string);
+
+    if (operands.length < 2 ||
+        QUOTATION_MARK_SIGN != operands.start[0] ||
+        QUOTATION_MARK_SIGN != operands.start[operands.length - 1])
+    {
+        string->start = operands.start;
+        string->length = 0;
+        return FALSE;
+    }
+
+    string->start = operands.start + 1;
+    string->length = operands.length - 2;
 
-    return HasSubstring(sentence, STRING_SENTENCE_PREFIX);
+    return TRUE;
 }
 
-bool HasValidSymbol(const char *sentence)
+/* Splits the next token (without spaces around it) off str. Returns FALSE
+ * when str has no more tokens. */
+bool GetNextToken(Span *str, char separator, Span *token)
 {
-    int i = 0;
+    int separatorIndex = 0;
 
-    assert(NULL != sentence);
+    assert(NULL != str);
+    assert(NULL != token);
 
-    if (!isalpha(sentence[i])) /* Label has to start with an alphabet */
+    if (NULL == str->start)
     {
         return FALSE;
     }
 
-    for (i = 1; sentence[i] != NEW_LINE && sentence[i] != COLON_SIGN; ++i)
+    separatorIndex = FindChar(*str, separator);
+
+    token->start = str->start;
+
+    if (NOT_FOUND == separatorIndex)
     {
-        if (i >= MAX_LABEL_SIZE ||
-            (!isalpha(sentence[i]) && !isdigit(sentence[i])))
-        {
-            return FALSE;
-        }
+        token->length = str->length;
+        str->start = NULL;
+        str->length = 0;
+    }
+    else
+    {
+        token->length = separatorIndex;
+        str->start += separatorIndex + 1;
+        str->length -= separatorIndex + 1;
     }
 
+    TrimWhiteSpaces(token);
+
     return TRUE;
 }
 
-bool HasValidOperationName(const char *sentence)
+/* Remove white spaces [according to isspace()] from both ends of a span */
+void TrimWhiteSpaces(Span *str)
 {
-    char operationName[MAX_SENTENCE_SIZE];
-
-    assert(NULL != sentence);
+    assert(NULL != str);
 
-    GetOperationName(sentence, operationName);
+    while (str->length > 0 && isspace((unsigned char)str->start[0]))
+    {
+        ++str->start;
+        --str->length;
+    }
 
-    return IsInOperationsTable(operationName);
+    while (str->length > 0 && isspace((unsigned char)str->start[str->length - 1]))
+    {
+        --str->length;
+    }
 }
 
-void GetString(const char *stringSentence, char *string)
+int FindChar(Span str, char c)
 {
-    int stringStartIndex = 0, stringEndIndex = 0, stringLen = 0;
+    size_t i = 0;
 
-    assert(NULL != stringSentence);
-    assert(NULL != string);
-    assert(IsStringSentence(stringSentence));
+    assert(NULL != str.start || 0 == str.length);
 
-    stringStartIndex = FindChar(stringSentence, QUOTATION_MARK_SIGN) + 1;
-    stringEndIndex = stringStartIndex +
-                     FindChar(stringSentence + stringStartIndex,
-                              QUOTATION_MARK_SIGN);
-    stringLen = stringEndIndex - stringStartIndex;
+    for (i = 0; i < str.length; ++i)
+    {
+        if (str.start[i] == c)
+        {
+            return (int)i;
+        }
+    }
 
-    strncpy(string, stringSentence + stringStartIndex, stringLen);
-    string[stringLen] = END_LINE;
+    return NOT_FOUND;
 }
 
-void GetData(const char *dataSentence, char *data)
+bool IsSpanEqual(Span str, const char *other)
 {
-    char *tempData = NULL;
-
-    assert(NULL != dataSentence);
-    assert(NULL != data);
-    assert(IsDataSentence(dataSentence));
-
-    tempData = strstr(dataSentence, DATA_SENTENCE_PREFIX) +
-               strlen(DATA_SENTENCE_PREFIX);
+    assert(NULL != other);
 
-    strcpy(data, tempData);
-    RemoveWhiteSpaces(data);
+    return (0 == strncmp(str.start, other, str.length) &&
+            END_LINE == other[str.length]);
 }
 
-void GetSymbol(const char *sentence, char *symbol)
+Span GetSpan(const char *str)
 {
-    int symbolEndIndex = FindChar(sentence, COLON_SIGN);
+    Span span = {0};
 
-    assert(NULL != sentence);
-    assert(NULL != symbol);
-    assert(HasValidSymbol(sentence));
+    assert(NULL != str);
 
-    strncpy(symbol, sentence, symbolEndIndex);
-    symbol[symbolEndIndex] = END_LINE;
+    span.start = str;
+    span.length = strlen(str);
+
+    return span;
 }
 
-void GetInstructionParams(const char *instructionSentence, char *params)
+bool IsNumber(Span str)
 {
-    int runner = 0, colonIndex = 0;
-
-    assert(NULL != instructionSentence);
-    assert(NULL != params);
-
-    colonIndex = FindChar(instructionSentence, COLON_SIGN);
+    return (str.length > 0 &&
+            (str.start[0] == PLUS_SIGN ||
+             str.start[0] == MINUS_SIGN ||
+             isdigit((unsigned char)str.start[0])));
+}
 
-    if (NOT_FOUND != colonIndex) /* Sentence has a symbol */
-    {
-        runner = colonIndex + 1;
-    }
+/* Like atoi, but stops at the end of the span. Digits stop counting once
+ * the value is past MAX_NUMBER_MAGNITUDE, so a longer number is only
+ * known to be out of every range (see IsNumberInRange). */
+int GetNumber(Span number)
+{
+    size_t i = 0;
+    int value = 0;
+    bool isNegative = FALSE;
 
-    while (isspace(instructionSentence[runner]))
-    {
-        ++runner;
-    }
+    assert(NULL != number.start || 0 == number.length);
 
-    while (!isspace(instructionSentence[runner]))
+    if (i < number.length &&
+        (number.start[i] == PLUS_SIGN || number.start[i] == MINUS_SIGN))
     {
-        ++runner;
+        isNegative = (number.start[i] == MINUS_SIGN);
+        ++i;
     }
 
-    while (isspace(instructionSentence[runner]))
+    for (; i < number.length && isdigit((unsigned char)number.start[i]); ++i)
     {
-        ++runner;
+        if (value <= MAX_NUMBER_MAGNITUDE)
+        {
+            value = value * 10 + (number.start[i] - ZERO_DIGIT);
+        }
     }
 
-    strcpy(params, instructionSentence + runner);
-    RemoveWhiteSpaces(params);
+    return isNegative ? -value : value;
 }
 
-void GetOperationName(const char *sentence, char *operationName)
+bool IsNumberInRange(int number, int minNumber, int maxNumber)
 {
-    int operationStartIndex = 0, operationEndIndex = 0, runner = 0;
-    int operationNameSize = 0, colonIndex = 0;
-
-    assert(NULL != sentence);
-    assert(NULL != operationName);
+    return (number >= minNumber && number <= maxNumber);
+}
 
-    colonIndex = FindChar(sentence, COLON_SIGN);
+/* Static functions */
+static CharClass GetCharClass(char c)
+{
+    if (isspace((unsigned char)c))
+    {
+        return SPACE_CHAR;
+    }
 
-    if (NOT_FOUND != colonIndex) /* Sentence has a symbol */
+    if (isalpha((unsigned char)c))
     {
-        runner = colonIndex + 1;
+        return LETTER_CHAR;
     }
 
-    while (isspace(sentence[runner]))
+    if (isdigit((unsigned char)c))
     {
-        ++runner;
+        return DIGIT_CHAR;
     }
-    operationStartIndex = runner;
 
-    while (isalpha(sentence[runner]))
+    if (COLON_SIGN == c)
     {
-        ++runner;
+        return COLON_CHAR;
     }
-    operationEndIndex = runner;
 
-    operationNameSize = operationEndIndex - operationStartIndex;
-    strncpy(operationName, sentence + operationStartIndex, operationNameSize);
-    operationName[operationNameSize] = END_LINE;
+    return (COMMENT_SENTENCE_PREFIX[0] == c) ? SEMICOLON_CHAR : OTHER_CHAR;
 }
 
-/* Remove white spaces [according to isspace()] from a given string */
-void RemoveWhiteSpaces(char *str)
+static SentenceType GetSentenceType(Span operation)
 {
-    int count = 0, i = 0;
-
-    assert(NULL != str);
-
-    for (i = 0; str[i]; ++i)
+    if (IsSpanEqual(operation, DATA_SENTENCE_PREFIX))
     {
-        if (!isspace(str[i]))
-        {
-            str[count++] = str[i];
-        }
+        return DATA_SENTENCE;
     }
 
-    str[count] = END_LINE;
-}
+    if (IsSpanEqual(operation, STRING_SENTENCE_PREFIX))
+    {
+        return STRING_SENTENCE;
+    }
 
-int FindChar(const char *str, char c)
-{
-    int count = 0, i = 0;
+    if (IsSpanEqual(operation, EXTERN_SENTENCE_PREFIX))
+    {
+        return EXTERN_SENTENCE;
+    }
 
-    assert(NULL != str);
+    if (IsSpanEqual(operation, ENTRY_SENTENCE_PREFIX))
+    {
+        return ENTRY_SENTENCE;
+    }
 
-    for (i = 0; str[i]; ++i, ++count)
+    if (IsSpanEqual(operation, MACRO_SENTENCE_PREFIX))
     {
-        if (str[i] == c)
-        {
-            return count;
-        }
+        return MACRO_SENTENCE;
     }
 
-    return NOT_FOUND;
+    return INSTRUCTION_SENTENCE;
 }
 
-/* Static functions */
-static bool IsSpecificSentenceByPrefix(const char *sentence,
-                                       const char *prefix)
+/* A symbol starts with a letter, has only letters and digits and is at
+ * most MAX_LABEL_SIZE long */
+static bool IsValidSymbol(Span symbol)
 {
-    assert(NULL != sentence);
-    assert(NULL != prefix);
+    size_t i = 0;
 
-    return (0 == strncmp(sentence, prefix, strlen(prefix)));
-}
+    if (0 == symbol.length ||
+        symbol.length > MAX_LABEL_SIZE ||
+        !isalpha((unsigned char)symbol.start[0]))
+    {
+        return FALSE;
+    }
 
-static bool HasSubstring(const char *sentence, const char *substring)
-{
-    assert(NULL != sentence);
-    assert(NULL != substring);
+    for (i = 1; i < symbol.length; ++i)
+    {
+        if (!isalnum((unsigned char)symbol.start[i]))
+        {
+            return FALSE;
+        }
+    }
 
-    return (NULL != strstr(sentence, substring));
+    return TRUE;
 }
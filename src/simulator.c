@@ -0,0 +1,984 @@
+/****************************************
+* ASSEMBLER: simulator.c                *
+****************************************/
+
+#include <stdio.h>  /* FILE, getc, putc, fseek, fprintf */
+#include <string.h> /* memset */
+#include <limits.h> /* ULONG_MAX */
+#include <assert.h> /* assert */
+
+#include "simulator.h"         /* API */
+#include "source_reader.h"     /* API */
+#include "sentence_analyzer.h" /* API */
+#include "operations.h"        /* API */
+#include "instruction_table.h" /* AddressingMethods */
+#include "memory_word.h"       /* MEMORY_WORD_SIZE_IN_BITS, MEMORY_WORD_MASK */
+#include "object_file.h"       /* API */
+#include "word_encoding.h"     /* API */
+
+/* Direct threading (a jump to the next handler at the end of every
+ * handler) with GCC's labels as values, a switch anywhere else */
+#if defined(__GNUC__) && !defined(SIMULATOR_SWITCH_DISPATCH)
+#define COMPUTED_GOTO_DISPATCH
+#endif
+
+static void BuildHandlerTable(unsigned char *handlers);
+static void DecodeMicroOp(Machine *machine, unsigned int address);
+static bool DecodeOperand(Machine *machine,
+                          unsigned int *address,
+                          unsigned int addressingMethod,
+                          unsigned int registerShift,
+                          unsigned int immediateIndex,
+                          unsigned char *space,
+                          unsigned short *offset);
+static void InvalidateMicroOps(Machine *machine, unsigned int address);
+static unsigned int GetJumpTarget(const Machine *machine,
+                                  unsigned int word,
+                                  const unsigned short *dest);
+static int ToSigned(unsigned int word);
+static bool ParseAddress(Span str, unsigned long *address);
+static unsigned long StoreWordBatch(Machine *machine,
+                                    EncodedWordBatch *batch,
+                                    Diagnostics *diagnostics);
+
+/* Loads "IC DC" and the "address<TAB>word" lines of an object file into
+ * memory and points the pc to the first instruction */
+ReturnStatus LoadObjectFile(Machine *machine,
+                            FILE *objectFile,
+                            Diagnostics *diagnostics)
+{
+    SourceReader sourceReader;
+    EncodedWordBatch batch;
+    Span line = {0}, field = {0};
+    unsigned long instructionCounter = 0, dataCounter = 0, numOfWords = 0;
+    int lineNumber = 1;
+
+    assert(NULL != machine);
+    assert(NULL != objectFile);
+    assert(NULL != diagnostics);
+
+    batch.numOfWords = 0;
+
+    if (SUCCESS != OpenSourceReader(&sourceReader, objectFile))
+    {
+        ReportError(diagnostics, "Error reading the object file\n");
+        CloseSourceReader(&sourceReader);
+        return FAILURE;
+    }
+
+    if (ReadSentence(&sourceReader, &line))
+    {
+        TrimWhiteSpaces(&line);
+
+        if (GetNextToken(&line, ' ', &field) &&
+            ParseAddress(field, &instructionCounter) &&
+            GetNextToken(&line, ' ', &field))
+        {
+            ParseAddress(field, &dataCounter);
+        }
+    }
+
+    if (0 == instructionCounter ||
+        instructionCounter + dataCounter > MEMORY_SIZE - STARTING_ADDRESS)
+    {
+        ReportError(diagnostics, "Line %d:\tError: bad object file header\n", lineNumber);
+        CloseSourceReader(&sourceReader);
+        return FAILURE;
+    }
+
+    /* The words are decoded a batch at a time. The batch is stored before
+     * any other error is reported, so the errors stay in line order. */
+    while (ReadSentence(&sourceReader, &line))
+    {
+        unsigned long address = 0;
+
+        ++lineNumber;
+
+        TrimWhiteSpaces(&line);
+        if (0 == line.length)
+        {
+            continue;
+        }
+
+        if (!GetNextToken(&line, '\t', &field) ||
+            !ParseAddress(field, &address) ||
+            address < STARTING_ADDRESS ||
+            address >= MEMORY_SIZE)
+        {
+            numOfWords += StoreWordBatch(machine, &batch, diagnostics);
+            ReportError(diagnostics, "Line %d:\tError: bad address\n", lineNumber);
+            continue;
+        }
+
+        if (!GetNextToken(&line, '\t', &field) || ENCODED_WORD_SIZE != field.length)
+        {
+            numOfWords += StoreWordBatch(machine, &batch, diagnostics);
+            ReportError(diagnostics, "Line %d:\tError: bad memory word\n", lineNumber);
+            continue;
+        }
+
+        if (AddToWordBatch(&batch, field.start, address, lineNumber))
+        {
+            numOfWords += StoreWordBatch(machine, &batch, diagnostics);
+        }
+    }
+
+    numOfWords += StoreWordBatch(machine, &batch, diagnostics);
+
+    CloseSourceReader(&sourceReader);
+
+    if (numOfWords != instructionCounter + dataCounter)
+    {
+        ReportError(diagnostics,
+                    "Error: the header has %lu words but the file has %lu\n",
+                    instructionCounter + dataCounter,
+                    numOfWords);
+    }
+
+    ClearMicroOps(machine);
+    machine->pc = STARTING_ADDRESS;
+    machine->numOfCodeWords = (unsigned int)instructionCounter;
+    machine->numOfDataWords = (unsigned int)dataCounter;
+
+    return diagnostics->errorHasOccurred ? FAILURE : SUCCESS;
+}
+
+/* Loads the words of a binary object file (see object_file.h), read in
+ * place from the mapped file */
+ReturnStatus LoadBinaryObjectFile(Machine *machine,
+                                  FILE *objectFile,
+                                  Diagnostics *diagnostics)
+{
+    SourceReader sourceReader;
+    BinaryObject object;
+    unsigned long i = 0, numOfWords = 0;
+
+    assert(NULL != machine);
+    assert(NULL != objectFile);
+    assert(NULL != diagnostics);
+
+    if (SUCCESS != OpenSourceReader(&sourceReader, objectFile))
+    {
+        ReportError(diagnostics, "Error reading the object file\n");
+        CloseSourceReader(&sourceReader);
+        return FAILURE;
+    }
+
+    if (SUCCESS != OpenBinaryObject(&object, sourceReader.data, sourceReader.size) ||
+        0 == object.instructionCounter ||
+        object.instructionCounter + object.dataCounter > MEMORY_SIZE - STARTING_ADDRESS)
+    {
+        ReportError(diagnostics, "Error: bad binary object file\n");
+        CloseSourceReader(&sourceReader);
+        return FAILURE;
+    }
+
+    numOfWords = object.instructionCounter + object.dataCounter;
+    for (i = 0; i < numOfWords; ++i)
+    {
+        machine->memory[STARTING_ADDRESS + i] =
+            (unsigned short)(GetBinaryObjectWord(&object, i) & MEMORY_WORD_MASK);
+    }
+
+    CloseSourceReader(&sourceReader);
+    ClearMicroOps(machine);
+    machine->pc = STARTING_ADDRESS;
+    machine->numOfCodeWords = (unsigned int)object.instructionCounter;
+    machine->numOfDataWords = (unsigned int)object.dataCounter;
+
+    return SUCCESS;
+}
+
+/* Runs from the pc until a stop, an error or maxSteps instructions (0 for
+ * no limit). The pc is left at the instruction the run ended on, or at the
+ * next instruction when the steps ran out (so the run can be resumed).
+ *
+ * Every instruction is decoded once, the first time it runs, into the
+ * MicroOp at its address: the handler, the length and where the operands
+ * are. A write to a word of a decoded instruction drops its MicroOp, so
+ * self-modifying code runs as it does in RunMachineUncached. */
+SimulationStatus RunMachine(Machine *machine, unsigned long maxSteps)
+{
+    unsigned short *bases[NUM_OF_OPERAND_SPACES];
+    unsigned short *const registers = machine->registers;
+    const unsigned char *const isCode = machine->isCode;
+    MicroOp *const microOps = machine->microOps;
+    const MicroOp *microOp = NULL;
+    bool zeroFlag = machine->zeroFlag;
+    unsigned long stepsLeft = (0 == maxSteps) ? ULONG_MAX : maxSteps;
+    unsigned int pc = machine->pc, instructionAddress = pc;
+    SimulationStatus status = SIMULATION_STOPPED;
+
+#ifdef COMPUTED_GOTO_DISPATCH
+    __extension__ static const void *const HANDLER_LABELS[NUM_OF_HANDLERS] = {
+        &&DECODE_HANDLER_LABEL, &&MOV_HANDLER_LABEL, &&CMP_HANDLER_LABEL,
+        &&ADD_HANDLER_LABEL, &&SUB_HANDLER_LABEL, &&NOT_HANDLER_LABEL,
+        &&CLR_HANDLER_LABEL, &&LEA_HANDLER_LABEL, &&INC_HANDLER_LABEL,
+        &&DEC_HANDLER_LABEL, &&JMP_HANDLER_LABEL, &&BNE_HANDLER_LABEL,
+        &&RED_HANDLER_LABEL, &&PRN_HANDLER_LABEL, &&JSR_HANDLER_LABEL,
+        &&RTS_HANDLER_LABEL, &&STOP_HANDLER_LABEL, &&ILLEGAL_HANDLER_LABEL,
+        &&ADDRESS_ERROR_HANDLER_LABEL};
+
+#define HANDLER(handler) handler##_LABEL
+#define DISPATCH()                                                  \
+    do                                                              \
+    {                                                               \
+        FETCH();                                                    \
+        REDISPATCH();                                               \
+    } while (0)
+#define REDISPATCH() __extension__({ goto *HANDLER_LABELS[microOp->handler]; })
+#else
+#define HANDLER(handler) case handler
+#define DISPATCH() continue
+#define REDISPATCH() goto dispatchMicroOp
+#endif
+
+/* Points microOp to the next instruction and moves the pc past it (an
+ * instruction not decoded yet has a length of 0 and DECODE_HANDLER). The
+ * length selects a branch instead of being added to the pc: a predicted
+ * branch lets the next fetch start before the length is loaded. */
+#define FETCH()                                     \
+    do                                              \
+    {                                               \
+        if (pc >= MEMORY_SIZE)                      \
+        {                                           \
+            status = SIMULATION_ADDRESS_ERROR;      \
+            goto endOfRun;                          \
+        }                                           \
+                                                    \
+        if (0 == stepsLeft)                         \
+        {                                           \
+            status = SIMULATION_OUT_OF_STEPS;       \
+            goto endOfRun;                          \
+        }                                           \
+                                                    \
+        --stepsLeft;                                \
+        instructionAddress = pc;                    \
+        microOp = microOps + pc;                    \
+        switch (microOp->length)                    \
+        {                                           \
+        case 1:                                     \
+            pc += 1;                                \
+            break;                                  \
+        case 2:                                     \
+            pc += 2;                                \
+            break;                                  \
+        case 3:                                     \
+            pc += 3;                                \
+            break;                                  \
+        case 4:                                     \
+            pc += 4;                                \
+            break;                                  \
+        case MAX_INSTRUCTION_LENGTH:                \
+            pc += MAX_INSTRUCTION_LENGTH;           \
+            break;                                  \
+        default:                                    \
+            break;                                  \
+        }                                           \
+    } while (0)
+
+#define SRC() (bases[microOp->srcSpace] + microOp->src)
+#define DEST() (bases[microOp->destSpace] + microOp->dest)
+#define JUMP_TARGET()                                    \
+    ((REGISTER_SPACE == microOp->destSpace)              \
+         ? (unsigned int)registers[microOp->dest]        \
+         : (unsigned int)microOp->dest)
+
+/* Writes value to the dest and drops the MicroOps that read the word */
+#define STORE(value)                                                     \
+    do                                                                   \
+    {                                                                    \
+        *DEST() = (unsigned short)(value);                               \
+        if (MEMORY_SPACE == microOp->destSpace && isCode[microOp->dest]) \
+        {                                                                \
+            InvalidateMicroOps(machine, microOp->dest);                  \
+        }                                                                \
+    } while (0)
+
+    assert(NULL != machine);
+
+    bases[MEMORY_SPACE] = machine->memory;
+    bases[REGISTER_SPACE] = registers;
+    bases[IMMEDIATE_SPACE] = machine->immediates;
+
+#ifdef COMPUTED_GOTO_DISPATCH
+    DISPATCH();
+#else
+    for (;;)
+    {
+        FETCH();
+
+    dispatchMicroOp:
+        switch (microOp->handler)
+        {
+#endif
+
+    HANDLER(DECODE_HANDLER):
+        DecodeMicroOp(machine, instructionAddress);
+        pc += microOp->length;
+        REDISPATCH();
+
+    HANDLER(MOV_HANDLER):
+        STORE(*SRC());
+        DISPATCH();
+
+    HANDLER(CMP_HANDLER):
+        zeroFlag = (*SRC() == *DEST());
+        DISPATCH();
+
+    HANDLER(ADD_HANDLER):
+        STORE((*DEST() + *SRC()) & MEMORY_WORD_MASK);
+        DISPATCH();
+
+    HANDLER(SUB_HANDLER):
+        STORE((*DEST() - *SRC()) & MEMORY_WORD_MASK);
+        DISPATCH();
+
+    HANDLER(NOT_HANDLER):
+        STORE(~*DEST() & MEMORY_WORD_MASK);
+        DISPATCH();
+
+    HANDLER(CLR_HANDLER):
+        STORE(0);
+        DISPATCH();
+
+    HANDLER(LEA_HANDLER):
+        STORE(microOp->src);
+        DISPATCH();
+
+    HANDLER(INC_HANDLER):
+        STORE((*DEST() + 1) & MEMORY_WORD_MASK);
+        DISPATCH();
+
+    HANDLER(DEC_HANDLER):
+        STORE((*DEST() - 1) & MEMORY_WORD_MASK);
+        DISPATCH();
+
+    HANDLER(JMP_HANDLER):
+        pc = JUMP_TARGET();
+        DISPATCH();
+
+    HANDLER(BNE_HANDLER):
+        if (!zeroFlag)
+        {
+            pc = JUMP_TARGET();
+        }
+        DISPATCH();
+
+    HANDLER(RED_HANDLER):
+        STORE(ReadInputCharacter(machine->input, machine->inputSource) & MEMORY_WORD_MASK);
+        DISPATCH();
+
+    HANDLER(PRN_HANDLER):
+        fprintf(machine->output, "%d\n", ToSigned(*DEST()));
+        DISPATCH();
+
+    HANDLER(JSR_HANDLER):
+        if (RETURN_STACK_SIZE == machine->stackPointer)
+        {
+            status = SIMULATION_STACK_ERROR;
+            goto endOfRun;
+        }
+        machine->returnStack[machine->stackPointer++] = (unsigned short)pc;
+        pc = JUMP_TARGET();
+        DISPATCH();
+
+    HANDLER(RTS_HANDLER):
+        if (0 == machine->stackPointer)
+        {
+            status = SIMULATION_STACK_ERROR;
+            goto endOfRun;
+        }
+        pc = machine->returnStack[--machine->stackPointer];
+        DISPATCH();
+
+    HANDLER(STOP_HANDLER):
+        status = SIMULATION_STOPPED;
+        goto endOfRun;
+
+    HANDLER(ILLEGAL_HANDLER):
+        status = SIMULATION_ILLEGAL_INSTRUCTION;
+        goto endOfRun;
+
+    HANDLER(ADDRESS_ERROR_HANDLER):
+        status = SIMULATION_ADDRESS_ERROR;
+        goto endOfRun;
+
+#ifndef COMPUTED_GOTO_DISPATCH
+        default:
+            status = SIMULATION_ILLEGAL_INSTRUCTION;
+            goto endOfRun;
+        }
+    }
+#endif
+
+#undef HANDLER
+#undef DISPATCH
+#undef REDISPATCH
+#undef FETCH
+#undef SRC
+#undef DEST
+#undef JUMP_TARGET
+#undef STORE
+
+endOfRun:
+    machine->zeroFlag = zeroFlag;
+    machine->pc = (SIMULATION_OUT_OF_STEPS == status) ? pc : instructionAddress;
+    machine->numOfSteps += ((0 == maxSteps) ? ULONG_MAX : maxSteps) - stepsLeft;
+
+    return status;
+}
+
+/* Runs as RunMachine does, but decodes every instruction every time it
+ * runs (as the simulator did before the micro-op cache). It writes memory
+ * behind the cache, so it leaves the cache empty. */
+SimulationStatus RunMachineUncached(Machine *machine, unsigned long maxSteps)
+{
+    unsigned char handlers[NUM_OF_DISPATCH_INDEXES];
+    unsigned short *const memory = machine->memory;
+    unsigned short *const registers = machine->registers;
+    unsigned short *src = NULL, *dest = NULL;
+    unsigned short srcImmediate = 0, destImmediate = 0;
+    bool zeroFlag = machine->zeroFlag;
+    unsigned long stepsLeft = (0 == maxSteps) ? ULONG_MAX : maxSteps;
+    unsigned int pc = machine->pc, instructionAddress = pc, word = 0;
+    SimulationStatus status = SIMULATION_STOPPED;
+
+#ifdef COMPUTED_GOTO_DISPATCH
+    __extension__ static const void *const HANDLER_LABELS[NUM_OF_HANDLERS] = {
+        &&ILLEGAL_HANDLER_LABEL, &&MOV_HANDLER_LABEL, &&CMP_HANDLER_LABEL,
+        &&ADD_HANDLER_LABEL, &&SUB_HANDLER_LABEL, &&NOT_HANDLER_LABEL,
+        &&CLR_HANDLER_LABEL, &&LEA_HANDLER_LABEL, &&INC_HANDLER_LABEL,
+        &&DEC_HANDLER_LABEL, &&JMP_HANDLER_LABEL, &&BNE_HANDLER_LABEL,
+        &&RED_HANDLER_LABEL, &&PRN_HANDLER_LABEL, &&JSR_HANDLER_LABEL,
+        &&RTS_HANDLER_LABEL, &&STOP_HANDLER_LABEL, &&ILLEGAL_HANDLER_LABEL};
+
+#define HANDLER(handler) handler##_LABEL
+#define DISPATCH()                                                             \
+    do                                                                         \
+    {                                                                          \
+        FETCH();                                                               \
+        __extension__({ goto *HANDLER_LABELS[handlers[DISPATCH_INDEX(word)]]; }); \
+    } while (0)
+#else
+#define HANDLER(handler) case handler
+#define DISPATCH() continue
+#endif
+
+/* Reads the first word of the next instruction into word */
+#define FETCH()                                     \
+    do                                              \
+    {                                               \
+        if (pc >= MEMORY_SIZE)                      \
+        {                                           \
+            status = SIMULATION_ADDRESS_ERROR;      \
+            goto endOfRun;                          \
+        }                                           \
+                                                    \
+        if (0 == stepsLeft)                         \
+        {                                           \
+            status = SIMULATION_OUT_OF_STEPS;       \
+            goto endOfRun;                          \
+        }                                           \
+                                                    \
+        --stepsLeft;                                \
+        instructionAddress = pc;                    \
+        word = memory[pc++];                        \
+    } while (0)
+
+/* Points operand to the value of the operand at the pc and moves the pc
+ * past its words */
+#define FETCH_OPERAND(operand, addressingMethod, registerShift, immediate)        \
+    do                                                                            \
+    {                                                                             \
+        unsigned int operandWord = memory[pc++];                                  \
+                                                                                  \
+        switch (addressingMethod)                                                 \
+        {                                                                         \
+        case IMMEDIATE_ADDRESSING:                                                \
+            immediate = (unsigned short)(SIGN_EXTEND_VALUE(operandWord >> 2) &    \
+                                         MEMORY_WORD_MASK);                       \
+            operand = &immediate;                                                 \
+            break;                                                                \
+                                                                                  \
+        case DIRECT_ADDRESSING:                                                   \
+            operand = memory + (operandWord >> 2);                                \
+            break;                                                                \
+                                                                                  \
+        case FIXED_INDEX_ADDRESSING:                                              \
+        {                                                                         \
+            long address = (long)(operandWord >> 2) +                             \
+                           SIGN_EXTEND_VALUE(memory[pc++] >> 2);                  \
+                                                                                  \
+            if (address < 0 || address >= MEMORY_SIZE)                            \
+            {                                                                     \
+                status = SIMULATION_ADDRESS_ERROR;                                \
+                goto endOfRun;                                                    \
+            }                                                                     \
+                                                                                  \
+            operand = memory + address;                                           \
+            break;                                                                \
+        }                                                                         \
+                                                                                  \
+        default:                                                                  \
+            operand = registers + ((operandWord >> (registerShift)) & REGISTER_MASK); \
+            break;                                                                \
+        }                                                                         \
+    } while (0)
+
+/* Two register operands share one word */
+#define FETCH_SRC_AND_DEST()                                                  \
+    do                                                                        \
+    {                                                                         \
+        if (DIRECT_REGISTER_ADDRESSING == SRC_ADDRESSING_METHOD(word) &&      \
+            DIRECT_REGISTER_ADDRESSING == DEST_ADDRESSING_METHOD(word))       \
+        {                                                                     \
+            unsigned int registersWord = memory[pc++];                        \
+                                                                              \
+            src = registers + ((registersWord >> SRC_REGISTER_SHIFT) & REGISTER_MASK);   \
+            dest = registers + ((registersWord >> DEST_REGISTER_SHIFT) & REGISTER_MASK); \
+        }                                                                     \
+        else                                                                  \
+        {                                                                     \
+            FETCH_OPERAND(src, SRC_ADDRESSING_METHOD(word), SRC_REGISTER_SHIFT, srcImmediate);     \
+            FETCH_OPERAND(dest, DEST_ADDRESSING_METHOD(word), DEST_REGISTER_SHIFT, destImmediate); \
+        }                                                                     \
+    } while (0)
+
+#define FETCH_DEST() \
+    FETCH_OPERAND(dest, DEST_ADDRESSING_METHOD(word), DEST_REGISTER_SHIFT, destImmediate)
+
+    assert(NULL != machine);
+
+    BuildHandlerTable(handlers);
+
+#ifdef COMPUTED_GOTO_DISPATCH
+    DISPATCH();
+#else
+    for (;;)
+    {
+        FETCH();
+
+        switch (handlers[DISPATCH_INDEX(word)])
+        {
+#endif
+
+    HANDLER(MOV_HANDLER):
+        FETCH_SRC_AND_DEST();
+        *dest = *src;
+        DISPATCH();
+
+    HANDLER(CMP_HANDLER):
+        FETCH_SRC_AND_DEST();
+        zeroFlag = (*src == *dest);
+        DISPATCH();
+
+    HANDLER(ADD_HANDLER):
+        FETCH_SRC_AND_DEST();
+        *dest = (*dest + *src) & MEMORY_WORD_MASK;
+        DISPATCH();
+
+    HANDLER(SUB_HANDLER):
+        FETCH_SRC_AND_DEST();
+        *dest = (*dest - *src) & MEMORY_WORD_MASK;
+        DISPATCH();
+
+    HANDLER(NOT_HANDLER):
+        FETCH_DEST();
+        *dest = ~*dest & MEMORY_WORD_MASK;
+        DISPATCH();
+
+    HANDLER(CLR_HANDLER):
+        FETCH_DEST();
+        *dest = 0;
+        DISPATCH();
+
+    HANDLER(LEA_HANDLER):
+        FETCH_SRC_AND_DEST();
+        *dest = (unsigned short)(src - memory);
+        DISPATCH();
+
+    HANDLER(INC_HANDLER):
+        FETCH_DEST();
+        *dest = (*dest + 1) & MEMORY_WORD_MASK;
+        DISPATCH();
+
+    HANDLER(DEC_HANDLER):
+        FETCH_DEST();
+        *dest = (*dest - 1) & MEMORY_WORD_MASK;
+        DISPATCH();
+
+    HANDLER(JMP_HANDLER):
+        FETCH_DEST();
+        pc = GetJumpTarget(machine, word, dest);
+        DISPATCH();
+
+    HANDLER(BNE_HANDLER):
+        FETCH_DEST();
+        if (!zeroFlag)
+        {
+            pc = GetJumpTarget(machine, word, dest);
+        }
+        DISPATCH();
+
+    HANDLER(RED_HANDLER):
+        FETCH_DEST();
+        *dest = (unsigned short)(ReadInputCharacter(machine->input, machine->inputSource) &
+                                 MEMORY_WORD_MASK);
+        DISPATCH();
+
+    HANDLER(PRN_HANDLER):
+        FETCH_DEST();
+        fprintf(machine->output, "%d\n", ToSigned(*dest));
+        DISPATCH();
+
+    HANDLER(JSR_HANDLER):
+        FETCH_DEST();
+        if (RETURN_STACK_SIZE == machine->stackPointer)
+        {
+            status = SIMULATION_STACK_ERROR;
+            goto endOfRun;
+        }
+        machine->returnStack[machine->stackPointer++] = (unsigned short)pc;
+        pc = GetJumpTarget(machine, word, dest);
+        DISPATCH();
+
+    HANDLER(RTS_HANDLER):
+        if (0 == machine->stackPointer)
+        {
+            status = SIMULATION_STACK_ERROR;
+            goto endOfRun;
+        }
+        pc = machine->returnStack[--machine->stackPointer];
+        DISPATCH();
+
+    HANDLER(STOP_HANDLER):
+        status = SIMULATION_STOPPED;
+        goto endOfRun;
+
+    HANDLER(ILLEGAL_HANDLER):
+        status = SIMULATION_ILLEGAL_INSTRUCTION;
+        goto endOfRun;
+
+#ifndef COMPUTED_GOTO_DISPATCH
+        default:
+            status = SIMULATION_ILLEGAL_INSTRUCTION;
+            goto endOfRun;
+        }
+    }
+#endif
+
+#undef HANDLER
+#undef DISPATCH
+#undef FETCH
+#undef FETCH_OPERAND
+#undef FETCH_SRC_AND_DEST
+#undef FETCH_DEST
+
+endOfRun:
+    machine->zeroFlag = zeroFlag;
+    machine->pc = (SIMULATION_OUT_OF_STEPS == status) ? pc : instructionAddress;
+    machine->numOfSteps += ((0 == maxSteps) ? ULONG_MAX : maxSteps) - stepsLeft;
+    ClearMicroOps(machine);
+
+    return status;
+}
+
+/* Returns the MicroOp of the instruction at the address (below
+ * MEMORY_SIZE), decoding it if it was not */
+const MicroOp *GetMicroOp(Machine *machine, unsigned int address)
+{
+    assert(NULL != machine);
+    assert(address < MEMORY_SIZE);
+
+    if (0 == machine->microOps[address].length)
+    {
+        DecodeMicroOp(machine, address);
+    }
+
+    return machine->microOps + address;
+}
+
+/* Drops every decoded instruction. Code that writes the memory of a
+ * Machine outside of RunMachine calls it before the next run. */
+void ClearMicroOps(Machine *machine)
+{
+    assert(NULL != machine);
+
+    memset(machine->microOps, 0, sizeof(machine->microOps));
+    memset(machine->isCode, 0, sizeof(machine->isCode));
+}
+
+const char *GetSimulationStatusName(SimulationStatus status)
+{
+    switch (status)
+    {
+    case SIMULATION_STOPPED:
+        return "stopped";
+    case SIMULATION_OUT_OF_STEPS:
+        return "out of steps";
+    case SIMULATION_ILLEGAL_INSTRUCTION:
+        return "illegal instruction";
+    case SIMULATION_ADDRESS_ERROR:
+        return "address out of memory";
+    case SIMULATION_STACK_ERROR:
+        return "return stack error";
+    default:
+        return "unknown status";
+    }
+}
+
+/* The character red reads: the next one of input or, at the end of input,
+ * the next one of inputSource (when it is not NULL), which is appended to
+ * input. So input holds a copy of what was read from inputSource, taken
+ * only as far as it was read. */
+int ReadInputCharacter(FILE *input, FILE *inputSource)
+{
+    int character = getc(input);
+
+    if (EOF == character && NULL != inputSource &&
+        EOF != (character = getc(inputSource)))
+    {
+        fseek(input, 0, SEEK_END);
+        putc(character, input);
+        fseek(input, 0, SEEK_CUR); /* From writing back to reading */
+    }
+
+    return character;
+}
+
+/* Static functions */
+
+/* Maps every dispatch index to the handler of its operation, or to
+ * ILLEGAL_HANDLER if the addressing methods are not legal for it */
+static void BuildHandlerTable(unsigned char *handlers)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < NUM_OF_DISPATCH_INDEXES; ++i)
+    {
+        unsigned int word = i << 2;
+        const Operation *operation = GetOperation(OPERATION_CODE(word));
+
+        handlers[i] = IsLegalInstruction(operation,
+                                         SRC_ADDRESSING_METHOD(word),
+                                         DEST_ADDRESSING_METHOD(word))
+                          ? MOV_HANDLER + operation->code
+                          : ILLEGAL_HANDLER;
+    }
+}
+
+/* Decodes the instruction at the address into its MicroOp. An operand
+ * index out of memory decodes to ADDRESS_ERROR_HANDLER. */
+static void DecodeMicroOp(Machine *machine, unsigned int address)
+{
+    MicroOp *microOp = machine->microOps + address;
+    unsigned int word = machine->memory[address], next = address + 1;
+    const Operation *operation = GetOperation(OPERATION_CODE(word));
+    unsigned int numOfOperands = operation->numOfOperands;
+    bool isInMemory = TRUE;
+
+    microOp->handler = IsLegalInstruction(operation,
+                                          SRC_ADDRESSING_METHOD(word),
+                                          DEST_ADDRESSING_METHOD(word))
+                           ? MOV_HANDLER + operation->code
+                           : ILLEGAL_HANDLER;
+    microOp->srcSpace = MEMORY_SPACE;
+    microOp->destSpace = MEMORY_SPACE;
+    microOp->src = 0;
+    microOp->dest = 0;
+
+    if (ILLEGAL_HANDLER == microOp->handler)
+    {
+        numOfOperands = 0;
+    }
+
+    /* Two register operands share one word */
+    if (2 == numOfOperands &&
+        DIRECT_REGISTER_ADDRESSING == SRC_ADDRESSING_METHOD(word) &&
+        DIRECT_REGISTER_ADDRESSING == DEST_ADDRESSING_METHOD(word))
+    {
+        unsigned int registersWord = machine->memory[next++];
+
+        microOp->srcSpace = REGISTER_SPACE;
+        microOp->destSpace = REGISTER_SPACE;
+        microOp->src = (unsigned short)((registersWord >> SRC_REGISTER_SHIFT) & REGISTER_MASK);
+        microOp->dest = (unsigned short)((registersWord >> DEST_REGISTER_SHIFT) & REGISTER_MASK);
+    }
+    else
+    {
+        if (2 == numOfOperands)
+        {
+            isInMemory = DecodeOperand(machine,
+                                       &next,
+                                       SRC_ADDRESSING_METHOD(word),
+                                       SRC_REGISTER_SHIFT,
+                                       2 * address,
+                                       &microOp->srcSpace,
+                                       &microOp->src);
+        }
+
+        if (isInMemory && 0 != numOfOperands)
+        {
+            isInMemory = DecodeOperand(machine,
+                                       &next,
+                                       DEST_ADDRESSING_METHOD(word),
+                                       DEST_REGISTER_SHIFT,
+                                       2 * address + 1,
+                                       &microOp->destSpace,
+                                       &microOp->dest);
+        }
+    }
+
+    if (!isInMemory)
+    {
+        microOp->handler = ADDRESS_ERROR_HANDLER;
+    }
+
+    microOp->length = (unsigned char)(next - address);
+
+    for (; address < next && address < MEMORY_SIZE; ++address)
+    {
+        machine->isCode[address] = TRUE;
+    }
+}
+
+/* Resolves the operand whose words start at *address and moves *address
+ * past them. Returns FALSE for an index out of memory. */
+static bool DecodeOperand(Machine *machine,
+                          unsigned int *address,
+                          unsigned int addressingMethod,
+                          unsigned int registerShift,
+                          unsigned int immediateIndex,
+                          unsigned char *space,
+                          unsigned short *offset)
+{
+    unsigned int operandWord = machine->memory[(*address)++];
+    long indexedAddress = 0;
+
+    switch (addressingMethod)
+    {
+    case IMMEDIATE_ADDRESSING:
+        machine->immediates[immediateIndex] =
+            (unsigned short)(SIGN_EXTEND_VALUE(operandWord >> 2) & MEMORY_WORD_MASK);
+        *space = IMMEDIATE_SPACE;
+        *offset = (unsigned short)immediateIndex;
+        break;
+
+    case DIRECT_ADDRESSING:
+        *space = MEMORY_SPACE;
+        *offset = (unsigned short)(operandWord >> 2);
+        break;
+
+    case FIXED_INDEX_ADDRESSING:
+        indexedAddress = (long)(operandWord >> 2) +
+                         SIGN_EXTEND_VALUE(machine->memory[(*address)++] >> 2);
+        if (indexedAddress < 0 || indexedAddress >= MEMORY_SIZE)
+        {
+            return FALSE;
+        }
+
+        *space = MEMORY_SPACE;
+        *offset = (unsigned short)indexedAddress;
+        break;
+
+    default:
+        *space = REGISTER_SPACE;
+        *offset = (unsigned short)((operandWord >> registerShift) & REGISTER_MASK);
+        break;
+    }
+
+    return TRUE;
+}
+
+/* Drops the MicroOps that read the word at the address */
+static void InvalidateMicroOps(Machine *machine, unsigned int address)
+{
+    unsigned int start = (address >= MAX_INSTRUCTION_LENGTH - 1)
+                             ? address - (MAX_INSTRUCTION_LENGTH - 1)
+                             : 0;
+
+    for (; start <= address; ++start)
+    {
+        if (machine->microOps[start].length > address - start)
+        {
+            machine->microOps[start].handler = DECODE_HANDLER;
+            machine->microOps[start].length = 0;
+        }
+    }
+
+    machine->isCode[address] = FALSE;
+}
+
+/* A jump to a label goes to its address, a jump to a register goes to
+ * the address the register holds */
+static unsigned int GetJumpTarget(const Machine *machine,
+                                  unsigned int word,
+                                  const unsigned short *dest)
+{
+    return (DIRECT_REGISTER_ADDRESSING == DEST_ADDRESSING_METHOD(word))
+               ? *dest
+               : (unsigned int)(dest - machine->memory);
+}
+
+static int ToSigned(unsigned int word)
+{
+    return (int)((word ^ WORD_SIGN_BIT) & MEMORY_WORD_MASK) - WORD_SIGN_BIT;
+}
+
+static bool ParseAddress(Span str, unsigned long *address)
+{
+    size_t i = 0;
+
+    if (0 == str.length || str.length > 9)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < str.length; ++i)
+    {
+        if (str.start[i] < ZERO_DIGIT || str.start[i] > NINE_DIGIT)
+        {
+            return FALSE;
+        }
+    }
+
+    *address = (unsigned long)GetNumber(str);
+
+    return TRUE;
+}
+
+/* Decodes the words of the batch into memory and empties it. Returns
+ * the number of words stored. */
+static unsigned long StoreWordBatch(Machine *machine,
+                                    EncodedWordBatch *batch,
+                                    Diagnostics *diagnostics)
+{
+    unsigned short words[WORD_BATCH_SIZE];
+    WordCodec codec = GetWordCodec();
+    size_t i = 0, numOfDecoded = 0;
+    unsigned long numOfStored = 0;
+
+    while (i < batch->numOfWords)
+    {
+        numOfDecoded = DecodeWords(codec,
+                                   words + i,
+                                   batch->encodings + i * ENCODED_WORD_STRIDE,
+                                   batch->numOfWords - i);
+
+        for (; numOfDecoded > 0; --numOfDecoded, ++i, ++numOfStored)
+        {
+            machine->memory[batch->addresses[i]] = words[i];
+        }
+
+        if (i < batch->numOfWords)
+        {
+            ReportError(diagnostics, "Line %d:\tError: bad memory word\n", batch->lineNumbers[i]);
+            ++i;
+        }
+    }
+
+    batch->numOfWords = 0;
+
+    return numOfStored;
+}
@@ -0,0 +1,626 @@
+/****************************************
+* ASSEMBLER: simulator_batch.c          *
+****************************************/
+
+#include <stdio.h>  /* FILE, fprintf, fopen, fclose, fread, tmpfile, ftell, rewind */
+#include <errno.h>  /* errno */
+#include <string.h> /* strerror, strlen, strcpy, strcat, strcmp, memcpy, memcmp */
+#include <stdlib.h> /* calloc, free, qsort */
+#include <time.h>   /* clock_gettime, CLOCK_MONOTONIC */
+#include <assert.h> /* assert */
+
+#include "simulator_batch.h"   /* API */
+#include "assembler.h"         /* AssembleSource */
+#include "source_reader.h"     /* API */
+#include "sentence_analyzer.h" /* GetNextToken, TrimWhiteSpaces */
+#include "thread_pool.h"       /* API */
+#include "diagnostics.h"       /* API */
+#include "memory_word.h"       /* MEMORY_WORD_MASK */
+#include "assembler_utils.h"   /* Utils file */
+
+/* The 32 bit FNV-1a hash of the output (see OUTPUT_HASH_BASIS) */
+#define FNV_PRIME (16777619UL)
+#define HASH_MASK (0xFFFFFFFFUL)
+
+#define OUTPUT_BUFFER_SIZE (4096)
+
+#define NANOSECONDS_PER_SECOND (1e9)
+#define MILLISECONDS_PER_SECOND (1e3)
+
+static const char *ASSEMBLY_FILE_POSTFIX = ".as";
+static const char *OBJECT_FILE_POSTFIX = ".ob";
+static const char *BINARY_OBJECT_FILE_POSTFIX = ".bin";
+static const char *READING_MODE = "r";
+static const char *LOAD_ERROR_NAME = "unloaded";
+
+/* The status of a results line, a word each (see SimulationStatus) */
+static const char *const STATUS_NAMES[] = {"stopped", "steps", "illegal", "address", "stack"};
+
+/* The percentiles of the latency report */
+static const double LATENCY_PERCENTILES[] = {0.5, 0.9, 0.99, 0.999};
+static const char *const LATENCY_PERCENTILE_NAMES[] = {"p50", "p90", "p99", "p99.9"};
+
+typedef struct
+{
+    char program[MAX_FILENAME_SIZE];
+    char input[MAX_FILENAME_SIZE]; /* Empty when red reads nothing */
+    const BatchOptions *options;
+    FILE *emptyInput;
+    SimulationResult result;
+    double seconds; /* From loading the program to hashing its output */
+    Diagnostics diagnostics;
+} BatchJob;
+
+static long ReadManifest(SourceReader *manifest, BatchJob *jobs, Diagnostics *diagnostics);
+static bool CopyField(Span field, char *destination);
+static void RunBatchJob(void *argument);
+static void SimulateProgram(BatchJob *job, Machine *machine);
+static ReturnStatus LoadProgram(BatchJob *job, Machine *machine);
+static ReturnStatus AssembleProgram(BatchJob *job, Machine *machine, FILE *assemblyFile);
+static bool HasPostfix(const char *filename, const char *postfix);
+static void ReportStatistics(FILE *statistics,
+                             const BatchJob *jobs,
+                             long numOfJobs,
+                             int numOfThreads,
+                             double seconds);
+static int CompareSeconds(const void *first, const void *second);
+static double GetSeconds(void);
+
+/* The manifest is read twice, to count the programs and then to fill in
+ * their jobs. The diagnostics of every program are collected separately
+ * and printed in the order of the manifest. */
+bool RunBatch(const char *manifestFilename,
+              FILE *results,
+              FILE *statistics,
+              const BatchOptions *options)
+{
+    SourceReader manifest;
+    FILE *manifestFile = NULL, *emptyInput = NULL;
+    BatchJob *jobs = NULL;
+    ThreadPool *threadPool = NULL;
+    Diagnostics diagnostics = {0};
+    long numOfJobs = 0, i = 0;
+    int numOfThreads = 0;
+    double startTime = 0;
+    bool haveAllStopped = TRUE;
+
+    assert(NULL != manifestFilename);
+    assert(NULL != results);
+    assert(NULL != statistics);
+    assert(NULL != options);
+    assert(NULL != options->run);
+
+    diagnostics.stream = stderr;
+
+    manifestFile = fopen(manifestFilename, READING_MODE);
+    if (NULL == manifestFile)
+    {
+        fprintf(stderr, "Error opening file \"%s\": %s\n", manifestFilename, strerror(errno));
+        return FALSE;
+    }
+
+    if (SUCCESS != OpenSourceReader(&manifest, manifestFile))
+    {
+        fprintf(stderr, "Error reading file \"%s\"\n", manifestFilename);
+        CloseSourceReader(&manifest);
+        fclose(manifestFile);
+        return FALSE;
+    }
+
+    numOfJobs = ReadManifest(&manifest, NULL, &diagnostics);
+    if (numOfJobs > 0)
+    {
+        jobs = (BatchJob *)calloc(numOfJobs, sizeof(BatchJob));
+    }
+
+    if (NULL != jobs)
+    {
+        RewindSourceReader(&manifest);
+        ReadManifest(&manifest, jobs, &diagnostics);
+    }
+
+    CloseSourceReader(&manifest);
+    fclose(manifestFile);
+
+    if (numOfJobs <= 0)
+    {
+        if (0 == numOfJobs)
+        {
+            fprintf(stderr, "%s: no programs\n", manifestFilename);
+        }
+        return FALSE;
+    }
+
+    numOfThreads = (0 == options->numOfThreads) ? GetNumOfProcessors() : options->numOfThreads;
+    if (numOfThreads > numOfJobs)
+    {
+        numOfThreads = (int)numOfJobs;
+    }
+
+    emptyInput = tmpfile();
+    threadPool = (NULL == jobs) ? NULL : CreateThreadPool(numOfThreads);
+    if (NULL == threadPool || NULL == emptyInput)
+    {
+        fprintf(stderr, "Memory allocation error\n");
+        if (NULL != threadPool)
+        {
+            DestroyThreadPool(threadPool);
+        }
+        if (NULL != emptyInput)
+        {
+            fclose(emptyInput);
+        }
+        free(jobs);
+        return FALSE;
+    }
+
+    startTime = GetSeconds();
+
+    for (i = 0; i < numOfJobs; ++i)
+    {
+        jobs[i].options = options;
+        jobs[i].emptyInput = emptyInput;
+
+        if (SUCCESS != SubmitTask(threadPool, RunBatchJob, jobs + i))
+        {
+            RunBatchJob(jobs + i);
+        }
+    }
+
+    WaitForTasks(threadPool);
+
+    ReportStatistics(statistics, jobs, numOfJobs, numOfThreads, GetSeconds() - startTime);
+
+    DestroyThreadPool(threadPool);
+    fclose(emptyInput);
+
+    WriteResultsHeader(results);
+
+    for (i = 0; i < numOfJobs; ++i)
+    {
+        WriteSimulationResult(results, jobs[i].program, &jobs[i].result);
+        AppendDiagnostics(&diagnostics, &jobs[i].diagnostics);
+        DestroyDiagnostics(&jobs[i].diagnostics);
+
+        if (!jobs[i].result.hasRun || SIMULATION_STOPPED != jobs[i].result.status)
+        {
+            haveAllStopped = FALSE;
+        }
+    }
+
+    free(jobs);
+
+    return haveAllStopped;
+}
+
+void GetSimulationResult(const Machine *machine,
+                         SimulationStatus status,
+                         SimulationResult *result)
+{
+    assert(NULL != machine);
+    assert(NULL != result);
+
+    result->hasRun = TRUE;
+    result->status = status;
+    result->pc = machine->pc;
+    result->numOfSteps = machine->numOfSteps;
+    result->zeroFlag = machine->zeroFlag;
+    memcpy(result->registers, machine->registers, sizeof(result->registers));
+    result->outputHash = OUTPUT_HASH_BASIS;
+    result->outputSize = 0;
+}
+
+bool IsSameSimulationResult(const SimulationResult *first, const SimulationResult *second)
+{
+    assert(NULL != first);
+    assert(NULL != second);
+
+    if (!first->hasRun || !second->hasRun)
+    {
+        return (first->hasRun == second->hasRun);
+    }
+
+    return (first->status == second->status &&
+            first->pc == second->pc &&
+            first->numOfSteps == second->numOfSteps &&
+            first->zeroFlag == second->zeroFlag &&
+            0 == memcmp(first->registers, second->registers, sizeof(first->registers)) &&
+            first->outputHash == second->outputHash &&
+            first->outputSize == second->outputSize);
+}
+
+unsigned long HashOutput(unsigned long hash, const char *output, size_t length)
+{
+    size_t i = 0;
+
+    assert(NULL != output || 0 == length);
+
+    for (i = 0; i < length; ++i)
+    {
+        hash = ((hash ^ (unsigned char)output[i]) * FNV_PRIME) & HASH_MASK;
+    }
+
+    return hash;
+}
+
+/* Adds what was written to the hash and the size of the output */
+void HashOutputStream(FILE *stream, SimulationResult *result)
+{
+    char buffer[OUTPUT_BUFFER_SIZE];
+    long length = 0;
+    size_t numOfBytes = 0;
+
+    assert(NULL != stream);
+    assert(NULL != result);
+
+    length = ftell(stream);
+    rewind(stream);
+
+    while (length > 0 &&
+           0 != (numOfBytes = fread(buffer,
+                                    1,
+                                    (length < OUTPUT_BUFFER_SIZE) ? (size_t)length : OUTPUT_BUFFER_SIZE,
+                                    stream)))
+    {
+        result->outputHash = HashOutput(result->outputHash, buffer, numOfBytes);
+        result->outputSize += numOfBytes;
+        length -= (long)numOfBytes;
+    }
+}
+
+void WriteResultsHeader(FILE *results)
+{
+    assert(NULL != results);
+
+    fprintf(results, "# program status pc steps zero_flag r0 r1 r2 r3 r4 r5 r6 r7 output_hash output_size\n");
+}
+
+void WriteSimulationResult(FILE *results, const char *name, const SimulationResult *result)
+{
+    int i = 0;
+
+    assert(NULL != results);
+    assert(NULL != name);
+    assert(NULL != result);
+
+    if (!result->hasRun)
+    {
+        fprintf(results, "%s %s\n", name, LOAD_ERROR_NAME);
+        return;
+    }
+
+    fprintf(results, "%s %s %04u %lu %d",
+            name,
+            STATUS_NAMES[result->status],
+            result->pc,
+            result->numOfSteps,
+            result->zeroFlag);
+
+    for (i = 0; i < NUM_OF_REGISTERS; ++i)
+    {
+        fprintf(results, " %u", result->registers[i]);
+    }
+
+    fprintf(results, " %08lx %lu\n", result->outputHash, result->outputSize);
+}
+
+/* Static functions */
+
+/* Fills in the program and the input of a job per line (when jobs is not
+ * NULL). Returns the number of programs, or -1 for a bad line. */
+static long ReadManifest(SourceReader *manifest, BatchJob *jobs, Diagnostics *diagnostics)
+{
+    Span line = {0}, field = {0};
+    long numOfJobs = 0;
+    int lineNumber = 0;
+
+    while (ReadSentence(manifest, &line))
+    {
+        ++lineNumber;
+
+        TrimWhiteSpaces(&line);
+        if (0 == line.length || HASH_MARK == line.start[0])
+        {
+            continue;
+        }
+
+        GetNextToken(&line, ' ', &field);
+        if (!CopyField(field, (NULL == jobs) ? NULL : jobs[numOfJobs].program))
+        {
+            ReportError(diagnostics, "Line %d:\tError: bad program name\n", lineNumber);
+            return -1;
+        }
+
+        if (GetNextToken(&line, ' ', &field) &&
+            !CopyField(field, (NULL == jobs) ? NULL : jobs[numOfJobs].input))
+        {
+            ReportError(diagnostics, "Line %d:\tError: bad input file name\n", lineNumber);
+            return -1;
+        }
+
+        if (NULL != line.start && 0 != line.length)
+        {
+            ReportError(diagnostics, "Line %d:\tError: extraneous text after the input file\n",
+                        lineNumber);
+            return -1;
+        }
+
+        ++numOfJobs;
+    }
+
+    return numOfJobs;
+}
+
+/* Leaves room for the postfix of an object file */
+static bool CopyField(Span field, char *destination)
+{
+    if (0 == field.length || field.length + strlen(BINARY_OBJECT_FILE_POSTFIX) >= MAX_FILENAME_SIZE)
+    {
+        return FALSE;
+    }
+
+    if (NULL != destination)
+    {
+        memcpy(destination, field.start, field.length);
+        destination[field.length] = END_LINE;
+    }
+
+    return TRUE;
+}
+
+static void RunBatchJob(void *argument)
+{
+    BatchJob *job = (BatchJob *)argument;
+    Machine *machine = NULL;
+    double startTime = GetSeconds();
+
+    machine = (Machine *)calloc(1, sizeof(Machine));
+    if (NULL == machine)
+    {
+        ReportError(&job->diagnostics, "%s: memory allocation error\n", job->program);
+    }
+    else
+    {
+        SimulateProgram(job, machine);
+        free(machine);
+    }
+
+    job->seconds = GetSeconds() - startTime;
+}
+
+static void SimulateProgram(BatchJob *job, Machine *machine)
+{
+    FILE *input = job->emptyInput, *output = NULL;
+
+    if (END_LINE != job->input[0])
+    {
+        input = fopen(job->input, READING_MODE);
+        if (NULL == input)
+        {
+            ReportError(&job->diagnostics,
+                        "Error opening file \"%s\": %s\n",
+                        job->input,
+                        strerror(errno));
+            return;
+        }
+    }
+
+    output = tmpfile();
+    if (NULL == output)
+    {
+        ReportError(&job->diagnostics, "Error creating a temporary file: %s\n", strerror(errno));
+    }
+    else if (SUCCESS == LoadProgram(job, machine))
+    {
+        machine->input = input;
+        machine->output = output;
+
+        GetSimulationResult(machine,
+                            job->options->run(machine, job->options->maxSteps),
+                            &job->result);
+        HashOutputStream(output, &job->result);
+    }
+
+    if (NULL != output)
+    {
+        fclose(output);
+    }
+
+    if (input != job->emptyInput)
+    {
+        fclose(input);
+    }
+}
+
+/* program.as is assembled, program.ob and program.bin are loaded, and any
+ * other program gets the postfix of -b */
+static ReturnStatus LoadProgram(BatchJob *job, Machine *machine)
+{
+    char filename[MAX_FILENAME_SIZE] = {0};
+    bool isAssembly = HasPostfix(job->program, ASSEMBLY_FILE_POSTFIX);
+    bool isBinaryObject = HasPostfix(job->program, BINARY_OBJECT_FILE_POSTFIX);
+    FILE *file = NULL;
+    ReturnStatus status = SUCCESS;
+
+    strcpy(filename, job->program);
+    if (!isAssembly && !isBinaryObject && !HasPostfix(filename, OBJECT_FILE_POSTFIX))
+    {
+        isBinaryObject = job->options->isBinaryObject;
+        strcat(filename, isBinaryObject ? BINARY_OBJECT_FILE_POSTFIX : OBJECT_FILE_POSTFIX);
+    }
+
+    file = fopen(filename, READING_MODE);
+    if (NULL == file)
+    {
+        ReportError(&job->diagnostics,
+                    "Error opening file \"%s\": %s\n",
+                    filename,
+                    strerror(errno));
+        return FAILURE;
+    }
+
+    if (isAssembly)
+    {
+        status = AssembleProgram(job, machine, file);
+    }
+    else if (isBinaryObject)
+    {
+        status = LoadBinaryObjectFile(machine, file, &job->diagnostics);
+    }
+    else
+    {
+        status = LoadObjectFile(machine, file, &job->diagnostics);
+    }
+
+    fclose(file);
+
+    return status;
+}
+
+/* The words are loaded as LoadObjectFile loads the .ob of the assembly */
+static ReturnStatus AssembleProgram(BatchJob *job, Machine *machine, FILE *assemblyFile)
+{
+    SourceReader sourceReader;
+    AssemblyResult result;
+    Diagnostics assemblyDiagnostics = {0};
+    size_t i = 0, numOfWords = 0;
+
+    if (SUCCESS != OpenSourceReader(&sourceReader, assemblyFile))
+    {
+        ReportError(&job->diagnostics, "Error reading file \"%s\"\n", job->program);
+        CloseSourceReader(&sourceReader);
+        return FAILURE;
+    }
+
+    AssembleSource(sourceReader.data, sourceReader.size, &result);
+    CloseSourceReader(&sourceReader);
+
+    if (NULL != result.diagnostics && END_LINE != result.diagnostics[0])
+    {
+        ReportWarning(&job->diagnostics, "%s:\n", job->program);
+        assemblyDiagnostics.buffer = result.diagnostics;
+        assemblyDiagnostics.length = strlen(result.diagnostics);
+        AppendDiagnostics(&job->diagnostics, &assemblyDiagnostics);
+    }
+
+    numOfWords = result.numOfCodeWords + result.numOfDataWords;
+    if (result.hasErrors ||
+        0 == result.numOfCodeWords ||
+        numOfWords > MEMORY_SIZE - STARTING_ADDRESS)
+    {
+        ReportError(&job->diagnostics, "%s: the program was not assembled\n", job->program);
+        DestroyAssemblyResult(&result);
+        return FAILURE;
+    }
+
+    for (i = 0; i < numOfWords; ++i)
+    {
+        machine->memory[STARTING_ADDRESS + i] = (unsigned short)(result.words[i] & MEMORY_WORD_MASK);
+    }
+
+    ClearMicroOps(machine);
+    machine->pc = STARTING_ADDRESS;
+    machine->numOfCodeWords = (unsigned int)result.numOfCodeWords;
+    machine->numOfDataWords = (unsigned int)result.numOfDataWords;
+    DestroyAssemblyResult(&result);
+
+    return SUCCESS;
+}
+
+static bool HasPostfix(const char *filename, const char *postfix)
+{
+    size_t filenameLength = strlen(filename), postfixLength = strlen(postfix);
+
+    return (filenameLength > postfixLength &&
+            0 == strcmp(filename + filenameLength - postfixLength, postfix));
+}
+
+/* The latency of a program is the wall time of its job, so it includes
+ * loading or assembling it */
+static void ReportStatistics(FILE *statistics,
+                             const BatchJob *jobs,
+                             long numOfJobs,
+                             int numOfThreads,
+                             double seconds)
+{
+    double *latencies = NULL;
+    unsigned long numOfSteps = 0, numOfStopped = 0;
+    const BatchJob *slowestJob = jobs;
+    long i = 0;
+    size_t j = 0;
+
+    for (i = 0; i < numOfJobs; ++i)
+    {
+        numOfSteps += jobs[i].result.numOfSteps;
+        if (jobs[i].result.hasRun && SIMULATION_STOPPED == jobs[i].result.status)
+        {
+            ++numOfStopped;
+        }
+
+        if (jobs[i].seconds > slowestJob->seconds)
+        {
+            slowestJob = jobs + i;
+        }
+    }
+
+    fprintf(statistics,
+            "%ld programs (%lu stopped) in %.3f s on %d threads: %.0f programs per second, "
+            "%.1f million steps per second\n",
+            numOfJobs,
+            numOfStopped,
+            seconds,
+            numOfThreads,
+            (seconds > 0) ? numOfJobs / seconds : 0.0,
+            (seconds > 0) ? numOfSteps / seconds / 1e6 : 0.0);
+
+    latencies = (double *)calloc(numOfJobs, sizeof(double));
+    if (NULL == latencies)
+    {
+        return;
+    }
+
+    for (i = 0; i < numOfJobs; ++i)
+    {
+        latencies[i] = jobs[i].seconds;
+    }
+
+    qsort(latencies, numOfJobs, sizeof(double), CompareSeconds);
+
+    /* The nearest rank: the smallest latency of at least that part of the programs */
+    fprintf(statistics, "latency:");
+    for (j = 0; j < sizeof(LATENCY_PERCENTILES) / sizeof(LATENCY_PERCENTILES[0]); ++j)
+    {
+        long rank = (long)(LATENCY_PERCENTILES[j] * numOfJobs);
+
+        if (rank < LATENCY_PERCENTILES[j] * numOfJobs)
+        {
+            ++rank;
+        }
+
+        fprintf(statistics, " %s %.3f ms,",
+                LATENCY_PERCENTILE_NAMES[j],
+                latencies[(rank > 0) ? rank - 1 : 0] * MILLISECONDS_PER_SECOND);
+    }
+
+    fprintf(statistics, " max %.3f ms (%s)\n",
+            slowestJob->seconds * MILLISECONDS_PER_SECOND,
+            slowestJob->program);
+
+    free(latencies);
+}
+
+static int CompareSeconds(const void *first, const void *second)
+{
+    double firstSeconds = *(const double *)first, secondSeconds = *(const double *)second;
+
+    return (firstSeconds > secondSeconds) - (firstSeconds < secondSeconds);
+}
+
+static double GetSeconds(void)
+{
+    struct timespec time = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / NANOSECONDS_PER_SECOND;
+}
@@ -0,0 +1,918 @@
+/****************************************
+* ASSEMBLER: simulator_jit.c            *
+****************************************/
+
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memset, memcpy */
+#include <stddef.h> /* offsetof, size_t */
+#include <limits.h> /* ULONG_MAX */
+#include <assert.h> /* assert */
+
+#include "simulator_jit.h" /* API */
+#include "memory_word.h"   /* MEMORY_WORD_MASK */
+
+/* The code is generated for the System V ABI of x86-64 and mapped with
+ * mmap, writable or executable but never both (mprotect). Anywhere else
+ * CreateJit returns NULL. */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__unix__) && !defined(SIMULATOR_NO_JIT)
+#define JIT_SUPPORTED
+#endif
+
+#ifdef JIT_SUPPORTED
+
+#include <sys/mman.h> /* mmap, mprotect, munmap */
+#include <fcntl.h>    /* open, O_RDWR */
+#include <unistd.h>   /* close */
+
+#define JIT_CODE_SIZE (4 * 1024 * 1024)
+#define MAX_BLOCK_LENGTH (64) /* Instructions */
+/* Bounds of the host code of an instruction (with its exits) and of a
+ * block (with its step check and its last exit) */
+#define MAX_INSTRUCTION_CODE_SIZE (192)
+#define MAX_BLOCK_CODE_SIZE (MAX_BLOCK_LENGTH * MAX_INSTRUCTION_CODE_SIZE + 128)
+/* Jumps to blocks not compiled yet, patched when the blocks are */
+#define MAX_CHAIN_SITES (16 * 1024)
+/* Writes to compiled code in one run before the rest of it is interpreted */
+#define MAX_JIT_FLUSHES (64)
+
+/* x86-64 encodings */
+#define REX (0x40)
+#define REX_W (0x08)
+#define REX_R (0x04)
+#define REX_B (0x01)
+#define MOD_RM(mod, reg, rm) (((mod) << 6) | (((reg) & 7) << 3) | ((rm) & 7))
+#define JB_SHORT (0x72)
+#define JAE_SHORT (0x73)
+#define JE_SHORT (0x74)
+#define JNE_SHORT (0x75)
+#define JMP_NEAR (0xE9)
+
+typedef enum
+{
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+} HostRegister;
+
+/* While a block runs: RDI points to the Machine (memory is at offset 0),
+ * RSI to the entries of the blocks, R10 holds the steps left, R11 the
+ * zero flag, and RAX, RCX and RDX are scratch */
+static const HostRegister MACHINE_REGISTERS[NUM_OF_REGISTERS] = {
+    RBX, RBP, R12, R13, R14, R15, R8, R9};
+
+/* Why a block returned to RunMachineJit. The pc of the Machine is the
+ * address to go on from. */
+typedef enum
+{
+    BLOCK_END_EXIT,  /* A jump to a block not compiled yet */
+    INTERPRET_EXIT,  /* The instruction at the pc runs in the interpreter */
+    CODE_WRITE_EXIT, /* A word of compiled code was written */
+    STEPS_EXIT       /* Fewer steps left than the block has instructions */
+} JitExit;
+
+/* What the entry routine reads and the exit routine writes back */
+typedef struct
+{
+    unsigned long stepsLeft;
+    unsigned char **entries;
+} JitState;
+
+typedef int (*EnterFunction)(Machine *machine, const unsigned char *block, JitState *state);
+
+typedef struct
+{
+    size_t offset; /* Of the rel32 of the jump */
+    unsigned int target;
+} ChainSite;
+
+struct jit
+{
+    unsigned char *code; /* Writable while compiling, executable while running */
+    bool isWritable;
+    size_t codeSize;
+    size_t blocksOffset; /* After the entry and exit routines */
+    size_t exitOffset;
+    unsigned char *entries[MEMORY_SIZE]; /* The block that starts at each address */
+    ChainSite chainSites[MAX_CHAIN_SITES];
+    size_t numOfChainSites;
+};
+
+static void EmitEntryRoutine(Jit *jit);
+static void EmitExitRoutine(Jit *jit);
+static unsigned char *CompileBlock(Jit *jit, Machine *machine, unsigned int address);
+static void EmitInstruction(Jit *jit,
+                            const Machine *machine,
+                            const MicroOp *microOp,
+                            unsigned int address,
+                            unsigned int numOfUncounted);
+static void EmitLoadOperand(Jit *jit,
+                            const Machine *machine,
+                            HostRegister target,
+                            unsigned int space,
+                            unsigned int offset);
+static void EmitStore(Jit *jit,
+                      const MicroOp *microOp,
+                      unsigned int nextAddress,
+                      unsigned int numOfUncounted);
+static void EmitJump(Jit *jit,
+                     const MicroOp *microOp,
+                     unsigned int address,
+                     unsigned int numOfUncounted);
+static void EmitChain(Jit *jit, unsigned int target);
+static void EmitIndirectJump(Jit *jit);
+static void EmitExit(Jit *jit, JitExit exit, unsigned int pc, unsigned int numOfUncounted);
+static void EmitExitUnless(Jit *jit,
+                           unsigned int skipOpcode,
+                           JitExit exit,
+                           unsigned int pc,
+                           unsigned int numOfUncounted);
+static void EmitRegisterInstruction(Jit *jit,
+                                    unsigned int opcode,
+                                    HostRegister rm,
+                                    HostRegister reg);
+static void EmitMachineAccess(Jit *jit,
+                              unsigned int prefix,
+                              unsigned int opcode,
+                              unsigned int reg,
+                              size_t offset);
+static void EmitMoveImmediate(Jit *jit, HostRegister reg, unsigned long value);
+static void EmitRex(Jit *jit, unsigned int flags, unsigned int reg, unsigned int rm);
+static void EmitByte(Jit *jit, unsigned int byte);
+static void Emit32(Jit *jit, unsigned long value);
+static void Patch32(Jit *jit, size_t offset, unsigned long value);
+static void FlushJit(Jit *jit);
+static bool ProtectJit(Jit *jit, bool isWritable);
+static bool IsStoreToCode(Machine *machine, unsigned int address);
+static SimulationStatus InterpretSteps(Machine *machine,
+                                       JitState *state,
+                                       unsigned long maxSteps);
+
+Jit *CreateJit(void)
+{
+    Jit *jit = NULL;
+    int zeroFile = -1;
+
+    /* The exit routine stores the zero flag as a 32-bit number */
+    if (sizeof(bool) != 4)
+    {
+        return NULL;
+    }
+
+    jit = (Jit *)malloc(sizeof(Jit));
+    if (NULL == jit)
+    {
+        return NULL;
+    }
+
+    /* /dev/zero rather than MAP_ANONYMOUS, which POSIX does not have */
+    zeroFile = open("/dev/zero", O_RDWR);
+    if (zeroFile < 0)
+    {
+        free(jit);
+        return NULL;
+    }
+
+    jit->code = (unsigned char *)mmap(NULL,
+                                      JIT_CODE_SIZE,
+                                      PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE,
+                                      zeroFile,
+                                      0);
+    close(zeroFile);
+
+    if (MAP_FAILED == (void *)jit->code)
+    {
+        free(jit);
+        return NULL;
+    }
+
+    jit->isWritable = TRUE;
+    jit->codeSize = 0;
+    EmitEntryRoutine(jit);
+    jit->exitOffset = jit->codeSize;
+    EmitExitRoutine(jit);
+    jit->blocksOffset = jit->codeSize;
+
+    FlushJit(jit);
+
+    if (!ProtectJit(jit, FALSE))
+    {
+        DestroyJit(jit);
+        return NULL;
+    }
+
+    return jit;
+}
+
+/* Runs as RunMachine does (the same statuses, pc, steps and output). The
+ * blocks are compiled the first time they run and jump to each other
+ * directly. The instructions that stop or fail a run, red and prn run in
+ * the interpreter, one step at a time. A write to compiled code drops
+ * every block; after MAX_JIT_FLUSHES of them (or when the protection
+ * of the code cannot be changed) the rest of the run is interpreted. The
+ * blocks live for one call. */
+SimulationStatus RunMachineJit(Jit *jit, Machine *machine, unsigned long maxSteps)
+{
+    JitState state;
+    EnterFunction enter = NULL;
+    unsigned long numOfSteps = (0 == maxSteps) ? ULONG_MAX : maxSteps;
+    SimulationStatus status = SIMULATION_STOPPED;
+    int numOfFlushes = 0;
+    bool isRunning = TRUE, isStoreToCode = FALSE;
+
+    assert(NULL != machine);
+
+    if (NULL == jit)
+    {
+        return RunMachine(machine, maxSteps);
+    }
+
+    state.stepsLeft = numOfSteps;
+    state.entries = jit->entries;
+    memcpy(&enter, &jit->code, sizeof(enter));
+
+    FlushJit(jit);
+
+    while (isRunning)
+    {
+        unsigned int pc = machine->pc;
+        unsigned char *block = NULL;
+
+        if (pc >= MEMORY_SIZE || numOfFlushes > MAX_JIT_FLUSHES)
+        {
+            status = InterpretSteps(machine, &state, state.stepsLeft);
+            break;
+        }
+
+        block = jit->entries[pc];
+        if (NULL == block && ProtectJit(jit, TRUE))
+        {
+            block = CompileBlock(jit, machine, pc);
+            if (NULL == block)
+            {
+                FlushJit(jit);
+                block = CompileBlock(jit, machine, pc);
+            }
+        }
+
+        if (NULL == block || !ProtectJit(jit, FALSE))
+        {
+            status = InterpretSteps(machine, &state, state.stepsLeft);
+            break;
+        }
+
+        switch ((JitExit)enter(machine, block, &state))
+        {
+        case BLOCK_END_EXIT:
+            break;
+
+        case INTERPRET_EXIT:
+            if (0 == state.stepsLeft)
+            {
+                status = SIMULATION_OUT_OF_STEPS;
+                isRunning = FALSE;
+                break;
+            }
+
+            pc = machine->pc;
+            isStoreToCode = IsStoreToCode(machine, pc);
+            status = InterpretSteps(machine, &state, 1);
+            if (SIMULATION_OUT_OF_STEPS != status)
+            {
+                isRunning = FALSE;
+            }
+            else if (machine->pc >= MEMORY_SIZE)
+            {
+                /* The interpreter fails the fetch after the instruction */
+                status = SIMULATION_ADDRESS_ERROR;
+                machine->pc = pc;
+                isRunning = FALSE;
+            }
+            else if (isStoreToCode)
+            {
+                FlushJit(jit);
+            }
+            break;
+
+        case CODE_WRITE_EXIT:
+            FlushJit(jit);
+            ClearMicroOps(machine);
+            ++numOfFlushes;
+            break;
+
+        default: /* STEPS_EXIT */
+            status = InterpretSteps(machine, &state, state.stepsLeft);
+            isRunning = FALSE;
+            break;
+        }
+    }
+
+    machine->numOfSteps += numOfSteps - state.stepsLeft;
+
+    return status;
+}
+
+void DestroyJit(Jit *jit)
+{
+    if (NULL != jit)
+    {
+        munmap(jit->code, JIT_CODE_SIZE);
+        free(jit);
+    }
+}
+
+/* Static functions */
+
+/* int enter(Machine *machine, const unsigned char *block, JitState *state):
+ * saves the registers the ABI keeps, loads the state and jumps to the
+ * block */
+static void EmitEntryRoutine(Jit *jit)
+{
+    int i = 0;
+
+    EmitByte(jit, 0x53);                    /* push rbx */
+    EmitByte(jit, 0x55);                    /* push rbp */
+    EmitByte(jit, REX | REX_B);             /* push r12-r15 */
+    EmitByte(jit, 0x54);
+    EmitByte(jit, REX | REX_B);
+    EmitByte(jit, 0x55);
+    EmitByte(jit, REX | REX_B);
+    EmitByte(jit, 0x56);
+    EmitByte(jit, REX | REX_B);
+    EmitByte(jit, 0x57);
+    EmitByte(jit, 0x52);                    /* push rdx (the state) */
+
+    EmitByte(jit, REX | REX_W | REX_R);     /* mov r10, [rdx] */
+    EmitByte(jit, 0x8B);
+    EmitByte(jit, MOD_RM(0, R10, RDX));
+    EmitByte(jit, REX | REX_W);             /* mov rax, rsi (the block) */
+    EmitByte(jit, 0x89);
+    EmitByte(jit, MOD_RM(3, RSI, RAX));
+    EmitByte(jit, REX | REX_W);             /* mov rsi, [rdx + 8] */
+    EmitByte(jit, 0x8B);
+    EmitByte(jit, MOD_RM(1, RSI, RDX));
+    EmitByte(jit, offsetof(JitState, entries));
+
+    for (i = 0; i < NUM_OF_REGISTERS; ++i)
+    {
+        EmitMachineAccess(jit, 0, 0x0FB7, MACHINE_REGISTERS[i],
+                          offsetof(Machine, registers) + i * sizeof(unsigned short));
+    }
+
+    EmitMachineAccess(jit, 0, 0x8B, R11, offsetof(Machine, zeroFlag));
+
+    EmitByte(jit, 0xFF);                    /* jmp rax */
+    EmitByte(jit, MOD_RM(3, 4, RAX));
+}
+
+/* Jumped to with the pc in EAX and the JitExit in EDX: writes the state
+ * back and returns the JitExit */
+static void EmitExitRoutine(Jit *jit)
+{
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_REGISTERS; ++i)
+    {
+        EmitMachineAccess(jit, 0x66, 0x89, MACHINE_REGISTERS[i],
+                          offsetof(Machine, registers) + i * sizeof(unsigned short));
+    }
+
+    EmitMachineAccess(jit, 0, 0x89, R11, offsetof(Machine, zeroFlag));
+    EmitMachineAccess(jit, 0, 0x89, RAX, offsetof(Machine, pc));
+
+    EmitByte(jit, 0x59);                    /* pop rcx (the state) */
+    EmitByte(jit, REX | REX_W | REX_R);     /* mov [rcx], r10 */
+    EmitByte(jit, 0x89);
+    EmitByte(jit, MOD_RM(0, R10, RCX));
+    EmitRegisterInstruction(jit, 0x89, RAX, RDX); /* mov eax, edx */
+
+    EmitByte(jit, REX | REX_B);             /* pop r15-r12 */
+    EmitByte(jit, 0x5F);
+    EmitByte(jit, REX | REX_B);
+    EmitByte(jit, 0x5E);
+    EmitByte(jit, REX | REX_B);
+    EmitByte(jit, 0x5D);
+    EmitByte(jit, REX | REX_B);
+    EmitByte(jit, 0x5C);
+    EmitByte(jit, 0x5D);                    /* pop rbp */
+    EmitByte(jit, 0x5B);                    /* pop rbx */
+    EmitByte(jit, 0xC3);                    /* ret */
+}
+
+/* Compiles the instructions from the address up to a jump (or to one
+ * that runs in the interpreter). Returns NULL when the code is full. */
+static unsigned char *CompileBlock(Jit *jit, Machine *machine, unsigned int address)
+{
+    const MicroOp *microOps[MAX_BLOCK_LENGTH];
+    unsigned int addresses[MAX_BLOCK_LENGTH];
+    unsigned int pc = address, numOfCompiled = 0, i = 0;
+    bool isInterpreted = FALSE, isJump = FALSE;
+    size_t entryOffset = jit->codeSize, site = 0;
+
+    if (jit->codeSize + MAX_BLOCK_CODE_SIZE > JIT_CODE_SIZE)
+    {
+        return NULL;
+    }
+
+    while (numOfCompiled < MAX_BLOCK_LENGTH && !isJump)
+    {
+        const MicroOp *microOp = GetMicroOp(machine, pc);
+
+        /* An instruction that ends at the end of memory fails the next
+         * fetch, so it runs in the interpreter */
+        if (microOp->handler < MOV_HANDLER ||
+            RED_HANDLER == microOp->handler ||
+            PRN_HANDLER == microOp->handler ||
+            microOp->handler > RTS_HANDLER ||
+            pc + microOp->length >= MEMORY_SIZE)
+        {
+            isInterpreted = TRUE;
+            break;
+        }
+
+        isJump = (microOp->handler >= JMP_HANDLER);
+        microOps[numOfCompiled] = microOp;
+        addresses[numOfCompiled++] = pc;
+        pc += microOp->length;
+    }
+
+    if (numOfCompiled > 0)
+    {
+        EmitByte(jit, REX | REX_W | REX_B);  /* cmp r10, numOfCompiled */
+        EmitByte(jit, 0x81);
+        EmitByte(jit, MOD_RM(3, 7, R10));
+        Emit32(jit, numOfCompiled);
+        EmitExitUnless(jit, JAE_SHORT, STEPS_EXIT, address, 0);
+        EmitByte(jit, REX | REX_W | REX_B);  /* sub r10, numOfCompiled */
+        EmitByte(jit, 0x81);
+        EmitByte(jit, MOD_RM(3, 5, R10));
+        Emit32(jit, numOfCompiled);
+    }
+
+    for (i = 0; i < numOfCompiled; ++i)
+    {
+        EmitInstruction(jit, machine, microOps[i], addresses[i], numOfCompiled - i);
+    }
+
+    if (isInterpreted)
+    {
+        EmitExit(jit, INTERPRET_EXIT, pc, 0);
+    }
+    else if (!isJump)
+    {
+        EmitChain(jit, pc);
+    }
+
+    jit->entries[address] = jit->code + entryOffset;
+
+    /* Chain the jumps that wait for this block */
+    while (site < jit->numOfChainSites)
+    {
+        if (address == jit->chainSites[site].target)
+        {
+            Patch32(jit,
+                    jit->chainSites[site].offset,
+                    entryOffset - (jit->chainSites[site].offset + 4));
+            jit->chainSites[site] = jit->chainSites[--jit->numOfChainSites];
+        }
+        else
+        {
+            ++site;
+        }
+    }
+
+    return jit->entries[address];
+}
+
+/* numOfUncounted is the number of instructions of the block from this one
+ * on: the steps an exit before the instruction gives back */
+static void EmitInstruction(Jit *jit,
+                            const Machine *machine,
+                            const MicroOp *microOp,
+                            unsigned int address,
+                            unsigned int numOfUncounted)
+{
+    unsigned int nextAddress = address + microOp->length;
+    size_t skipOffset = 0;
+
+    switch (microOp->handler)
+    {
+    case MOV_HANDLER:
+        EmitLoadOperand(jit, machine, RAX, microOp->srcSpace, microOp->src);
+        EmitStore(jit, microOp, nextAddress, numOfUncounted - 1);
+        break;
+
+    case CMP_HANDLER:
+        EmitLoadOperand(jit, machine, RAX, microOp->srcSpace, microOp->src);
+        EmitLoadOperand(jit, machine, RCX, microOp->destSpace, microOp->dest);
+        EmitRegisterInstruction(jit, 0x31, R11, R11); /* xor r11d, r11d */
+        EmitRegisterInstruction(jit, 0x39, RAX, RCX); /* cmp eax, ecx */
+        EmitByte(jit, REX | REX_B);                   /* sete r11b */
+        EmitByte(jit, 0x0F);
+        EmitByte(jit, 0x94);
+        EmitByte(jit, MOD_RM(3, 0, R11));
+        break;
+
+    case ADD_HANDLER:
+    case SUB_HANDLER:
+        EmitLoadOperand(jit, machine, RAX, microOp->destSpace, microOp->dest);
+        EmitLoadOperand(jit, machine, RCX, microOp->srcSpace, microOp->src);
+        EmitRegisterInstruction(jit,
+                                (ADD_HANDLER == microOp->handler) ? 0x01 : 0x29,
+                                RAX,
+                                RCX);
+        EmitByte(jit, 0x25); /* and eax, MEMORY_WORD_MASK */
+        Emit32(jit, MEMORY_WORD_MASK);
+        EmitStore(jit, microOp, nextAddress, numOfUncounted - 1);
+        break;
+
+    case NOT_HANDLER:
+    case INC_HANDLER:
+    case DEC_HANDLER:
+        EmitLoadOperand(jit, machine, RAX, microOp->destSpace, microOp->dest);
+        EmitByte(jit, (NOT_HANDLER == microOp->handler) ? 0xF7 : 0xFF);
+        EmitByte(jit, (NOT_HANDLER == microOp->handler)   ? MOD_RM(3, 2, RAX)
+                      : (INC_HANDLER == microOp->handler) ? MOD_RM(3, 0, RAX)
+                                                          : MOD_RM(3, 1, RAX));
+        EmitByte(jit, 0x25);
+        Emit32(jit, MEMORY_WORD_MASK);
+        EmitStore(jit, microOp, nextAddress, numOfUncounted - 1);
+        break;
+
+    case CLR_HANDLER:
+        EmitRegisterInstruction(jit, 0x31, RAX, RAX); /* xor eax, eax */
+        EmitStore(jit, microOp, nextAddress, numOfUncounted - 1);
+        break;
+
+    case LEA_HANDLER:
+        EmitMoveImmediate(jit, RAX, microOp->src);
+        EmitStore(jit, microOp, nextAddress, numOfUncounted - 1);
+        break;
+
+    case JMP_HANDLER:
+        EmitJump(jit, microOp, address, numOfUncounted);
+        break;
+
+    case BNE_HANDLER:
+        EmitRegisterInstruction(jit, 0x85, R11, R11); /* test r11d, r11d */
+        EmitByte(jit, 0x0F);                          /* jne (not taken) */
+        EmitByte(jit, 0x85);
+        skipOffset = jit->codeSize;
+        Emit32(jit, 0);
+        EmitJump(jit, microOp, address, numOfUncounted);
+        Patch32(jit, skipOffset, jit->codeSize - (skipOffset + 4));
+        EmitChain(jit, nextAddress);
+        break;
+
+    case JSR_HANDLER:
+        if (REGISTER_SPACE == microOp->destSpace)
+        {
+            EmitRegisterInstruction(jit, 0x89, RCX, MACHINE_REGISTERS[microOp->dest]);
+            EmitByte(jit, 0x81); /* cmp ecx, MEMORY_SIZE */
+            EmitByte(jit, MOD_RM(3, 7, RCX));
+            Emit32(jit, MEMORY_SIZE);
+            EmitExitUnless(jit, JB_SHORT, INTERPRET_EXIT, address, numOfUncounted);
+        }
+
+        EmitMachineAccess(jit, 0, 0x8B, RAX, offsetof(Machine, stackPointer));
+        EmitByte(jit, 0x3D); /* cmp eax, RETURN_STACK_SIZE */
+        Emit32(jit, RETURN_STACK_SIZE);
+        EmitExitUnless(jit, JNE_SHORT, INTERPRET_EXIT, address, numOfUncounted);
+
+        EmitByte(jit, 0x66); /* mov word [rdi + rax * 2 + returnStack], nextAddress */
+        EmitByte(jit, 0xC7);
+        EmitByte(jit, MOD_RM(2, 0, 4));
+        EmitByte(jit, MOD_RM(1, RAX, RDI));
+        Emit32(jit, offsetof(Machine, returnStack));
+        EmitByte(jit, nextAddress & 0xFF);
+        EmitByte(jit, nextAddress >> 8);
+        EmitMachineAccess(jit, 0, 0xFF, 0, offsetof(Machine, stackPointer)); /* inc */
+
+        if (REGISTER_SPACE == microOp->destSpace)
+        {
+            EmitIndirectJump(jit);
+        }
+        else
+        {
+            EmitChain(jit, microOp->dest);
+        }
+        break;
+
+    default: /* RTS_HANDLER */
+        EmitMachineAccess(jit, 0, 0x8B, RAX, offsetof(Machine, stackPointer));
+        EmitRegisterInstruction(jit, 0x85, RAX, RAX); /* test eax, eax */
+        EmitExitUnless(jit, JNE_SHORT, INTERPRET_EXIT, address, numOfUncounted);
+
+        EmitByte(jit, 0x0F); /* movzx ecx, word [rdi + rax * 2 + returnStack - 2] */
+        EmitByte(jit, 0xB7);
+        EmitByte(jit, MOD_RM(2, RCX, 4));
+        EmitByte(jit, MOD_RM(1, RAX, RDI));
+        Emit32(jit, offsetof(Machine, returnStack) - sizeof(unsigned short));
+        EmitByte(jit, 0x81); /* cmp ecx, MEMORY_SIZE */
+        EmitByte(jit, MOD_RM(3, 7, RCX));
+        Emit32(jit, MEMORY_SIZE);
+        EmitExitUnless(jit, JB_SHORT, INTERPRET_EXIT, address, numOfUncounted);
+
+        EmitMachineAccess(jit, 0, 0xFF, 1, offsetof(Machine, stackPointer)); /* dec */
+        EmitIndirectJump(jit);
+        break;
+    }
+}
+
+static void EmitLoadOperand(Jit *jit,
+                            const Machine *machine,
+                            HostRegister target,
+                            unsigned int space,
+                            unsigned int offset)
+{
+    switch (space)
+    {
+    case MEMORY_SPACE: /* movzx target, word [rdi + offset * 2] */
+        EmitMachineAccess(jit, 0, 0x0FB7, target, offset * sizeof(unsigned short));
+        break;
+
+    case REGISTER_SPACE:
+        EmitRegisterInstruction(jit, 0x89, target, MACHINE_REGISTERS[offset]);
+        break;
+
+    default: /* IMMEDIATE_SPACE */
+        EmitMoveImmediate(jit, target, machine->immediates[offset]);
+        break;
+    }
+}
+
+/* Stores EAX to the dest. A store to a word of decoded code leaves the
+ * block. */
+static void EmitStore(Jit *jit,
+                      const MicroOp *microOp,
+                      unsigned int nextAddress,
+                      unsigned int numOfUncounted)
+{
+    if (REGISTER_SPACE == microOp->destSpace)
+    {
+        EmitRegisterInstruction(jit, 0x89, MACHINE_REGISTERS[microOp->dest], RAX);
+        return;
+    }
+
+    EmitMachineAccess(jit, 0x66, 0x89, RAX, microOp->dest * sizeof(unsigned short));
+    EmitMachineAccess(jit, 0, 0x80, 7, offsetof(Machine, isCode) + microOp->dest); /* cmp */
+    EmitByte(jit, 0);
+    EmitExitUnless(jit, JE_SHORT, CODE_WRITE_EXIT, nextAddress, numOfUncounted);
+}
+
+/* jmp, bne (taken) and jsr (after the push) */
+static void EmitJump(Jit *jit,
+                     const MicroOp *microOp,
+                     unsigned int address,
+                     unsigned int numOfUncounted)
+{
+    if (REGISTER_SPACE != microOp->destSpace)
+    {
+        EmitChain(jit, microOp->dest);
+        return;
+    }
+
+    EmitRegisterInstruction(jit, 0x89, RCX, MACHINE_REGISTERS[microOp->dest]);
+    EmitByte(jit, 0x81); /* cmp ecx, MEMORY_SIZE */
+    EmitByte(jit, MOD_RM(3, 7, RCX));
+    Emit32(jit, MEMORY_SIZE);
+    EmitExitUnless(jit, JB_SHORT, INTERPRET_EXIT, address, numOfUncounted);
+    EmitIndirectJump(jit);
+}
+
+/* A jump to the block of the target, or to an exit to RunMachineJit
+ * until the block is compiled */
+static void EmitChain(Jit *jit, unsigned int target)
+{
+    EmitByte(jit, JMP_NEAR);
+
+    if (NULL != jit->entries[target])
+    {
+        Emit32(jit, (unsigned long)(jit->entries[target] - jit->code) - (jit->codeSize + 4));
+        return;
+    }
+
+    if (jit->numOfChainSites < MAX_CHAIN_SITES)
+    {
+        jit->chainSites[jit->numOfChainSites].offset = jit->codeSize;
+        jit->chainSites[jit->numOfChainSites++].target = target;
+    }
+
+    Emit32(jit, 0); /* To the exit below */
+    EmitExit(jit, BLOCK_END_EXIT, target, 0);
+}
+
+/* Jumps to the block of the address in ECX (below MEMORY_SIZE) */
+static void EmitIndirectJump(Jit *jit)
+{
+    EmitByte(jit, REX | REX_W); /* mov rax, [rsi + rcx * 8] */
+    EmitByte(jit, 0x8B);
+    EmitByte(jit, MOD_RM(0, RAX, 4));
+    EmitByte(jit, MOD_RM(3, RCX, RSI));
+    EmitByte(jit, REX | REX_W); /* test rax, rax */
+    EmitByte(jit, 0x85);
+    EmitByte(jit, MOD_RM(3, RAX, RAX));
+    EmitByte(jit, JE_SHORT);
+    EmitByte(jit, 2);
+    EmitByte(jit, 0xFF); /* jmp rax */
+    EmitByte(jit, MOD_RM(3, 4, RAX));
+    EmitRegisterInstruction(jit, 0x89, RAX, RCX); /* mov eax, ecx */
+    EmitMoveImmediate(jit, RDX, BLOCK_END_EXIT);
+    EmitByte(jit, JMP_NEAR);
+    Emit32(jit, jit->exitOffset - (jit->codeSize + 4));
+}
+
+static void EmitExit(Jit *jit, JitExit exit, unsigned int pc, unsigned int numOfUncounted)
+{
+    if (numOfUncounted > 0)
+    {
+        EmitByte(jit, REX | REX_W | REX_B); /* add r10, numOfUncounted */
+        EmitByte(jit, 0x81);
+        EmitByte(jit, MOD_RM(3, 0, R10));
+        Emit32(jit, numOfUncounted);
+    }
+
+    EmitMoveImmediate(jit, RAX, pc);
+    EmitMoveImmediate(jit, RDX, exit);
+    EmitByte(jit, JMP_NEAR);
+    Emit32(jit, jit->exitOffset - (jit->codeSize + 4));
+}
+
+/* An exit skipped by a short conditional jump */
+static void EmitExitUnless(Jit *jit,
+                           unsigned int skipOpcode,
+                           JitExit exit,
+                           unsigned int pc,
+                           unsigned int numOfUncounted)
+{
+    size_t exitOffset = 0;
+
+    EmitByte(jit, skipOpcode);
+    EmitByte(jit, 0);
+    exitOffset = jit->codeSize;
+    EmitExit(jit, exit, pc, numOfUncounted);
+    jit->code[exitOffset - 1] = (unsigned char)(jit->codeSize - exitOffset);
+}
+
+/* A 32-bit instruction between two registers (opcode r/m32, r32) */
+static void EmitRegisterInstruction(Jit *jit,
+                                    unsigned int opcode,
+                                    HostRegister rm,
+                                    HostRegister reg)
+{
+    EmitRex(jit, 0, reg, rm);
+    EmitByte(jit, opcode);
+    EmitByte(jit, MOD_RM(3, reg, rm));
+}
+
+/* An instruction on [rdi + offset], a field of the Machine. reg is a
+ * register or the extension of the opcode; prefix is 0x66 for 16 bits. */
+static void EmitMachineAccess(Jit *jit,
+                              unsigned int prefix,
+                              unsigned int opcode,
+                              unsigned int reg,
+                              size_t offset)
+{
+    if (0 != prefix)
+    {
+        EmitByte(jit, prefix);
+    }
+
+    EmitRex(jit, 0, reg, RDI);
+
+    if (opcode > 0xFF)
+    {
+        EmitByte(jit, opcode >> 8);
+    }
+
+    EmitByte(jit, opcode & 0xFF);
+    EmitByte(jit, MOD_RM(2, reg, RDI));
+    Emit32(jit, offset);
+}
+
+static void EmitMoveImmediate(Jit *jit, HostRegister reg, unsigned long value)
+{
+    EmitRex(jit, 0, 0, reg);
+    EmitByte(jit, 0xB8 + (reg & 7));
+    Emit32(jit, value);
+}
+
+static void EmitRex(Jit *jit, unsigned int flags, unsigned int reg, unsigned int rm)
+{
+    flags |= ((reg >> 3) ? REX_R : 0) | ((rm >> 3) ? REX_B : 0);
+
+    if (0 != flags)
+    {
+        EmitByte(jit, REX | flags);
+    }
+}
+
+static void EmitByte(Jit *jit, unsigned int byte)
+{
+    jit->code[jit->codeSize++] = (unsigned char)byte;
+}
+
+static void Emit32(Jit *jit, unsigned long value)
+{
+    Patch32(jit, jit->codeSize, value);
+    jit->codeSize += 4;
+}
+
+static void Patch32(Jit *jit, size_t offset, unsigned long value)
+{
+    jit->code[offset] = (unsigned char)(value & 0xFF);
+    jit->code[offset + 1] = (unsigned char)((value >> 8) & 0xFF);
+    jit->code[offset + 2] = (unsigned char)((value >> 16) & 0xFF);
+    jit->code[offset + 3] = (unsigned char)((value >> 24) & 0xFF);
+}
+
+static void FlushJit(Jit *jit)
+{
+    jit->codeSize = jit->blocksOffset;
+    jit->numOfChainSites = 0;
+    memset(jit->entries, 0, sizeof(jit->entries));
+}
+
+/* Maps the code writable (to compile blocks) or executable (to run
+ * them). Returns FALSE when mprotect fails. */
+static bool ProtectJit(Jit *jit, bool isWritable)
+{
+    if (jit->isWritable != isWritable)
+    {
+        if (0 != mprotect(jit->code,
+                          JIT_CODE_SIZE,
+                          isWritable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC)))
+        {
+            return FALSE;
+        }
+
+        jit->isWritable = isWritable;
+    }
+
+    return TRUE;
+}
+
+/* Whether the instruction at the address writes a word of decoded code */
+static bool IsStoreToCode(Machine *machine, unsigned int address)
+{
+    const MicroOp *microOp = GetMicroOp(machine, address);
+
+    switch (microOp->handler)
+    {
+    case MOV_HANDLER:
+    case ADD_HANDLER:
+    case SUB_HANDLER:
+    case NOT_HANDLER:
+    case CLR_HANDLER:
+    case LEA_HANDLER:
+    case INC_HANDLER:
+    case DEC_HANDLER:
+    case RED_HANDLER:
+        return (MEMORY_SPACE == microOp->destSpace && machine->isCode[microOp->dest]);
+    default:
+        return FALSE;
+    }
+}
+
+/* Runs up to maxSteps instructions in the interpreter, counting them in
+ * the state rather than in the Machine */
+static SimulationStatus InterpretSteps(Machine *machine,
+                                       JitState *state,
+                                       unsigned long maxSteps)
+{
+    unsigned long numOfSteps = machine->numOfSteps;
+    SimulationStatus status = SIMULATION_STOPPED;
+
+    /* RunMachine takes 0 as no limit */
+    if (0 == maxSteps)
+    {
+        return (machine->pc >= MEMORY_SIZE) ? SIMULATION_ADDRESS_ERROR
+                                            : SIMULATION_OUT_OF_STEPS;
+    }
+
+    status = RunMachine(machine, maxSteps);
+    state->stepsLeft -= machine->numOfSteps - numOfSteps;
+    machine->numOfSteps = numOfSteps;
+
+    return status;
+}
+
+#else /* !JIT_SUPPORTED */
+
+Jit *CreateJit(void)
+{
+    return NULL;
+}
+
+SimulationStatus RunMachineJit(Jit *jit, Machine *machine, unsigned long maxSteps)
+{
+    (void)jit;
+
+    return RunMachine(machine, maxSteps);
+}
+
+void DestroyJit(Jit *jit)
+{
+    (void)jit;
+}
+
+#endif /* JIT_SUPPORTED */
@@ -0,0 +1,1536 @@
+/****************************************
+* ASSEMBLER: simulator_lanes.c          *
+****************************************/
+
+#include <stdio.h>  /* FILE, sprintf, fread, fseek, rewind, tmpfile, fclose */
+#include <stdlib.h> /* malloc, realloc, free, posix_memalign */
+#include <string.h> /* memset, memcpy */
+#include <limits.h> /* ULONG_MAX */
+#include <assert.h> /* assert */
+
+#include "simulator_lanes.h"   /* API */
+#include "source_reader.h"     /* API */
+#include "sentence_analyzer.h" /* GetNextToken, TrimWhiteSpaces, GetNumber */
+#include "memory_word.h"       /* MEMORY_WORD_MASK */
+#include "assembler_utils.h"   /* Utils file */
+
+/* The AVX2 kernels are built with GCC's (and clang's) target attributes
+ * and picked at run time, as the shuffle codecs of word_encoding.c are */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    !defined(SIMULATOR_SCALAR_LANES_ONLY)
+#define AVX2_LANES
+#include <immintrin.h> /* AVX2 intrinsics */
+#endif
+
+#define LANE_BIT(lane) (1UL << (lane))
+/* The first numOfLanes lanes (a shift by all the 32 bits is undefined) */
+#define ALL_LANES(numOfLanes) ((NUM_OF_LANES == (numOfLanes)) ? 0xFFFFFFFFUL : LANE_BIT(numOfLanes) - 1)
+#define ROW(rows, index) ((rows) + (size_t)(index) * NUM_OF_LANES)
+
+/* A lane of a mask row, and the zero flag of a lane when it is set */
+#define LANE_SET (0xFFFF)
+/* The pc of a lane that finished */
+#define NO_LANE_PC (0xFFFF)
+
+/* Lanes that run with at most MAX_SPARSE_LANES active lanes for
+ * MAX_SPARSE_STEPS steps in a row are finished by RunMachine */
+#define MAX_SPARSE_LANES (NUM_OF_LANES / 8)
+#define MAX_SPARSE_STEPS (1024)
+
+#define GROUP_ALIGNMENT (64)
+#define INPUT_BUFFER_SIZE (4096)
+#define MAX_NUMBER_TEXT_SIZE (16)
+/* A number of a data segment, as in .data: a sign and up to 5 digits */
+#define MAX_NUMBER_LENGTH (6)
+
+static const char *INSTANCE_ENGINE_NAMES[NUM_OF_INSTANCE_ENGINES] = {"one by one", "scalar lanes", "avx2 lanes"};
+
+/* The handlers that write their dest */
+static const unsigned char IS_STORE_HANDLER[NUM_OF_HANDLERS] = {
+    FALSE, TRUE, FALSE, TRUE, TRUE, TRUE, TRUE, TRUE, TRUE, TRUE,
+    FALSE, FALSE, TRUE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE};
+
+/* The operations on rows. A mask row has LANE_SET in the lanes an
+ * instruction runs on; the other lanes of the dest are kept. */
+typedef struct
+{
+    void (*fill)(unsigned short *row, unsigned int value);
+    void (*move)(unsigned short *dest, const unsigned short *src, const unsigned short *mask);
+    void (*add)(unsigned short *dest, const unsigned short *src, const unsigned short *mask);
+    void (*subtract)(unsigned short *dest, const unsigned short *src, const unsigned short *mask);
+    void (*complement)(unsigned short *dest, const unsigned short *mask);
+    void (*compare)(unsigned short *zeroFlags,
+                    const unsigned short *src,
+                    const unsigned short *dest,
+                    const unsigned short *mask);
+    unsigned long (*getSetLanes)(const unsigned short *row);
+    unsigned long (*getEqualLanes)(const unsigned short *row, unsigned int value);
+    unsigned int (*getMinimum)(const unsigned short *row, unsigned int excludedValue);
+    void (*expand)(unsigned short *mask, unsigned long lanes);
+} LaneKernels;
+
+/* NUM_OF_LANES instances of a program. The rows come first, so they are
+ * aligned as the group is. */
+typedef struct
+{
+    unsigned short memory[MEMORY_SIZE * NUM_OF_LANES];
+    unsigned short registers[NUM_OF_REGISTERS * NUM_OF_LANES];
+    unsigned short returnStacks[RETURN_STACK_SIZE * NUM_OF_LANES];
+    unsigned short zeroFlags[NUM_OF_LANES];
+    unsigned short pcs[NUM_OF_LANES]; /* Of the lanes that are not active, NO_LANE_PC when finished */
+    unsigned short activeMask[NUM_OF_LANES];
+    unsigned short jumpMask[NUM_OF_LANES];
+    unsigned short srcRow[NUM_OF_LANES];  /* An immediate src, or a value of every lane */
+    unsigned short destRow[NUM_OF_LANES]; /* An immediate dest */
+    unsigned short oneRow[NUM_OF_LANES];
+    Machine program; /* The words every lane has at first; decodes the instructions */
+    unsigned char isWritten[MEMORY_SIZE]; /* A lane of any group so far may have another word */
+    unsigned short writtenAddresses[MEMORY_SIZE];
+    unsigned int numOfWrittenAddresses;
+    unsigned char isTainted[MEMORY_SIZE]; /* The instruction read such a word */
+    int stackPointers[NUM_OF_LANES];
+    unsigned long idleSteps[NUM_OF_LANES];    /* Steps of the group the lane waited */
+    unsigned long waitingSince[NUM_OF_LANES]; /* When the lane started to wait */
+    size_t inputPositions[NUM_OF_LANES];
+    SimulationResult *results[NUM_OF_LANES];
+    unsigned long runningLanes;
+    unsigned long activeLanes; /* The running lanes at pc */
+    unsigned int pc;
+    unsigned int waitingPc; /* The smallest pc of the other running lanes */
+    unsigned long numOfSteps;
+    unsigned long stepLimit; /* numOfSteps when the first active lane runs out of steps */
+    bool isSparse;
+    unsigned long sparseSince;
+    unsigned long maxSteps;
+    const LaneKernels *kernels;
+    unsigned char *input; /* What the lanes read of inputFile so far */
+    size_t inputSize;
+    size_t inputCapacity;
+    FILE *inputFile;
+    FILE *inputSource; /* Of the program: read on from it at the end of inputFile */
+    FILE *output;
+    Machine *scalarMachine; /* Runs the lanes that fall back to RunMachine */
+    InstanceStatistics *statistics;
+} LaneGroup;
+
+static ReturnStatus ReadDataSegments(SourceReader *sourceReader,
+                                     unsigned int maxNumOfWords,
+                                     InstanceSet *instances,
+                                     size_t *numOfWords,
+                                     Diagnostics *diagnostics);
+static bool ParseWord(Span field, unsigned short *word);
+static void RunOneByOne(const Machine *program,
+                        const InstanceSet *instances,
+                        FILE *input,
+                        FILE *output,
+                        unsigned long maxSteps,
+                        Machine *machine,
+                        SimulationResult *results);
+static unsigned char *ReadInput(FILE *input, size_t *size, size_t *capacity);
+static void PrepareLaneGroup(LaneGroup *group, const Machine *program);
+static void StartLaneGroup(LaneGroup *group,
+                           const Machine *program,
+                           const InstanceSet *instances,
+                           size_t firstInstance,
+                           unsigned int numOfLanes,
+                           SimulationResult *results);
+static void RunLaneGroup(LaneGroup *group);
+static const MicroOp *DecodeLaneInstruction(LaneGroup *group, unsigned int pc);
+static unsigned short *GetOperandRow(LaneGroup *group,
+                                     unsigned int space,
+                                     unsigned int offset,
+                                     unsigned short *immediateRow);
+static void SelectLanes(LaneGroup *group);
+static void UpdateStepLimit(LaneGroup *group);
+static void MoveLanes(LaneGroup *group, unsigned int pc);
+static void JumpLanes(LaneGroup *group,
+                      const MicroOp *microOp,
+                      unsigned long jumpingLanes,
+                      unsigned int next);
+static void ReadLanes(LaneGroup *group, unsigned short *dest);
+static void ExtendLaneInput(LaneGroup *group);
+static void PrintLanes(LaneGroup *group, const unsigned short *dest);
+static void PushReturnAddresses(LaneGroup *group, unsigned int returnAddress);
+static void ReturnLanes(LaneGroup *group);
+static void FinishOutOfStepsLanes(LaneGroup *group);
+static void FinishLanes(LaneGroup *group, unsigned long lanes, SimulationStatus status, unsigned int pc);
+static void FallBackLanes(LaneGroup *group, unsigned long lanes);
+static void MarkWritten(LaneGroup *group, unsigned int address);
+static void RemoveLane(LaneGroup *group, unsigned int lane);
+static unsigned int CountLanes(unsigned long lanes);
+static int ToSigned(unsigned int word);
+
+static void FillRowScalar(unsigned short *row, unsigned int value);
+static void MoveRowScalar(unsigned short *dest, const unsigned short *src, const unsigned short *mask);
+static void AddRowScalar(unsigned short *dest, const unsigned short *src, const unsigned short *mask);
+static void SubtractRowScalar(unsigned short *dest, const unsigned short *src, const unsigned short *mask);
+static void ComplementRowScalar(unsigned short *dest, const unsigned short *mask);
+static void CompareRowsScalar(unsigned short *zeroFlags,
+                              const unsigned short *src,
+                              const unsigned short *dest,
+                              const unsigned short *mask);
+static unsigned long GetSetLanesScalar(const unsigned short *row);
+static unsigned long GetEqualLanesScalar(const unsigned short *row, unsigned int value);
+static unsigned int GetMinimumScalar(const unsigned short *row, unsigned int excludedValue);
+static void ExpandLanesScalar(unsigned short *mask, unsigned long lanes);
+
+static const LaneKernels SCALAR_KERNELS = {
+    FillRowScalar, MoveRowScalar, AddRowScalar, SubtractRowScalar, ComplementRowScalar,
+    CompareRowsScalar, GetSetLanesScalar, GetEqualLanesScalar, GetMinimumScalar, ExpandLanesScalar};
+
+#ifdef AVX2_LANES
+/* 16 lanes of 16 bits per vector */
+#define NUM_OF_ROW_VECTORS (NUM_OF_LANES / 16)
+
+static void FillRowAVX2(unsigned short *row, unsigned int value);
+static void MoveRowAVX2(unsigned short *dest, const unsigned short *src, const unsigned short *mask);
+static void AddRowAVX2(unsigned short *dest, const unsigned short *src, const unsigned short *mask);
+static void SubtractRowAVX2(unsigned short *dest, const unsigned short *src, const unsigned short *mask);
+static void ComplementRowAVX2(unsigned short *dest, const unsigned short *mask);
+static void CompareRowsAVX2(unsigned short *zeroFlags,
+                            const unsigned short *src,
+                            const unsigned short *dest,
+                            const unsigned short *mask);
+static unsigned long GetSetLanesAVX2(const unsigned short *row);
+static unsigned long GetEqualLanesAVX2(const unsigned short *row, unsigned int value);
+static unsigned int GetMinimumAVX2(const unsigned short *row, unsigned int excludedValue);
+static void ExpandLanesAVX2(unsigned short *mask, unsigned long lanes);
+
+static const LaneKernels AVX2_KERNELS = {
+    FillRowAVX2, MoveRowAVX2, AddRowAVX2, SubtractRowAVX2, ComplementRowAVX2,
+    CompareRowsAVX2, GetSetLanesAVX2, GetEqualLanesAVX2, GetMinimumAVX2, ExpandLanesAVX2};
+#endif /* AVX2_LANES */
+
+/* The file is read twice, to count the words and then to store them */
+ReturnStatus ReadInstanceSet(FILE *file,
+                             unsigned int maxNumOfWords,
+                             InstanceSet *instances,
+                             Diagnostics *diagnostics)
+{
+    SourceReader sourceReader;
+    size_t numOfWords = 0;
+    ReturnStatus status = SUCCESS;
+
+    assert(NULL != file);
+    assert(NULL != instances);
+    assert(NULL != diagnostics);
+
+    memset(instances, 0, sizeof(InstanceSet));
+
+    if (SUCCESS != OpenSourceReader(&sourceReader, file))
+    {
+        ReportError(diagnostics, "Error reading the data segments\n");
+        CloseSourceReader(&sourceReader);
+        return FAILURE;
+    }
+
+    status = ReadDataSegments(&sourceReader, maxNumOfWords, instances, &numOfWords, diagnostics);
+    if (SUCCESS == status)
+    {
+        instances->words = (unsigned short *)malloc((numOfWords + 1) * sizeof(unsigned short));
+        instances->offsets = (size_t *)malloc((instances->numOfInstances + 1) * sizeof(size_t));
+        if (NULL == instances->words || NULL == instances->offsets)
+        {
+            ReportError(diagnostics, "Memory allocation error\n");
+            status = FAILURE;
+        }
+        else
+        {
+            RewindSourceReader(&sourceReader);
+            status = ReadDataSegments(&sourceReader, maxNumOfWords, instances, &numOfWords, diagnostics);
+        }
+    }
+
+    CloseSourceReader(&sourceReader);
+
+    if (SUCCESS != status)
+    {
+        DestroyInstanceSet(instances);
+    }
+
+    return status;
+}
+
+void DestroyInstanceSet(InstanceSet *instances)
+{
+    assert(NULL != instances);
+
+    free(instances->words);
+    free(instances->offsets);
+    memset(instances, 0, sizeof(InstanceSet));
+}
+
+InstanceEngine GetInstanceEngine(void)
+{
+    return IsInstanceEngineSupported(AVX2_LANE_ENGINE) ? AVX2_LANE_ENGINE : SCALAR_LANE_ENGINE;
+}
+
+bool IsInstanceEngineSupported(InstanceEngine engine)
+{
+    switch (engine)
+    {
+    case ONE_BY_ONE_ENGINE:
+    case SCALAR_LANE_ENGINE:
+        return TRUE;
+#ifdef AVX2_LANES
+    case AVX2_LANE_ENGINE:
+        return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+#endif /* AVX2_LANES */
+    default:
+        return FALSE;
+    }
+}
+
+const char *GetInstanceEngineName(InstanceEngine engine)
+{
+    assert(engine >= 0 && engine < NUM_OF_INSTANCE_ENGINES);
+
+    return INSTANCE_ENGINE_NAMES[engine];
+}
+
+ReturnStatus RunInstances(InstanceEngine engine,
+                          const Machine *machine,
+                          const InstanceSet *instances,
+                          FILE *input,
+                          unsigned long maxSteps,
+                          SimulationResult *results,
+                          InstanceStatistics *statistics)
+{
+    Machine *program = NULL, *scalarMachine = NULL;
+    LaneGroup *group = NULL;
+    void *groupMemory = NULL;
+    unsigned char *inputData = NULL;
+    size_t inputSize = 0, inputCapacity = 0, i = 0;
+    FILE *output = NULL;
+    ReturnStatus status = SUCCESS;
+
+    assert(IsInstanceEngineSupported(engine));
+    assert(NULL != machine);
+    assert(machine->pc < MEMORY_SIZE);
+    assert(NULL != instances);
+    assert(NULL != input);
+    assert(NULL != results);
+    assert(NULL != statistics);
+
+    memset(statistics, 0, sizeof(InstanceStatistics));
+
+    program = (Machine *)malloc(sizeof(Machine));
+    scalarMachine = (Machine *)malloc(sizeof(Machine));
+    output = tmpfile();
+    if (ONE_BY_ONE_ENGINE != engine)
+    {
+        inputData = ReadInput(input, &inputSize, &inputCapacity);
+        if (0 != posix_memalign(&groupMemory, GROUP_ALIGNMENT, sizeof(LaneGroup)))
+        {
+            groupMemory = NULL;
+        }
+    }
+
+    if (NULL == program || NULL == scalarMachine || NULL == output ||
+        (ONE_BY_ONE_ENGINE != engine && (NULL == inputData || NULL == groupMemory)))
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        /* The instances decode their own copies of the instructions */
+        memcpy(program, machine, sizeof(Machine));
+        ClearMicroOps(program);
+
+        if (ONE_BY_ONE_ENGINE == engine)
+        {
+            RunOneByOne(program, instances, input, output, maxSteps, scalarMachine, results);
+        }
+        else
+        {
+            group = (LaneGroup *)groupMemory;
+            group->kernels = &SCALAR_KERNELS;
+#ifdef AVX2_LANES
+            if (AVX2_LANE_ENGINE == engine)
+            {
+                group->kernels = &AVX2_KERNELS;
+            }
+#endif /* AVX2_LANES */
+            group->maxSteps = maxSteps;
+            group->input = inputData;
+            group->inputSize = inputSize;
+            group->inputCapacity = inputCapacity;
+            group->inputFile = input;
+            group->inputSource = program->inputSource;
+            group->output = output;
+            group->scalarMachine = scalarMachine;
+            group->statistics = statistics;
+            PrepareLaneGroup(group, program);
+
+            for (i = 0; i < instances->numOfInstances; i += NUM_OF_LANES)
+            {
+                StartLaneGroup(group,
+                               program,
+                               instances,
+                               i,
+                               (instances->numOfInstances - i < NUM_OF_LANES)
+                                   ? (unsigned int)(instances->numOfInstances - i)
+                                   : NUM_OF_LANES,
+                               results + i);
+                RunLaneGroup(group);
+                statistics->numOfLockstepSteps += group->numOfSteps - program->numOfSteps;
+            }
+
+            inputData = group->input; /* Moved when it grew */
+        }
+    }
+
+    free(groupMemory);
+    free(inputData);
+    if (NULL != output)
+    {
+        fclose(output);
+    }
+    free(scalarMachine);
+    free(program);
+
+    return status;
+}
+
+/* Static functions */
+
+/* Counts the instances and the words, and stores them when
+ * instances->words is set */
+static ReturnStatus ReadDataSegments(SourceReader *sourceReader,
+                                     unsigned int maxNumOfWords,
+                                     InstanceSet *instances,
+                                     size_t *numOfWords,
+                                     Diagnostics *diagnostics)
+{
+    Span line = {0}, field = {0};
+    unsigned short word = 0;
+    unsigned int numOfLineWords = 0;
+    int lineNumber = 0;
+
+    instances->numOfInstances = 0;
+    *numOfWords = 0;
+
+    while (ReadSentence(sourceReader, &line))
+    {
+        ++lineNumber;
+
+        TrimWhiteSpaces(&line);
+        if (0 == line.length || HASH_MARK == line.start[0])
+        {
+            continue;
+        }
+
+        if (NULL != instances->words)
+        {
+            instances->offsets[instances->numOfInstances] = *numOfWords;
+        }
+
+        for (numOfLineWords = 0; GetNextToken(&line, COMMA_SIGN, &field); ++numOfLineWords)
+        {
+            if (!ParseWord(field, &word))
+            {
+                ReportError(diagnostics, "Line %d:\tError: bad number\n", lineNumber);
+                return FAILURE;
+            }
+
+            if (numOfLineWords == maxNumOfWords)
+            {
+                ReportError(diagnostics,
+                            "Line %d:\tError: more than the %u words after the code\n",
+                            lineNumber,
+                            maxNumOfWords);
+                return FAILURE;
+            }
+
+            if (NULL != instances->words)
+            {
+                instances->words[*numOfWords] = word;
+            }
+            ++*numOfWords;
+        }
+
+        ++instances->numOfInstances;
+    }
+
+    if (NULL != instances->words)
+    {
+        instances->offsets[instances->numOfInstances] = *numOfWords;
+    }
+
+    return SUCCESS;
+}
+
+/* A number of a 14 bit word, signed or not */
+static bool ParseWord(Span field, unsigned short *word)
+{
+    size_t i = 0;
+    int value = 0;
+
+    if (0 == field.length || field.length > MAX_NUMBER_LENGTH)
+    {
+        return FALSE;
+    }
+
+    if (PLUS_SIGN == field.start[0] || MINUS_SIGN == field.start[0])
+    {
+        i = 1;
+    }
+
+    if (i == field.length)
+    {
+        return FALSE;
+    }
+
+    for (; i < field.length; ++i)
+    {
+        if (field.start[i] < ZERO_DIGIT || field.start[i] > NINE_DIGIT)
+        {
+            return FALSE;
+        }
+    }
+
+    value = GetNumber(field);
+    if (value < -WORD_SIGN_BIT || value > MEMORY_WORD_MASK)
+    {
+        return FALSE;
+    }
+
+    *word = (unsigned short)(value & MEMORY_WORD_MASK);
+
+    return TRUE;
+}
+
+/* A copy of the Machine per instance, as the simulator runs a program */
+static void RunOneByOne(const Machine *program,
+                        const InstanceSet *instances,
+                        FILE *input,
+                        FILE *output,
+                        unsigned long maxSteps,
+                        Machine *machine,
+                        SimulationResult *results)
+{
+    unsigned int dataAddress = STARTING_ADDRESS + program->numOfCodeWords;
+    size_t i = 0;
+
+    for (i = 0; i < instances->numOfInstances; ++i)
+    {
+        memcpy(machine, program, sizeof(Machine));
+        memcpy(machine->memory + dataAddress,
+               instances->words + instances->offsets[i],
+               (instances->offsets[i + 1] - instances->offsets[i]) * sizeof(unsigned short));
+        machine->input = input;
+        machine->output = output;
+        rewind(input);
+        rewind(output);
+
+        GetSimulationResult(machine, RunMachine(machine, maxSteps), results + i);
+        HashOutputStream(output, results + i);
+    }
+}
+
+/* Returns the malloced input (with room for a byte, so an empty input is
+ * not NULL), or NULL */
+static unsigned char *ReadInput(FILE *input, size_t *size, size_t *capacity)
+{
+    unsigned char *data = NULL, *newData = NULL;
+    size_t numOfBytes = 0;
+
+    *size = 0;
+    *capacity = INPUT_BUFFER_SIZE;
+    rewind(input);
+
+    data = (unsigned char *)malloc(*capacity);
+    while (NULL != data &&
+           0 != (numOfBytes = fread(data + *size, 1, *capacity - *size, input)))
+    {
+        *size += numOfBytes;
+        if (*size == *capacity)
+        {
+            *capacity *= 2;
+            newData = (unsigned char *)realloc(data, *capacity);
+            if (NULL == newData)
+            {
+                free(data);
+                return NULL;
+            }
+            data = newData;
+        }
+    }
+
+    return data;
+}
+
+/* The groups share the memory rows and the decoded instructions: the
+ * program is never written, and a group restores the rows written before */
+static void PrepareLaneGroup(LaneGroup *group, const Machine *program)
+{
+    unsigned int address = 0;
+
+    memcpy(&group->program, program, sizeof(Machine));
+    memset(group->isWritten, FALSE, sizeof(group->isWritten));
+    memset(group->isTainted, FALSE, sizeof(group->isTainted));
+    group->numOfWrittenAddresses = 0;
+
+    for (address = 0; address < MEMORY_SIZE; ++address)
+    {
+        group->kernels->fill(ROW(group->memory, address), program->memory[address]);
+    }
+}
+
+/* Every lane gets the memory, the registers and the pc of the program,
+ * and the words of its instance after the code. Any word the instances
+ * change may differ between the lanes, so it is written. */
+static void StartLaneGroup(LaneGroup *group,
+                           const Machine *program,
+                           const InstanceSet *instances,
+                           size_t firstInstance,
+                           unsigned int numOfLanes,
+                           SimulationResult *results)
+{
+    const LaneKernels *kernels = group->kernels;
+    unsigned int dataAddress = STARTING_ADDRESS + program->numOfCodeWords;
+    unsigned int lane = 0, address = 0;
+    int i = 0;
+
+    for (i = 0; i < (int)group->numOfWrittenAddresses; ++i)
+    {
+        address = group->writtenAddresses[i];
+        kernels->fill(ROW(group->memory, address), program->memory[address]);
+    }
+
+    for (i = 0; i < NUM_OF_REGISTERS; ++i)
+    {
+        kernels->fill(ROW(group->registers, i), program->registers[i]);
+    }
+
+    for (i = 0; i < program->stackPointer; ++i)
+    {
+        kernels->fill(ROW(group->returnStacks, i), program->returnStack[i]);
+    }
+
+    kernels->fill(group->zeroFlags, program->zeroFlag ? LANE_SET : 0);
+    kernels->fill(group->pcs, NO_LANE_PC);
+    kernels->fill(group->oneRow, 1);
+
+    for (lane = 0; lane < numOfLanes; ++lane)
+    {
+        size_t word = instances->offsets[firstInstance + lane];
+
+        for (address = dataAddress; word < instances->offsets[firstInstance + lane + 1]; ++address, ++word)
+        {
+            ROW(group->memory, address)[lane] = instances->words[word];
+            MarkWritten(group, address);
+        }
+
+        group->pcs[lane] = (unsigned short)program->pc;
+        group->stackPointers[lane] = program->stackPointer;
+        group->idleSteps[lane] = 0;
+        group->waitingSince[lane] = program->numOfSteps;
+        group->inputPositions[lane] = 0;
+        group->results[lane] = results + lane;
+
+        memset(results + lane, 0, sizeof(SimulationResult));
+        results[lane].outputHash = OUTPUT_HASH_BASIS;
+    }
+
+    group->numOfSteps = program->numOfSteps;
+    group->runningLanes = ALL_LANES(numOfLanes);
+    group->activeLanes = 0;
+    group->isSparse = FALSE;
+}
+
+/* Runs an instruction at a time for the active lanes, the running lanes
+ * at the smallest pc */
+static void RunLaneGroup(LaneGroup *group)
+{
+    const LaneKernels *kernels = group->kernels;
+    const MicroOp *microOp = NULL;
+    unsigned short *src = NULL, *dest = NULL;
+    unsigned int pc = 0, next = 0;
+
+    while (0 != group->runningLanes)
+    {
+        if (0 == group->activeLanes)
+        {
+            SelectLanes(group);
+        }
+
+        pc = group->pc;
+
+        if (group->numOfSteps >= group->stepLimit)
+        {
+            FinishOutOfStepsLanes(group);
+            continue;
+        }
+
+        if (group->isSparse && group->numOfSteps - group->sparseSince >= MAX_SPARSE_STEPS)
+        {
+            FallBackLanes(group, group->activeLanes);
+            continue;
+        }
+
+        microOp = group->program.microOps + pc;
+        if (0 == microOp->length)
+        {
+            microOp = DecodeLaneInstruction(group, pc);
+        }
+
+        /* The lanes do not write the code they run: RunMachine does */
+        if (group->isTainted[pc] ||
+            (IS_STORE_HANDLER[microOp->handler] &&
+             MEMORY_SPACE == microOp->destSpace &&
+             group->program.isCode[microOp->dest]))
+        {
+            FallBackLanes(group, group->activeLanes);
+            continue;
+        }
+
+        ++group->numOfSteps;
+        next = pc + microOp->length;
+        src = GetOperandRow(group, microOp->srcSpace, microOp->src, group->srcRow);
+        dest = GetOperandRow(group, microOp->destSpace, microOp->dest, group->destRow);
+
+        switch (microOp->handler)
+        {
+        case MOV_HANDLER:
+            kernels->move(dest, src, group->activeMask);
+            break;
+
+        case CMP_HANDLER:
+            kernels->compare(group->zeroFlags, src, dest, group->activeMask);
+            break;
+
+        case ADD_HANDLER:
+            kernels->add(dest, src, group->activeMask);
+            break;
+
+        case SUB_HANDLER:
+            kernels->subtract(dest, src, group->activeMask);
+            break;
+
+        case NOT_HANDLER:
+            kernels->complement(dest, group->activeMask);
+            break;
+
+        case CLR_HANDLER:
+            kernels->fill(group->srcRow, 0);
+            kernels->move(dest, group->srcRow, group->activeMask);
+            break;
+
+        case LEA_HANDLER:
+            kernels->fill(group->srcRow, microOp->src);
+            kernels->move(dest, group->srcRow, group->activeMask);
+            break;
+
+        case INC_HANDLER:
+            kernels->add(dest, group->oneRow, group->activeMask);
+            break;
+
+        case DEC_HANDLER:
+            kernels->subtract(dest, group->oneRow, group->activeMask);
+            break;
+
+        case JMP_HANDLER:
+            JumpLanes(group, microOp, group->activeLanes, next);
+            continue;
+
+        case BNE_HANDLER:
+            JumpLanes(group,
+                      microOp,
+                      group->activeLanes & ~kernels->getSetLanes(group->zeroFlags),
+                      next);
+            continue;
+
+        case RED_HANDLER:
+            ReadLanes(group, dest);
+            break;
+
+        case PRN_HANDLER:
+            PrintLanes(group, dest);
+            break;
+
+        case JSR_HANDLER:
+            PushReturnAddresses(group, next);
+            if (0 != group->activeLanes)
+            {
+                JumpLanes(group, microOp, group->activeLanes, next);
+            }
+            continue;
+
+        case RTS_HANDLER:
+            ReturnLanes(group);
+            continue;
+
+        case STOP_HANDLER:
+            FinishLanes(group, group->activeLanes, SIMULATION_STOPPED, pc);
+            continue;
+
+        case ILLEGAL_HANDLER:
+            FinishLanes(group, group->activeLanes, SIMULATION_ILLEGAL_INSTRUCTION, pc);
+            continue;
+
+        default:
+            FinishLanes(group, group->activeLanes, SIMULATION_ADDRESS_ERROR, pc);
+            continue;
+        }
+
+        if (IS_STORE_HANDLER[microOp->handler] && MEMORY_SPACE == microOp->destSpace)
+        {
+            MarkWritten(group, microOp->dest);
+        }
+
+        MoveLanes(group, next);
+    }
+}
+
+/* The lanes run the instruction as the program has it, unless a word of
+ * it was written */
+static const MicroOp *DecodeLaneInstruction(LaneGroup *group, unsigned int pc)
+{
+    const MicroOp *microOp = GetMicroOp(&group->program, pc);
+    unsigned int address = pc;
+
+    for (; address < pc + microOp->length && address < MEMORY_SIZE; ++address)
+    {
+        if (group->isWritten[address])
+        {
+            group->isTainted[pc] = TRUE;
+        }
+    }
+
+    return microOp;
+}
+
+static unsigned short *GetOperandRow(LaneGroup *group,
+                                     unsigned int space,
+                                     unsigned int offset,
+                                     unsigned short *immediateRow)
+{
+    switch (space)
+    {
+    case MEMORY_SPACE:
+        return ROW(group->memory, offset);
+    case REGISTER_SPACE:
+        return ROW(group->registers, offset);
+    default:
+        group->kernels->fill(immediateRow, group->program.immediates[offset]);
+        return immediateRow;
+    }
+}
+
+/* Makes the running lanes at the smallest pc the active lanes. The pcs of
+ * all the running lanes must be in pcs. */
+static void SelectLanes(LaneGroup *group)
+{
+    const LaneKernels *kernels = group->kernels;
+    unsigned long changedLanes = 0;
+    unsigned int lane = 0;
+
+    if (0 == group->runningLanes)
+    {
+        group->activeLanes = 0;
+        return;
+    }
+
+    group->pc = kernels->getMinimum(group->pcs, NO_LANE_PC);
+    group->waitingPc = kernels->getMinimum(group->pcs, group->pc);
+    changedLanes = group->activeLanes;
+    group->activeLanes = kernels->getEqualLanes(group->pcs, group->pc);
+    changedLanes ^= group->activeLanes;
+
+    for (lane = 0; 0 != changedLanes; ++lane, changedLanes >>= 1)
+    {
+        if (0 == (changedLanes & 1))
+        {
+            continue;
+        }
+
+        if (group->activeLanes & LANE_BIT(lane))
+        {
+            group->idleSteps[lane] += group->numOfSteps - group->waitingSince[lane];
+        }
+        else
+        {
+            group->waitingSince[lane] = group->numOfSteps;
+        }
+    }
+
+    kernels->expand(group->activeMask, group->activeLanes);
+    UpdateStepLimit(group);
+
+    if (CountLanes(group->activeLanes) > MAX_SPARSE_LANES)
+    {
+        group->isSparse = FALSE;
+    }
+    else if (!group->isSparse)
+    {
+        group->isSparse = TRUE;
+        group->sparseSince = group->numOfSteps;
+    }
+}
+
+/* The steps of a lane are the steps of the group it did not wait */
+static void UpdateStepLimit(LaneGroup *group)
+{
+    unsigned long minIdleSteps = ULONG_MAX;
+    unsigned int lane = 0;
+
+    if (0 == group->maxSteps)
+    {
+        group->stepLimit = ULONG_MAX;
+        return;
+    }
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        if ((group->activeLanes & LANE_BIT(lane)) && group->idleSteps[lane] < minIdleSteps)
+        {
+            minIdleSteps = group->idleSteps[lane];
+        }
+    }
+
+    group->stepLimit = (ULONG_MAX == minIdleSteps) ? ULONG_MAX : group->maxSteps + minIdleSteps;
+}
+
+/* Moves the active lanes to pc. They stay the active lanes unless other
+ * lanes wait at a smaller or equal pc. */
+static void MoveLanes(LaneGroup *group, unsigned int pc)
+{
+    if (pc >= MEMORY_SIZE)
+    {
+        FinishLanes(group, group->activeLanes, SIMULATION_ADDRESS_ERROR, group->pc);
+        return;
+    }
+
+    if (pc < group->waitingPc)
+    {
+        group->pc = pc;
+        return;
+    }
+
+    group->kernels->fill(group->srcRow, pc);
+    group->kernels->move(group->pcs, group->srcRow, group->activeMask);
+    SelectLanes(group);
+}
+
+/* The jumping lanes go to the target of the instruction (a register holds
+ * a target per lane), and the other active lanes to next */
+static void JumpLanes(LaneGroup *group,
+                      const MicroOp *microOp,
+                      unsigned long jumpingLanes,
+                      unsigned int next)
+{
+    const LaneKernels *kernels = group->kernels;
+    const unsigned short *targets = NULL;
+    unsigned long outOfMemoryLanes = 0;
+    unsigned int lane = 0;
+
+    if (REGISTER_SPACE == microOp->destSpace)
+    {
+        targets = ROW(group->registers, microOp->dest);
+    }
+    else if (jumpingLanes == group->activeLanes)
+    {
+        MoveLanes(group, microOp->dest);
+        return;
+    }
+    else if (0 == jumpingLanes)
+    {
+        MoveLanes(group, next);
+        return;
+    }
+    else
+    {
+        kernels->fill(group->destRow, microOp->dest);
+        targets = group->destRow;
+    }
+
+    kernels->fill(group->srcRow, next);
+    kernels->move(group->pcs, group->srcRow, group->activeMask);
+    kernels->expand(group->jumpMask, jumpingLanes);
+    kernels->move(group->pcs, targets, group->jumpMask);
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        if ((group->activeLanes & LANE_BIT(lane)) && group->pcs[lane] >= MEMORY_SIZE)
+        {
+            outOfMemoryLanes |= LANE_BIT(lane);
+        }
+    }
+
+    FinishLanes(group, outOfMemoryLanes, SIMULATION_ADDRESS_ERROR, group->pc);
+    SelectLanes(group);
+}
+
+/* Every lane reads its own copy of the input */
+static void ReadLanes(LaneGroup *group, unsigned short *dest)
+{
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        int value = EOF;
+
+        if (group->activeLanes & LANE_BIT(lane) &&
+            group->inputPositions[lane] == group->inputSize &&
+            NULL != group->inputSource)
+        {
+            ExtendLaneInput(group);
+        }
+
+        if (group->activeLanes & LANE_BIT(lane) &&
+            group->inputPositions[lane] < group->inputSize)
+        {
+            value = group->input[group->inputPositions[lane]++];
+        }
+
+        group->srcRow[lane] = (unsigned short)(value & MEMORY_WORD_MASK);
+    }
+
+    group->kernels->move(dest, group->srcRow, group->activeMask);
+}
+
+/* Reads a character more into the input of the lanes: from inputFile,
+ * where a lane finished by RunMachine may have read further, or else from
+ * the source of the input */
+static void ExtendLaneInput(LaneGroup *group)
+{
+    int character = EOF;
+
+    if (group->inputSize == group->inputCapacity)
+    {
+        unsigned char *newInput = (unsigned char *)realloc(group->input, 2 * group->inputCapacity);
+
+        if (NULL == newInput)
+        {
+            return; /* The lanes read the end of the input */
+        }
+
+        group->input = newInput;
+        group->inputCapacity *= 2;
+    }
+
+    fseek(group->inputFile, (long)group->inputSize, SEEK_SET);
+    character = ReadInputCharacter(group->inputFile, group->inputSource);
+    if (EOF != character)
+    {
+        group->input[group->inputSize++] = (unsigned char)character;
+    }
+}
+
+static void PrintLanes(LaneGroup *group, const unsigned short *dest)
+{
+    char text[MAX_NUMBER_TEXT_SIZE] = {0};
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        if (group->activeLanes & LANE_BIT(lane))
+        {
+            SimulationResult *result = group->results[lane];
+            int length = sprintf(text, "%d\n", ToSigned(dest[lane]));
+
+            result->outputHash = HashOutput(result->outputHash, text, (size_t)length);
+            result->outputSize += (unsigned long)length;
+        }
+    }
+}
+
+static void PushReturnAddresses(LaneGroup *group, unsigned int returnAddress)
+{
+    unsigned long fullLanes = 0;
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        if (0 == (group->activeLanes & LANE_BIT(lane)))
+        {
+            continue;
+        }
+
+        if (RETURN_STACK_SIZE == group->stackPointers[lane])
+        {
+            fullLanes |= LANE_BIT(lane);
+        }
+        else
+        {
+            ROW(group->returnStacks, group->stackPointers[lane]++)[lane] = (unsigned short)returnAddress;
+        }
+    }
+
+    FinishLanes(group, fullLanes, SIMULATION_STACK_ERROR, group->pc);
+}
+
+static void ReturnLanes(LaneGroup *group)
+{
+    unsigned long emptyLanes = 0, outOfMemoryLanes = 0;
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        if (0 == (group->activeLanes & LANE_BIT(lane)))
+        {
+            continue;
+        }
+
+        if (0 == group->stackPointers[lane])
+        {
+            emptyLanes |= LANE_BIT(lane);
+            continue;
+        }
+
+        group->pcs[lane] = ROW(group->returnStacks, --group->stackPointers[lane])[lane];
+        if (group->pcs[lane] >= MEMORY_SIZE)
+        {
+            outOfMemoryLanes |= LANE_BIT(lane);
+        }
+    }
+
+    FinishLanes(group, emptyLanes, SIMULATION_STACK_ERROR, group->pc);
+    FinishLanes(group, outOfMemoryLanes, SIMULATION_ADDRESS_ERROR, group->pc);
+    SelectLanes(group);
+}
+
+static void FinishOutOfStepsLanes(LaneGroup *group)
+{
+    unsigned long finishedLanes = 0;
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        if ((group->activeLanes & LANE_BIT(lane)) &&
+            group->numOfSteps - group->idleSteps[lane] >= group->maxSteps)
+        {
+            finishedLanes |= LANE_BIT(lane);
+        }
+    }
+
+    FinishLanes(group, finishedLanes, SIMULATION_OUT_OF_STEPS, group->pc);
+    UpdateStepLimit(group);
+}
+
+/* The lanes ended on the instruction at pc */
+static void FinishLanes(LaneGroup *group, unsigned long lanes, SimulationStatus status, unsigned int pc)
+{
+    unsigned int lane = 0;
+    int i = 0;
+
+    for (lane = 0; 0 != lanes; ++lane, lanes >>= 1)
+    {
+        SimulationResult *result = group->results[lane];
+
+        if (0 == (lanes & 1))
+        {
+            continue;
+        }
+
+        result->hasRun = TRUE;
+        result->status = status;
+        result->pc = pc;
+        result->numOfSteps = group->numOfSteps - group->idleSteps[lane];
+        result->zeroFlag = (0 != group->zeroFlags[lane]);
+        for (i = 0; i < NUM_OF_REGISTERS; ++i)
+        {
+            result->registers[i] = ROW(group->registers, i)[lane];
+        }
+
+        group->statistics->numOfLaneSteps += result->numOfSteps - group->program.numOfSteps;
+        RemoveLane(group, lane);
+    }
+}
+
+/* The active lanes are at the start of an instruction they did not run */
+static void FallBackLanes(LaneGroup *group, unsigned long lanes)
+{
+    Machine *machine = group->scalarMachine;
+    unsigned long numOfSteps = 0, hash = 0, size = 0;
+    unsigned int lane = 0, address = 0;
+    int i = 0;
+
+    for (lane = 0; 0 != lanes; ++lane, lanes >>= 1)
+    {
+        SimulationResult *result = group->results[lane];
+
+        if (0 == (lanes & 1))
+        {
+            continue;
+        }
+
+        numOfSteps = group->numOfSteps - group->idleSteps[lane];
+
+        memset(machine, 0, sizeof(Machine));
+        for (address = 0; address < MEMORY_SIZE; ++address)
+        {
+            machine->memory[address] = ROW(group->memory, address)[lane];
+        }
+
+        for (i = 0; i < NUM_OF_REGISTERS; ++i)
+        {
+            machine->registers[i] = ROW(group->registers, i)[lane];
+        }
+
+        for (i = 0; i < group->stackPointers[lane]; ++i)
+        {
+            machine->returnStack[i] = ROW(group->returnStacks, i)[lane];
+        }
+
+        machine->stackPointer = group->stackPointers[lane];
+        machine->pc = group->pc;
+        machine->zeroFlag = (0 != group->zeroFlags[lane]);
+        machine->numOfSteps = numOfSteps;
+        machine->input = group->inputFile;
+        machine->inputSource = group->inputSource;
+        machine->output = group->output;
+        fseek(group->inputFile, (long)group->inputPositions[lane], SEEK_SET);
+        rewind(group->output);
+
+        hash = result->outputHash;
+        size = result->outputSize;
+        GetSimulationResult(machine,
+                            RunMachine(machine, (0 == group->maxSteps) ? 0 : group->maxSteps - numOfSteps),
+                            result);
+        result->outputHash = hash;
+        result->outputSize = size;
+        HashOutputStream(group->output, result);
+
+        group->statistics->numOfLaneSteps += numOfSteps - group->program.numOfSteps;
+        ++group->statistics->numOfScalarLanes;
+        RemoveLane(group, lane);
+    }
+}
+
+static void MarkWritten(LaneGroup *group, unsigned int address)
+{
+    if (!group->isWritten[address])
+    {
+        group->isWritten[address] = TRUE;
+        group->writtenAddresses[group->numOfWrittenAddresses++] = (unsigned short)address;
+    }
+}
+
+static void RemoveLane(LaneGroup *group, unsigned int lane)
+{
+    group->runningLanes &= ~LANE_BIT(lane);
+    group->activeLanes &= ~LANE_BIT(lane);
+    group->pcs[lane] = NO_LANE_PC;
+    group->activeMask[lane] = 0;
+}
+
+static unsigned int CountLanes(unsigned long lanes)
+{
+    unsigned int numOfLanes = 0;
+
+    for (; 0 != lanes; lanes &= lanes - 1)
+    {
+        ++numOfLanes;
+    }
+
+    return numOfLanes;
+}
+
+static int ToSigned(unsigned int word)
+{
+    return (int)((word ^ WORD_SIGN_BIT) & MEMORY_WORD_MASK) - WORD_SIGN_BIT;
+}
+
+static void FillRowScalar(unsigned short *row, unsigned int value)
+{
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        row[lane] = (unsigned short)value;
+    }
+}
+
+static void MoveRowScalar(unsigned short *dest, const unsigned short *src, const unsigned short *mask)
+{
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        dest[lane] = (unsigned short)((dest[lane] & ~mask[lane]) | (src[lane] & mask[lane]));
+    }
+}
+
+static void AddRowScalar(unsigned short *dest, const unsigned short *src, const unsigned short *mask)
+{
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        dest[lane] = (unsigned short)((dest[lane] & ~mask[lane]) |
+                                      ((dest[lane] + src[lane]) & MEMORY_WORD_MASK & mask[lane]));
+    }
+}
+
+static void SubtractRowScalar(unsigned short *dest, const unsigned short *src, const unsigned short *mask)
+{
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        dest[lane] = (unsigned short)((dest[lane] & ~mask[lane]) |
+                                      ((dest[lane] - src[lane]) & MEMORY_WORD_MASK & mask[lane]));
+    }
+}
+
+static void ComplementRowScalar(unsigned short *dest, const unsigned short *mask)
+{
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        dest[lane] = (unsigned short)(dest[lane] ^ (MEMORY_WORD_MASK & mask[lane]));
+    }
+}
+
+static void CompareRowsScalar(unsigned short *zeroFlags,
+                              const unsigned short *src,
+                              const unsigned short *dest,
+                              const unsigned short *mask)
+{
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        zeroFlags[lane] = (unsigned short)((zeroFlags[lane] & ~mask[lane]) |
+                                           ((src[lane] == dest[lane]) ? mask[lane] : 0));
+    }
+}
+
+static unsigned long GetSetLanesScalar(const unsigned short *row)
+{
+    unsigned long lanes = 0;
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        if (0 != row[lane])
+        {
+            lanes |= LANE_BIT(lane);
+        }
+    }
+
+    return lanes;
+}
+
+static unsigned long GetEqualLanesScalar(const unsigned short *row, unsigned int value)
+{
+    unsigned long lanes = 0;
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        if (value == row[lane])
+        {
+            lanes |= LANE_BIT(lane);
+        }
+    }
+
+    return lanes;
+}
+
+/* NO_LANE_PC when every lane has the excluded value */
+static unsigned int GetMinimumScalar(const unsigned short *row, unsigned int excludedValue)
+{
+    unsigned int minimum = NO_LANE_PC, lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        if (row[lane] != excludedValue && row[lane] < minimum)
+        {
+            minimum = row[lane];
+        }
+    }
+
+    return minimum;
+}
+
+static void ExpandLanesScalar(unsigned short *mask, unsigned long lanes)
+{
+    unsigned int lane = 0;
+
+    for (lane = 0; lane < NUM_OF_LANES; ++lane)
+    {
+        mask[lane] = (lanes & LANE_BIT(lane)) ? LANE_SET : 0;
+    }
+}
+
+#ifdef AVX2_LANES
+__attribute__((target("avx2")))
+static void FillRowAVX2(unsigned short *row, unsigned int value)
+{
+    __m256i words = _mm256_set1_epi16((short)value);
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_ROW_VECTORS; ++i)
+    {
+        _mm256_storeu_si256((__m256i *)row + i, words);
+    }
+}
+
+__attribute__((target("avx2")))
+static void MoveRowAVX2(unsigned short *dest, const unsigned short *src, const unsigned short *mask)
+{
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_ROW_VECTORS; ++i)
+    {
+        __m256i destWords = _mm256_loadu_si256((const __m256i *)dest + i);
+        __m256i srcWords = _mm256_loadu_si256((const __m256i *)src + i);
+        __m256i lanes = _mm256_loadu_si256((const __m256i *)mask + i);
+
+        _mm256_storeu_si256((__m256i *)dest + i, _mm256_blendv_epi8(destWords, srcWords, lanes));
+    }
+}
+
+__attribute__((target("avx2")))
+static void AddRowAVX2(unsigned short *dest, const unsigned short *src, const unsigned short *mask)
+{
+    const __m256i wordMask = _mm256_set1_epi16(MEMORY_WORD_MASK);
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_ROW_VECTORS; ++i)
+    {
+        __m256i destWords = _mm256_loadu_si256((const __m256i *)dest + i);
+        __m256i sums = _mm256_and_si256(_mm256_add_epi16(destWords,
+                                                         _mm256_loadu_si256((const __m256i *)src + i)),
+                                        wordMask);
+        __m256i lanes = _mm256_loadu_si256((const __m256i *)mask + i);
+
+        _mm256_storeu_si256((__m256i *)dest + i, _mm256_blendv_epi8(destWords, sums, lanes));
+    }
+}
+
+__attribute__((target("avx2")))
+static void SubtractRowAVX2(unsigned short *dest, const unsigned short *src, const unsigned short *mask)
+{
+    const __m256i wordMask = _mm256_set1_epi16(MEMORY_WORD_MASK);
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_ROW_VECTORS; ++i)
+    {
+        __m256i destWords = _mm256_loadu_si256((const __m256i *)dest + i);
+        __m256i differences = _mm256_and_si256(_mm256_sub_epi16(destWords,
+                                                                _mm256_loadu_si256((const __m256i *)src + i)),
+                                               wordMask);
+        __m256i lanes = _mm256_loadu_si256((const __m256i *)mask + i);
+
+        _mm256_storeu_si256((__m256i *)dest + i, _mm256_blendv_epi8(destWords, differences, lanes));
+    }
+}
+
+/* The words have no bits above the 14, so not is a xor with the mask */
+__attribute__((target("avx2")))
+static void ComplementRowAVX2(unsigned short *dest, const unsigned short *mask)
+{
+    const __m256i wordMask = _mm256_set1_epi16(MEMORY_WORD_MASK);
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_ROW_VECTORS; ++i)
+    {
+        __m256i lanes = _mm256_loadu_si256((const __m256i *)mask + i);
+
+        _mm256_storeu_si256((__m256i *)dest + i,
+                            _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)dest + i),
+                                             _mm256_and_si256(lanes, wordMask)));
+    }
+}
+
+__attribute__((target("avx2")))
+static void CompareRowsAVX2(unsigned short *zeroFlags,
+                            const unsigned short *src,
+                            const unsigned short *dest,
+                            const unsigned short *mask)
+{
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_ROW_VECTORS; ++i)
+    {
+        __m256i isEqual = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)src + i),
+                                             _mm256_loadu_si256((const __m256i *)dest + i));
+        __m256i lanes = _mm256_loadu_si256((const __m256i *)mask + i);
+
+        _mm256_storeu_si256((__m256i *)zeroFlags + i,
+                            _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i *)zeroFlags + i),
+                                               isEqual,
+                                               lanes));
+    }
+}
+
+/* The packs saturate LANE_SET to a byte of ones, a lane per byte, but
+ * interleave the 128-bit halves of the two vectors; the permute puts the
+ * lanes back in order before the bytes are gathered */
+__attribute__((target("avx2")))
+static unsigned long GetSetLanesAVX2(const unsigned short *row)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i isSet[NUM_OF_ROW_VECTORS];
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_ROW_VECTORS; ++i)
+    {
+        isSet[i] = _mm256_xor_si256(_mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)row + i), zero),
+                                    _mm256_set1_epi16(-1));
+    }
+
+    return (unsigned long)(unsigned int)_mm256_movemask_epi8(
+        _mm256_permute4x64_epi64(_mm256_packs_epi16(isSet[0], isSet[1]), 0xD8));
+}
+
+__attribute__((target("avx2")))
+static unsigned long GetEqualLanesAVX2(const unsigned short *row, unsigned int value)
+{
+    const __m256i words = _mm256_set1_epi16((short)value);
+    __m256i isEqual[NUM_OF_ROW_VECTORS];
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_ROW_VECTORS; ++i)
+    {
+        isEqual[i] = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)row + i), words);
+    }
+
+    return (unsigned long)(unsigned int)_mm256_movemask_epi8(
+        _mm256_permute4x64_epi64(_mm256_packs_epi16(isEqual[0], isEqual[1]), 0xD8));
+}
+
+/* The excluded lanes become 0xFFFF (NO_LANE_PC), and minpos finds the
+ * smallest of the last 8 words */
+__attribute__((target("avx2")))
+static unsigned int GetMinimumAVX2(const unsigned short *row, unsigned int excludedValue)
+{
+    const __m256i excludedWords = _mm256_set1_epi16((short)excludedValue);
+    __m256i minimum = _mm256_set1_epi16(-1);
+    __m128i halfMinimum;
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_ROW_VECTORS; ++i)
+    {
+        __m256i words = _mm256_loadu_si256((const __m256i *)row + i);
+
+        minimum = _mm256_min_epu16(minimum,
+                                   _mm256_or_si256(words, _mm256_cmpeq_epi16(words, excludedWords)));
+    }
+
+    halfMinimum = _mm_min_epu16(_mm256_castsi256_si128(minimum), _mm256_extracti128_si256(minimum, 1));
+
+    return (unsigned int)_mm_cvtsi128_si32(_mm_minpos_epu16(halfMinimum)) & NO_LANE_PC;
+}
+
+__attribute__((target("avx2")))
+static void ExpandLanesAVX2(unsigned short *mask, unsigned long lanes)
+{
+    const __m256i laneBits = _mm256_setr_epi16(0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+                                               0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000,
+                                               (short)0x8000);
+    int i = 0;
+
+    for (i = 0; i < NUM_OF_ROW_VECTORS; ++i, lanes >>= 16)
+    {
+        __m256i bits = _mm256_and_si256(_mm256_set1_epi16((short)(lanes & 0xFFFF)), laneBits);
+
+        _mm256_storeu_si256((__m256i *)mask + i, _mm256_cmpeq_epi16(bits, laneBits));
+    }
+}
+#endif /* AVX2_LANES */
@@ -0,0 +1,1090 @@
+/****************************************
+* ASSEMBLER: simulator_main.c           *
+****************************************/
+
+#include <stdio.h>  /* FILE, fprintf, fopen, fclose, fflush, tmpfile, sprintf */
+#include <errno.h>  /* errno */
+#include <string.h> /* strerror, strcat, strcpy, strcmp, memcmp, memset */
+#include <stdlib.h> /* EXIT_SUCCESS, EXIT_FAILURE, strtoul */
+#include <limits.h> /* INT_MAX */
+#include <time.h>   /* clock, CLOCKS_PER_SEC */
+#include <assert.h> /* assert */
+
+#include "simulator.h"         /* API */
+#include "simulator_jit.h"     /* API */
+#include "simulator_batch.h"   /* API */
+#include "simulator_lanes.h"   /* API */
+#include "diagnostics.h"       /* API */
+#include "operations.h"        /* API */
+#include "instruction_table.h" /* AddressingMethods */
+#include "memory_word.h"       /* MEMORY_WORD_MASK */
+#include "assembler_utils.h"   /* Utils file */
+
+/* Steps of a random program of -f without -s */
+#define RANDOM_PROGRAM_STEPS (100000)
+
+/* Steps of a program of -p, or of an instance of -v, without -s */
+#define BATCH_PROGRAM_STEPS (10000000)
+
+/* Sizes of a random program, in words */
+#define MIN_RANDOM_CODE_SIZE (8)
+#define MAX_RANDOM_CODE_SIZE (120)
+#define MAX_RANDOM_DATA_SIZE (20)
+
+/* The name of an instance of -v in the results: its line number */
+#define MAX_NUMBER_TEXT_SIZE (24)
+
+/* The operands jmp, bne and jsr may have */
+#define JUMP_ADDRESSING_METHODS (ADDRESSING_METHOD_FLAG(DIRECT_ADDRESSING) | \
+                                 ADDRESSING_METHOD_FLAG(DIRECT_REGISTER_ADDRESSING))
+
+static const char *OBJECT_FILE_POSTFIX = ".ob";
+static const char *BINARY_OBJECT_FILE_POSTFIX = ".bin";
+static const char *READING_MODE = "r";
+static const char *WRITING_MODE = "w";
+static const char *STEPS_OPTION = "-s";
+static const char *STATISTICS_OPTION = "-t";
+static const char *BINARY_OBJECT_OPTION = "-b";
+static const char *UNCACHED_OPTION = "-d";
+static const char *JIT_OPTION = "-j";
+static const char *COMPARE_OPTION = "-x";
+static const char *RANDOM_PROGRAMS_OPTION = "-f";
+static const char *MACHINE_OPTION = "-m";
+static const char *BATCH_OPTION = "-p";
+static const char *RESULTS_OPTION = "-o";
+static const char *THREADS_OPTION = "-w";
+static const char *INSTANCES_OPTION = "-v";
+static const char RANDOM_PROGRAM_INPUT[] = "The quick brown fox jumps over the lazy dog\n";
+
+/* Operation codes of a random instruction; jumps and jsr are repeated so
+ * random programs loop and call, and stop is left for the end */
+static const unsigned char RANDOM_OPERATION_CODES[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 10, 10,
+                                                       11, 12, 13, 13, 14, 0, 1, 7, 8, 10};
+
+typedef enum
+{
+    MICRO_OP_ENGINE, /* RunMachine */
+    UNCACHED_ENGINE, /* RunMachineUncached (-d) */
+    JIT_ENGINE,      /* RunMachineJit (-j) */
+    COMPARE_ENGINES  /* RunMachine and RunMachineJit, compared (-x) */
+} Engine;
+
+typedef struct
+{
+    unsigned long maxSteps;
+    bool printStatistics;
+    bool printMachine; /* The registers and the memory at the end (-m) */
+    bool isBinaryObject;
+    Engine engine;
+    Jit *jit;     /* NULL when the JIT is not supported (runs RunMachine) */
+    FILE *input;       /* What was read of inputSource, replayed by every run (-x) */
+    FILE *inputSource; /* stdin with -x, read only as far as a program reads it */
+} SimulatorOptions;
+
+/* A random program being written (-f) */
+typedef struct
+{
+    Machine *machine;
+    unsigned long random;
+    unsigned int codeSize;
+    unsigned int dataSize;
+} RandomProgram;
+
+static bool SimulateFile(const char *filename, const SimulatorOptions *options);
+static bool LoadMachine(Machine *machine, const char *filename, const SimulatorOptions *options);
+static bool RunInstancesFile(const char *filename,
+                             const char *dataSegmentsFilename,
+                             const char *resultsFilename,
+                             const SimulatorOptions *options);
+static bool RunInstanceEngine(InstanceEngine engine,
+                              const Machine *machine,
+                              const InstanceSet *instances,
+                              unsigned long maxSteps,
+                              SimulationResult *results,
+                              FILE *input);
+static bool WriteInstanceResults(const char *resultsFilename,
+                                 const SimulationResult *results,
+                                 size_t numOfInstances);
+static bool RunBatchFile(const char *manifestFilename,
+                         const char *resultsFilename,
+                         int numOfThreads,
+                         const SimulatorOptions *options);
+static void PrintMachine(const Machine *machine, FILE *stream);
+static bool CompareEngines(const Machine *loadedMachine,
+                           const SimulatorOptions *options,
+                           const char *name,
+                           bool printOutput);
+static const char *FindDifference(const Machine *interpreted,
+                                  SimulationStatus interpretedStatus,
+                                  const Machine *compiled,
+                                  SimulationStatus compiledStatus);
+static bool AreStreamsEqual(FILE *first, FILE *second);
+static void CopyStream(FILE *destination, FILE *source);
+static bool CompareOnRandomPrograms(unsigned long numOfPrograms, SimulatorOptions *options);
+static void GenerateProgram(Machine *machine, unsigned long seed);
+static unsigned int AddRandomOperand(RandomProgram *program,
+                                     unsigned int address,
+                                     AddressingMethods addressingMethod,
+                                     int registerShift);
+static unsigned int GetRandomAddressingMethod(RandomProgram *program, unsigned char addressingMethods);
+static unsigned int GetRandomAddress(RandomProgram *program);
+static unsigned int GetRandom(RandomProgram *program);
+
+/* Runs the object file of every program (prn to stdout, red from stdin) */
+int main(int argc, char *argv[])
+{
+    int i = 1, exitStatus = EXIT_SUCCESS;
+    unsigned long numOfRandomPrograms = 0, numOfThreads = 0;
+    const char *manifestFilename = NULL, *resultsFilename = NULL, *dataSegmentsFilename = NULL;
+    SimulatorOptions options = {0};
+
+    options.engine = MICRO_OP_ENGINE;
+
+    for (; i < argc && '-' == argv[i][0]; ++i)
+    {
+        if ((0 == strcmp(argv[i], STEPS_OPTION) ||
+             0 == strcmp(argv[i], RANDOM_PROGRAMS_OPTION) ||
+             0 == strcmp(argv[i], THREADS_OPTION)) &&
+            i + 1 < argc)
+        {
+            const char *option = argv[i];
+            char *end = NULL;
+            unsigned long number = strtoul(argv[++i], &end, 10);
+
+            if (END_LINE != *end || END_LINE == argv[i][0])
+            {
+                break;
+            }
+
+            if (0 == strcmp(option, STEPS_OPTION))
+            {
+                options.maxSteps = number;
+            }
+            else if (0 == strcmp(option, RANDOM_PROGRAMS_OPTION))
+            {
+                numOfRandomPrograms = number;
+            }
+            else
+            {
+                numOfThreads = number;
+            }
+        }
+        else if (0 == strcmp(argv[i], BATCH_OPTION) && i + 1 < argc)
+        {
+            manifestFilename = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], INSTANCES_OPTION) && i + 1 < argc)
+        {
+            dataSegmentsFilename = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], RESULTS_OPTION) && i + 1 < argc)
+        {
+            resultsFilename = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], STATISTICS_OPTION))
+        {
+            options.printStatistics = TRUE;
+        }
+        else if (0 == strcmp(argv[i], MACHINE_OPTION))
+        {
+            options.printMachine = TRUE;
+        }
+        else if (0 == strcmp(argv[i], BINARY_OBJECT_OPTION))
+        {
+            options.isBinaryObject = TRUE;
+        }
+        else if (0 == strcmp(argv[i], UNCACHED_OPTION))
+        {
+            options.engine = UNCACHED_ENGINE;
+        }
+        else if (0 == strcmp(argv[i], JIT_OPTION))
+        {
+            options.engine = JIT_ENGINE;
+        }
+        else if (0 == strcmp(argv[i], COMPARE_OPTION))
+        {
+            options.engine = COMPARE_ENGINES;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if ((i == argc && 0 == numOfRandomPrograms && NULL == manifestFilename) ||
+        (i < argc && '-' == argv[i][0]) ||
+        (NULL != manifestFilename &&
+         (i < argc || 0 != numOfRandomPrograms || numOfThreads > INT_MAX ||
+          JIT_ENGINE == options.engine || COMPARE_ENGINES == options.engine)) ||
+        (NULL != dataSegmentsFilename &&
+         (i + 1 != argc || 0 != numOfRandomPrograms || NULL != manifestFilename ||
+          JIT_ENGINE == options.engine)))
+    {
+        fprintf(stderr,
+                "Usage: %s [-s MAX_STEPS] [-t] [-m] [-b] [-d | -j | -x] file...\n"
+                "       %s [-s MAX_STEPS] -f NUM_OF_PROGRAMS\n"
+                "       %s [-s MAX_STEPS] [-b] [-d] [-w NUM_OF_THREADS] [-o RESULTS] -p MANIFEST\n"
+                "       %s [-s MAX_STEPS] [-b] [-d | -x] [-o RESULTS] -v DATA_SEGMENTS file\n",
+                argv[0],
+                argv[0],
+                argv[0],
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (NULL != dataSegmentsFilename)
+    {
+        return RunInstancesFile(argv[i], dataSegmentsFilename, resultsFilename, &options)
+                   ? EXIT_SUCCESS
+                   : EXIT_FAILURE;
+    }
+
+    if (NULL != manifestFilename)
+    {
+        return RunBatchFile(manifestFilename, resultsFilename, (int)numOfThreads, &options)
+                   ? EXIT_SUCCESS
+                   : EXIT_FAILURE;
+    }
+
+    if (JIT_ENGINE == options.engine || COMPARE_ENGINES == options.engine || 0 != numOfRandomPrograms)
+    {
+        options.jit = CreateJit();
+        if (NULL == options.jit)
+        {
+            fprintf(stderr, "%s: the JIT is not supported here, the interpreter runs instead\n", argv[0]);
+        }
+    }
+
+    if (0 != numOfRandomPrograms)
+    {
+        /* Random programs often loop forever */
+        if (0 == options.maxSteps)
+        {
+            options.maxSteps = RANDOM_PROGRAM_STEPS;
+        }
+
+        if (!CompareOnRandomPrograms(numOfRandomPrograms, &options))
+        {
+            exitStatus = EXIT_FAILURE;
+        }
+    }
+
+    if (COMPARE_ENGINES == options.engine && i < argc)
+    {
+        /* Both engines read the same input, so what is read of stdin is
+         * kept. It is read as the programs read it, so a terminal is read
+         * line by line. */
+        options.input = tmpfile();
+        if (NULL == options.input)
+        {
+            fprintf(stderr, "Error creating a temporary file: %s\n", strerror(errno));
+            DestroyJit(options.jit);
+            return EXIT_FAILURE;
+        }
+
+        options.inputSource = stdin;
+    }
+
+    for (; i < argc; ++i)
+    {
+        if (!SimulateFile(argv[i], &options))
+        {
+            exitStatus = EXIT_FAILURE;
+        }
+    }
+
+    if (NULL != options.input)
+    {
+        fclose(options.input);
+    }
+
+    DestroyJit(options.jit);
+
+    return exitStatus;
+}
+
+/* Static functions */
+static bool SimulateFile(const char *filename, const SimulatorOptions *options)
+{
+    static Machine machine;
+    SimulationStatus status = SIMULATION_STOPPED;
+    clock_t startTime = 0;
+    double seconds = 0;
+
+    if (!LoadMachine(&machine, filename, options))
+    {
+        return FALSE;
+    }
+
+    if (COMPARE_ENGINES == options->engine)
+    {
+        return CompareEngines(&machine, options, filename, TRUE);
+    }
+
+    startTime = clock();
+    switch (options->engine)
+    {
+    case UNCACHED_ENGINE:
+        status = RunMachineUncached(&machine, options->maxSteps);
+        break;
+    case JIT_ENGINE:
+        status = RunMachineJit(options->jit, &machine, options->maxSteps);
+        break;
+    default:
+        status = RunMachine(&machine, options->maxSteps);
+        break;
+    }
+    seconds = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+    fflush(stdout);
+
+    if (SIMULATION_STOPPED != status)
+    {
+        fprintf(stderr, "%s: %s at address %04u\n",
+                filename,
+                GetSimulationStatusName(status),
+                machine.pc);
+    }
+
+    if (options->printMachine)
+    {
+        PrintMachine(&machine, stderr);
+    }
+
+    if (options->printStatistics)
+    {
+        fprintf(stderr, "%s: %lu steps in %.3f s (%.1f million steps per second)\n",
+                filename,
+                machine.numOfSteps,
+                seconds,
+                (seconds > 0) ? machine.numOfSteps / seconds / 1e6 : 0.0);
+    }
+
+    return (SIMULATION_STOPPED == status);
+}
+
+/* Loads filename.ob (or filename.bin with -b); red reads stdin and prn
+ * writes to stdout */
+static bool LoadMachine(Machine *machine, const char *filename, const SimulatorOptions *options)
+{
+    Diagnostics diagnostics = {0};
+    FILE *objectFile = NULL;
+    char filenameWithPostfix[MAX_FILENAME_SIZE] = {0};
+
+    assert(NULL != machine);
+    assert(NULL != filename);
+    assert(NULL != options);
+
+    strcpy(filenameWithPostfix, filename);
+    strcat(filenameWithPostfix,
+           options->isBinaryObject ? BINARY_OBJECT_FILE_POSTFIX : OBJECT_FILE_POSTFIX);
+
+    objectFile = fopen(filenameWithPostfix, READING_MODE);
+    if (NULL == objectFile)
+    {
+        fprintf(stderr, "Error opening file \"%s\": %s\n", filenameWithPostfix, strerror(errno));
+        return FALSE;
+    }
+
+    memset(machine, 0, sizeof(Machine));
+    machine->input = stdin;
+    machine->output = stdout;
+    diagnostics.stream = stderr;
+
+    if (SUCCESS != (options->isBinaryObject
+                        ? LoadBinaryObjectFile(machine, objectFile, &diagnostics)
+                        : LoadObjectFile(machine, objectFile, &diagnostics)))
+    {
+        fclose(objectFile);
+        return FALSE;
+    }
+
+    fclose(objectFile);
+
+    return TRUE;
+}
+
+/* Runs filename once per line of data segments (-v) and writes a results
+ * line per instance, numbered from 1 in the order of the file. With -x,
+ * every engine this processor supports runs the instances and is compared
+ * with running them one by one. */
+static bool RunInstancesFile(const char *filename,
+                             const char *dataSegmentsFilename,
+                             const char *resultsFilename,
+                             const SimulatorOptions *options)
+{
+    static Machine machine;
+    Diagnostics diagnostics = {0};
+    InstanceSet instances = {0};
+    SimulationResult *results = NULL, *engineResults = NULL;
+    FILE *dataSegments = NULL, *input = NULL;
+    unsigned long maxSteps = (0 == options->maxSteps) ? BATCH_PROGRAM_STEPS : options->maxSteps;
+    size_t i = 0, numOfStopped = 0;
+    int engine = 0;
+    bool isSuccessful = FALSE;
+
+    assert(NULL != filename);
+    assert(NULL != dataSegmentsFilename);
+    assert(NULL != options);
+
+    if (!LoadMachine(&machine, filename, options))
+    {
+        return FALSE;
+    }
+
+    dataSegments = fopen(dataSegmentsFilename, READING_MODE);
+    if (NULL == dataSegments)
+    {
+        fprintf(stderr, "Error opening file \"%s\": %s\n", dataSegmentsFilename, strerror(errno));
+        return FALSE;
+    }
+
+    diagnostics.stream = stderr;
+    if (SUCCESS != ReadInstanceSet(dataSegments,
+                                   MEMORY_SIZE - STARTING_ADDRESS - machine.numOfCodeWords,
+                                   &instances,
+                                   &diagnostics))
+    {
+        fclose(dataSegments);
+        return FALSE;
+    }
+
+    fclose(dataSegments);
+
+    /* Every instance reads stdin from its start: what is read of it is kept
+     * in input, and stdin is read only as far as an instance reads it */
+    input = tmpfile();
+    machine.inputSource = stdin;
+    results = (SimulationResult *)calloc(instances.numOfInstances + 1, sizeof(SimulationResult));
+    engineResults = (SimulationResult *)calloc(instances.numOfInstances + 1, sizeof(SimulationResult));
+    if (NULL == input || NULL == results || NULL == engineResults)
+    {
+        fprintf(stderr, "Error creating the instances: %s\n", strerror(errno));
+    }
+    else
+    {
+        if (COMPARE_ENGINES != options->engine)
+        {
+            isSuccessful = RunInstanceEngine((UNCACHED_ENGINE == options->engine)
+                                                 ? ONE_BY_ONE_ENGINE
+                                                 : GetInstanceEngine(),
+                                             &machine,
+                                             &instances,
+                                             maxSteps,
+                                             results,
+                                             input);
+        }
+        else
+        {
+            isSuccessful = RunInstanceEngine(ONE_BY_ONE_ENGINE, &machine, &instances, maxSteps, results, input);
+            for (engine = ONE_BY_ONE_ENGINE + 1; isSuccessful && engine < NUM_OF_INSTANCE_ENGINES; ++engine)
+            {
+                if (!IsInstanceEngineSupported((InstanceEngine)engine))
+                {
+                    continue;
+                }
+
+                isSuccessful = RunInstanceEngine((InstanceEngine)engine,
+                                                 &machine,
+                                                 &instances,
+                                                 maxSteps,
+                                                 engineResults,
+                                                 input);
+                for (i = 0; isSuccessful && i < instances.numOfInstances; ++i)
+                {
+                    if (!IsSameSimulationResult(results + i, engineResults + i))
+                    {
+                        fprintf(stderr, "%s: the %s engine and running one by one differ on instance %lu\n",
+                                filename,
+                                GetInstanceEngineName((InstanceEngine)engine),
+                                (unsigned long)i);
+                        isSuccessful = FALSE;
+                    }
+                }
+            }
+        }
+    }
+
+    if (isSuccessful)
+    {
+        isSuccessful = WriteInstanceResults(resultsFilename, results, instances.numOfInstances);
+    }
+
+    for (i = 0; isSuccessful && i < instances.numOfInstances; ++i)
+    {
+        if (SIMULATION_STOPPED == results[i].status)
+        {
+            ++numOfStopped;
+        }
+    }
+
+    if (isSuccessful && numOfStopped != instances.numOfInstances)
+    {
+        fprintf(stderr, "%s: %lu of %lu instances did not stop\n",
+                filename,
+                (unsigned long)(instances.numOfInstances - numOfStopped),
+                (unsigned long)instances.numOfInstances);
+        isSuccessful = FALSE;
+    }
+
+    free(engineResults);
+    free(results);
+    if (NULL != input)
+    {
+        fclose(input);
+    }
+    DestroyInstanceSet(&instances);
+
+    return isSuccessful;
+}
+
+/* Runs the instances and reports the throughput to stderr */
+static bool RunInstanceEngine(InstanceEngine engine,
+                              const Machine *machine,
+                              const InstanceSet *instances,
+                              unsigned long maxSteps,
+                              SimulationResult *results,
+                              FILE *input)
+{
+    InstanceStatistics statistics = {0};
+    clock_t startTime = clock();
+    double seconds = 0, numOfSteps = 0;
+    size_t i = 0;
+
+    if (SUCCESS != RunInstances(engine, machine, instances, input, maxSteps, results, &statistics))
+    {
+        fprintf(stderr, "Error running the instances: %s\n", strerror(errno));
+        return FALSE;
+    }
+
+    seconds = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+
+    for (i = 0; i < instances->numOfInstances; ++i)
+    {
+        numOfSteps += results[i].numOfSteps;
+    }
+
+    fprintf(stderr,
+            "%lu instances %s in %.3f s: %.0f instances per second, %.1f million steps per second",
+            (unsigned long)instances->numOfInstances,
+            GetInstanceEngineName(engine),
+            seconds,
+            (seconds > 0) ? instances->numOfInstances / seconds : 0.0,
+            (seconds > 0) ? numOfSteps / seconds / 1e6 : 0.0);
+
+    if (ONE_BY_ONE_ENGINE != engine)
+    {
+        fprintf(stderr, " (%.1f lanes per step, %lu lanes finished one by one)",
+                (statistics.numOfLockstepSteps > 0)
+                    ? (double)statistics.numOfLaneSteps / statistics.numOfLockstepSteps
+                    : 0.0,
+                statistics.numOfScalarLanes);
+    }
+
+    fprintf(stderr, "\n");
+
+    return TRUE;
+}
+
+/* The results go to stdout without -o */
+static bool WriteInstanceResults(const char *resultsFilename,
+                                 const SimulationResult *results,
+                                 size_t numOfInstances)
+{
+    FILE *resultsFile = stdout;
+    char name[MAX_NUMBER_TEXT_SIZE] = {0};
+    size_t i = 0;
+
+    if (NULL != resultsFilename)
+    {
+        resultsFile = fopen(resultsFilename, WRITING_MODE);
+        if (NULL == resultsFile)
+        {
+            fprintf(stderr, "Error opening file \"%s\": %s\n", resultsFilename, strerror(errno));
+            return FALSE;
+        }
+    }
+
+    WriteResultsHeader(resultsFile);
+    for (i = 0; i < numOfInstances; ++i)
+    {
+        sprintf(name, "%lu", (unsigned long)i + 1);
+        WriteSimulationResult(resultsFile, name, results + i);
+    }
+
+    if (stdout != resultsFile && 0 != fclose(resultsFile))
+    {
+        fprintf(stderr, "Error writing file \"%s\": %s\n", resultsFilename, strerror(errno));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* The results go to stdout without -o. Every program gets the step
+ * budget of -s, so a program that loops forever does not stall the batch. */
+static bool RunBatchFile(const char *manifestFilename,
+                         const char *resultsFilename,
+                         int numOfThreads,
+                         const SimulatorOptions *options)
+{
+    BatchOptions batchOptions = {0};
+    FILE *results = stdout;
+    bool haveAllStopped = FALSE;
+
+    batchOptions.maxSteps = (0 == options->maxSteps) ? BATCH_PROGRAM_STEPS : options->maxSteps;
+    batchOptions.numOfThreads = numOfThreads;
+    batchOptions.isBinaryObject = options->isBinaryObject;
+    batchOptions.run = (UNCACHED_ENGINE == options->engine) ? RunMachineUncached : RunMachine;
+
+    if (NULL != resultsFilename)
+    {
+        results = fopen(resultsFilename, WRITING_MODE);
+        if (NULL == results)
+        {
+            fprintf(stderr, "Error opening file \"%s\": %s\n", resultsFilename, strerror(errno));
+            return FALSE;
+        }
+    }
+
+    haveAllStopped = RunBatch(manifestFilename, results, stderr, &batchOptions);
+
+    if (stdout != results && 0 != fclose(results))
+    {
+        fprintf(stderr, "Error writing file \"%s\": %s\n", resultsFilename, strerror(errno));
+        haveAllStopped = FALSE;
+    }
+
+    return haveAllStopped;
+}
+
+/* The lines of the programs of assembler --emit-c with -m, to compare
+ * them with a run of the simulator */
+static void PrintMachine(const Machine *machine, FILE *stream)
+{
+    unsigned int i = 0;
+
+    assert(NULL != machine);
+    assert(NULL != stream);
+
+    fprintf(stream, "steps: %lu\nzero flag: %d\nregisters:", machine->numOfSteps, machine->zeroFlag);
+    for (i = 0; i < NUM_OF_REGISTERS; ++i)
+    {
+        fprintf(stream, " %u", machine->registers[i]);
+    }
+
+    fprintf(stream, "\nreturn stack:");
+    for (i = 0; i < (unsigned int)machine->stackPointer; ++i)
+    {
+        fprintf(stream, " %u", machine->returnStack[i]);
+    }
+
+    fprintf(stream, "\nmemory:\n");
+    for (i = 0; i < MEMORY_SIZE; ++i)
+    {
+        if (0 != machine->memory[i])
+        {
+            fprintf(stream, "%04u %u\n", i, machine->memory[i]);
+        }
+    }
+}
+
+/* Runs a loaded machine with the interpreter and with the JIT and reports
+ * the first difference between the two runs; returns FALSE when they
+ * differ or the program did not stop */
+static bool CompareEngines(const Machine *loadedMachine,
+                           const SimulatorOptions *options,
+                           const char *name,
+                           bool printOutput)
+{
+    static Machine interpreted, compiled;
+    SimulationStatus interpretedStatus = SIMULATION_STOPPED, compiledStatus = SIMULATION_STOPPED;
+    const char *difference = NULL;
+    clock_t startTime = 0;
+    double interpretedSeconds = 0, compiledSeconds = 0;
+
+    assert(NULL != loadedMachine);
+    assert(NULL != options);
+    assert(NULL != options->input);
+    assert(NULL != name);
+
+    interpreted = *loadedMachine;
+    compiled = *loadedMachine;
+    interpreted.output = tmpfile();
+    compiled.output = tmpfile();
+    if (NULL == interpreted.output || NULL == compiled.output)
+    {
+        fprintf(stderr, "Error creating a temporary file: %s\n", strerror(errno));
+        if (NULL != interpreted.output)
+        {
+            fclose(interpreted.output);
+        }
+        if (NULL != compiled.output)
+        {
+            fclose(compiled.output);
+        }
+        return FALSE;
+    }
+
+    rewind(options->input);
+    interpreted.input = options->input;
+    interpreted.inputSource = options->inputSource;
+    startTime = clock();
+    interpretedStatus = RunMachine(&interpreted, options->maxSteps);
+    interpretedSeconds = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+
+    rewind(options->input);
+    compiled.input = options->input;
+    compiled.inputSource = options->inputSource;
+    startTime = clock();
+    compiledStatus = RunMachineJit(options->jit, &compiled, options->maxSteps);
+    compiledSeconds = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+
+    difference = FindDifference(&interpreted, interpretedStatus, &compiled, compiledStatus);
+    if (NULL == difference && !AreStreamsEqual(interpreted.output, compiled.output))
+    {
+        difference = "output";
+    }
+
+    if (printOutput)
+    {
+        rewind(interpreted.output);
+        CopyStream(stdout, interpreted.output);
+        fflush(stdout);
+    }
+
+    fclose(interpreted.output);
+    fclose(compiled.output);
+
+    if (NULL != difference)
+    {
+        fprintf(stderr, "%s: the JIT and the interpreter differ in the %s "
+                        "(%s at address %04u after %lu steps, %s at address %04u after %lu steps)\n",
+                name,
+                difference,
+                GetSimulationStatusName(interpretedStatus),
+                interpreted.pc,
+                interpreted.numOfSteps,
+                GetSimulationStatusName(compiledStatus),
+                compiled.pc,
+                compiled.numOfSteps);
+        return FALSE;
+    }
+
+    if (printOutput && SIMULATION_STOPPED != interpretedStatus)
+    {
+        fprintf(stderr, "%s: %s at address %04u\n",
+                name,
+                GetSimulationStatusName(interpretedStatus),
+                interpreted.pc);
+    }
+
+    if (options->printStatistics)
+    {
+        fprintf(stderr, "%s: %lu steps, interpreted in %.3f s and compiled in %.3f s\n",
+                name,
+                interpreted.numOfSteps,
+                interpretedSeconds,
+                compiledSeconds);
+    }
+
+    return (!printOutput || SIMULATION_STOPPED == interpretedStatus);
+}
+
+/* Returns what two runs of the same program ended with differently, or NULL */
+static const char *FindDifference(const Machine *interpreted,
+                                  SimulationStatus interpretedStatus,
+                                  const Machine *compiled,
+                                  SimulationStatus compiledStatus)
+{
+    assert(NULL != interpreted);
+    assert(NULL != compiled);
+
+    if (interpretedStatus != compiledStatus)
+    {
+        return "status";
+    }
+
+    if (interpreted->pc != compiled->pc)
+    {
+        return "pc";
+    }
+
+    if (interpreted->numOfSteps != compiled->numOfSteps)
+    {
+        return "number of steps";
+    }
+
+    if (interpreted->zeroFlag != compiled->zeroFlag)
+    {
+        return "zero flag";
+    }
+
+    if (0 != memcmp(interpreted->registers, compiled->registers, sizeof(interpreted->registers)))
+    {
+        return "registers";
+    }
+
+    if (0 != memcmp(interpreted->memory, compiled->memory, MEMORY_SIZE * sizeof(interpreted->memory[0])))
+    {
+        return "memory";
+    }
+
+    if (interpreted->stackPointer != compiled->stackPointer ||
+        0 != memcmp(interpreted->returnStack,
+                    compiled->returnStack,
+                    interpreted->stackPointer * sizeof(interpreted->returnStack[0])))
+    {
+        return "return stack";
+    }
+
+    return NULL;
+}
+
+static bool AreStreamsEqual(FILE *first, FILE *second)
+{
+    int character = EOF;
+
+    assert(NULL != first);
+    assert(NULL != second);
+
+    rewind(first);
+    rewind(second);
+
+    do
+    {
+        character = getc(first);
+        if (character != getc(second))
+        {
+            return FALSE;
+        }
+    } while (EOF != character);
+
+    return TRUE;
+}
+
+static void CopyStream(FILE *destination, FILE *source)
+{
+    int character = EOF;
+
+    assert(NULL != destination);
+    assert(NULL != source);
+
+    while (EOF != (character = getc(source)))
+    {
+        putc(character, destination);
+    }
+}
+
+/* Compares the engines on random programs, most of which modify their own
+ * code, jump into data or end with an error */
+static bool CompareOnRandomPrograms(unsigned long numOfPrograms, SimulatorOptions *options)
+{
+    static Machine machine;
+    char name[MAX_SENTENCE_SIZE] = {0};
+    unsigned long seed = 1, numOfDifferences = 0;
+
+    assert(NULL != options);
+
+    options->input = tmpfile();
+    if (NULL == options->input)
+    {
+        fprintf(stderr, "Error creating a temporary file: %s\n", strerror(errno));
+        return FALSE;
+    }
+
+    fputs(RANDOM_PROGRAM_INPUT, options->input);
+
+    for (; seed <= numOfPrograms; ++seed)
+    {
+        GenerateProgram(&machine, seed);
+        sprintf(name, "random program %lu", seed);
+        if (!CompareEngines(&machine, options, name, FALSE))
+        {
+            ++numOfDifferences;
+        }
+    }
+
+    fclose(options->input);
+    options->input = NULL;
+
+    fprintf(stderr, "%lu random programs, %lu with a difference\n", numOfPrograms, numOfDifferences);
+
+    return (0 == numOfDifferences);
+}
+
+/* Writes random instructions from STARTING_ADDRESS, their jumps going to
+ * the starts of instructions, and random data words after them */
+static void GenerateProgram(Machine *machine, unsigned long seed)
+{
+    RandomProgram program;
+    unsigned int starts[MAX_RANDOM_CODE_SIZE] = {0};
+    unsigned int jumpOperands[MAX_RANDOM_CODE_SIZE] = {0};
+    unsigned int numOfStarts = 0, numOfJumpOperands = 0, i = 0;
+    unsigned int end = 0, address = STARTING_ADDRESS;
+
+    assert(NULL != machine);
+
+    memset(machine, 0, sizeof(Machine));
+    machine->pc = STARTING_ADDRESS;
+
+    program.machine = machine;
+    program.random = seed;
+
+    /* A few draws so that close seeds do not start alike */
+    for (i = 0; i < 4; ++i)
+    {
+        GetRandom(&program);
+    }
+
+    program.codeSize = MIN_RANDOM_CODE_SIZE +
+                       GetRandom(&program) % (MAX_RANDOM_CODE_SIZE - MIN_RANDOM_CODE_SIZE + 1);
+    program.dataSize = 1 + GetRandom(&program) % MAX_RANDOM_DATA_SIZE;
+    end = STARTING_ADDRESS + program.codeSize;
+
+    while (address < end)
+    {
+        const Operation *operation = NULL;
+        unsigned int srcMethod = 0, destMethod = 0, code = 0;
+
+        if (0 == GetRandom(&program) % 50)
+        {
+            machine->memory[address++] = GetRandom(&program) & MEMORY_WORD_MASK;
+            continue;
+        }
+
+        code = RANDOM_OPERATION_CODES[GetRandom(&program) % sizeof(RANDOM_OPERATION_CODES)];
+        if (0 == GetRandom(&program) % 150)
+        {
+            code = NUM_OF_OPERATIONS - 1;
+        }
+
+        operation = GetOperation(code);
+        if (2 == operation->numOfOperands)
+        {
+            srcMethod = GetRandomAddressingMethod(&program, operation->srcAddressingMethods);
+        }
+        if (1 <= operation->numOfOperands)
+        {
+            destMethod = GetRandomAddressingMethod(&program, operation->destAddressingMethods);
+        }
+
+        /* Jumps mostly go to a label, so that programs run for a while */
+        if (JUMP_ADDRESSING_METHODS == operation->destAddressingMethods &&
+            0 != GetRandom(&program) % 10)
+        {
+            destMethod = DIRECT_ADDRESSING;
+        }
+
+        starts[numOfStarts++] = address;
+        machine->memory[address++] = (code << 6) | (srcMethod << 4) | (destMethod << 2);
+
+        if (2 == operation->numOfOperands &&
+            DIRECT_REGISTER_ADDRESSING == srcMethod &&
+            DIRECT_REGISTER_ADDRESSING == destMethod)
+        {
+            machine->memory[address++] = ((GetRandom(&program) % NUM_OF_REGISTERS) << 5) |
+                                         ((GetRandom(&program) % NUM_OF_REGISTERS) << 2);
+            continue;
+        }
+
+        if (2 == operation->numOfOperands)
+        {
+            address = AddRandomOperand(&program, address, srcMethod, 5);
+        }
+
+        if (JUMP_ADDRESSING_METHODS == operation->destAddressingMethods &&
+            DIRECT_ADDRESSING == destMethod)
+        {
+            jumpOperands[numOfJumpOperands++] = address++;
+        }
+        else if (1 <= operation->numOfOperands)
+        {
+            address = AddRandomOperand(&program, address, destMethod, 2);
+        }
+    }
+
+    for (i = 0; i < numOfJumpOperands; ++i)
+    {
+        machine->memory[jumpOperands[i]] = starts[GetRandom(&program) % numOfStarts] << 2;
+    }
+
+    /* The last instruction may not fit; its words past the code are data */
+    for (address = end; address < end + program.dataSize; ++address)
+    {
+        machine->memory[address] = GetRandom(&program) & MEMORY_WORD_MASK;
+    }
+}
+
+static unsigned int AddRandomOperand(RandomProgram *program,
+                                     unsigned int address,
+                                     AddressingMethods addressingMethod,
+                                     int registerShift)
+{
+    unsigned short *memory = NULL;
+
+    assert(NULL != program);
+    assert(address < MEMORY_SIZE);
+
+    memory = program->machine->memory;
+
+    switch (addressingMethod)
+    {
+    case IMMEDIATE_ADDRESSING:
+        memory[address++] = (GetRandom(program) & 0xFFF) << 2;
+        break;
+    case DIRECT_ADDRESSING:
+        memory[address++] = (GetRandomAddress(program) << 2) | (GetRandom(program) % 3);
+        break;
+    case FIXED_INDEX_ADDRESSING:
+        memory[address++] = GetRandomAddress(program) << 2;
+        memory[address++] = ((GetRandom(program) % 13 - 6) & 0xFFF) << 2;
+        break;
+    default:
+        memory[address++] = (GetRandom(program) % NUM_OF_REGISTERS) << registerShift;
+        break;
+    }
+
+    return address;
+}
+
+static unsigned int GetRandomAddressingMethod(RandomProgram *program, unsigned char addressingMethods)
+{
+    unsigned int addressingMethod = 0;
+
+    assert(0 != addressingMethods);
+
+    do
+    {
+        addressingMethod = GetRandom(program) % 4;
+    } while (!(addressingMethods & ADDRESSING_METHOD_FLAG(addressingMethod)));
+
+    return addressingMethod;
+}
+
+/* Mostly the data and the code of the program, and sometimes anywhere */
+static unsigned int GetRandomAddress(RandomProgram *program)
+{
+    unsigned int chance = GetRandom(program) % 100;
+
+    if (chance < 60)
+    {
+        return STARTING_ADDRESS + program->codeSize + GetRandom(program) % program->dataSize;
+    }
+
+    if (chance < 97)
+    {
+        return STARTING_ADDRESS + GetRandom(program) % program->codeSize;
+    }
+
+    return GetRandom(program) % MEMORY_SIZE;
+}
+
+/* A linear congruential generator, the same on every platform */
+static unsigned int GetRandom(RandomProgram *program)
+{
+    assert(NULL != program);
+
+    program->random = (program->random * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+
+    return (unsigned int)(program->random >> 16) & 0x7FFF;
+}
@@ -0,0 +1,343 @@
+/****************************************
+* ASSEMBLER: socket_stream.c            *
+****************************************/
+
+#include <sys/types.h>  /* ssize_t */
+#include <sys/stat.h>   /* lstat, S_ISSOCK */
+#include <sys/socket.h> /* socket, bind, listen, connect, send, recv */
+#include <sys/un.h>     /* struct sockaddr_un */
+#include <unistd.h>     /* close, unlink */
+#include <errno.h>      /* errno, EINTR, ECONNREFUSED, EADDRINUSE, ENOTSOCK */
+#include <stdlib.h>     /* malloc, free */
+#include <string.h>     /* strlen, memset, memcpy */
+#include <assert.h>     /* assert */
+
+#include "socket_stream.h" /* API */
+
+#define NUMBER_SIZE (4)
+#define LISTEN_BACKLOG (64)
+
+static int OpenSocket(const char *socketPath, struct sockaddr_un *address);
+static ReturnStatus WriteToStream(SocketStream *stream,
+                                  const void *data,
+                                  size_t length);
+static ReturnStatus ReadFromStream(SocketStream *stream, void *data, size_t length);
+static ReturnStatus SendAll(int socket, const void *data, size_t length);
+
+/* Returns the listening socket, or ERROR. A stale socket file (one that
+ * refuses connections) is replaced; errno is EADDRINUSE when a server
+ * listens on the path, and ENOTSOCK when the path is not a socket. */
+int OpenListeningSocket(const char *socketPath)
+{
+    struct sockaddr_un address;
+    struct stat fileStatus;
+    int listeningSocket = ERROR;
+
+    if (0 == lstat(socketPath, &fileStatus))
+    {
+        int runningServer = ERROR;
+
+        if (!S_ISSOCK(fileStatus.st_mode))
+        {
+            errno = ENOTSOCK;
+            return ERROR;
+        }
+
+        runningServer = ConnectToSocket(socketPath);
+        if (ERROR != runningServer)
+        {
+            close(runningServer);
+            errno = EADDRINUSE;
+            return ERROR;
+        }
+
+        if (ECONNREFUSED != errno)
+        {
+            return ERROR;
+        }
+
+        unlink(socketPath);
+    }
+
+    listeningSocket = OpenSocket(socketPath, &address);
+    if (ERROR == listeningSocket)
+    {
+        return ERROR;
+    }
+
+    if (0 != bind(listeningSocket, (struct sockaddr *)&address, sizeof(address)) ||
+        0 != listen(listeningSocket, LISTEN_BACKLOG))
+    {
+        close(listeningSocket);
+        return ERROR;
+    }
+
+    return listeningSocket;
+}
+
+/* Returns the connected socket, or ERROR */
+int ConnectToSocket(const char *socketPath)
+{
+    struct sockaddr_un address;
+    int connectedSocket = OpenSocket(socketPath, &address);
+
+    if (ERROR == connectedSocket)
+    {
+        return ERROR;
+    }
+
+    if (0 != connect(connectedSocket, (struct sockaddr *)&address, sizeof(address)))
+    {
+        close(connectedSocket);
+        return ERROR;
+    }
+
+    return connectedSocket;
+}
+
+void OpenSocketStream(SocketStream *stream, int socket)
+{
+    assert(NULL != stream);
+
+    stream->socket = socket;
+    stream->inputPosition = 0;
+    stream->inputLength = 0;
+    stream->outputLength = 0;
+}
+
+void CloseSocketStream(SocketStream *stream)
+{
+    assert(NULL != stream);
+
+    close(stream->socket);
+    stream->socket = ERROR;
+}
+
+ReturnStatus FlushSocketStream(SocketStream *stream)
+{
+    ReturnStatus status = SUCCESS;
+
+    assert(NULL != stream);
+
+    status = SendAll(stream->socket, stream->output, stream->outputLength);
+    stream->outputLength = 0;
+
+    return status;
+}
+
+ReturnStatus SendNumber(SocketStream *stream, unsigned long number)
+{
+    unsigned char bytes[NUMBER_SIZE];
+    int i = 0;
+
+    for (i = NUMBER_SIZE - 1; i >= 0; --i)
+    {
+        bytes[i] = (unsigned char)(number & 0xFF);
+        number >>= 8;
+    }
+
+    return WriteToStream(stream, bytes, NUMBER_SIZE);
+}
+
+ReturnStatus ReceiveNumber(SocketStream *stream, unsigned long *number)
+{
+    unsigned char bytes[NUMBER_SIZE];
+    int i = 0;
+
+    assert(NULL != number);
+
+    if (SUCCESS != ReadFromStream(stream, bytes, NUMBER_SIZE))
+    {
+        return FAILURE;
+    }
+
+    *number = 0;
+    for (i = 0; i < NUMBER_SIZE; ++i)
+    {
+        *number = (*number << 8) | bytes[i];
+    }
+
+    return SUCCESS;
+}
+
+ReturnStatus SendText(SocketStream *stream, const char *text, size_t length)
+{
+    if (NULL == text)
+    {
+        return SendNumber(stream, NO_TEXT);
+    }
+
+    if (length > MAX_TEXT_LENGTH ||
+        SUCCESS != SendNumber(stream, length))
+    {
+        return FAILURE;
+    }
+
+    return WriteToStream(stream, text, length);
+}
+
+/* The text is malloced and NUL-terminated, or NULL when none was sent */
+ReturnStatus ReceiveText(SocketStream *stream, char **text, size_t *length)
+{
+    unsigned long textLength = 0;
+
+    assert(NULL != text);
+    assert(NULL != length);
+
+    *text = NULL;
+    *length = 0;
+
+    if (SUCCESS != ReceiveNumber(stream, &textLength))
+    {
+        return FAILURE;
+    }
+
+    if (NO_TEXT == textLength)
+    {
+        return SUCCESS;
+    }
+
+    if (textLength > MAX_TEXT_LENGTH)
+    {
+        return FAILURE;
+    }
+
+    *text = (char *)malloc(textLength + 1);
+    if (NULL == *text)
+    {
+        return FAILURE;
+    }
+
+    if (SUCCESS != ReadFromStream(stream, *text, textLength))
+    {
+        free(*text);
+        *text = NULL;
+        return FAILURE;
+    }
+
+    (*text)[textLength] = END_LINE;
+    *length = textLength;
+
+    return SUCCESS;
+}
+
+/* Static functions */
+static int OpenSocket(const char *socketPath, struct sockaddr_un *address)
+{
+    int newSocket = 0;
+
+    assert(NULL != socketPath);
+
+    memset(address, 0, sizeof(struct sockaddr_un));
+    if (strlen(socketPath) >= sizeof(address->sun_path))
+    {
+        return ERROR;
+    }
+
+    address->sun_family = AF_UNIX;
+    memcpy(address->sun_path, socketPath, strlen(socketPath));
+
+    newSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    return (newSocket >= 0) ? newSocket : ERROR;
+}
+
+/* Large blocks skip the buffer */
+static ReturnStatus WriteToStream(SocketStream *stream,
+                                  const void *data,
+                                  size_t length)
+{
+    if (stream->outputLength + length > SOCKET_BUFFER_SIZE &&
+        SUCCESS != FlushSocketStream(stream))
+    {
+        return FAILURE;
+    }
+
+    if (length > SOCKET_BUFFER_SIZE)
+    {
+        return SendAll(stream->socket, data, length);
+    }
+
+    memcpy(stream->output + stream->outputLength, data, length);
+    stream->outputLength += length;
+
+    return SUCCESS;
+}
+
+/* Fails when the peer closed the connection before length bytes arrived */
+static ReturnStatus ReadFromStream(SocketStream *stream, void *data, size_t length)
+{
+    char *position = (char *)data;
+
+    while (length > 0)
+    {
+        size_t numOfBufferedBytes = stream->inputLength - stream->inputPosition;
+        ssize_t numOfBytes = 0;
+
+        if (numOfBufferedBytes > 0)
+        {
+            if (numOfBufferedBytes > length)
+            {
+                numOfBufferedBytes = length;
+            }
+
+            memcpy(position, stream->input + stream->inputPosition, numOfBufferedBytes);
+            stream->inputPosition += numOfBufferedBytes;
+            position += numOfBufferedBytes;
+            length -= numOfBufferedBytes;
+
+            continue;
+        }
+
+        if (length >= SOCKET_BUFFER_SIZE) /* Straight into the destination */
+        {
+            numOfBytes = recv(stream->socket, position, length, 0);
+            if (numOfBytes > 0)
+            {
+                position += numOfBytes;
+                length -= numOfBytes;
+            }
+        }
+        else
+        {
+            numOfBytes = recv(stream->socket, stream->input, SOCKET_BUFFER_SIZE, 0);
+            if (numOfBytes > 0)
+            {
+                stream->inputPosition = 0;
+                stream->inputLength = numOfBytes;
+            }
+        }
+
+        if (numOfBytes == 0 || (numOfBytes < 0 && EINTR != errno))
+        {
+            return FAILURE;
+        }
+    }
+
+    return SUCCESS;
+}
+
+static ReturnStatus SendAll(int socket, const void *data, size_t length)
+{
+    const char *position = (const char *)data;
+
+    while (length > 0)
+    {
+        ssize_t numOfBytes = send(socket, position, length, 0);
+
+        if (numOfBytes < 0 && EINTR == errno)
+        {
+            continue;
+        }
+
+        if (numOfBytes <= 0)
+        {
+            return FAILURE;
+        }
+
+        position += numOfBytes;
+        length -= numOfBytes;
+    }
+
+    return SUCCESS;
+}
@@ -0,0 +1,154 @@
+/****************************************
+* ASSEMBLER: source_reader.c            *
+****************************************/
+
+#include <assert.h>   /* assert */
+#include <stdio.h>    /* FILE, fileno, fread, ferror */
+#include <stdlib.h>   /* realloc, free */
+#include <string.h>   /* memchr, memset */
+#include <sys/mman.h> /* mmap, munmap */
+#include <sys/stat.h> /* fstat */
+
+#include "source_reader.h" /* API */
+
+#define READ_BLOCK_SIZE (65536)
+
+static ReturnStatus MapSourceFile(SourceReader *sourceReader, FILE *sourceFile);
+static ReturnStatus ReadSourceFile(SourceReader *sourceReader, FILE *sourceFile);
+
+ReturnStatus OpenSourceReader(SourceReader *sourceReader, FILE *sourceFile)
+{
+    assert(NULL != sourceReader);
+    assert(NULL != sourceFile);
+
+    memset(sourceReader, 0, sizeof(SourceReader));
+
+    if (SUCCESS == MapSourceFile(sourceReader, sourceFile))
+    {
+        return SUCCESS;
+    }
+
+    return ReadSourceFile(sourceReader, sourceFile);
+}
+
+/* Reads from memory the caller keeps alive until the reader is closed */
+void OpenSourceBuffer(SourceReader *sourceReader,
+                      const char *source,
+                      size_t length)
+{
+    assert(NULL != sourceReader);
+    assert(NULL != source || 0 == length);
+
+    memset(sourceReader, 0, sizeof(SourceReader));
+    sourceReader->data = source;
+    sourceReader->size = length;
+}
+
+/* The sentence does not include its '\n' */
+bool ReadSentence(SourceReader *sourceReader, Span *sentence)
+{
+    const char *start = NULL, *newLine = NULL;
+    size_t remaining = 0;
+
+    assert(NULL != sourceReader);
+    assert(NULL != sentence);
+
+    if (sourceReader->position >= sourceReader->size)
+    {
+        return FALSE;
+    }
+
+    start = sourceReader->data + sourceReader->position;
+    remaining = sourceReader->size - sourceReader->position;
+    newLine = (const char *)memchr(start, '\n', remaining);
+
+    sentence->start = start;
+    sentence->length = (NULL != newLine) ? (size_t)(newLine - start) : remaining;
+    sourceReader->position += sentence->length + 1;
+
+    return TRUE;
+}
+
+/* The next sentence read is the first sentence of the source */
+void RewindSourceReader(SourceReader *sourceReader)
+{
+    assert(NULL != sourceReader);
+
+    sourceReader->position = 0;
+}
+
+void CloseSourceReader(SourceReader *sourceReader)
+{
+    assert(NULL != sourceReader);
+
+    if (sourceReader->isMapped)
+    {
+        munmap((void *)sourceReader->data, sourceReader->size);
+    }
+
+    free(sourceReader->buffer);
+    memset(sourceReader, 0, sizeof(SourceReader));
+}
+
+/* Static functions */
+static ReturnStatus MapSourceFile(SourceReader *sourceReader, FILE *sourceFile)
+{
+    struct stat fileStatus;
+    void *data = NULL;
+
+    if (0 != fstat(fileno(sourceFile), &fileStatus) ||
+        !S_ISREG(fileStatus.st_mode) ||
+        0 == fileStatus.st_size)
+    {
+        return FAILURE;
+    }
+
+    data = mmap(NULL,
+                (size_t)fileStatus.st_size,
+                PROT_READ,
+                MAP_PRIVATE,
+                fileno(sourceFile),
+                0);
+    if (MAP_FAILED == data)
+    {
+        return FAILURE;
+    }
+
+    sourceReader->data = (const char *)data;
+    sourceReader->size = (size_t)fileStatus.st_size;
+    sourceReader->isMapped = TRUE;
+
+    return SUCCESS;
+}
+
+static ReturnStatus ReadSourceFile(SourceReader *sourceReader, FILE *sourceFile)
+{
+    size_t capacity = 0, numOfBytesRead = 0;
+
+    do
+    {
+        if (sourceReader->size + READ_BLOCK_SIZE > capacity)
+        {
+            char *newBuffer = NULL;
+
+            capacity = (0 == capacity) ? READ_BLOCK_SIZE : capacity * 2;
+            newBuffer = (char *)realloc(sourceReader->buffer, capacity);
+            if (NULL == newBuffer)
+            {
+                return FAILURE;
+            }
+
+            sourceReader->buffer = newBuffer;
+        }
+
+        numOfBytesRead = fread(sourceReader->buffer + sourceReader->size,
+                               1,
+                               READ_BLOCK_SIZE,
+                               sourceFile);
+        sourceReader->size += numOfBytesRead;
+    } while (READ_BLOCK_SIZE == numOfBytesRead);
+
+    sourceReader->data = sourceReader->buffer;
+
+    return ferror(sourceFile) ? FAILURE : SUCCESS;
+}
@@ -0,0 +1,275 @@
+/****************************************
+* ASSEMBLER: string_pool.c              *
+****************************************/
+
+#include <stdlib.h> /* malloc, realloc, calloc, free */
+#include <string.h> /* memcpy, strncmp, memset */
+#include <assert.h> /* assert */
+
+#include "string_pool.h" /* API */
+
+#define BLOCK_SIZE (4096)
+#define INITIAL_STRINGS_CAPACITY (64)
+#define FNV_OFFSET_BASIS (2166136261UL)
+#define FNV_PRIME (16777619UL)
+
+struct stringPoolBlock
+{
+    struct stringPoolBlock *next;
+    size_t used;
+    size_t size;
+    char chars[1]; /* Allocated with the rest of the block */
+};
+
+static int *FindBucket(int *buckets,
+                       size_t numOfBuckets,
+                       const StringPool *stringPool,
+                       const char *str,
+                       size_t length,
+                       unsigned long hash);
+static const char *CopyToArena(StringPool *stringPool,
+                               const char *str,
+                               size_t length);
+static ReturnStatus GrowStrings(StringPool *stringPool);
+static ReturnStatus GrowBuckets(StringPool *stringPool);
+
+/* Returns the id of the string, or ERROR on allocation failure */
+int InternString(StringPool *stringPool, const char *str, size_t length)
+{
+    unsigned long hash = 0;
+    int *bucket = NULL;
+    const char *pooledString = NULL;
+
+    assert(NULL != stringPool);
+    assert(NULL != str);
+
+    if (2 * (size_t)(stringPool->numOfStrings + 1) > stringPool->numOfBuckets &&
+        SUCCESS != GrowBuckets(stringPool))
+    {
+        return ERROR;
+    }
+
+    hash = HashString(str, length);
+    bucket = FindBucket(stringPool->buckets,
+                        stringPool->numOfBuckets,
+                        stringPool,
+                        str,
+                        length,
+                        hash);
+
+    if (0 != *bucket) /* Already interned */
+    {
+        return *bucket - 1;
+    }
+
+    if (stringPool->numOfStrings == stringPool->stringsCapacity &&
+        SUCCESS != GrowStrings(stringPool))
+    {
+        return ERROR;
+    }
+
+    pooledString = CopyToArena(stringPool, str, length);
+    if (NULL == pooledString)
+    {
+        return ERROR;
+    }
+
+    stringPool->strings[stringPool->numOfStrings] = pooledString;
+    stringPool->hashes[stringPool->numOfStrings] = hash;
+    *bucket = ++stringPool->numOfStrings;
+
+    return *bucket - 1;
+}
+
+/* Returns the id of the string, or NOT_FOUND if it was never interned */
+int FindString(const StringPool *stringPool, const char *str, size_t length)
+{
+    int *bucket = NULL;
+
+    assert(NULL != stringPool);
+    assert(NULL != str);
+
+    if (0 == stringPool->numOfStrings)
+    {
+        return NOT_FOUND;
+    }
+
+    bucket = FindBucket(stringPool->buckets,
+                        stringPool->numOfBuckets,
+                        stringPool,
+                        str,
+                        length,
+                        HashString(str, length));
+
+    return (0 != *bucket) ? *bucket - 1 : NOT_FOUND;
+}
+
+const char *GetPooledString(const StringPool *stringPool, int id)
+{
+    assert(NULL != stringPool);
+    assert(id >= 0 && id < stringPool->numOfStrings);
+
+    return stringPool->strings[id];
+}
+
+/* FNV-1a */
+unsigned long HashString(const char *str, size_t length)
+{
+    return AddToHash(FNV_OFFSET_BASIS, str, length);
+}
+
+unsigned long AddToHash(unsigned long hash, const char *str, size_t length)
+{
+    size_t i = 0;
+
+    for (i = 0; i < length; ++i)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+void DestroyStringPool(StringPool *stringPool)
+{
+    StringPoolBlock *currentBlock = NULL, *nextBlock = NULL;
+
+    assert(NULL != stringPool);
+
+    for (currentBlock = stringPool->blocks;
+         NULL != currentBlock;
+         currentBlock = nextBlock)
+    {
+        nextBlock = currentBlock->next;
+        free(currentBlock);
+    }
+
+    free(stringPool->strings);
+    free(stringPool->hashes);
+    free(stringPool->buckets);
+    memset(stringPool, 0, sizeof(StringPool));
+}
+
+/* Static functions */
+
+/* Returns the bucket holding the string, or the empty bucket it belongs to */
+static int *FindBucket(int *buckets,
+                       size_t numOfBuckets,
+                       const StringPool *stringPool,
+                       const char *str,
+                       size_t length,
+                       unsigned long hash)
+{
+    size_t mask = numOfBuckets - 1, i = hash & mask;
+
+    while (0 != buckets[i])
+    {
+        int id = buckets[i] - 1;
+
+        if (stringPool->hashes[id] == hash &&
+            0 == strncmp(stringPool->strings[id], str, length) &&
+            END_LINE == stringPool->strings[id][length])
+        {
+            break;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return buckets + i;
+}
+
+static const char *CopyToArena(StringPool *stringPool,
+                               const char *str,
+                               size_t length)
+{
+    StringPoolBlock *block = stringPool->blocks;
+    char *pooledString = NULL;
+
+    if (NULL == block || block->used + length + 1 > block->size)
+    {
+        size_t blockSize = (length + 1 > BLOCK_SIZE) ? length + 1 : BLOCK_SIZE;
+
+        block = (StringPoolBlock *)malloc(sizeof(StringPoolBlock) + blockSize);
+        if (NULL == block)
+        {
+            return NULL;
+        }
+
+        block->next = stringPool->blocks;
+        block->used = 0;
+        block->size = blockSize;
+        stringPool->blocks = block;
+    }
+
+    pooledString = block->chars + block->used;
+    memcpy(pooledString, str, length);
+    pooledString[length] = END_LINE;
+    block->used += length + 1;
+
+    return pooledString;
+}
+
+static ReturnStatus GrowStrings(StringPool *stringPool)
+{
+    int newCapacity = (0 == stringPool->stringsCapacity)
+                          ? INITIAL_STRINGS_CAPACITY
+                          : 2 * stringPool->stringsCapacity;
+    const char **newStrings = NULL;
+    unsigned long *newHashes = NULL;
+
+    newStrings = (const char **)realloc((void *)stringPool->strings,
+                                        newCapacity * sizeof(const char *));
+    if (NULL == newStrings)
+    {
+        return FAILURE;
+    }
+    stringPool->strings = newStrings;
+
+    newHashes = (unsigned long *)realloc(stringPool->hashes,
+                                         newCapacity * sizeof(unsigned long));
+    if (NULL == newHashes)
+    {
+        return FAILURE;
+    }
+    stringPool->hashes = newHashes;
+
+    stringPool->stringsCapacity = newCapacity;
+
+    return SUCCESS;
+}
+
+static ReturnStatus GrowBuckets(StringPool *stringPool)
+{
+    size_t newNumOfBuckets = (0 == stringPool->numOfBuckets)
+                                 ? 2 * INITIAL_STRINGS_CAPACITY
+                                 : 2 * stringPool->numOfBuckets;
+    int *newBuckets = NULL;
+    int id = 0;
+
+    newBuckets = (int *)calloc(newNumOfBuckets, sizeof(int));
+    if (NULL == newBuckets)
+    {
+        return FAILURE;
+    }
+
+    for (id = 0; id < stringPool->numOfStrings; ++id)
+    {
+        size_t mask = newNumOfBuckets - 1;
+        size_t i = stringPool->hashes[id] & mask;
+
+        while (0 != newBuckets[i])
+        {
+            i = (i + 1) & mask;
+        }
+
+        newBuckets[i] = id + 1;
+    }
+
+    free(stringPool->buckets);
+    stringPool->buckets = newBuckets;
+    stringPool->numOfBuckets = newNumOfBuckets;
+
+    return SUCCESS;
+}
@@ -5,409 +5,741 @@
 * Date: 19/08/2019                      *
 ****************************************/
 
-#include <stdlib.h> /* malloc, free */
-#include <string.h> /* strcmp, symbol */
+#include <stdlib.h> /* malloc, realloc, free */
+#include <string.h> /* memset, strlen, memcpy */
 #include <assert.h> /* assert */
-#include <stdio.h>  /* fprintf */
+#include <stdio.h>  /* sprintf */
 
 #include "symbol_table.h"      /* API */
 #include "sentence_analyzer.h" /* API */
 
 typedef struct macroDetails
 {
-    char name[MAX_SENTENCE_SIZE];
+    Span name;
     int value;
 } MacroDetails;
 
-static SymbolTableNode *CreateSymbolTableNode(const Symbol *symbol);
-static void DestroySymbolTableNode(SymbolTableNode *nodeToDestroy);
-static void GetMacroDetails(const char *macroSentence, MacroDetails *macroDetails);
-static void InsertToSymbolTable(SymbolTableNode **symbolTableHead,
-                                Symbol *newSymbol,
-                                bool *errorHasOccurred,
-                                int lineNumber);
-static void InsertNodeToTable(SymbolTableNode **symbolTableHead,
-                              SymbolTableNode *nodeToInsert,
-                              bool *errorHasOccurred,
-                              int lineNumber);
-
-void DestroySymbolTable(SymbolTableNode *head)
+#define NODES_PER_BLOCK (256)
+#define INITIAL_NUM_OF_FIRST_NODES (64)
+#define INITIAL_ENTRIES_CAPACITY (16)
+#define INITIAL_EXTERN_REFERENCES_CAPACITY (16)
+/* '\t', a value of up to 11 characters and '\n' */
+#define MAX_SYMBOL_LINE_EXTRA (13)
+
+struct symbolTableBlock
+{
+    struct symbolTableBlock *next;
+    int numOfNodes;
+    SymbolTableNode nodes[NODES_PER_BLOCK];
+};
+
+static SymbolTableNode *AllocateSymbolTableNode(SymbolTable *symbolTable);
+static bool IsMissingOperand(const Sentence *sentence,
+                             Diagnostics *diagnostics,
+                             int lineNumber);
+static bool GetMacroDetails(const Sentence *macroSentence,
+                            MacroDetails *macroDetails,
+                            Diagnostics *diagnostics,
+                            int lineNumber);
+static int InsertToSymbolTable(SymbolTable *symbolTable,
+                               Span name,
+                               SymbolCharacteristic type,
+                               int value,
+                               Diagnostics *diagnostics,
+                               int lineNumber);
+static SymbolTableNode *FindFirstNode(const SymbolTable *symbolTable,
+                                      int symbolId);
+static ReturnStatus GrowFirstNodes(SymbolTable *symbolTable, int symbolId);
+static ReturnStatus GrowExternReferences(ExternReferenceList *externReferences,
+                                         int numOfReferences);
+
+void DestroySymbolTable(SymbolTable *symbolTable)
 {
-    SymbolTableNode *currentNode = head, *nextNode = NULL;
+    SymbolTableBlock *currentBlock = NULL, *nextBlock = NULL;
 
-    while (NULL != currentNode)
+    assert(NULL != symbolTable);
+
+    for (currentBlock = symbolTable->blocks;
+         NULL != currentBlock;
+         currentBlock = nextBlock)
     {
-        nextNode = currentNode->next;
-        DestroySymbolTableNode(currentNode);
-        currentNode = nextNode;
+        nextBlock = currentBlock->next;
+        free(currentBlock);
     }
+
+    free(symbolTable->firstNodes);
+    free(symbolTable->entryIds);
+    free(symbolTable->externReferences.references);
+    DestroyStringPool(&symbolTable->names);
+    memset(symbolTable, 0, sizeof(SymbolTable));
 }
 
-void GetSymbolDetails(SymbolTableNode *symbolTableHead,
-                      const char *symbolName,
+void GetSymbolDetails(const SymbolTable *symbolTable,
+                      int symbolId,
                       Symbol *symbol,
-                      bool *errorHasOccurred,
+                      Diagnostics *diagnostics,
                       int lineNumber)
 {
-    const SymbolTableNode *currentNode = symbolTableHead;
+    const SymbolTableNode *node = FindFirstNode(symbolTable, symbolId);
 
-    while (NULL != currentNode)
-    {
-        if (0 == strcmp(currentNode->symbol->name, symbolName))
-        {
-            if (EXTERNAL == currentNode->symbol->type &&
-                currentNode->symbol->value != 0)
-            {
-                Symbol newSymbol = {0};
-
-                SetSymbolParams(&newSymbol, symbolName, EXTERNAL, 0);
-                InsertToSymbolTable(&symbolTableHead,
-                                    &newSymbol,
-                                    errorHasOccurred,
-                                    lineNumber);
-            }
-
-            SetSymbolParams(symbol,
-                            currentNode->symbol->name,
-                            currentNode->symbol->type,
-                            currentNode->symbol->value);
+    assert(NULL != symbol);
 
-            return;
-        }
+    if (NULL != node)
+    {
+        *symbol = node->symbol;
 
-        currentNode = currentNode->next;
+        return;
     }
 
-    fprintf(stderr,
-            "Line %d:\tError: \"%s\" is undefined (not in symbol table)\n",
-            lineNumber,
-            symbolName);
-
-    *errorHasOccurred = TRUE;
+    ReportError(diagnostics,
+                "Line %d:\tError: \"%s\" is undefined (not in symbol table)\n",
+                lineNumber,
+                GetSymbolName(symbolTable, symbolId));
 }
 
-bool IsValidMacro(const SymbolTableNode *symbolTableHead,
-                  const char *macroName,
+bool IsValidMacro(const SymbolTable *symbolTable,
+                  Span macroName,
                   int *value,
-                  bool *errorHasOccurred,
+                  Diagnostics *diagnostics,
                   int lineNumber)
 {
-    const SymbolTableNode *currentNode = symbolTableHead;
+    const SymbolTableNode *node = NULL;
+    int symbolId = 0;
 
-    while (NULL != currentNode)
+    assert(NULL != symbolTable);
+    assert(NULL != macroName.start);
+
+    symbolId = FindString(&symbolTable->names, macroName.start, macroName.length);
+    if (NOT_FOUND != symbolId)
     {
-        if (0 == strcmp(currentNode->symbol->name, macroName))
-        {
-            if (MACRO == currentNode->symbol->type)
-            {
-                *value = currentNode->symbol->value;
-
-                return TRUE;
-            }
-            else
-            {
-                fprintf(stderr,
-                        "Line %d:\tError: \"%s\" is not characterized as macro\n",
-                        lineNumber,
-                        macroName);
+        node = FindFirstNode(symbolTable, symbolId);
+    }
 
-                *errorHasOccurred = TRUE;
+    if (NULL != node)
+    {
+        if (MACRO == node->symbol.type)
+        {
+            *value = node->symbol.value;
 
-                return FALSE;
-            }
+            return TRUE;
         }
 
-        currentNode = currentNode->next;
-    }
+        ReportError(diagnostics,
+                    "Line %d:\tError: \"%.*s\" is not characterized as macro\n",
+                    lineNumber,
+                    (int)macroName.length,
+                    macroName.start);
 
-    fprintf(stderr,
-            "Line %d:\tError: \"%s\" is undefined (not in symbol table)\n",
-            lineNumber,
-            macroName);
+        return FALSE;
+    }
 
-    *errorHasOccurred = TRUE;
+    ReportError(diagnostics,
+                "Line %d:\tError: \"%.*s\" is undefined (not in symbol table)\n",
+                lineNumber,
+                (int)macroName.length,
+                macroName.start);
 
     return FALSE;
 }
 
-void SetSymbolParams(Symbol *symbol,
-                     const char *name,
-                     SymbolCharacteristic type,
-                     int value)
+void AddExternReference(ExternReferenceList *externReferences,
+                        int symbolId,
+                        int address,
+                        Diagnostics *diagnostics,
+                        int lineNumber)
 {
-    assert(NULL != symbol);
-    assert(NULL != name);
+    ExternReference *reference = NULL;
 
-    strcpy(symbol->name, name);
-    symbol->type = type;
-    symbol->value = value;
+    assert(NULL != externReferences);
+    assert(symbolId >= 0);
+
+    if (externReferences->numOfReferences == externReferences->capacity &&
+        SUCCESS != GrowExternReferences(externReferences,
+                                        externReferences->numOfReferences + 1))
+    {
+        ReportError(diagnostics, "Line %d:\tMemory allocation error\n", lineNumber);
+        return;
+    }
+
+    reference = externReferences->references + externReferences->numOfReferences++;
+    reference->symbolId = symbolId;
+    reference->address = address;
+}
+
+/* The references of other follow those of externReferences */
+ReturnStatus AppendExternReferences(ExternReferenceList *externReferences,
+                                    const ExternReferenceList *other)
+{
+    int numOfReferences = 0;
+
+    assert(NULL != externReferences);
+    assert(NULL != other);
+
+    numOfReferences = externReferences->numOfReferences + other->numOfReferences;
+    if (numOfReferences > externReferences->capacity &&
+        SUCCESS != GrowExternReferences(externReferences, numOfReferences))
+    {
+        return FAILURE;
+    }
+
+    if (other->numOfReferences > 0)
+    {
+        memcpy(externReferences->references + externReferences->numOfReferences,
+               other->references,
+               other->numOfReferences * sizeof(ExternReference));
+    }
+
+    externReferences->numOfReferences = numOfReferences;
+
+    return SUCCESS;
 }
 
-void UpdateExternValue(SymbolTableNode *symbolTableHead,
-                       const char *symbolName,
-                       int newValue,
-                       bool *errorHasOccurred,
-                       int lineNumber)
+void UpdateDataSymbols(SymbolTable *symbolTable, int valueToAdd)
 {
-    SymbolTableNode *currentNode = symbolTableHead;
+    SymbolTableNode *currentNode = NULL;
 
-    assert(NULL != symbolTableHead);
-    assert(NULL != symbolName);
+    assert(NULL != symbolTable);
+
+    currentNode = symbolTable->head;
 
     while (NULL != currentNode)
     {
-        if (0 == strcmp(currentNode->symbol->name, symbolName) &&
-            0 == currentNode->symbol->value) /* Value not initialized yet */
+        if (DATA == currentNode->symbol.type)
         {
-            currentNode->symbol->value = newValue;
-            return;
+            currentNode->symbol.value += valueToAdd;
         }
 
         currentNode = currentNode->next;
     }
 }
 
-void UpdateDataSymbols(SymbolTableNode *symbolTableHead, int valueToAdd)
+void UpdateSymbolTypeToEntry(SymbolTable *symbolTable, int symbolId)
 {
-    SymbolTableNode *currentNode = symbolTableHead;
+    SymbolTableNode *node = NULL;
 
-    assert(NULL != symbolTableHead);
+    assert(NULL != symbolTable);
 
-    while (NULL != currentNode)
+    node = FindFirstNode(symbolTable, symbolId);
+
+    if (NULL != node)
     {
-        if (DATA == currentNode->symbol->type)
+        node->symbol.type = ENTRY;
+    }
+}
+
+void UpdateEntrySymbols(SymbolTable *symbolTable)
+{
+    int i = 0;
+
+    assert(NULL != symbolTable);
+
+    for (i = 0; i < symbolTable->numOfEntries; ++i)
+    {
+        UpdateSymbolTypeToEntry(symbolTable, symbolTable->entryIds[i]);
+    }
+}
+
+/* Returns the id of a symbol name, or ERROR */
+int InternSymbolName(SymbolTable *symbolTable,
+                     Span name,
+                     Diagnostics *diagnostics,
+                     int lineNumber)
+{
+    int symbolId = 0;
+
+    assert(NULL != symbolTable);
+    assert(NULL != name.start);
+
+    symbolId = InternString(&symbolTable->names, name.start, name.length);
+    if (ERROR == symbolId)
+    {
+        ReportError(diagnostics, "Line %d:\tMemory allocation error\n", lineNumber);
+    }
+
+    return symbolId;
+}
+
+const char *GetSymbolName(const SymbolTable *symbolTable, int symbolId)
+{
+    assert(NULL != symbolTable);
+
+    return GetPooledString(&symbolTable->names, symbolId);
+}
+
+/* Returns the "name\taddress\n" lines of the symbols of the type (malloced,
+ * NUL-terminated), or NULL */
+char *FormatSymbolsByType(const SymbolTable *symbolTable,
+                          SymbolCharacteristic type,
+                          size_t *length)
+{
+    const SymbolTableNode *currentNode = NULL;
+    size_t textSize = 1;
+    char *text = NULL, *end = NULL;
+
+    assert(NULL != symbolTable);
+    assert(NULL != length);
+
+    for (currentNode = symbolTable->head;
+         NULL != currentNode;
+         currentNode = currentNode->next)
+    {
+        if (type == currentNode->symbol.type)
         {
-            currentNode->symbol->value += valueToAdd;
+            textSize += strlen(GetSymbolName(symbolTable, currentNode->symbol.nameId)) +
+                        MAX_SYMBOL_LINE_EXTRA;
         }
+    }
 
-        currentNode = currentNode->next;
+    text = (char *)malloc(textSize);
+    if (NULL == text)
+    {
+        return NULL;
+    }
+
+    end = text;
+    *end = END_LINE;
+
+    for (currentNode = symbolTable->head;
+         NULL != currentNode;
+         currentNode = currentNode->next)
+    {
+        if (type == currentNode->symbol.type)
+        {
+            end += sprintf(end, "%s\t%04d\n",
+                           GetSymbolName(symbolTable, currentNode->symbol.nameId),
+                           currentNode->symbol.value);
+        }
     }
+
+    *length = end - text;
+
+    return text;
 }
 
-void UpdateSymbolTypeToEntry(SymbolTableNode *symbolTableHead, const char *symbol)
+/* Returns the lines of the .ext file (malloced, NUL-terminated), or NULL */
+char *FormatExternReferences(const SymbolTable *symbolTable, size_t *length)
 {
-    SymbolTableNode *currentNode = symbolTableHead;
+    size_t textSize = 1;
+    char *text = NULL, *end = NULL;
+    int i = 0;
 
-    assert(NULL != symbolTableHead);
-    assert(NULL != symbol);
+    assert(NULL != symbolTable);
+    assert(NULL != length);
 
-    while (NULL != currentNode)
+    for (i = 0; i < symbolTable->externReferences.numOfReferences; ++i)
+    {
+        textSize += strlen(GetSymbolName(symbolTable,
+                                         symbolTable->externReferences.references[i].symbolId)) +
+                    MAX_SYMBOL_LINE_EXTRA;
+    }
+
+    text = (char *)malloc(textSize);
+    if (NULL == text)
+    {
+        return NULL;
+    }
+
+    end = text;
+    *end = END_LINE;
+
+    for (i = 0; i < symbolTable->externReferences.numOfReferences; ++i)
+    {
+        const ExternReference *reference = symbolTable->externReferences.references + i;
+
+        end += sprintf(end, "%s\t%04d\n",
+                       GetSymbolName(symbolTable, reference->symbolId),
+                       reference->address);
+    }
+
+    *length = end - text;
+
+    return text;
+}
+
+void InsertSymbolById(SymbolTable *symbolTable,
+                      int symbolId,
+                      SymbolCharacteristic type,
+                      int value,
+                      Diagnostics *diagnostics,
+                      int lineNumber)
+{
+    SymbolTableNode *newNode = NULL;
+    SymbolTableNode *currentNode = NULL, *lastNode = NULL;
+
+    assert(NULL != symbolTable);
+    assert(symbolId >= 0);
+
+    for (currentNode = FindFirstNode(symbolTable, symbolId);
+         NULL != currentNode;
+         currentNode = currentNode->nextSameName)
     {
-        if (0 == strcmp(currentNode->symbol->name, symbol))
+        lastNode = currentNode;
+
+        if (currentNode->symbol.type != EXTERNAL)
         {
-            currentNode->symbol->type = ENTRY;
+            ReportError(diagnostics, "Line %d:\tError: redefinition of \"%s\"\n",
+                        lineNumber,
+                        GetSymbolName(symbolTable, symbolId));
+
             return;
         }
+    }
 
-        currentNode = currentNode->next;
+    if ((symbolId >= symbolTable->numOfFirstNodes &&
+         SUCCESS != GrowFirstNodes(symbolTable, symbolId)) ||
+        NULL == (newNode = AllocateSymbolTableNode(symbolTable)))
+    {
+        ReportError(diagnostics, "Line %d:\tMemory allocation error\n", lineNumber);
+
+        return;
     }
+
+    newNode->symbol.nameId = symbolId;
+    newNode->symbol.type = type;
+    newNode->symbol.value = value;
+
+    if (NULL == lastNode) /* New name */
+    {
+        symbolTable->firstNodes[symbolId] = newNode;
+    }
+    else
+    {
+        lastNode->nextSameName = newNode;
+    }
+
+    if (NULL == symbolTable->head) /* Empty table */
+    {
+        symbolTable->head = newNode;
+    }
+    else
+    {
+        symbolTable->tail->next = newNode;
+    }
+
+    symbolTable->tail = newNode;
 }
 
-void WriteToFileByType(FILE *file,
-                       SymbolTableNode *symbolTableHead,
-                       SymbolCharacteristic type)
+void AddEntrySymbol(SymbolTable *symbolTable,
+                    int symbolId,
+                    Diagnostics *diagnostics,
+                    int lineNumber)
 {
-    SymbolTableNode *currentNode = symbolTableHead;
-
-    assert(NULL != file);
-    assert(NULL != symbolTableHead);
+    assert(NULL != symbolTable);
+    assert(symbolId >= 0);
 
-    while (NULL != currentNode)
+    if (symbolTable->numOfEntries == symbolTable->entriesCapacity)
     {
-        if (type == currentNode->symbol->type)
+        int newCapacity = (0 == symbolTable->entriesCapacity)
+                              ? INITIAL_ENTRIES_CAPACITY
+                              : 2 * symbolTable->entriesCapacity;
+        int *newEntryIds = (int *)realloc(symbolTable->entryIds,
+                                          newCapacity * sizeof(int));
+        if (NULL == newEntryIds)
         {
-            fprintf(file, "%s\t%04d\n",
-                    currentNode->symbol->name,
-                    currentNode->symbol->value);
+            ReportError(diagnostics, "Line %d:\tMemory allocation error\n", lineNumber);
+            return;
         }
 
-        currentNode = currentNode->next;
+        symbolTable->entryIds = newEntryIds;
+        symbolTable->entriesCapacity = newCapacity;
     }
+
+    symbolTable->entryIds[symbolTable->numOfEntries++] = symbolId;
 }
 
-void InsertMacroToSymbolTable(const char *macroSentence,
-                              SymbolTableNode **symbolTableHead,
-                              bool *errorHasOccurred,
+void InsertMacroToSymbolTable(const Sentence *macroSentence,
+                              SymbolTable *symbolTable,
+                              Diagnostics *diagnostics,
                               int lineNumber)
 {
-    MacroDetails macroDetails = {0};
-    Symbol newSymbol = {0};
+    MacroDetails macroDetails = {{0}};
 
     assert(NULL != macroSentence);
-    assert(IsMacroSentence(macroSentence));
-    assert(NULL != symbolTableHead);
-    assert(NULL != errorHasOccurred);
+    assert(MACRO_SENTENCE == macroSentence->type);
+    assert(NULL != symbolTable);
+    assert(NULL != diagnostics);
     assert(lineNumber >= 0);
 
-    GetMacroDetails(macroSentence, &macroDetails);
-    SetSymbolParams(&newSymbol,
-                    macroDetails.name,
-                    MACRO,
-                    macroDetails.value);
+    if (IsMissingOperand(macroSentence, diagnostics, lineNumber) ||
+        !GetMacroDetails(macroSentence, &macroDetails, diagnostics, lineNumber))
+    {
+        return;
+    }
 
-    InsertToSymbolTable(symbolTableHead,
-                        &newSymbol,
-                        errorHasOccurred,
+    InsertToSymbolTable(symbolTable,
+                        macroDetails.name,
+                        MACRO,
+                        macroDetails.value,
+                        diagnostics,
                         lineNumber);
 }
 
-void InsertSymbolToSymbolTable(const char *sentenceWithSymbol,
-                               SymbolTableNode **symbolTableHead,
-                               SymbolCharacteristic characteristic,
-                               int counter,
-                               bool *errorHasOccurred,
-                               int lineNumber)
+/* Returns the id of the symbol, or ERROR */
+int InsertSymbolToSymbolTable(const Sentence *sentenceWithSymbol,
+                              SymbolTable *symbolTable,
+                              SymbolCharacteristic characteristic,
+                              int counter,
+                              Diagnostics *diagnostics,
+                              int lineNumber)
 {
-    Symbol newSymbol = {0};
-    char symbolName[MAX_SENTENCE_SIZE];
-
     assert(NULL != sentenceWithSymbol);
-    assert(HasValidSymbol(sentenceWithSymbol));
-    assert(NULL != symbolTableHead);
+    assert(0 != sentenceWithSymbol->symbol.length);
+    assert(NULL != symbolTable);
     assert(counter >= 0);
-    assert(NULL != errorHasOccurred);
+    assert(NULL != diagnostics);
     assert(lineNumber >= 0);
 
-    GetSymbol(sentenceWithSymbol, symbolName);
-    SetSymbolParams(&newSymbol, symbolName, characteristic, counter);
+    return InsertToSymbolTable(symbolTable,
+                               sentenceWithSymbol->symbol,
+                               characteristic,
+                               counter,
+                               diagnostics,
+                               lineNumber);
+}
 
-    InsertToSymbolTable(symbolTableHead,
-                        &newSymbol,
-                        errorHasOccurred,
-                        lineNumber);
+/* Returns the id of the symbol, or ERROR */
+int InsertExternToSymbolTable(const Sentence *externSentence,
+                              SymbolTable *symbolTable,
+                              Diagnostics *diagnostics,
+                              int lineNumber)
+{
+    assert(NULL != externSentence);
+    assert(EXTERN_SENTENCE == externSentence->type);
+    assert(NULL != symbolTable);
+
+    if (IsMissingOperand(externSentence, diagnostics, lineNumber))
+    {
+        return ERROR;
+    }
+
+    return InsertToSymbolTable(symbolTable,
+                               externSentence->operands,
+                               EXTERNAL,
+                               0,
+                               diagnostics,
+                               lineNumber);
 }
 
-void InsertExternToSymbolTable(const char *externSentence,
-                               SymbolTableNode **symbolTableHead,
-                               bool *errorHasOccurred,
-                               int lineNumber)
+/* Returns the id of the symbol, or ERROR */
+int InsertEntryToSymbolTable(const Sentence *entrySentence,
+                             SymbolTable *symbolTable,
+                             Diagnostics *diagnostics,
+                             int lineNumber)
 {
-    Symbol newSymbol = {0};
-    char extern_symbol[MAX_SENTENCE_SIZE];
-    char *externPrefixEnd = NULL;
+    int symbolId = 0;
 
-    assert(NULL != externSentence);
-    assert(IsExternSentence(externSentence));
-    assert(NULL != symbolTableHead);
+    assert(NULL != entrySentence);
+    assert(ENTRY_SENTENCE == entrySentence->type);
+    assert(NULL != symbolTable);
 
-    externPrefixEnd = strstr(externSentence, EXTERN_SENTENCE_PREFIX) +
-                      strlen(EXTERN_SENTENCE_PREFIX);
+    if (IsMissingOperand(entrySentence, diagnostics, lineNumber))
+    {
+        return ERROR;
+    }
 
-    strcpy(extern_symbol, externPrefixEnd);
-    RemoveWhiteSpaces(extern_symbol);
-    SetSymbolParams(&newSymbol, extern_symbol, EXTERNAL, 0);
+    symbolId = InternSymbolName(symbolTable,
+                                entrySentence->operands,
+                                diagnostics,
+                                lineNumber);
+    if (ERROR != symbolId)
+    {
+        AddEntrySymbol(symbolTable, symbolId, diagnostics, lineNumber);
+    }
 
-    InsertToSymbolTable(symbolTableHead,
-                        &newSymbol,
-                        errorHasOccurred,
-                        lineNumber);
+    return symbolId;
 }
 
 /* Static functions */
-static void InsertNodeToTable(SymbolTableNode **symbolTableHead,
-                              SymbolTableNode *nodeToInsert,
-                              bool *errorHasOccurred,
-                              int lineNumber)
+static int InsertToSymbolTable(SymbolTable *symbolTable,
+                               Span name,
+                               SymbolCharacteristic type,
+                               int value,
+                               Diagnostics *diagnostics,
+                               int lineNumber)
 {
-    SymbolTableNode *currentNode = *symbolTableHead, *lastNode = NULL;
+    int symbolId = InternSymbolName(symbolTable, name, diagnostics, lineNumber);
 
-    assert(NULL != symbolTableHead);
-    assert(NULL != nodeToInsert);
-
-    if (NULL == *symbolTableHead) /* Empty table */
+    if (ERROR != symbolId)
     {
-        *symbolTableHead = nodeToInsert;
-        return;
+        InsertSymbolById(symbolTable,
+                         symbolId,
+                         type,
+                         value,
+                         diagnostics,
+                         lineNumber);
     }
 
-    assert(NULL != *symbolTableHead);
+    return symbolId;
+}
 
-    while (NULL != currentNode)
-    {
-        lastNode = currentNode;
+/* Takes the next node of the newest block, the nodes are never freed one by
+ * one */
+static SymbolTableNode *AllocateSymbolTableNode(SymbolTable *symbolTable)
+{
+    SymbolTableBlock *block = symbolTable->blocks;
+    SymbolTableNode *newNode = NULL;
 
-        if (0 == strcmp(currentNode->symbol->name, nodeToInsert->symbol->name) &&
-            currentNode->symbol->type != EXTERNAL)
+    if (NULL == block || NODES_PER_BLOCK == block->numOfNodes)
+    {
+        block = (SymbolTableBlock *)malloc(sizeof(SymbolTableBlock));
+        if (NULL == block)
         {
-            fprintf(stderr, "Line %d:\tError: redefinition of \"%s\"\n",
-                    lineNumber,
-                    currentNode->symbol->name);
-            DestroySymbolTableNode(nodeToInsert);
-            *errorHasOccurred = TRUE;
-
-            return;
+            return NULL;
         }
 
-        currentNode = currentNode->next;
+        block->next = symbolTable->blocks;
+        block->numOfNodes = 0;
+        symbolTable->blocks = block;
     }
 
-    lastNode->next = nodeToInsert;
+    newNode = block->nodes + block->numOfNodes++;
+    newNode->next = NULL;
+    newNode->nextSameName = NULL;
+
+    return newNode;
 }
 
-static void DestroySymbolTableNode(SymbolTableNode *nodeToDestroy)
+static bool IsMissingOperand(const Sentence *sentence,
+                             Diagnostics *diagnostics,
+                             int lineNumber)
 {
-    free(nodeToDestroy->symbol);
-    free(nodeToDestroy);
+    if (0 != sentence->operands.length)
+    {
+        return FALSE;
+    }
+
+    ReportError(diagnostics,
+                "Line %d:\tError: missing operand of \"%.*s\"\n",
+                lineNumber,
+                (int)sentence->operation.length,
+                sentence->operation.start);
+
+    return TRUE;
 }
 
-static void GetMacroDetails(const char *macroSentence,
-                            MacroDetails *macroDetails)
+/* A definition is "name = number". Nothing is interned for a malformed
+ * one, so it is not reported again as a redefinition. */
+static bool GetMacroDetails(const Sentence *macroSentence,
+                            MacroDetails *macroDetails,
+                            Diagnostics *diagnostics,
+                            int lineNumber)
 {
-    int equalSignIndex = 0;
-    char tempMacroSentence[MAX_SENTENCE_SIZE];
+    Span definition = macroSentence->operands, value = {0};
+    int equalSignIndex = FindChar(definition, EQUAL_SIGN);
+
+    if (NOT_FOUND == equalSignIndex)
+    {
+        ReportError(diagnostics, "Line %d:\tError: macro definition without \"=\"\n", lineNumber);
+        return FALSE;
+    }
+
+    macroDetails->name.start = definition.start;
+    macroDetails->name.length = equalSignIndex;
+    TrimWhiteSpaces(&macroDetails->name);
 
-    strcpy(tempMacroSentence, macroSentence + strlen(MACRO_SENTENCE_PREFIX));
-    RemoveWhiteSpaces(tempMacroSentence);
+    value.start = definition.start + equalSignIndex + 1;
+    value.length = definition.length - equalSignIndex - 1;
+    TrimWhiteSpaces(&value);
 
-    equalSignIndex = FindChar(tempMacroSentence, EQUAL_SIGN);
+    if (0 == macroDetails->name.length)
+    {
+        ReportError(diagnostics, "Line %d:\tError: macro definition without a name\n", lineNumber);
+        return FALSE;
+    }
 
-    if (NOT_FOUND != equalSignIndex)
+    if (!IsNumber(value))
     {
-        strncpy(macroDetails->name, tempMacroSentence, equalSignIndex);
-        macroDetails->value = atoi(tempMacroSentence + equalSignIndex + 1);
+        ReportError(diagnostics,
+                    "Line %d:\tError: the value of macro \"%.*s\" is not a number\n",
+                    lineNumber,
+                    (int)macroDetails->name.length,
+                    macroDetails->name.start);
+        return FALSE;
+    }
+
+    macroDetails->value = GetNumber(value);
+    if (!IsNumberInRange(macroDetails->value, MIN_DATA_NUMBER, MAX_DATA_NUMBER))
+    {
+        ReportError(diagnostics,
+                    "Line %d:\tError: \"%.*s\" is out of the range of a memory word\n",
+                    lineNumber,
+                    (int)value.length,
+                    value.start);
+        return FALSE;
     }
+
+    return TRUE;
 }
 
-static void InsertToSymbolTable(SymbolTableNode **symbolTableHead,
-                                Symbol *newSymbol,
-                                bool *errorHasOccurred,
-                                int lineNumber)
+static SymbolTableNode *FindFirstNode(const SymbolTable *symbolTable,
+                                      int symbolId)
 {
-    SymbolTableNode *newNode = CreateSymbolTableNode(newSymbol);
+    assert(NULL != symbolTable);
+    assert(symbolId >= 0);
 
-    if (NULL != newNode)
+    /* Names that were only referenced have no nodes */
+    if (symbolId >= symbolTable->numOfFirstNodes)
     {
-        InsertNodeToTable(symbolTableHead,
-                          newNode,
-                          errorHasOccurred,
-                          lineNumber);
+        return NULL;
     }
-    else
+
+    return symbolTable->firstNodes[symbolId];
+}
+
+static ReturnStatus GrowFirstNodes(SymbolTable *symbolTable, int symbolId)
+{
+    int newNumOfFirstNodes = (0 == symbolTable->numOfFirstNodes)
+                                 ? INITIAL_NUM_OF_FIRST_NODES
+                                 : symbolTable->numOfFirstNodes;
+    SymbolTableNode **newFirstNodes = NULL;
+
+    while (newNumOfFirstNodes <= symbolId)
     {
-        fprintf(stderr, "Line %d:\tMemory allocation error\n", lineNumber);
-        *errorHasOccurred = TRUE;
+        newNumOfFirstNodes *= 2;
     }
+
+    newFirstNodes = (SymbolTableNode **)realloc(
+        (void *)symbolTable->firstNodes,
+        newNumOfFirstNodes * sizeof(SymbolTableNode *));
+    if (NULL == newFirstNodes)
+    {
+        return FAILURE;
+    }
+
+    memset((void *)(newFirstNodes + symbolTable->numOfFirstNodes),
+           0,
+           (newNumOfFirstNodes - symbolTable->numOfFirstNodes) *
+               sizeof(SymbolTableNode *));
+
+    symbolTable->firstNodes = newFirstNodes;
+    symbolTable->numOfFirstNodes = newNumOfFirstNodes;
+
+    return SUCCESS;
 }
 
-static SymbolTableNode *CreateSymbolTableNode(const Symbol *symbol)
+/* The capacity is at least doubled, so appending is amortized O(1) */
+static ReturnStatus GrowExternReferences(ExternReferenceList *externReferences,
+                                         int numOfReferences)
 {
-    SymbolTableNode *newNode = NULL;
+    int newCapacity = (0 == externReferences->capacity)
+                          ? INITIAL_EXTERN_REFERENCES_CAPACITY
+                          : 2 * externReferences->capacity;
+    ExternReference *newReferences = NULL;
 
-    newNode = (SymbolTableNode *)malloc(sizeof(SymbolTableNode));
-    if (NULL == newNode)
+    if (newCapacity < numOfReferences)
     {
-        return NULL;
+        newCapacity = numOfReferences;
     }
 
-    newNode->symbol = (Symbol *)malloc(sizeof(Symbol));
-    if (NULL == newNode->symbol)
+    newReferences = (ExternReference *)realloc(externReferences->references,
+                                               newCapacity * sizeof(ExternReference));
+    if (NULL == newReferences)
     {
-        free(newNode);
-        return NULL;
+        return FAILURE;
     }
 
-    memcpy(newNode->symbol, symbol, sizeof(Symbol));
-    newNode->next = NULL;
+    externReferences->references = newReferences;
+    externReferences->capacity = newCapacity;
 
-    return newNode;
+    return SUCCESS;
 }
@@ -0,0 +1,331 @@
+/****************************************
+* ASSEMBLER: thread_pool.c              *
+****************************************/
+
+#include <pthread.h> /* pthread_create, pthread_join, pthread_mutex_t */
+#include <unistd.h>  /* sysconf */
+#include <stdlib.h>  /* malloc, calloc, free */
+#include <assert.h>  /* assert */
+
+#include "thread_pool.h" /* API */
+
+#define INITIAL_QUEUE_CAPACITY (16)
+
+typedef struct
+{
+    TaskFunction function;
+    void *argument;
+} Task;
+
+/* Ring buffer: the owner pops the newest task, thieves take the oldest */
+typedef struct
+{
+    pthread_mutex_t lock;
+    Task *tasks;
+    size_t first;
+    size_t numOfTasks;
+    size_t capacity;
+} TaskQueue;
+
+typedef struct
+{
+    ThreadPool *threadPool;
+    int index;
+} Worker;
+
+struct threadPool
+{
+    pthread_t *threads;
+    Worker *workers;
+    TaskQueue *queues;
+    int numOfThreads;
+    int nextQueue;
+    pthread_mutex_t lock;
+    pthread_cond_t hasTasks;
+    pthread_cond_t allTasksDone;
+    long numOfQueuedTasks;  /* Submitted and not taken yet */
+    long numOfPendingTasks; /* Submitted and not finished yet */
+    bool isShuttingDown;
+};
+
+static void *RunWorker(void *argument);
+static bool PopTask(TaskQueue *queue, Task *task);
+static bool StealTask(ThreadPool *threadPool, int thiefIndex, Task *task);
+static ReturnStatus PushTask(TaskQueue *queue, const Task *task);
+
+ThreadPool *CreateThreadPool(int numOfThreads)
+{
+    ThreadPool *threadPool = NULL;
+    int i = 0;
+
+    assert(numOfThreads > 0);
+
+    threadPool = (ThreadPool *)calloc(1, sizeof(ThreadPool));
+    if (NULL == threadPool)
+    {
+        return NULL;
+    }
+
+    threadPool->threads = (pthread_t *)calloc(numOfThreads, sizeof(pthread_t));
+    threadPool->workers = (Worker *)calloc(numOfThreads, sizeof(Worker));
+    threadPool->queues = (TaskQueue *)calloc(numOfThreads, sizeof(TaskQueue));
+    if (NULL == threadPool->threads ||
+        NULL == threadPool->workers ||
+        NULL == threadPool->queues)
+    {
+        free(threadPool->threads);
+        free(threadPool->workers);
+        free(threadPool->queues);
+        free(threadPool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&threadPool->lock, NULL);
+    pthread_cond_init(&threadPool->hasTasks, NULL);
+    pthread_cond_init(&threadPool->allTasksDone, NULL);
+
+    for (i = 0; i < numOfThreads; ++i)
+    {
+        pthread_mutex_init(&threadPool->queues[i].lock, NULL);
+        threadPool->workers[i].threadPool = threadPool;
+        threadPool->workers[i].index = i;
+    }
+
+    for (i = 0; i < numOfThreads; ++i)
+    {
+        if (0 != pthread_create(threadPool->threads + i,
+                                NULL,
+                                RunWorker,
+                                threadPool->workers + i))
+        {
+            break;
+        }
+    }
+
+    threadPool->numOfThreads = i;
+    if (0 == i)
+    {
+        DestroyThreadPool(threadPool);
+        return NULL;
+    }
+
+    return threadPool;
+}
+
+ReturnStatus SubmitTask(ThreadPool *threadPool,
+                        TaskFunction function,
+                        void *argument)
+{
+    Task task = {0};
+    ReturnStatus status = SUCCESS;
+
+    assert(NULL != threadPool);
+    assert(NULL != function);
+
+    task.function = function;
+    task.argument = argument;
+
+    pthread_mutex_lock(&threadPool->lock);
+
+    status = PushTask(threadPool->queues + threadPool->nextQueue, &task);
+    if (SUCCESS == status)
+    {
+        threadPool->nextQueue = (threadPool->nextQueue + 1) %
+                                threadPool->numOfThreads;
+        ++threadPool->numOfQueuedTasks;
+        ++threadPool->numOfPendingTasks;
+        pthread_cond_signal(&threadPool->hasTasks);
+    }
+
+    pthread_mutex_unlock(&threadPool->lock);
+
+    return status;
+}
+
+void WaitForTasks(ThreadPool *threadPool)
+{
+    assert(NULL != threadPool);
+
+    pthread_mutex_lock(&threadPool->lock);
+
+    while (threadPool->numOfPendingTasks > 0)
+    {
+        pthread_cond_wait(&threadPool->allTasksDone, &threadPool->lock);
+    }
+
+    pthread_mutex_unlock(&threadPool->lock);
+}
+
+void DestroyThreadPool(ThreadPool *threadPool)
+{
+    int i = 0;
+
+    assert(NULL != threadPool);
+
+    pthread_mutex_lock(&threadPool->lock);
+    threadPool->isShuttingDown = TRUE;
+    pthread_cond_broadcast(&threadPool->hasTasks);
+    pthread_mutex_unlock(&threadPool->lock);
+
+    for (i = 0; i < threadPool->numOfThreads; ++i)
+    {
+        pthread_join(threadPool->threads[i], NULL);
+    }
+
+    for (i = 0; i < threadPool->numOfThreads; ++i)
+    {
+        pthread_mutex_destroy(&threadPool->queues[i].lock);
+        free(threadPool->queues[i].tasks);
+    }
+
+    pthread_cond_destroy(&threadPool->allTasksDone);
+    pthread_cond_destroy(&threadPool->hasTasks);
+    pthread_mutex_destroy(&threadPool->lock);
+
+    free(threadPool->queues);
+    free(threadPool->workers);
+    free(threadPool->threads);
+    free(threadPool);
+}
+
+int GetNumOfProcessors(void)
+{
+    long numOfProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (numOfProcessors > 0) ? (int)numOfProcessors : 1;
+}
+
+/* Static functions */
+static void *RunWorker(void *argument)
+{
+    Worker *worker = (Worker *)argument;
+    ThreadPool *threadPool = worker->threadPool;
+
+    for (;;)
+    {
+        Task task = {0};
+
+        if (PopTask(threadPool->queues + worker->index, &task) ||
+            StealTask(threadPool, worker->index, &task))
+        {
+            pthread_mutex_lock(&threadPool->lock);
+            --threadPool->numOfQueuedTasks;
+            pthread_mutex_unlock(&threadPool->lock);
+
+            task.function(task.argument);
+
+            pthread_mutex_lock(&threadPool->lock);
+            if (0 == --threadPool->numOfPendingTasks)
+            {
+                pthread_cond_broadcast(&threadPool->allTasksDone);
+            }
+            pthread_mutex_unlock(&threadPool->lock);
+
+            continue;
+        }
+
+        pthread_mutex_lock(&threadPool->lock);
+
+        while (0 == threadPool->numOfQueuedTasks &&
+               !threadPool->isShuttingDown)
+        {
+            pthread_cond_wait(&threadPool->hasTasks, &threadPool->lock);
+        }
+
+        if (0 == threadPool->numOfQueuedTasks && threadPool->isShuttingDown)
+        {
+            pthread_mutex_unlock(&threadPool->lock);
+            break;
+        }
+
+        pthread_mutex_unlock(&threadPool->lock);
+    }
+
+    return NULL;
+}
+
+static bool PopTask(TaskQueue *queue, Task *task)
+{
+    bool hasTask = FALSE;
+
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->numOfTasks > 0)
+    {
+        --queue->numOfTasks;
+        *task = queue->tasks[(queue->first + queue->numOfTasks) %
+                             queue->capacity];
+        hasTask = TRUE;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return hasTask;
+}
+
+static bool StealTask(ThreadPool *threadPool, int thiefIndex, Task *task)
+{
+    int i = 0;
+
+    for (i = 1; i < threadPool->numOfThreads; ++i)
+    {
+        TaskQueue *queue = threadPool->queues +
+                           (thiefIndex + i) % threadPool->numOfThreads;
+        bool hasTask = FALSE;
+
+        pthread_mutex_lock(&queue->lock);
+
+        if (queue->numOfTasks > 0)
+        {
+            *task = queue->tasks[queue->first];
+            queue->first = (queue->first + 1) % queue->capacity;
+            --queue->numOfTasks;
+            hasTask = TRUE;
+        }
+
+        pthread_mutex_unlock(&queue->lock);
+
+        if (hasTask)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static ReturnStatus PushTask(TaskQueue *queue, const Task *task)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->numOfTasks == queue->capacity)
+    {
+        size_t i = 0, newCapacity = (0 == queue->capacity)
+                                        ? INITIAL_QUEUE_CAPACITY
+                                        : 2 * queue->capacity;
+        Task *newTasks = (Task *)malloc(newCapacity * sizeof(Task));
+
+        if (NULL == newTasks)
+        {
+            pthread_mutex_unlock(&queue->lock);
+            return FAILURE;
+        }
+
+        for (i = 0; i < queue->numOfTasks; ++i)
+        {
+            newTasks[i] = queue->tasks[(queue->first + i) % queue->capacity];
+        }
+
+        free(queue->tasks);
+        queue->tasks = newTasks;
+        queue->first = 0;
+        queue->capacity = newCapacity;
+    }
+
+    queue->tasks[(queue->first + queue->numOfTasks) % queue->capacity] = *task;
+    ++queue->numOfTasks;
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return SUCCESS;
+}
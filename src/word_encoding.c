@@ -0,0 +1,461 @@
+/****************************************
+* ASSEMBLER: word_encoding.c            *
+****************************************/
+
+#include <string.h> /* memcpy */
+#include <assert.h> /* assert */
+
+#include "word_encoding.h"   /* API */
+#include "assembler_utils.h" /* Utils file */
+
+/* The shuffle codecs are built with GCC's (and clang's) target
+ * attributes and picked at run time, so the rest of the program needs no
+ * special flags and runs on any x86 processor */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    !defined(WORD_ENCODING_SCALAR_ONLY)
+#define SHUFFLE_WORD_CODECS
+#include <immintrin.h> /* SSSE3 and AVX2 intrinsics */
+#endif
+
+#define NUM_OF_WORD_VALUES (1 << MEMORY_WORD_SIZE_IN_BITS)
+#define PADDING_DIGIT ('*')
+
+/* Bit 7 of every encoded character is clear and bits 4-6 are 010 */
+#define ENCODED_HIGH_NIBBLE (0x20)
+/* Any value above 3: the character is not a digit */
+#define BAD_DIGIT (0x10)
+
+/* ENCODE_PARTS_n(prefix) expands to the encodings of all the n-part
+ * values after prefix, in increasing order ('*', '#', '%', '!' are the
+ * base 4 digits 0-3, most significant first) */
+#define ENCODE_PARTS_1(prefix) prefix "*", prefix "#", prefix "%", prefix "!"
+#define ENCODE_PARTS_2(prefix) ENCODE_PARTS_1(prefix "*"), ENCODE_PARTS_1(prefix "#"), \
+                               ENCODE_PARTS_1(prefix "%"), ENCODE_PARTS_1(prefix "!")
+#define ENCODE_PARTS_3(prefix) ENCODE_PARTS_2(prefix "*"), ENCODE_PARTS_2(prefix "#"), \
+                               ENCODE_PARTS_2(prefix "%"), ENCODE_PARTS_2(prefix "!")
+#define ENCODE_PARTS_4(prefix) ENCODE_PARTS_3(prefix "*"), ENCODE_PARTS_3(prefix "#"), \
+                               ENCODE_PARTS_3(prefix "%"), ENCODE_PARTS_3(prefix "!")
+#define ENCODE_PARTS_5(prefix) ENCODE_PARTS_4(prefix "*"), ENCODE_PARTS_4(prefix "#"), \
+                               ENCODE_PARTS_4(prefix "%"), ENCODE_PARTS_4(prefix "!")
+#define ENCODE_PARTS_6(prefix) ENCODE_PARTS_5(prefix "*"), ENCODE_PARTS_5(prefix "#"), \
+                               ENCODE_PARTS_5(prefix "%"), ENCODE_PARTS_5(prefix "!")
+#define ENCODE_PARTS_7(prefix) ENCODE_PARTS_6(prefix "*"), ENCODE_PARTS_6(prefix "#"), \
+                               ENCODE_PARTS_6(prefix "%"), ENCODE_PARTS_6(prefix "!")
+
+/* The encoding of every word value (without '\0') */
+static const char ENCODED_WORDS[NUM_OF_WORD_VALUES][ENCODED_WORD_SIZE] = {ENCODE_PARTS_7("")};
+
+/* The digit of every low nibble of a character ('*' 0x2A, '#' 0x23,
+ * '%' 0x25, '!' 0x21), also the table of the shuffle decoders */
+static const char DIGIT_VALUES[16] = {BAD_DIGIT, 3, BAD_DIGIT, 1, BAD_DIGIT, 2, BAD_DIGIT, BAD_DIGIT,
+                                      BAD_DIGIT, BAD_DIGIT, 0, BAD_DIGIT, BAD_DIGIT, BAD_DIGIT, BAD_DIGIT, BAD_DIGIT};
+
+static const char *WORD_CODEC_NAMES[NUM_OF_WORD_CODECS] = {"scalar", "ssse3", "avx2"};
+
+static void EncodeWordsScalar(char *encodings,
+                              const unsigned short *words,
+                              size_t numOfWords);
+static size_t DecodeWordsScalar(unsigned short *words,
+                                const char *encodings,
+                                size_t numOfWords);
+
+#ifdef SHUFFLE_WORD_CODECS
+/* A shuffle index that selects no byte (the result byte is 0) */
+#define NO_BYTE (-128)
+
+static void EncodeWordsSSSE3(char *encodings,
+                             const unsigned short *words,
+                             size_t numOfWords);
+static void EncodeWordsAVX2(char *encodings,
+                            const unsigned short *words,
+                            size_t numOfWords);
+static size_t DecodeWordsSSSE3(unsigned short *words,
+                               const char *encodings,
+                               size_t numOfWords);
+static size_t DecodeWordsAVX2(unsigned short *words,
+                              const char *encodings,
+                              size_t numOfWords);
+#endif /* SHUFFLE_WORD_CODECS */
+
+/* The fastest codec of this processor */
+WordCodec GetWordCodec(void)
+{
+    if (IsWordCodecSupported(AVX2_WORD_CODEC))
+    {
+        return AVX2_WORD_CODEC;
+    }
+
+    if (IsWordCodecSupported(SSSE3_WORD_CODEC))
+    {
+        return SSSE3_WORD_CODEC;
+    }
+
+    return SCALAR_WORD_CODEC;
+}
+
+bool IsWordCodecSupported(WordCodec codec)
+{
+    switch (codec)
+    {
+    case SCALAR_WORD_CODEC:
+        return TRUE;
+#ifdef SHUFFLE_WORD_CODECS
+    case SSSE3_WORD_CODEC:
+        return __builtin_cpu_supports("ssse3") ? TRUE : FALSE;
+    case AVX2_WORD_CODEC:
+        return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+#endif /* SHUFFLE_WORD_CODECS */
+    default:
+        return FALSE;
+    }
+}
+
+const char *GetWordCodecName(WordCodec codec)
+{
+    assert(codec >= 0 && codec < NUM_OF_WORD_CODECS);
+
+    return WORD_CODEC_NAMES[codec];
+}
+
+/* Writes the encoding of every word ENCODED_WORD_STRIDE bytes apart */
+void EncodeWords(WordCodec codec,
+                 char *encodings,
+                 const unsigned short *words,
+                 size_t numOfWords)
+{
+    assert(NULL != encodings);
+    assert(NULL != words || 0 == numOfWords);
+    assert(IsWordCodecSupported(codec));
+
+    switch (codec)
+    {
+#ifdef SHUFFLE_WORD_CODECS
+    case AVX2_WORD_CODEC:
+        EncodeWordsAVX2(encodings, words, numOfWords);
+        break;
+    case SSSE3_WORD_CODEC:
+        EncodeWordsSSSE3(encodings, words, numOfWords);
+        break;
+#endif /* SHUFFLE_WORD_CODECS */
+    default:
+        EncodeWordsScalar(encodings, words, numOfWords);
+        break;
+    }
+}
+
+/* Reads encodings ENCODED_WORD_STRIDE bytes apart. Returns the number of
+ * words decoded before the first bad encoding (numOfWords if there is
+ * none); the words after it are undefined. */
+size_t DecodeWords(WordCodec codec,
+                   unsigned short *words,
+                   const char *encodings,
+                   size_t numOfWords)
+{
+    assert(NULL != words || 0 == numOfWords);
+    assert(NULL != encodings);
+    assert(IsWordCodecSupported(codec));
+
+    switch (codec)
+    {
+#ifdef SHUFFLE_WORD_CODECS
+    case AVX2_WORD_CODEC:
+        return DecodeWordsAVX2(words, encodings, numOfWords);
+    case SSSE3_WORD_CODEC:
+        return DecodeWordsSSSE3(words, encodings, numOfWords);
+#endif /* SHUFFLE_WORD_CODECS */
+    default:
+        return DecodeWordsScalar(words, encodings, numOfWords);
+    }
+}
+
+/* Copies an encoding of ENCODED_WORD_SIZE characters into the batch.
+ * Returns TRUE when the batch is full. */
+bool AddToWordBatch(EncodedWordBatch *batch,
+                    const char *encodedWord,
+                    unsigned long address,
+                    int lineNumber)
+{
+    assert(NULL != batch);
+    assert(NULL != encodedWord);
+    assert(batch->numOfWords < WORD_BATCH_SIZE);
+
+    memcpy(batch->encodings + batch->numOfWords * ENCODED_WORD_STRIDE,
+           encodedWord,
+           ENCODED_WORD_SIZE);
+    batch->addresses[batch->numOfWords] = address;
+    batch->lineNumbers[batch->numOfWords] = lineNumber;
+
+    return WORD_BATCH_SIZE == ++batch->numOfWords;
+}
+
+/* Static functions */
+
+static void EncodeWordsScalar(char *encodings,
+                              const unsigned short *words,
+                              size_t numOfWords)
+{
+    size_t i = 0;
+
+    for (i = 0; i < numOfWords; ++i)
+    {
+        memcpy(encodings, ENCODED_WORDS[words[i] & MEMORY_WORD_MASK], ENCODED_WORD_SIZE);
+        encodings[ENCODED_WORD_SIZE] = PADDING_DIGIT;
+        encodings += ENCODED_WORD_STRIDE;
+    }
+}
+
+/* Without branches on the characters, like the shuffle decoders */
+static size_t DecodeWordsScalar(unsigned short *words,
+                                const char *encodings,
+                                size_t numOfWords)
+{
+    size_t i = 0, j = 0;
+
+    for (i = 0; i < numOfWords; ++i)
+    {
+        unsigned int word = 0, bad = 0;
+
+        for (j = 0; j < ENCODED_WORD_SIZE; ++j)
+        {
+            unsigned int character = (unsigned char)encodings[j];
+            unsigned int digit = (unsigned char)DIGIT_VALUES[character & 0x0F];
+
+            bad |= ((character ^ ENCODED_HIGH_NIBBLE) & 0xF0) | (digit & ~3U);
+            word = (word << 2) | (digit & 3);
+        }
+
+        if (0 != bad)
+        {
+            return i;
+        }
+
+        words[i] = (unsigned short)word;
+        encodings += ENCODED_WORD_STRIDE;
+    }
+
+    return numOfWords;
+}
+
+#ifdef SHUFFLE_WORD_CODECS
+
+/* Every byte of a word holds 4 digits. The digits are split by their
+ * place in the byte (digits[k] holds bits 2k-2k+1 of every byte), and
+ * interleaving them gives the 16 digits of two words, least significant
+ * first. One shuffle puts them in order and a second one turns them into
+ * characters; the index of the padding selects no digit, so it is '*'. */
+__attribute__((target("ssse3")))
+static void EncodeWordsSSSE3(char *encodings,
+                             const unsigned short *words,
+                             size_t numOfWords)
+{
+    const __m128i digitMask = _mm_set1_epi8(3);
+    const __m128i digitCharacters = _mm_setr_epi8('*', '#', '%', '!', 0, 0, 0, 0,
+                                                  0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i digitOrder = _mm_setr_epi8(6, 5, 4, 3, 2, 1, 0, NO_BYTE,
+                                             14, 13, 12, 11, 10, 9, 8, NO_BYTE);
+    size_t i = 0;
+
+    for (i = 0; i + 8 <= numOfWords; i += 8)
+    {
+        __m128i packedWords = _mm_loadu_si128((const __m128i *)(words + i));
+        __m128i digits0 = _mm_and_si128(packedWords, digitMask);
+        __m128i digits1 = _mm_and_si128(_mm_srli_epi16(packedWords, 2), digitMask);
+        __m128i digits2 = _mm_and_si128(_mm_srli_epi16(packedWords, 4), digitMask);
+        __m128i digits3 = _mm_and_si128(_mm_srli_epi16(packedWords, 6), digitMask);
+        __m128i lowDigits01 = _mm_unpacklo_epi8(digits0, digits1);
+        __m128i lowDigits23 = _mm_unpacklo_epi8(digits2, digits3);
+        __m128i highDigits01 = _mm_unpackhi_epi8(digits0, digits1);
+        __m128i highDigits23 = _mm_unpackhi_epi8(digits2, digits3);
+        char *encoding = encodings + i * ENCODED_WORD_STRIDE;
+
+        _mm_storeu_si128((__m128i *)encoding,
+                         _mm_shuffle_epi8(digitCharacters,
+                                          _mm_shuffle_epi8(_mm_unpacklo_epi16(lowDigits01, lowDigits23),
+                                                           digitOrder)));
+        _mm_storeu_si128((__m128i *)(encoding + 16),
+                         _mm_shuffle_epi8(digitCharacters,
+                                          _mm_shuffle_epi8(_mm_unpackhi_epi16(lowDigits01, lowDigits23),
+                                                           digitOrder)));
+        _mm_storeu_si128((__m128i *)(encoding + 32),
+                         _mm_shuffle_epi8(digitCharacters,
+                                          _mm_shuffle_epi8(_mm_unpacklo_epi16(highDigits01, highDigits23),
+                                                           digitOrder)));
+        _mm_storeu_si128((__m128i *)(encoding + 48),
+                         _mm_shuffle_epi8(digitCharacters,
+                                          _mm_shuffle_epi8(_mm_unpackhi_epi16(highDigits01, highDigits23),
+                                                           digitOrder)));
+    }
+
+    EncodeWordsScalar(encodings + i * ENCODED_WORD_STRIDE, words + i, numOfWords - i);
+}
+
+/* Like the SSSE3 encoder, 16 words at a time. The interleaving works in
+ * 16-byte lanes, so the pairs of words are first spread over the lanes
+ * (0, 4, 8, 12 in the lower lane, 2, 6, 10, 14 in the upper lane) for
+ * every result to hold 4 words in order. */
+__attribute__((target("avx2")))
+static void EncodeWordsAVX2(char *encodings,
+                            const unsigned short *words,
+                            size_t numOfWords)
+{
+    const __m256i digitMask = _mm256_set1_epi8(3);
+    const __m256i digitCharacters = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8('*', '#', '%', '!', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0));
+    const __m256i digitOrder = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(6, 5, 4, 3, 2, 1, 0, NO_BYTE, 14, 13, 12, 11, 10, 9, 8, NO_BYTE));
+    const __m256i pairOrder = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    size_t i = 0;
+
+    for (i = 0; i + 16 <= numOfWords; i += 16)
+    {
+        __m256i packedWords = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256((const __m256i *)(words + i)), pairOrder);
+        __m256i digits0 = _mm256_and_si256(packedWords, digitMask);
+        __m256i digits1 = _mm256_and_si256(_mm256_srli_epi16(packedWords, 2), digitMask);
+        __m256i digits2 = _mm256_and_si256(_mm256_srli_epi16(packedWords, 4), digitMask);
+        __m256i digits3 = _mm256_and_si256(_mm256_srli_epi16(packedWords, 6), digitMask);
+        __m256i lowDigits01 = _mm256_unpacklo_epi8(digits0, digits1);
+        __m256i lowDigits23 = _mm256_unpacklo_epi8(digits2, digits3);
+        __m256i highDigits01 = _mm256_unpackhi_epi8(digits0, digits1);
+        __m256i highDigits23 = _mm256_unpackhi_epi8(digits2, digits3);
+        char *encoding = encodings + i * ENCODED_WORD_STRIDE;
+
+        _mm256_storeu_si256((__m256i *)encoding,
+                            _mm256_shuffle_epi8(digitCharacters,
+                                                _mm256_shuffle_epi8(_mm256_unpacklo_epi16(lowDigits01, lowDigits23),
+                                                                    digitOrder)));
+        _mm256_storeu_si256((__m256i *)(encoding + 32),
+                            _mm256_shuffle_epi8(digitCharacters,
+                                                _mm256_shuffle_epi8(_mm256_unpackhi_epi16(lowDigits01, lowDigits23),
+                                                                    digitOrder)));
+        _mm256_storeu_si256((__m256i *)(encoding + 64),
+                            _mm256_shuffle_epi8(digitCharacters,
+                                                _mm256_shuffle_epi8(_mm256_unpacklo_epi16(highDigits01, highDigits23),
+                                                                    digitOrder)));
+        _mm256_storeu_si256((__m256i *)(encoding + 96),
+                            _mm256_shuffle_epi8(digitCharacters,
+                                                _mm256_shuffle_epi8(_mm256_unpackhi_epi16(highDigits01, highDigits23),
+                                                                    digitOrder)));
+    }
+
+    EncodeWordsSSSE3(encodings + i * ENCODED_WORD_STRIDE, words + i, numOfWords - i);
+}
+
+/* The low nibble of a character selects its digit and the high nibble
+ * must be 2. The digits of an encoding are then summed into the word in three multiply-add steps:
+ * pairs of digits, the first 4 and the last 3 digits, and the word. */
+__attribute__((target("ssse3")))
+static size_t DecodeWordsSSSE3(unsigned short *words,
+                               const char *encodings,
+                               size_t numOfWords)
+{
+    const __m128i lowNibble = _mm_set1_epi8(0x0F);
+    const __m128i highNibble = _mm_set1_epi8((char)0xF0);
+    const __m128i encodedHighNibble = _mm_set1_epi8(ENCODED_HIGH_NIBBLE);
+    const __m128i notADigit = _mm_set1_epi8((char)0xFC);
+    const __m128i digitValues = _mm_loadu_si128((const __m128i *)DIGIT_VALUES);
+    const __m128i encodingBytes = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, 0,
+                                                -1, -1, -1, -1, -1, -1, -1, 0);
+    const __m128i pairWeights = _mm_setr_epi8(4, 1, 4, 1, 4, 1, 1, 0,
+                                              4, 1, 4, 1, 4, 1, 1, 0);
+    const __m128i partWeights = _mm_setr_epi16(16, 1, 4, 1, 16, 1, 4, 1);
+    const __m128i wordWeights = _mm_setr_epi16(64, 1, 64, 1, 64, 1, 64, 1);
+    size_t i = 0;
+    int m = 0;
+
+    for (i = 0; i + 8 <= numOfWords; i += 8)
+    {
+        __m128i parts[4], badBytes = _mm_setzero_si128();
+
+        for (m = 0; m < 4; ++m)
+        {
+            __m128i characters = _mm_loadu_si128(
+                (const __m128i *)(encodings + (i + 2 * m) * ENCODED_WORD_STRIDE));
+            __m128i digits = _mm_shuffle_epi8(digitValues, _mm_and_si128(characters, lowNibble));
+            __m128i bad = _mm_or_si128(
+                _mm_and_si128(_mm_xor_si128(characters, encodedHighNibble), highNibble),
+                _mm_and_si128(digits, notADigit));
+
+            badBytes = _mm_or_si128(badBytes, _mm_and_si128(bad, encodingBytes));
+            parts[m] = _mm_madd_epi16(_mm_maddubs_epi16(digits, pairWeights), partWeights);
+        }
+
+        if (0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi8(badBytes, _mm_setzero_si128())))
+        {
+            break;
+        }
+
+        _mm_storeu_si128((__m128i *)(words + i),
+                         _mm_packs_epi32(
+                             _mm_madd_epi16(_mm_packs_epi32(parts[0], parts[1]), wordWeights),
+                             _mm_madd_epi16(_mm_packs_epi32(parts[2], parts[3]), wordWeights)));
+    }
+
+    return i + DecodeWordsScalar(words + i,
+                                 encodings + i * ENCODED_WORD_STRIDE,
+                                 numOfWords - i);
+}
+
+/* Like the SSSE3 decoder, 4 encodings per register. The packs work in
+ * 16-byte lanes, so the words come out in the order 0-1, 4-5, 8-9, 12-13,
+ * 2-3, 6-7, 10-11, 14-15 and a last permutation sorts them. */
+__attribute__((target("avx2")))
+static size_t DecodeWordsAVX2(unsigned short *words,
+                              const char *encodings,
+                              size_t numOfWords)
+{
+    const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+    const __m256i highNibble = _mm256_set1_epi8((char)0xF0);
+    const __m256i encodedHighNibble = _mm256_set1_epi8(ENCODED_HIGH_NIBBLE);
+    const __m256i notADigit = _mm256_set1_epi8((char)0xFC);
+    const __m256i digitValues = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)DIGIT_VALUES));
+    const __m256i encodingBytes = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, 0, -1, -1, -1, -1, -1, -1, -1, 0));
+    const __m256i pairWeights = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(4, 1, 4, 1, 4, 1, 1, 0, 4, 1, 4, 1, 4, 1, 1, 0));
+    const __m256i partWeights = _mm256_broadcastsi128_si256(
+        _mm_setr_epi16(16, 1, 4, 1, 16, 1, 4, 1));
+    const __m256i wordWeights = _mm256_set1_epi32(0x00010040); /* 64, 1 */
+    const __m256i wordOrder = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    int m = 0;
+
+    for (i = 0; i + 16 <= numOfWords; i += 16)
+    {
+        __m256i parts[4], badBytes = _mm256_setzero_si256();
+
+        for (m = 0; m < 4; ++m)
+        {
+            __m256i characters = _mm256_loadu_si256(
+                (const __m256i *)(encodings + (i + 4 * m) * ENCODED_WORD_STRIDE));
+            __m256i digits = _mm256_shuffle_epi8(digitValues,
+                                                 _mm256_and_si256(characters, lowNibble));
+            __m256i bad = _mm256_or_si256(
+                _mm256_and_si256(_mm256_xor_si256(characters, encodedHighNibble), highNibble),
+                _mm256_and_si256(digits, notADigit));
+
+            badBytes = _mm256_or_si256(badBytes, _mm256_and_si256(bad, encodingBytes));
+            parts[m] = _mm256_madd_epi16(_mm256_maddubs_epi16(digits, pairWeights), partWeights);
+        }
+
+        if (-1 != _mm256_movemask_epi8(_mm256_cmpeq_epi8(badBytes, _mm256_setzero_si256())))
+        {
+            break;
+        }
+
+        _mm256_storeu_si256(
+            (__m256i *)(words + i),
+            _mm256_permutevar8x32_epi32(
+                _mm256_packs_epi32(
+                    _mm256_madd_epi16(_mm256_packs_epi32(parts[0], parts[1]), wordWeights),
+                    _mm256_madd_epi16(_mm256_packs_epi32(parts[2], parts[3]), wordWeights)),
+                wordOrder));
+    }
+
+    return i + DecodeWordsSSSE3(words + i,
+                                encodings + i * ENCODED_WORD_STRIDE,
+                                numOfWords - i);
+}
+
+#endif /* SHUFFLE_WORD_CODECS */
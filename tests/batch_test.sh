@@ -0,0 +1,64 @@
+#!/bin/sh
+# A batch (-p) must end every program of its manifest as a separate run
+# of the simulator does: the same status, steps, zero flag, registers and
+# output (its hash and size), on any number of threads, with and without
+# the micro-op cache (-d). The programs are those of simulator_helpers.sh
+# and a program reading different inputs, as an object file and as a
+# source assembled in memory.
+# Run from the repository root after 'make' (or through 'make test').
+
+. tests/simulator_helpers.sh
+
+MAX_STEPS=5000
+
+write_programs
+cat > "$WORK_DIR/echo.as" << 'EOF'
+.define N = 4
+MAIN:   mov     #N, r2
+LOOP:   red     r1
+        prn     r1
+        add     r1, SUM
+        dec     r2
+        cmp     r2, #0
+        bne     LOOP
+        prn     SUM
+        jsr     SUB
+        mov     SUM, r3
+        stop
+SUB:    not     SUM
+        prn     SUM
+        rts
+SUM:    .data   0
+EOF
+"$ASSEMBLER" "$WORK_DIR/echo"
+printf 'abcdefgh' > "$WORK_DIR/letters"
+printf 'xy' > "$WORK_DIR/short"
+: > "$WORK_DIR/empty"
+
+{
+    echo "# Object files, a source assembled in memory, and missing inputs"
+    for program in $PROGRAMS; do
+        echo "$program.ob"
+    done
+    echo
+    echo "$WORK_DIR/echo.ob $WORK_DIR/letters"
+    echo "$WORK_DIR/echo.ob $WORK_DIR/short"
+    echo "$WORK_DIR/echo.ob $WORK_DIR/empty"
+    echo "$WORK_DIR/echo.as $WORK_DIR/letters"
+} > "$WORK_DIR/manifest"
+
+grep -v '^#' "$WORK_DIR/manifest" | grep -v '^$' | while read -r program input; do
+    write_results_line "$program" "$program" "$input"
+done > "$WORK_DIR/expected"
+
+for options in "-w 1" "-w 4" "-w 4 -d"; do
+    "$SIMULATOR" -s $MAX_STEPS $options -o "$WORK_DIR/results" -p "$WORK_DIR/manifest" 2> /dev/null
+    compare_results "$WORK_DIR/expected" "$WORK_DIR/results" "the batch ($options)"
+done
+
+if [ $(wc -l < "$WORK_DIR/expected") -lt 6 ]; then
+    echo "FAIL: too few of the programs assembled"
+    failures=$((failures + 1))
+fi
+
+finish_test batch_test
@@ -0,0 +1,137 @@
+#!/bin/sh
+# Collected messages must be whole, however long: a message is reported
+# to a stream and to a buffer (and appended to another buffer), and the
+# three must be the same. Wrong sentences must be reported as errors,
+# and leave no object file; the numbers at the ends of the ranges must
+# run as written.
+# Run from the repository root after 'make' (or through 'make test').
+
+CC=${CC:-cc}
+ASSEMBLER=${ASSEMBLER:-./assembler}
+SIMULATOR=${SIMULATOR:-./simulator}
+WORK_DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+cat > "$WORK_DIR/diagnostics_check.c" << 'EOF'
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "diagnostics.h"
+
+int main(int argc, char *argv[])
+{
+    Diagnostics streamed = {0}, collected = {0}, appended = {0};
+    size_t nameLength = (size_t)atoi(argv[1]);
+    char *name = (char *)malloc(nameLength + 1);
+
+    memset(name, 'A', nameLength);
+    name[nameLength] = '\0';
+
+    streamed.stream = stdout;
+    ReportError(&streamed, "Line %d:\tError: redefinition of \"%s\"\n", 1, name);
+    ReportWarning(&collected, "Line %d:\tError: redefinition of \"%s\"\n", 1, name);
+    ReportError(&collected, "Line %d:\tError: redefinition of \"%s\"\n", 2, name);
+    AppendDiagnostics(&appended, &collected);
+
+    fputs(collected.buffer, stdout);
+    fputs(appended.buffer, stdout);
+    printf("%d %d\n", (int)appended.numOfReports, (int)appended.errorHasOccurred);
+
+    DestroyDiagnostics(&collected);
+    DestroyDiagnostics(&appended);
+    free(name);
+
+    return 0;
+}
+EOF
+
+if ! $CC -ansi -pedantic -Wall -Iinclude "$WORK_DIR/diagnostics_check.c" \
+        -Llib -lassembler -pthread -o "$WORK_DIR/diagnostics_check"; then
+    echo "diagnostics_test: the check does not compile"
+    exit 1
+fi
+
+failures=0
+for nameLength in 0 150 300 1000 100000; do
+    name=$(awk -v n=$nameLength 'BEGIN { while (i++ < n) printf "A" }')
+    {
+        printf 'Line 1:\tError: redefinition of "%s"\n' "$name"
+        printf 'Line 1:\tError: redefinition of "%s"\n' "$name"
+        printf 'Line 2:\tError: redefinition of "%s"\n' "$name"
+        printf 'Line 1:\tError: redefinition of "%s"\n' "$name"
+        printf 'Line 2:\tError: redefinition of "%s"\n' "$name"
+        echo "2 1"
+    } > "$WORK_DIR/expected"
+
+    "$WORK_DIR/diagnostics_check" $nameLength > "$WORK_DIR/actual"
+    if ! cmp -s "$WORK_DIR/expected" "$WORK_DIR/actual"; then
+        echo "FAIL: a message with a name of $nameLength characters"
+        failures=$((failures + 1))
+    fi
+done
+
+# Assembles the source (the second argument) and compares the messages
+# with the third
+check_errors()
+{
+    printf '%b' "$2" > "$WORK_DIR/$1.as"
+    printf '%b' "$3" > "$WORK_DIR/$1.expected"
+    "$ASSEMBLER" "$WORK_DIR/$1" 2> "$WORK_DIR/$1.errors"
+    if ! cmp -s "$WORK_DIR/$1.expected" "$WORK_DIR/$1.errors" || [ -e "$WORK_DIR/$1.ob" ]; then
+        echo "FAIL: $1"
+        cat "$WORK_DIR/$1.errors"
+        failures=$((failures + 1))
+    fi
+}
+
+check_errors missing_register_destination 'A:      mov     r1\n        stop\n' \
+    'Line 1:\tError: missing destination operand of "mov"\n'
+check_errors missing_symbol_destination 'X:      .data   1\n        mov     X\n        stop\n' \
+    'Line 2:\tError: missing destination operand of "mov"\n'
+# Assembles and runs the source (the second argument) and compares the
+# output with the third
+check_output()
+{
+    printf '%b' "$2" > "$WORK_DIR/$1.as"
+    printf '%b' "$3" > "$WORK_DIR/$1.expected"
+    "$ASSEMBLER" "$WORK_DIR/$1" 2> "$WORK_DIR/$1.errors"
+    "$SIMULATOR" "$WORK_DIR/$1" > "$WORK_DIR/$1.output" 2>> "$WORK_DIR/$1.errors"
+    if ! cmp -s "$WORK_DIR/$1.expected" "$WORK_DIR/$1.output" || [ -s "$WORK_DIR/$1.errors" ]; then
+        echo "FAIL: $1"
+        cat "$WORK_DIR/$1.errors"
+        failures=$((failures + 1))
+    fi
+}
+
+check_errors too_many_operands 'X:      .data   1\n        mov     r1, r2, r3\n        inc     X, r2\n        stop    extra\n        rts     r1\n' \
+    'Line 2:\tError: too many operands of "mov"\nLine 3:\tError: too many operands of "inc"\nLine 4:\tError: too many operands of "stop"\nLine 5:\tError: too many operands of "rts"\n'
+check_errors long_immediate '        prn     #99999999999999999999\n        stop\n' \
+    'Line 1:\tError: "99999999999999999999" is out of the range of an immediate operand\n'
+check_errors immediate_range '.define BIG = 2048\n        prn     #2048\n        prn     #-2049\n        prn     #BIG\n        stop\n' \
+    'Line 2:\tError: "2048" is out of the range of an immediate operand\nLine 3:\tError: "-2049" is out of the range of an immediate operand\nLine 4:\tError: "BIG" is out of the range of an immediate operand\n'
+check_errors index_range 'X:      .data   1\n        mov     X[2048], r1\n        mov     X[-1], r1\n        stop\n' \
+    'Line 2:\tError: "2048" is out of the range of an index\nLine 3:\tError: "-1" is out of the range of an index\n'
+check_errors data_range 'X:      .data   8192\nY:      .data   -8193\n        stop\n' \
+    'Line 1:\tError: "8192" is out of the range of a memory word\nLine 2:\tError: "-8193" is out of the range of a memory word\n'
+check_output range_ends '.define LOW = -2048\nX:      .data   8191, -8192\n        prn     #2047\n        prn     #LOW\n        prn     X\n        prn     X[1]\n        stop\n' \
+    '2047\n-2048\n8191\n-8192\n'
+check_errors long_data 'X:      .data   1, -99999999999\n        stop\n' \
+    'Line 1:\tError: "-99999999999" is out of the range of a memory word\n'
+check_errors malformed_definitions '.define\n.define A\n.define B\n.define = 3\n.define C = x\n.define D = 99999\n        stop\n' \
+    'Line 1:\tError: missing operand of ".define"\nLine 2:\tError: macro definition without "="\nLine 3:\tError: macro definition without "="\nLine 4:\tError: macro definition without a name\nLine 5:\tError: the value of macro "C" is not a number\nLine 6:\tError: "99999" is out of the range of a memory word\n'
+check_errors indented_symbols '   A: mov     r1, r2\n\tB:\tstop\n   C:\n        stop\n' \
+    'Line 1:\tError: a symbol definition must start in column 1\nLine 2:\tError: a symbol definition must start in column 1\nLine 3:\tError: a symbol definition must start in column 1\n'
+check_output registers '        mov     #5, r7\n        mov     #3, r6\n        mov     #-1, r0\n        add     r7, r6\n        mov     r6, r7\n        prn     r7\n        prn     r6\n        prn     r0\n        stop\n' \
+    '8\n8\n-1\n'
+check_errors no_register_8 '        prn     r8\n        stop\n' \
+    'Line 1:\tError: "r8" is undefined (not in symbol table)\n'
+check_errors missing_symbols '.extern\n.entry\n        stop\n' \
+    'Line 1:\tError: missing operand of ".extern"\nLine 2:\tError: missing operand of ".entry"\n'
+
+if [ $failures -ne 0 ]; then
+    echo "diagnostics_test: $failures failures"
+    exit 1
+fi
+
+echo "diagnostics_test: passed"
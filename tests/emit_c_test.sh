@@ -0,0 +1,111 @@
+#!/bin/sh
+# A program translated to C (--emit-c) must run as the simulator runs it:
+# the same output, messages, final state and exit status.
+# Run from the repository root after 'make' (or through 'make test').
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+SIMULATOR=${SIMULATOR:-./simulator}
+CC=${CC:-cc}
+MAX_STEPS=100000
+WORK_DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+failures=0
+
+# Loops, subroutines, input and indexed operands
+cat > "$WORK_DIR/loops.as" << 'EOF'
+MAIN:   mov     #10, r1
+        clr     r2
+LOOP:   add     r1, r2
+        dec     r1
+        cmp     r1, #0
+        bne     LOOP
+        prn     r2
+        jsr     SUB
+        jsr     SUB
+        red     r3
+        prn     r3
+        red     CHAR
+        prn     CHAR
+        mov     ARR[2], r5
+        prn     r5
+        mov     #-7, ARR[1]
+        prn     ARR[1]
+        not     r5
+        cmp     r5, #-4
+        bne     DONE
+        prn     #1
+DONE:   stop
+SUB:    inc     COUNT
+        prn     COUNT
+        rts
+ARR:    .data   1, 2, 3
+COUNT:  .data   0
+CHAR:   .data   0
+EOF
+
+# Code that writes to the code, and a jump into the data
+cat > "$WORK_DIR/patch.as" << 'EOF'
+MAIN:   mov     STOPW, PATCH
+        prn     #2
+PATCH:  inc     r1
+        prn     r1
+        stop
+STOPW:  .data   960
+EOF
+
+cat > "$WORK_DIR/data.as" << 'EOF'
+MAIN:   prn     #3
+        jmp     WORDS
+        stop
+WORDS:  .data   960
+EOF
+
+# A program that never stops
+cat > "$WORK_DIR/forever.as" << 'EOF'
+MAIN:   inc     r1
+        jmp     MAIN
+EOF
+
+cp tests/*.as "$WORK_DIR/"
+
+for source in "$WORK_DIR"/*.as; do
+    program=${source%.as}
+    name=$(basename "$program")
+
+    "$ASSEMBLER" --emit-c "$program" 2> /dev/null
+    if [ ! -f "$program.ob" ]; then
+        continue # Not assembled (errors in the source)
+    fi
+
+    if ! $CC -O2 -w "$program.c" -o "$program.exe"; then
+        echo "FAIL: $name: the translated program does not compile"
+        failures=$((failures + 1))
+        continue
+    fi
+
+    printf 'AB' | "$SIMULATOR" -s $MAX_STEPS -m "$program" > "$WORK_DIR/expected.out" 2> "$WORK_DIR/expected.err"
+    echo "status $?" >> "$WORK_DIR/expected.out"
+    printf 'AB' | "$program.exe" -s $MAX_STEPS -m > "$WORK_DIR/actual.out" 2> "$WORK_DIR/actual.err"
+    echo "status $?" >> "$WORK_DIR/actual.out"
+
+    # The messages start with the name of the program
+    sed "s#^$program:#PROGRAM:#" "$WORK_DIR/expected.err" > "$WORK_DIR/expected.messages"
+    sed "s#^$program.exe:#PROGRAM:#" "$WORK_DIR/actual.err" > "$WORK_DIR/actual.messages"
+
+    if ! cmp -s "$WORK_DIR/expected.out" "$WORK_DIR/actual.out"; then
+        echo "FAIL: $name: the output differs from the simulator"
+        failures=$((failures + 1))
+    fi
+
+    if ! cmp -s "$WORK_DIR/expected.messages" "$WORK_DIR/actual.messages"; then
+        echo "FAIL: $name: the final state differs from the simulator"
+        failures=$((failures + 1))
+    fi
+done
+
+if [ $failures -ne 0 ]; then
+    echo "emit_c_test: $failures failures"
+    exit 1
+fi
+
+echo "emit_c_test: passed"
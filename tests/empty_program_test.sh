@@ -0,0 +1,51 @@
+#!/bin/sh
+# A program without instructions (data only, an empty file, comments only)
+# must assemble in every mode, to an object file with no code words.
+# Run from the repository root after 'make' (or through 'make test').
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+OBJCONV=${OBJCONV:-./objconv}
+WORK_DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+failures=0
+
+mkdir "$WORK_DIR/sources"
+printf 'A:      .data   1, 2, 3\n        .entry  A\n' > "$WORK_DIR/sources/data.as"
+: > "$WORK_DIR/sources/empty.as"
+printf '; nothing but a comment\n\n' > "$WORK_DIR/sources/comment.as"
+
+printf '\t0 3\n0100\t******#\n0101\t******%%\n0102\t******!\n' > "$WORK_DIR/data.ob"
+printf 'A\t0100\n' > "$WORK_DIR/data.ent"
+printf '\t0 0\n' > "$WORK_DIR/empty.ob"
+printf '\t0 0\n' > "$WORK_DIR/comment.ob"
+
+# Each mode runs twice, so that -i also reads back what it cached
+for mode in "" "-j 2" "-i" "-b" "--emit-c"; do
+    rm -rf "$WORK_DIR/run"
+    cp -r "$WORK_DIR/sources" "$WORK_DIR/run"
+    for run in 1 2; do
+        if ! "$ASSEMBLER" $mode "$WORK_DIR/run/data" "$WORK_DIR/run/empty" \
+                "$WORK_DIR/run/comment" 2> "$WORK_DIR/run/errors"; then
+            echo "FAIL: '$mode' (run $run): the assembler failed"
+            cat "$WORK_DIR/run/errors"
+            failures=$((failures + 1))
+            continue
+        fi
+        if [ "$mode" = "-b" ]; then # The text files back from the binary ones
+            "$OBJCONV" -t "$WORK_DIR/run/data" "$WORK_DIR/run/empty" "$WORK_DIR/run/comment"
+        fi
+        for file in data.ob data.ent empty.ob comment.ob; do
+            if ! cmp -s "$WORK_DIR/$file" "$WORK_DIR/run/$file"; then
+                echo "FAIL: '$mode' (run $run): $file is not as expected"
+                failures=$((failures + 1))
+            fi
+        done
+    done
+done
+
+if [ $failures -ne 0 ]; then
+    echo "empty_program_test: $failures failures"
+    exit 1
+fi
+
+echo "empty_program_test: passed"
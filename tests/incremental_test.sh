@@ -0,0 +1,82 @@
+#!/bin/sh
+# Incremental assembly (-i) must write the same files as a full assembly:
+# after edits of the source, and with a damaged cache file.
+# Run from the repository root after 'make' (or through 'make test').
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+WORK_DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+failures=0
+
+# Assembles $1.as in full and with its cache, and compares the files
+compare_with_full_assembly()
+{
+    mkdir -p "$WORK_DIR/full"
+    cp "$1.as" "$WORK_DIR/full/"
+    name=$(basename "$1")
+    rm -f "$1.ob" "$1.ent" "$1.ext"
+    "$ASSEMBLER" "$WORK_DIR/full/$name" 2> "$WORK_DIR/full/$name.err"
+    "$ASSEMBLER" -i "$1" 2> "$1.err"
+
+    for postfix in ob ent ext err; do
+        if [ -f "$WORK_DIR/full/$name.$postfix" ] || [ -f "$1.$postfix" ]; then
+            sed "s#$WORK_DIR/full/##g" "$WORK_DIR/full/$name.$postfix" > "$WORK_DIR/expected" 2> /dev/null
+            sed "s#$WORK_DIR/##g" "$1.$postfix" > "$WORK_DIR/actual" 2> /dev/null
+            if ! cmp -s "$WORK_DIR/expected" "$WORK_DIR/actual"; then
+                echo "FAIL: $2: $name.$postfix differs from a full assembly"
+                failures=$((failures + 1))
+            fi
+        fi
+    done
+
+    rm -rf "$WORK_DIR/full"
+}
+
+for test in tests/test1 tests/test2 tests/test3; do
+    name=$(basename "$test")
+    cp "$test.as" "$WORK_DIR/$name.as"
+    compare_with_full_assembly "$WORK_DIR/$name" "$name, no cache"
+    compare_with_full_assembly "$WORK_DIR/$name" "$name, unchanged"
+
+    # A line inserted at the top moves every address after it
+    { echo "FIRST: .data 7"; cat "$test.as"; } > "$WORK_DIR/$name.as"
+    compare_with_full_assembly "$WORK_DIR/$name" "$name, line inserted"
+
+    # A line removed from the middle
+    sed '5d' "$test.as" > "$WORK_DIR/$name.as"
+    compare_with_full_assembly "$WORK_DIR/$name" "$name, line removed"
+done
+
+# A program with many instructions of three words each
+{
+    echo "ARR: .data 1, 2, 3"
+    i=0
+    while [ $i -lt 400 ]; do
+        echo "mov ARR[1], ARR[2]"
+        i=$((i + 1))
+    done
+    echo "stop"
+} > "$WORK_DIR/long.as"
+compare_with_full_assembly "$WORK_DIR/long" "long, no cache"
+
+# Damage the cache file, a byte at a time: every byte of the header and of
+# the first sentences, and a few bytes of the rest
+size=$(wc -c < "$WORK_DIR/long.cache")
+cp "$WORK_DIR/long.cache" "$WORK_DIR/long.cache.good"
+offsets=$(seq 0 320)
+for offset in $offsets 1000 $((size / 2)) $((size - 1)); do
+    cp "$WORK_DIR/long.cache.good" "$WORK_DIR/long.cache"
+    printf '\001' | dd of="$WORK_DIR/long.cache" bs=1 seek=$offset conv=notrunc 2> /dev/null
+    compare_with_full_assembly "$WORK_DIR/long" "long, cache damaged at byte $offset"
+done
+
+# A truncated cache file
+head -c $((size / 3)) "$WORK_DIR/long.cache.good" > "$WORK_DIR/long.cache"
+compare_with_full_assembly "$WORK_DIR/long" "long, cache truncated"
+
+if [ $failures -ne 0 ]; then
+    echo "incremental_test: $failures failures"
+    exit 1
+fi
+
+echo "incremental_test: passed"
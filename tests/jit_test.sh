@@ -0,0 +1,22 @@
+#!/bin/sh
+# The JIT (-j) must run programs as the uncached engine (-d) does: the
+# same output, status and final machine (-m) at every step limit, with no
+# crash. The programs are those of simulator_helpers.sh and the random
+# programs of -f (on which -f compares the JIT with the interpreter),
+# whose seeds are fixed (1 to NUM_OF_PROGRAMS).
+# Run from the repository root after 'make' (or through 'make test').
+
+. tests/simulator_helpers.sh
+
+NUM_OF_PROGRAMS=${NUM_OF_PROGRAMS:-500}
+
+write_programs
+compare_with_uncached_engine -j
+
+if ! "$SIMULATOR" -s 2000 -f $NUM_OF_PROGRAMS 2> "$WORK_DIR/errors"; then
+    echo "FAIL: random programs:"
+    cat "$WORK_DIR/errors"
+    failures=$((failures + 1))
+fi
+
+finish_test jit_test
@@ -0,0 +1,89 @@
+#!/bin/sh
+# Instances run in lockstep lanes (-v) must end as separate runs of the
+# program do: every data segment is also written into a copy of the
+# source, the copies are run one by one, and the results lines must be
+# the same. The instances branch apart on their data, do not fill every
+# group of lanes, and some give fewer words than .data has.
+# Run from the repository root after 'make' (or through 'make test').
+
+. tests/simulator_helpers.sh
+
+NUM_OF_INSTANCES=${NUM_OF_INSTANCES:-40}
+MAX_STEPS=100000
+
+cat > "$WORK_DIR/lanes.as" << 'EOF'
+MAIN:   red     r1
+        mov     VALUES, r2
+        cmp     r2, #0
+        bne     LOOP
+        prn     #0
+        stop
+LOOP:   add     VALUES[1], r3
+        add     r1, r3
+        dec     r2
+        cmp     r2, #0
+        bne     LOOP
+        mov     r3, VALUES[2]
+        cmp     VALUES[3], #7
+        bne     DONE
+        jsr     SHOW
+DONE:   mov     r3, r7
+        prn     r7
+        stop
+SHOW:   prn     VALUES[2]
+        rts
+VALUES: .data   0, 0, 0, 0
+EOF
+"$ASSEMBLER" "$WORK_DIR/lanes"
+printf 'Q\n' > "$WORK_DIR/input"
+
+# A loop count, an addend, a word overwritten and whether to call SHOW;
+# every fifth instance gives only the first two
+awk -v count=$NUM_OF_INSTANCES 'BEGIN {
+    srand(20191);
+    for (i = 1; i <= count; ++i) {
+        line = int(rand() * 20) ", " (int(rand() * 4000) - 2000);
+        if (i % 5 != 0) {
+            line = line ", " int(rand() * 100) ", " (5 + int(rand() * 4));
+        }
+        print line;
+    }
+}' > "$WORK_DIR/data_segments"
+
+mkdir "$WORK_DIR/instances"
+instance=0
+while read -r words; do
+    instance=$((instance + 1))
+    # The words of the instance, then those of .data it does not give
+    echo "$words" | awk -F', ' '{
+        printf "VALUES: .data   ";
+        for (i = 1; i <= 4; ++i) {
+            printf "%s%s", (i > 1) ? ", " : "", (i <= NF) ? $i : 0;
+        }
+        printf "\n";
+    }' > "$WORK_DIR/values"
+    sed "/^VALUES:/{
+r $WORK_DIR/values
+d
+}" "$WORK_DIR/lanes.as" > "$WORK_DIR/instances/$instance.as"
+    "$ASSEMBLER" "$WORK_DIR/instances/$instance"
+    write_results_line $instance "$WORK_DIR/instances/$instance.ob" "$WORK_DIR/input"
+done < "$WORK_DIR/data_segments" > "$WORK_DIR/expected"
+
+for options in "" "-x" "-d"; do
+    if ! "$SIMULATOR" -s $MAX_STEPS $options -o "$WORK_DIR/results" -v "$WORK_DIR/data_segments" \
+            "$WORK_DIR/lanes" < "$WORK_DIR/input" 2> "$WORK_DIR/errors"; then
+        echo "FAIL: -v $options did not run every instance to its stop:"
+        cat "$WORK_DIR/errors"
+        failures=$((failures + 1))
+    fi
+
+    compare_results "$WORK_DIR/expected" "$WORK_DIR/results" "the lanes (-v $options)"
+done
+
+if [ $(wc -l < "$WORK_DIR/expected") -ne $NUM_OF_INSTANCES ]; then
+    echo "FAIL: not every instance ran separately"
+    failures=$((failures + 1))
+fi
+
+finish_test lanes_test
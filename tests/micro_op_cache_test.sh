@@ -0,0 +1,12 @@
+#!/bin/sh
+# The micro-op cache engine must end where the uncached engine (-d) ends:
+# the same output, status, registers, flags, return stack and memory (-m),
+# at every step limit. The programs are those of simulator_helpers.sh.
+# Run from the repository root after 'make' (or through 'make test').
+
+. tests/simulator_helpers.sh
+
+write_programs
+compare_with_uncached_engine
+
+finish_test micro_op_cache_test
@@ -0,0 +1,109 @@
+#!/bin/sh
+# The binary object format must keep everything of the text files: an
+# .ob/.ent/.ext turned into a .bin (objconv -b) and back (objconv -t) must
+# be byte-identical, and the .bin must be the one 'assembler -b' writes.
+# Sources: tests/*.as and a corpus of random programs (a fixed seed).
+# Run from the repository root after 'make' (or through 'make test').
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+OBJCONV=${OBJCONV:-./objconv}
+NUM_OF_PROGRAMS=${NUM_OF_PROGRAMS:-100}
+WORK_DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+failures=0
+
+mkdir "$WORK_DIR/text" "$WORK_DIR/binary" "$WORK_DIR/back"
+cp tests/*.as "$WORK_DIR/text/"
+
+# Programs with every operation and addressing method, labels, data,
+# strings, macros, entries and externals
+awk -v dir="$WORK_DIR/text" -v count=$NUM_OF_PROGRAMS 'BEGIN {
+    srand(20191);
+    split("mov cmp add sub lea", twoOperands, " ");
+    split("not clr inc dec red prn jmp bne jsr", oneOperand, " ");
+    for (p = 0; p < count; ++p) {
+        file = dir "/random" p ".as";
+        numOfLabels = 1 + int(rand() * 8);
+        numOfLines = 1 + int(rand() * 60);
+        print ".define SZ = " int(rand() * 3) > file;
+        print ".extern EXT" p > file;
+        for (i = 0; i < numOfLines; ++i) {
+            line = (rand() < 0.3 && i < numOfLabels) ? "C" i ": " : "        ";
+            if (rand() < 0.15) {
+                line = line (rand() < 0.5 ? "rts" : "stop");
+            } else if (rand() < 0.5) {
+                op = twoOperands[1 + int(rand() * 5)];
+                line = line op " " operand(op == "lea" ? "memory" : "all") ", " operand("writable");
+            } else {
+                op = oneOperand[1 + int(rand() * 9)];
+                kind = (op == "prn") ? "all" : (op ~ /^(jmp|bne|jsr)$/) ? "jump" : "writable";
+                line = line op " " operand(kind);
+            }
+            print line > file;
+        }
+        print "        stop" > file;
+        for (i = 0; i < numOfLabels; ++i) {
+            if (rand() < 0.5) {
+                print "D" i ":     .data   " int(rand() * 4000) - 2000 ", SZ, " int(rand() * 100) > file;
+            } else {
+                print "D" i ":     .string \"s" i "x\"" > file;
+            }
+        }
+        if (rand() < 0.7) {
+            print ".entry D0" > file;
+        }
+        close(file);
+    }
+}
+
+function operand(kind,    r) {
+    r = rand();
+    if (kind == "all" && r < 0.25) {
+        return (rand() < 0.5) ? "#" (int(rand() * 200) - 100) : "#SZ";
+    }
+    if (kind != "memory" && r < 0.5) {
+        return "r" int(rand() * 8);
+    }
+    if (kind != "jump" && r < 0.75) {
+        return "D" int(rand() * numOfLabels) "[" (rand() < 0.5 ? "SZ" : "1") "]";
+    }
+    return (rand() < 0.2) ? "EXT" p : "D" int(rand() * numOfLabels);
+}'
+
+for source in "$WORK_DIR"/text/*.as; do
+    name=$(basename "$source" .as)
+    if ! "$ASSEMBLER" "$WORK_DIR/text/$name" 2> /dev/null || [ ! -f "$WORK_DIR/text/$name.ob" ]; then
+        continue # Sources that do not assemble have nothing to convert
+    fi
+
+    "$OBJCONV" -b "$WORK_DIR/text/$name"
+    cp "$WORK_DIR/text/$name.bin" "$WORK_DIR/back/"
+    "$OBJCONV" -t "$WORK_DIR/back/$name"
+    for postfix in ob ent ext; do
+        if [ -f "$WORK_DIR/text/$name.$postfix" ] || [ -f "$WORK_DIR/back/$name.$postfix" ]; then
+            if ! cmp -s "$WORK_DIR/text/$name.$postfix" "$WORK_DIR/back/$name.$postfix"; then
+                echo "FAIL: $name.$postfix differs after .bin and back"
+                failures=$((failures + 1))
+            fi
+        fi
+    done
+
+    cp "$source" "$WORK_DIR/binary/"
+    "$ASSEMBLER" -b "$WORK_DIR/binary/$name" 2> /dev/null
+    if ! cmp -s "$WORK_DIR/text/$name.bin" "$WORK_DIR/binary/$name.bin"; then
+        echo "FAIL: $name.bin of objconv -b differs from that of assembler -b"
+        failures=$((failures + 1))
+    fi
+done
+
+if [ $(ls "$WORK_DIR"/back/*.bin | wc -l) -lt $NUM_OF_PROGRAMS ]; then
+    echo "FAIL: too few of the sources assembled"
+    failures=$((failures + 1))
+fi
+
+if [ $failures -ne 0 ]; then
+    echo "object_file_test: $failures failures"
+    exit 1
+fi
+
+echo "object_file_test: passed"
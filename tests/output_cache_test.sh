@@ -0,0 +1,69 @@
+#!/bin/sh
+# An assembly with an output cache (-r) must write the same files and
+# messages as one without: from a new entry, from a whole entry, and from
+# an entry that lost some of its files.
+# Run from the repository root after 'make' (or through 'make test').
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+WORK_DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+CACHE_DIR="$WORK_DIR/cache"
+failures=0
+
+# Assembles $1.as with and without the cache, and compares the files
+compare_with_assembly()
+{
+    mkdir -p "$WORK_DIR/plain"
+    cp "$1.as" "$WORK_DIR/plain/"
+    name=$(basename "$1")
+    rm -f "$1.ob" "$1.ent" "$1.ext"
+    "$ASSEMBLER" "$WORK_DIR/plain/$name" 2> "$WORK_DIR/plain/$name.err"
+    "$ASSEMBLER" -r "$CACHE_DIR" "$1" 2> "$1.err"
+
+    for postfix in ob ent ext err; do
+        if [ -f "$WORK_DIR/plain/$name.$postfix" ] || [ -f "$1.$postfix" ]; then
+            sed "s#$WORK_DIR/plain/##g" "$WORK_DIR/plain/$name.$postfix" > "$WORK_DIR/expected" 2> /dev/null
+            sed "s#$WORK_DIR/##g" "$1.$postfix" > "$WORK_DIR/actual" 2> /dev/null
+            if ! cmp -s "$WORK_DIR/expected" "$WORK_DIR/actual"; then
+                echo "FAIL: $2: $name.$postfix differs from an assembly without the cache"
+                failures=$((failures + 1))
+            fi
+        fi
+    done
+
+    rm -rf "$WORK_DIR/plain"
+}
+
+# A program with entries, externs and a warning
+{
+    echo "MAIN: mov r1, r2"
+    echo "LABEL: .extern EXT"
+    echo ".entry MAIN"
+    echo "jmp EXT"
+    echo "stop"
+} > "$WORK_DIR/prog.as"
+
+for test in tests/test1 tests/test2 tests/test3 "$WORK_DIR/prog"; do
+    name=$(basename "$test")
+    [ "$test" = "$WORK_DIR/prog" ] || cp "$test.as" "$WORK_DIR/$name.as"
+    compare_with_assembly "$WORK_DIR/$name" "$name, new entry"
+    compare_with_assembly "$WORK_DIR/$name" "$name, whole entry"
+
+    # Every file of an entry, removed in turn from a whole entry
+    for file in "$CACHE_DIR"/*/output.*; do
+        [ -f "$file" ] || continue
+        cp "$file" "$WORK_DIR/saved"
+        rm -f "$file"
+        compare_with_assembly "$WORK_DIR/$name" "$name, entry without $(basename "$file")"
+        [ -f "$file" ] || cp "$WORK_DIR/saved" "$file"
+    done
+
+    rm -rf "$CACHE_DIR"
+done
+
+if [ $failures -ne 0 ]; then
+    echo "output_cache_test: $failures failures"
+    exit 1
+fi
+
+echo "output_cache_test: passed"
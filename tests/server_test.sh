@@ -0,0 +1,86 @@
+#!/bin/sh
+# The server (-d) must not replace a file that is not a socket, nor the
+# socket of a running server, and must replace a stale socket. Files sent
+# through the client (-c) must be those of a local assembly.
+# Run from the repository root after 'make' (or through 'make test').
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+WORK_DIR=$(mktemp -d) || exit 1
+SOCKET="$WORK_DIR/assembler.sock"
+server=
+trap '[ -z "$server" ] || kill $server 2> /dev/null; rm -rf "$WORK_DIR"' EXIT
+failures=0
+
+fail()
+{
+    echo "FAIL: $1"
+    failures=$((failures + 1))
+}
+
+# Starts a server and waits for its socket
+start_server()
+{
+    "$ASSEMBLER" -d "$SOCKET" -j 2 2> /dev/null &
+    server=$!
+    tries=0
+    while [ ! -S "$SOCKET" ] && [ $tries -lt 50 ]; do
+        sleep 0.1
+        tries=$((tries + 1))
+    done
+}
+
+# A server that must refuse to start; fails when it is still running
+refused_server()
+{
+    "$ASSEMBLER" -d "$SOCKET" 2> "$WORK_DIR/refused.err" &
+    refused=$!
+    sleep 1
+    if kill $refused 2> /dev/null; then
+        fail "$1"
+    fi
+    wait $refused 2> /dev/null
+}
+
+stop_server()
+{
+    kill $server 2> /dev/null
+    wait $server 2> /dev/null
+    server=
+}
+
+echo "not a socket" > "$SOCKET"
+refused_server "a server started on a regular file"
+[ -f "$SOCKET" ] && [ "$(cat "$SOCKET")" = "not a socket" ] || fail "a regular file was replaced"
+rm -f "$SOCKET"
+
+start_server
+refused_server "a second server started on the socket of a running one"
+grep -q "already running" "$WORK_DIR/refused.err" || fail "a second server did not report the running one"
+
+cp tests/test1.as tests/test2.as "$WORK_DIR/"
+mkdir "$WORK_DIR/local"
+cp tests/test1.as tests/test2.as "$WORK_DIR/local/"
+"$ASSEMBLER" -c "$SOCKET" "$WORK_DIR/test1" "$WORK_DIR/test2" 2> "$WORK_DIR/served.err"
+"$ASSEMBLER" "$WORK_DIR/local/test1" "$WORK_DIR/local/test2" 2> "$WORK_DIR/local.err"
+for file in test1.ob test1.ent test1.ext test2.ob; do
+    cmp -s "$WORK_DIR/$file" "$WORK_DIR/local/$file" || fail "$file differs from a local assembly"
+done
+cmp -s "$WORK_DIR/served.err" "$WORK_DIR/local.err" || fail "the messages differ from a local assembly"
+
+# A killed server leaves its socket behind
+stop_server
+start_server
+if [ -z "$server" ] || ! kill -0 $server 2> /dev/null; then
+    fail "a server did not replace a stale socket"
+fi
+rm -f "$WORK_DIR/test1.ob"
+"$ASSEMBLER" -c "$SOCKET" "$WORK_DIR/test1" 2> /dev/null
+[ -f "$WORK_DIR/test1.ob" ] || fail "no files from a server on a replaced socket"
+stop_server
+
+if [ $failures -ne 0 ]; then
+    echo "server_test: $failures failures"
+    exit 1
+fi
+
+echo "server_test: passed"
@@ -0,0 +1,160 @@
+# The fixture and the comparisons shared by the tests of the simulator
+# engines. Sourced (not run) by them from the repository root: it makes
+# WORK_DIR, and the functions count what fails in $failures.
+
+ASSEMBLER=${ASSEMBLER:-./assembler}
+SIMULATOR=${SIMULATOR:-./simulator}
+WORK_DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+failures=0
+
+# tests/test2 loops forever, so every run is bounded
+STEP_LIMITS="1 2 3 5 8 13 21 34 55 89 1000 100000"
+
+# Assembles tests/*.as and a program that reads input, calls, uses the
+# lowest and the highest register and writes its own code, in WORK_DIR.
+# PROGRAMS lists the ones that assembled (without a postfix).
+write_programs()
+{
+    cp tests/*.as "$WORK_DIR/"
+    cat > "$WORK_DIR/patched.as" << 'EOF'
+.define N = 40
+MAIN:   red     r1
+        prn     r1
+        mov     #N, r2
+        mov     #-1, r0
+LOOP:   add     #1, COUNT
+        jsr     SUB
+        dec     r2
+        cmp     r2, #0
+        bne     LOOP
+        mov     SUB, SLOT
+        mov     COUNT, SLOT[1]
+SLOT:   prn     #1
+        mov     COUNT, r3
+        red     r4
+        stop
+SUB:    add     r1, r7
+        prn     COUNT
+        rts
+COUNT:  .data   0
+EOF
+
+    PROGRAMS=""
+    for source in "$WORK_DIR"/*.as; do
+        "$ASSEMBLER" "${source%.as}" 2> /dev/null
+        if [ -f "${source%.as}.ob" ]; then
+            PROGRAMS="$PROGRAMS ${source%.as}"
+        fi
+    done
+}
+
+# Runs every program of PROGRAMS with the engine options (the arguments)
+# and with the uncached engine (-d) at every step limit, and compares the
+# output, the exit status and the final machine (-m)
+compare_with_uncached_engine()
+{
+    for program in $PROGRAMS; do
+        for maxSteps in $STEP_LIMITS; do
+            echo "ab" | "$SIMULATOR" -s $maxSteps -m "$@" "$program" \
+                > "$WORK_DIR/engine.out" 2> "$WORK_DIR/engine.err"
+            echo "exit status: $?" >> "$WORK_DIR/engine.err"
+            echo "ab" | "$SIMULATOR" -s $maxSteps -m -d "$program" \
+                > "$WORK_DIR/uncached.out" 2> "$WORK_DIR/uncached.err"
+            echo "exit status: $?" >> "$WORK_DIR/uncached.err"
+
+            if ! cmp -s "$WORK_DIR/engine.out" "$WORK_DIR/uncached.out" ||
+               ! cmp -s "$WORK_DIR/engine.err" "$WORK_DIR/uncached.err"; then
+                echo "FAIL: $(basename "$program"), $maxSteps steps: $* and -d end differently"
+                diff "$WORK_DIR/engine.err" "$WORK_DIR/uncached.err" | head -10
+                failures=$((failures + 1))
+            fi
+        done
+    done
+}
+
+# Writes the results line (as -p and -v write it) of a separate run of the
+# program $2 (an .ob or .as, assembled) with the input file $3, named $1,
+# for up to MAX_STEPS steps. The pc of a program that stopped is '-': a
+# separate run does not print it.
+write_results_line()
+{
+    "$SIMULATOR" -s $MAX_STEPS -m "${2%.*}" < "${3:-/dev/null}" \
+        > "$WORK_DIR/output" 2> "$WORK_DIR/machine"
+    od -An -v -tu1 "$WORK_DIR/output" | awk -v name="$1" -v machine="$WORK_DIR/machine" '
+        BEGIN {
+            hash = 2166136261;
+        }
+        {
+            for (i = 1; i <= NF; ++i) {
+                hash = XorByte(hash, $i);
+                hash = ((hash % 256) * 16777216 + hash * 403) % 4294967296;
+                ++size;
+            }
+        }
+        END {
+            status = "stopped";
+            pc = "-";
+            while ((getline line < machine) > 0) {
+                if (line ~ /: out of steps at address /) {
+                    status = "steps";
+                } else if (line ~ /: illegal instruction at address /) {
+                    status = "illegal";
+                } else if (line ~ /: address out of memory at address /) {
+                    status = "address";
+                } else if (line ~ /: return stack error at address /) {
+                    status = "stack";
+                }
+                if (line ~ / at address [0-9]+$/) {
+                    pc = line;
+                    sub(/.* at address /, "", pc);
+                } else if (line ~ /^steps: /) {
+                    steps = substr(line, 8);
+                } else if (line ~ /^zero flag: /) {
+                    zeroFlag = substr(line, 12);
+                } else if (line ~ /^registers: /) {
+                    registers = substr(line, 12);
+                }
+            }
+            printf "%s %s %s %s %s %s %08x %d\n", name, status, pc, steps, zeroFlag, registers, hash, size;
+        }
+
+        # hash with its low byte xored with the byte
+        function XorByte(hash, byte,    low, xored, bit) {
+            low = hash % 256;
+            xored = 0;
+            for (bit = 128; bit >= 1; bit /= 2) {
+                if ((low >= bit) != (byte >= bit)) {
+                    xored += bit;
+                }
+                low %= bit;
+                byte %= bit;
+            }
+            return hash - hash % 256 + xored;
+        }'
+}
+
+# Compares the results file $2 of -p or -v (described by $3) with the
+# results lines of the separate runs in $1 (the pc of a program that
+# stopped is not compared)
+compare_results()
+{
+    grep -v '^#' "$2" | awk '$2 == "stopped" { $3 = "-" } { print }' > "$WORK_DIR/actual"
+    if ! cmp -s "$1" "$WORK_DIR/actual"; then
+        echo "FAIL: $3 and the separate runs differ:"
+        diff "$1" "$WORK_DIR/actual"
+        failures=$((failures + 1))
+    fi
+}
+
+# Exits with the status of the test named $1
+finish_test()
+{
+    if [ $failures -ne 0 ]; then
+        echo "$1: $failures failures"
+        exit 1
+    fi
+
+    echo "$1: passed"
+    exit 0
+}
@@ -0,0 +1,117 @@
+#!/bin/sh
+# The shuffle word codecs must agree with the scalar codec: the same
+# encodings for the same words, the same words for the same encodings,
+# and the same count of words decoded before a bad encoding. Lengths run
+# past the vector widths so the scalar tails of the codecs are covered.
+# Codecs the processor does not support are skipped.
+# Run from the repository root after 'make' (or through 'make test').
+
+CC=${CC:-cc}
+WORK_DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+cat > "$WORK_DIR/word_codec_check.c" << 'EOF'
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "word_encoding.h"
+
+#define MAX_NUM_OF_WORDS (3 * WORD_BATCH_SIZE + 5)
+
+static unsigned short words[MAX_NUM_OF_WORDS];
+static unsigned short expectedWords[MAX_NUM_OF_WORDS];
+static unsigned short actualWords[MAX_NUM_OF_WORDS];
+static char expectedEncodings[MAX_NUM_OF_WORDS * ENCODED_WORD_STRIDE];
+static char actualEncodings[MAX_NUM_OF_WORDS * ENCODED_WORD_STRIDE];
+
+/* Returns the number of disagreements of the codec with the scalar codec
+ * on the first numOfWords words */
+static int CheckCodec(WordCodec codec, size_t numOfWords)
+{
+    int failures = 0;
+    size_t badIndex;
+
+    memset(expectedEncodings, '?', sizeof(expectedEncodings));
+    memset(actualEncodings, '?', sizeof(actualEncodings));
+    EncodeWords(SCALAR_WORD_CODEC, expectedEncodings, words, numOfWords);
+    EncodeWords(codec, actualEncodings, words, numOfWords);
+    if (0 != memcmp(expectedEncodings, actualEncodings, sizeof(expectedEncodings)))
+    {
+        printf("FAIL: %s encodes %d words differently\n", GetWordCodecName(codec), (int)numOfWords);
+        ++failures;
+    }
+
+    if (numOfWords != DecodeWords(codec, actualWords, expectedEncodings, numOfWords) ||
+        0 != memcmp(words, actualWords, numOfWords * sizeof(*words)))
+    {
+        printf("FAIL: %s decodes %d words differently\n", GetWordCodecName(codec), (int)numOfWords);
+        ++failures;
+    }
+
+    for (badIndex = 0; badIndex < numOfWords; badIndex += 1 + badIndex / 3)
+    {
+        char *badDigit = expectedEncodings + badIndex * ENCODED_WORD_STRIDE + badIndex % ENCODED_WORD_SIZE;
+        char digit = *badDigit;
+        size_t expectedCount, actualCount;
+
+        *badDigit = 'x';
+        expectedCount = DecodeWords(SCALAR_WORD_CODEC, expectedWords, expectedEncodings, numOfWords);
+        actualCount = DecodeWords(codec, actualWords, expectedEncodings, numOfWords);
+        *badDigit = digit;
+        if (expectedCount != actualCount ||
+            0 != memcmp(expectedWords, actualWords, actualCount * sizeof(*words)))
+        {
+            printf("FAIL: %s decodes %d words with a bad word %d differently\n",
+                   GetWordCodecName(codec),
+                   (int)numOfWords,
+                   (int)badIndex);
+            ++failures;
+        }
+    }
+
+    return failures;
+}
+
+int main(void)
+{
+    int failures = 0, codec;
+    size_t i, numOfWords;
+
+    srand(20191);
+    for (i = 0; i < MAX_NUM_OF_WORDS; ++i)
+    {
+        /* The extremes first, then any value of a memory word */
+        words[i] = (unsigned short)((i < 2) ? i * MEMORY_WORD_MASK : rand() & MEMORY_WORD_MASK);
+    }
+
+    for (codec = SCALAR_WORD_CODEC + 1; codec < NUM_OF_WORD_CODECS; ++codec)
+    {
+        if (!IsWordCodecSupported((WordCodec)codec))
+        {
+            printf("%s: not supported, skipped\n", GetWordCodecName((WordCodec)codec));
+            continue;
+        }
+
+        for (numOfWords = 0; numOfWords <= MAX_NUM_OF_WORDS; ++numOfWords)
+        {
+            failures += CheckCodec((WordCodec)codec, numOfWords);
+        }
+    }
+
+    return (0 == failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+EOF
+
+if ! $CC -ansi -pedantic -Wall -Iinclude "$WORK_DIR/word_codec_check.c" \
+        -Llib -lassembler -pthread -o "$WORK_DIR/word_codec_check"; then
+    echo "word_codec_test: the check does not compile"
+    exit 1
+fi
+
+if ! "$WORK_DIR/word_codec_check"; then
+    echo "word_codec_test: failed"
+    exit 1
+fi
+
+echo "word_codec_test: passed"